@@ -27,6 +27,7 @@ struct IUnknown;
 #include <commctrl.h>
 #include "Helpers.h"
 #include "Dlapi.h"
+#include "IconCache.h"
 #include "DropSource.h"
 
 //==== DirList ================================================================
@@ -252,37 +253,82 @@ int DirList_Fill(HWND hwnd, LPCWSTR lpszDir, DWORD grfFlags, LPCWSTR lpszFileSpe
 	return ListView_GetItemCount(hwnd);
 }
 
-//=============================================================================
-//
-//  DirList_IconThread()
-//
-//  Thread to extract file icons in the background
-//
-DWORD WINAPI DirList_IconThread(LPVOID lpParam) {
-	DLDATA * const lpdl = static_cast<DLDATA *>(lpParam);
-	const BackgroundWorker &worker = lpdl->worker;
+//==== DirList Icon Threads ===================================================
+// icons are resolved by a small pool of threads sharing the work queue and the
+// file type cache from IconCache.h, only items whose icon can differ per file
+// are resolved individually.
+#define DL_ICONTHREAD_MAX		4
+#define DL_ICONTHREAD_ITEMS		256		// minimum number of items for each extra thread
+
+struct DLICONWORKER {
+	DLDATA *lpdl;
+	IconWorkQueue queue;
+	IconTypeCache cache;
+};
 
-	// Exit immediately if DirList_Fill() hasn't been called
-	if (!lpdl->lpsf) {
-		return 0;
+// items whose icon is stored inside the file or depends on link target.
+static bool DirList_IsIconPerFile(LPCWSTR lpszExt, DWORD dwAttributes) noexcept {
+	if (dwAttributes & SFGAO_LINK) {
+		return true;
+	}
+	if (dwAttributes & SFGAO_FOLDER) {
+		// desktop.ini in read-only or system folder may specify custom icon
+		return (dwAttributes & (SFGAO_READONLY | SFGAO_SYSTEM)) != 0;
 	}
+	static const LPCWSTR extensionList[] = {
+		L".exe", L".lnk", L".ico", L".cur", L".ani", L".url", L".scr", L".cpl", L".msc", L".pif", L".appref-ms",
+	};
+	for (LPCWSTR ext : extensionList) {
+		if (StrCaseEqual(lpszExt, ext)) {
+			return true;
+		}
+	}
+	return false;
+}
 
+static DWORD WINAPI DirList_IconWorker(LPVOID lpParam) {
+	DLICONWORKER * const lpiw = static_cast<DLICONWORKER *>(lpParam);
+	DLDATA * const lpdl = lpiw->lpdl;
+	const BackgroundWorker &worker = lpdl->worker;
 	HWND hwnd = worker.hwnd;
-	const int iMaxItem = ListView_GetItemCount(hwnd);
 
 	// Get IShellIcon
 	IShellIcon *lpshi;
 	lpdl->lpsf->QueryInterface(IID_IShellIcon, AsPPVArgs(&lpshi));
 
-	int iItem = 0;
-	while (iItem < iMaxItem && worker.Continue()) {
+	int iItem;
+	while (worker.Continue() && (iItem = lpiw->queue.Take()) >= 0) {
 		LV_ITEM lvi;
 		lvi.iItem = iItem;
+		lvi.iSubItem = 0;
 		lvi.mask = LVIF_PARAM;
-		if (ListView_GetItem(hwnd, &lvi)) {
-			LV_ITEMDATA *lplvid = AsPointer<LV_ITEMDATA *>(lvi.lParam);
-			lvi.mask = LVIF_IMAGE;
+		if (!ListView_GetItem(hwnd, &lvi)) {
+			continue;
+		}
+
+		LV_ITEMDATA *lplvid = AsPointer<LV_ITEMDATA *>(lvi.lParam);
+		lvi.mask = LVIF_IMAGE;
+
+		// Link and Share Overlay, file type
+		DWORD dwAttributes = SFGAO_LINK | SFGAO_SHARE | SFGAO_FOLDER | SFGAO_STREAM | SFGAO_READONLY | SFGAO_SYSTEM;
+		if (S_OK != lplvid->lpsf->GetAttributesOf(1, reinterpret_cast<PCUITEMID_CHILD_ARRAY>(&lplvid->pidl), &dwAttributes)) {
+			dwAttributes = 0;
+		}
+
+		IconTypeCache::Entry *entry = nullptr;
+		WCHAR szName[MAX_PATH];
+		if (IL_GetDisplayName(lplvid->lpsf, lplvid->pidl, SHGDN_INFOLDER | SHGDN_FORPARSING, szName, MAX_PATH)) {
+			// zip files are folders with stream
+			const bool folder = (dwAttributes & (SFGAO_FOLDER | SFGAO_STREAM)) == SFGAO_FOLDER;
+			LPCWSTR lpszExt = folder ? L"" : PathFindExtension(szName);
+			if (!DirList_IsIconPerFile(lpszExt, dwAttributes)) {
+				entry = lpiw->cache.Find(lpszExt, folder);
+			}
+		}
 
+		if (entry && entry->Icon() >= 0) {
+			lvi.iImage = entry->Icon();
+		} else {
 			if (!lpshi || S_OK != lpshi->GetIconOf(reinterpret_cast<PCUITEMID_CHILD>(lplvid->pidl), GIL_FORSHELL, &lvi.iImage)) {
 				SHFILEINFO shfi;
 				LPITEMIDLIST pidl = IL_Create(lpdl->pidl, lpdl->cbidl, lplvid->pidl, 0);
@@ -290,48 +336,88 @@ DWORD WINAPI DirList_IconThread(LPVOID lpParam) {
 				CoTaskMemFree(pidl);
 				lvi.iImage = shfi.iIcon;
 			}
+			if (entry) {
+				entry->SetIcon(lvi.iImage);
+			}
+		}
 
-			// It proved necessary to reset the state bits...
-			lvi.stateMask = 0;
-			lvi.state = 0;
-
-			DWORD dwAttributes = SFGAO_LINK | SFGAO_SHARE;
-			// Link and Share Overlay
-			lplvid->lpsf->GetAttributesOf(1, reinterpret_cast<PCUITEMID_CHILD_ARRAY>(&lplvid->pidl), &dwAttributes);
+		// It proved necessary to reset the state bits...
+		lvi.stateMask = 0;
+		lvi.state = 0;
 
-			if (dwAttributes & SFGAO_LINK) {
-				lvi.mask |= LVIF_STATE;
-				lvi.stateMask |= LVIS_OVERLAYMASK;
-				lvi.state |= INDEXTOOVERLAYMASK(2);
-			}
+		if (dwAttributes & SFGAO_LINK) {
+			lvi.mask |= LVIF_STATE;
+			lvi.stateMask |= LVIS_OVERLAYMASK;
+			lvi.state |= INDEXTOOVERLAYMASK(2);
+		}
 
-			if (dwAttributes & SFGAO_SHARE) {
-				lvi.mask |= LVIF_STATE;
-				lvi.stateMask |= LVIS_OVERLAYMASK;
-				lvi.state |= INDEXTOOVERLAYMASK(1);
-			}
+		if (dwAttributes & SFGAO_SHARE) {
+			lvi.mask |= LVIF_STATE;
+			lvi.stateMask |= LVIS_OVERLAYMASK;
+			lvi.state |= INDEXTOOVERLAYMASK(1);
+		}
 
-			// Fade hidden/system files
-			if (!lpdl->bNoFadeHidden) {
-				WIN32_FIND_DATA fd;
-				if (S_OK == SHGetDataFromIDList(lplvid->lpsf, reinterpret_cast<PCUITEMID_CHILD>(lplvid->pidl), SHGDFIL_FINDDATA, &fd, sizeof(WIN32_FIND_DATA))) {
-					if ((fd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) || (fd.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM)) {
-						lvi.mask |= LVIF_STATE;
-						lvi.stateMask |= LVIS_CUT;
-						lvi.state |= LVIS_CUT;
-					}
+		// Fade hidden/system files
+		if (!lpdl->bNoFadeHidden) {
+			WIN32_FIND_DATA fd;
+			if (S_OK == SHGetDataFromIDList(lplvid->lpsf, reinterpret_cast<PCUITEMID_CHILD>(lplvid->pidl), SHGDFIL_FINDDATA, &fd, sizeof(WIN32_FIND_DATA))) {
+				if ((fd.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN) || (fd.dwFileAttributes & FILE_ATTRIBUTE_SYSTEM)) {
+					lvi.mask |= LVIF_STATE;
+					lvi.stateMask |= LVIS_CUT;
+					lvi.state |= LVIS_CUT;
 				}
 			}
-			lvi.iSubItem = 0;
-			ListView_SetItem(hwnd, &lvi);
 		}
-		iItem++;
+		ListView_SetItem(hwnd, &lvi);
 	}
 
 	if (lpshi) {
 		lpshi->Release();
 	}
+	return 0;
+}
+
+//=============================================================================
+//
+//  DirList_IconThread()
+//
+//  Thread to extract file icons in the background
+//
+DWORD WINAPI DirList_IconThread(LPVOID lpParam) {
+	DLDATA * const lpdl = static_cast<DLDATA *>(lpParam);
+
+	// Exit immediately if DirList_Fill() hasn't been called
+	if (!lpdl->lpsf) {
+		return 0;
+	}
 
+	DLICONWORKER iw;
+	HWND hwnd = lpdl->worker.hwnd;
+	const int iMaxItem = ListView_GetItemCount(hwnd);
+	iw.lpdl = lpdl;
+	// start with visible items, then items below them, finally wrap around to the first item
+	iw.queue.Reset(iMaxItem, ListView_GetTopIndex(hwnd));
+
+	SYSTEM_INFO info;
+	GetNativeSystemInfo(&info);
+	const int iThreads = min(min(static_cast<int>(info.dwNumberOfProcessors), DL_ICONTHREAD_MAX), 1 + iMaxItem/DL_ICONTHREAD_ITEMS);
+	HANDLE hThreads[DL_ICONTHREAD_MAX - 1];
+	DWORD dwCount = 0;
+	for (int i = 1; i < iThreads; i++) {
+		HANDLE hThread = CreateThread(nullptr, 0, DirList_IconWorker, &iw, 0, nullptr);
+		if (hThread) {
+			hThreads[dwCount++] = hThread;
+		}
+	}
+
+	DirList_IconWorker(&iw);
+	if (dwCount != 0) {
+		// BackgroundWorker::Stop() keeps dispatching messages sent by the helper threads
+		WaitForMultipleObjects(dwCount, hThreads, TRUE, INFINITE);
+		for (DWORD i = 0; i < dwCount; i++) {
+			CloseHandle(hThreads[i]);
+		}
+	}
 	return 0;
 }
 
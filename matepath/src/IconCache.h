@@ -0,0 +1,132 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#pragma once
+
+#include <atomic>
+
+// Work queue and file type icon cache shared by icon threads of the directory list,
+// they don't use Windows API and can be tested standalone.
+
+// hands out list items to icon threads: visible items first, then items
+// below them, finally wrap around to the first item.
+class IconWorkQueue {
+	std::atomic<int> next {0};
+	int count = 0;
+	int top = 0;
+
+public:
+	void Reset(int count_, int top_) noexcept {
+		count = count_;
+		top = (top_ < 0 || top_ >= count_) ? 0 : top_;
+		next.store(0, std::memory_order_relaxed);
+	}
+	// returns -1 when all items are taken
+	int Take() noexcept {
+		const int sequence = next.fetch_add(1, std::memory_order_relaxed);
+		if (sequence >= count) {
+			return -1;
+		}
+		const int item = top + sequence;
+		return (item >= count) ? item - count : item;
+	}
+};
+
+// icons for most files only depend on file type, the icon is resolved once for each
+// extension and directory attribute, then reused for the remaining items.
+class IconTypeCache {
+public:
+	static constexpr unsigned Size = 256; // power of 2
+	static constexpr unsigned MaxExtension = 16;
+
+	class Entry {
+		friend class IconTypeCache;
+		std::atomic<int> state {Empty};
+		std::atomic<int> icon {-1};
+		bool folder = false;
+		wchar_t extension[MaxExtension] {};
+
+	public:
+		// -1 when the icon is not resolved yet, other thread may resolve it at same time.
+		int Icon() const noexcept {
+			return icon.load(std::memory_order_relaxed);
+		}
+		void SetIcon(int value) noexcept {
+			icon.store(value, std::memory_order_relaxed);
+		}
+	};
+
+	// returns entry for the file type (extension including the dot, empty for folder),
+	// nullptr when the type can't be cached.
+	Entry *Find(const wchar_t *ext, bool folder) noexcept {
+		wchar_t key[MaxExtension];
+		unsigned hash = folder ? 0x811C9DC5U : 0x050C5D1FU;
+		unsigned len = 0;
+		while (ext[len]) {
+			if (len + 1 == MaxExtension) {
+				return nullptr;
+			}
+			wchar_t ch = ext[len];
+			if (ch >= L'A' && ch <= L'Z') {
+				ch += L'a' - L'A';
+			}
+			key[len++] = ch;
+			hash = (hash ^ static_cast<unsigned>(ch)) * 0x01000193U;
+		}
+		key[len] = L'\0';
+
+		unsigned index = hash & (Size - 1);
+		while (true) {
+			Entry &entry = entries[index];
+			int state = entry.state.load(std::memory_order_acquire);
+			if (state == Empty) {
+				// keep at least one empty slot to terminate probing
+				if (used.fetch_add(1, std::memory_order_relaxed) + 1 >= Size) {
+					used.fetch_sub(1, std::memory_order_relaxed);
+					return nullptr;
+				}
+				if (entry.state.compare_exchange_strong(state, Claimed, std::memory_order_acquire)) {
+					entry.folder = folder;
+					for (unsigned i = 0; i <= len; i++) {
+						entry.extension[i] = key[i];
+					}
+					entry.state.store(Ready, std::memory_order_release);
+					return &entry;
+				}
+				// slot was taken by other thread
+				used.fetch_sub(1, std::memory_order_relaxed);
+			}
+			while (state != Ready) {
+				state = entry.state.load(std::memory_order_acquire);
+			}
+			if (entry.folder == folder && SameKey(entry.extension, key)) {
+				return &entry;
+			}
+			index = (index + 1) & (Size - 1);
+		}
+	}
+
+	unsigned Count() const noexcept {
+		return used.load(std::memory_order_relaxed);
+	}
+
+private:
+	enum {
+		Empty,
+		Claimed,
+		Ready,
+	};
+
+	static bool SameKey(const wchar_t *lhs, const wchar_t *rhs) noexcept {
+		while (*lhs == *rhs) {
+			if (*lhs == L'\0') {
+				return true;
+			}
+			++lhs;
+			++rhs;
+		}
+		return false;
+	}
+
+	Entry entries[Size];
+	std::atomic<unsigned> used {0};
+};
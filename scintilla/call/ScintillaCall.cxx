@@ -1170,6 +1170,10 @@ Position ScintillaCall::FindTextFull(Scintilla::FindOption searchFlags, TextToFi
 	return CallPointer(Message::FindTextFull, static_cast<uintptr_t>(searchFlags), ft);
 }
 
+Position ScintillaCall::FindTextAll(Scintilla::FindOption searchFlags, TextToFindAll *ft) {
+	return CallPointer(Message::FindTextAll, static_cast<uintptr_t>(searchFlags), ft);
+}
+
 Position ScintillaCall::FormatRangeFull(bool draw, const RangeToFormatFull *fr) {
 	return CallConstPointer(Message::FormatRangeFull, draw, fr);
 }
@@ -1438,6 +1442,10 @@ FindOption ScintillaCall::SearchFlags() {
 	return static_cast<Scintilla::FindOption>(Call(Message::GetSearchFlags));
 }
 
+void ScintillaCall::SetSearchStyleMask(void *styleMask) {
+	CallPointer(Message::SetSearchStyleMask, 0, styleMask);
+}
+
 void ScintillaCall::CallTipShow(Position pos, const char *definition) {
 	CallString(Message::CallTipShow, pos, definition);
 }
@@ -2510,6 +2518,14 @@ void ScintillaCall::Allocate(Position bytes) {
 	Call(Message::Allocate, bytes);
 }
 
+void ScintillaCall::CompressDocument() {
+	Call(Message::CompressDocument);
+}
+
+bool ScintillaCall::IsDocumentCompressed() {
+	return Call(Message::IsDocumentCompressed);
+}
+
 Position ScintillaCall::TargetAsUTF8(char *s) {
 	return CallPointer(Message::TargetAsUTF8, 0, s);
 }
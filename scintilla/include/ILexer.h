@@ -28,6 +28,7 @@ public:
 	virtual Sci_Position SCI_METHOD LineStart(Sci_Line line) const noexcept = 0;
 	virtual int SCI_METHOD GetLevel(Sci_Line line) const noexcept = 0;
 	virtual int SCI_METHOD SetLevel(Sci_Line line, int level) = 0;
+	virtual void SCI_METHOD SetLevels(Sci_Line lineStart, Sci_Line lineCount, const int *levels) = 0;
 	virtual int SCI_METHOD GetLineState(Sci_Line line) const noexcept = 0;
 	virtual int SCI_METHOD SetLineState(Sci_Line line, int state) = 0;
 	virtual void SCI_METHOD StartStyling(Sci_Position position) noexcept = 0;
@@ -99,6 +99,7 @@
 #define SCLEX_MATHEMATICA 225
 #define SCLEX_WINHEX 226
 #define SCLEX_CANGJIE 227
+#define SCLEX_LOG 228
 #define SCLEX_AUTOMATIC 1000
 #define SCE_PY_DEFAULT 0
 #define SCE_PY_COMMENTLINE 1
@@ -1898,4 +1899,15 @@
 #define SCE_CANGJIE_ENUM 29
 #define SCE_CANGJIE_FUNCTION_DEFINITION 30
 #define SCE_CANGJIE_FUNCTION 31
+#define SCE_LOG_DEFAULT 0
+#define SCE_LOG_DATETIME 1
+#define SCE_LOG_LEVEL_ERROR 2
+#define SCE_LOG_LEVEL_WARNING 3
+#define SCE_LOG_LEVEL_INFO 4
+#define SCE_LOG_LEVEL_DEBUG 5
+#define SCE_LOG_THREAD 6
+#define SCE_LOG_NUMBER 7
+#define SCE_LOG_STRING 8
+#define SCE_LOG_UNIQUE_ID 9
+#define SCE_LOG_STACKTRACE 10
 /* --Autogenerated -- end of section automatically generated from SciLexer.iface */
@@ -493,6 +493,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCFIND_POSIX 0x00400000
 #define SCFIND_CXX11REGEX 0x00800000
 #define SCI_FINDTEXTFULL 2196
+#define SCI_FINDTEXTALL 2805
 #define SCI_FORMATRANGEFULL 2777
 #define SC_CHANGE_HISTORY_DISABLED 0
 #define SC_CHANGE_HISTORY_ENABLED 1
@@ -560,6 +561,7 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_SEARCHINTARGET 2197
 #define SCI_SETSEARCHFLAGS 2198
 #define SCI_GETSEARCHFLAGS 2199
+#define SCI_SETSEARCHSTYLEMASK 2807
 #define SCI_CALLTIPSHOW 2200
 #define SCI_CALLTIPCANCEL 2201
 #define SCI_CALLTIPACTIVE 2202
@@ -922,6 +924,8 @@ typedef sptr_t (*SciFnDirectStatus)(sptr_t ptr, unsigned int iMessage, uptr_t wP
 #define SCI_AUTOCSETORDER 2660
 #define SCI_AUTOCGETORDER 2661
 #define SCI_ALLOCATE 2446
+#define SCI_COMPRESSDOCUMENT 2806
+#define SCI_ISDOCUMENTCOMPRESSED 2808
 #define SCI_TARGETASUTF8 2447
 #define SCI_SETLENGTHFORENCODE 2448
 #define SCI_ENCODEDFROMUTF8 2449
@@ -1307,6 +1311,13 @@ struct Sci_TextToFindFull {
 	struct Sci_CharacterRangeFull chrgText;
 };
 
+struct Sci_TextToFindAll {
+	struct Sci_CharacterRangeFull chrg;
+	const char *lpstrText;
+	struct Sci_CharacterRangeFull *ranges;
+	Sci_Position count;
+};
+
 typedef void *Sci_SurfaceID;
 
 struct Sci_Rectangle {
@@ -16,6 +16,7 @@ enum class Message;	// Declare in case ScintillaMessages.h not included
 // Declare in case ScintillaStructures.h not included
 struct TextRangeFull;
 struct TextToFindFull;
+struct TextToFindAll;
 struct RangeToFormatFull;
 
 class IDocumentEditable;
@@ -339,6 +340,7 @@ public:
 	void SetPrintColourMode(Scintilla::PrintOption mode);
 	Scintilla::PrintOption PrintColourMode();
 	Position FindTextFull(Scintilla::FindOption searchFlags, TextToFindFull *ft);
+	Position FindTextAll(Scintilla::FindOption searchFlags, TextToFindAll *ft);
 	Position FormatRangeFull(bool draw, const RangeToFormatFull *fr);
 	void SetChangeHistory(Scintilla::ChangeHistoryOption changeHistory);
 	Scintilla::ChangeHistoryOption ChangeHistory();
@@ -406,6 +408,7 @@ public:
 	Position SearchInTarget(Position length, const char *text);
 	void SetSearchFlags(Scintilla::FindOption searchFlags);
 	Scintilla::FindOption SearchFlags();
+	void SetSearchStyleMask(void *styleMask);
 	void CallTipShow(Position pos, const char *definition);
 	void CallTipCancel();
 	bool CallTipActive();
@@ -674,6 +677,8 @@ public:
 	void AutoCSetOrder(Scintilla::Ordering order);
 	Scintilla::Ordering AutoCGetOrder();
 	void Allocate(Position bytes);
+	void CompressDocument();
+	bool IsDocumentCompressed();
 	Position TargetAsUTF8(char *s);
 	std::string TargetAsUTF8();
 	void SetLengthForEncode(Position bytes);
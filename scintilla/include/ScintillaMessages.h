@@ -264,6 +264,7 @@ enum class Message {
 	SetPrintColourMode = 2148,
 	GetPrintColourMode = 2149,
 	FindTextFull = 2196,
+	FindTextAll = 2805,
 	FormatRangeFull = 2777,
 	SetChangeHistory = 2780,
 	GetChangeHistory = 2781,
@@ -327,6 +328,7 @@ enum class Message {
 	SearchInTarget = 2197,
 	SetSearchFlags = 2198,
 	GetSearchFlags = 2199,
+	SetSearchStyleMask = 2807,
 	CallTipShow = 2200,
 	CallTipCancel = 2201,
 	CallTipActive = 2202,
@@ -590,6 +592,8 @@ enum class Message {
 	AutoCSetOrder = 2660,
 	AutoCGetOrder = 2661,
 	Allocate = 2446,
+	CompressDocument = 2806,
+	IsDocumentCompressed = 2808,
 	TargetAsUTF8 = 2447,
 	SetLengthForEncode = 2448,
 	EncodedFromUTF8 = 2449,
@@ -26,6 +26,13 @@ struct TextToFindFull final {
 	CharacterRangeFull chrgText;
 };
 
+struct TextToFindAll final {
+	CharacterRangeFull chrg;
+	const char *lpstrText;
+	CharacterRangeFull *ranges;
+	Position count;
+};
+
 using SurfaceID = void *;
 
 struct Rectangle final {
@@ -700,7 +700,12 @@ void ColouriseCppDoc(Sci_PositionU startPos, Sci_Position length, int initStyle,
 			visibleChars++;
 		}
 		continuationLine = false;
-		sc.Forward();
+		if (sc.state == SCE_C_COMMENT || sc.state == SCE_C_COMMENTLINE) {
+			// only comment end and line continuation are significant
+			sc.ForwardUntil((sc.state == SCE_C_COMMENT) ? "*\\" : "\\");
+		} else {
+			sc.Forward();
+		}
 	}
 
 	sc.Complete();
@@ -97,6 +97,22 @@ constexpr bool IsSpaceEquiv(int state) noexcept {
 	return state <= SCE_JS_TASKMARKER;
 }
 
+// characters may start comment tag or end the comment
+constexpr const char *GetCommentStopChars(int state) noexcept {
+	switch (state) {
+	case SCE_JS_COMMENTLINE:
+		return "@";
+	case SCE_JS_COMMENTLINEDOC:
+		return "@<";
+	case SCE_JS_COMMENTBLOCK:
+		return "*@";
+	case SCE_JS_COMMENTBLOCKDOC:
+		return "*@{";
+	default:
+		return nullptr;
+	}
+}
+
 constexpr int GetStringQuote(int state) noexcept {
 	if (state == SCE_JS_STRING_BT) {
 		return '`';
@@ -575,7 +591,14 @@ void ColouriseJsDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyl
 			kwType = KeywordType::None;
 			docTagState = DocTagState::None;
 		}
-		sc.Forward();
+		const char *stopChars;
+		if (docTagState == DocTagState::None && visibleChars > visibleCharsBefore + 3
+			&& (stopChars = GetCommentStopChars(sc.state)) != nullptr) {
+			// task marker is only checked near comment start
+			sc.ForwardUntil(stopChars);
+		} else {
+			sc.Forward();
+		}
 	}
 
 	sc.Complete();
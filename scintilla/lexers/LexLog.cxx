@@ -0,0 +1,423 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+//! Lexer for application and server log files.
+
+#include <cassert>
+#include <cstring>
+
+#include <string>
+#include <string_view>
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+
+#include "WordList.h"
+#include "LexAccessor.h"
+#include "Accessor.h"
+#include "CharacterSet.h"
+#include "StringUtils.h"
+#include "LexerModule.h"
+
+using namespace Lexilla;
+
+namespace {
+
+// Every line is styled on its own without line state, so styling can restart on any line.
+// Record header (timestamp, level and bracketed fields like thread name) is classified
+// on a fixed size copy of the line start, the remaining text is scanned once for
+// strings, numbers and unique IDs.
+// Lines not started with timestamp or level are continuation of previous record
+// (stack trace, multi-line message), which are folded into the record.
+
+constexpr Sci_PositionU maxLogHeaderLength = 128;
+constexpr int maxLogHeaderFields = 6;
+constexpr int maxLogFieldLength = 64;
+constexpr int maxLogHeaderSpanCount = maxLogHeaderFields + 1;
+
+struct LogSpan {
+	int start;
+	int end;
+	int style;
+};
+
+struct LogHeader {
+	int spanCount;
+	bool recordStart;
+	LogSpan spans[maxLogHeaderSpanCount];
+
+	void Add(int start, int end, int style) noexcept {
+		spans[spanCount++] = {start, end, style};
+	}
+};
+
+constexpr bool IsLogWordChar(int ch) noexcept {
+	return IsAlphaNumeric(ch) || ch == '_';
+}
+
+bool IsMonthName(const char *s) noexcept {
+	constexpr const char *months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	for (int i = 0; i < 12*3; i += 3) {
+		if (s[0] == months[i] && s[1] == months[i + 1] && s[2] == months[i + 2]) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// length of timestamp at start of s, e.g. 2024-01-02 15:04:05,123, 2024-01-02T15:04:05.123Z,
+// 2024/01/02 15:04:05, 15:04:05.123 or syslog style Jan  2 15:04:05.
+int MatchDateTime(const char *s) noexcept {
+	const char *p = s;
+	int dateSeparator = 0;
+	if (IsMonthName(p) && p[3] == ' ') {
+		p += (p[4] == ' ') ? 5 : 4;
+		dateSeparator = 2;
+	}
+	if (!IsADigit(*p)) {
+		return 0;
+	}
+
+	int digits = 0;
+	bool time = false;
+	bool spaced = false;
+	while (true) {
+		const uint8_t ch = *p;
+		if (IsADigit(ch)) {
+			++digits;
+			++p;
+			continue;
+		}
+		if (!IsADigit(p[-1])) {
+			break;
+		}
+		if (ch == 'Z') {
+			p += time;
+			break;
+		}
+		if (ch == '\0' || !IsADigit(p[1])) {
+			// separator must be followed by digit
+			break;
+		}
+		if (ch == ':') {
+			time = true;
+		} else if (ch == '-' || ch == '/') {
+			if (time) {
+				break;
+			}
+			++dateSeparator;
+		} else if (ch == ' ' || ch == 'T') {
+			// date and time
+			if (time || spaced || dateSeparator < 2) {
+				break;
+			}
+			spaced = true;
+		} else if (!(ch == '.' || ch == ',' || (ch == '+' && time))) {
+			break;
+		}
+		++p;
+	}
+
+	if (p[-1] == ' ') {
+		--p;
+	}
+	if ((time && digits >= 4) || (dateSeparator >= 2 && digits >= 6)) {
+		return static_cast<int>(p - s);
+	}
+	return 0;
+}
+
+int ClassifyLogLevel(const char *s, int length) noexcept {
+	char word[16];
+	if (length < 3 || length >= static_cast<int>(sizeof(word))) {
+		return SCE_LOG_DEFAULT;
+	}
+	for (int i = 0; i < length; i++) {
+		word[i] = MakeLowerCase(s[i]);
+	}
+	word[length] = '\0';
+
+	switch (word[0]) {
+	case 'a':
+		return StrEqual(word, "alert") ? SCE_LOG_LEVEL_ERROR : SCE_LOG_DEFAULT;
+	case 'c':
+		return StrEqualsAny(word, "critical", "crit") ? SCE_LOG_LEVEL_ERROR : SCE_LOG_DEFAULT;
+	case 'd':
+		return StrEqualsAny(word, "debug", "dbg") ? SCE_LOG_LEVEL_DEBUG : SCE_LOG_DEFAULT;
+	case 'e':
+		return StrEqualsAny(word, "error", "err", "emerg", "emergency") ? SCE_LOG_LEVEL_ERROR : SCE_LOG_DEFAULT;
+	case 'f':
+		if (StrEqual(word, "fatal")) {
+			return SCE_LOG_LEVEL_ERROR;
+		}
+		return StrEqualsAny(word, "fine", "finer", "finest") ? SCE_LOG_LEVEL_DEBUG : SCE_LOG_DEFAULT;
+	case 'i':
+		return StrEqualsAny(word, "info", "information", "informational") ? SCE_LOG_LEVEL_INFO : SCE_LOG_DEFAULT;
+	case 'n':
+		return StrEqual(word, "notice") ? SCE_LOG_LEVEL_INFO : SCE_LOG_DEFAULT;
+	case 'p':
+		return StrEqual(word, "panic") ? SCE_LOG_LEVEL_ERROR : SCE_LOG_DEFAULT;
+	case 's':
+		return StrEqual(word, "severe") ? SCE_LOG_LEVEL_ERROR : SCE_LOG_DEFAULT;
+	case 't':
+		return StrEqual(word, "trace") ? SCE_LOG_LEVEL_DEBUG : SCE_LOG_DEFAULT;
+	case 'v':
+		return StrEqualsAny(word, "verbose", "verb") ? SCE_LOG_LEVEL_DEBUG : SCE_LOG_DEFAULT;
+	case 'w':
+		return StrEqualsAny(word, "warning", "warn") ? SCE_LOG_LEVEL_WARNING : SCE_LOG_DEFAULT;
+	}
+	return SCE_LOG_DEFAULT;
+}
+
+// Java, .NET, JavaScript and Python stack trace.
+bool IsStackTraceLine(const char *s) noexcept {
+	const char *p = s;
+	while (IsSpaceOrTab(*p)) {
+		++p;
+	}
+	if (p != s) {
+		if (StrStartsWith(p, "at ") || StrStartsWith(p, "File \"") || StrStartsWith(p, "... ")) {
+			return true;
+		}
+	}
+	if (StrStartsWith(p, "Caused by: ") || StrStartsWith(p, "Suppressed: ")
+		|| StrStartsWith(p, "Traceback (most recent call last)")) {
+		return true;
+	}
+
+	// exception type: java.lang.IllegalStateException: message
+	const char *name = p;
+	while (IsLogWordChar(*p) || *p == '.' || *p == '$') {
+		++p;
+	}
+	const std::string_view type(name, p - name);
+	return (*p == ':' || *p == '\0' || IsEOLChar(*p))
+		&& (type.ends_with("Exception") || type.ends_with("Error"));
+}
+
+void ParseLogHeader(const char *s, LogHeader &header) noexcept {
+	header.spanCount = 0;
+	header.recordStart = false;
+
+	const char *p = s;
+	int length = 0;
+	if (*p == '[') {
+		length = MatchDateTime(p + 1);
+		if (length != 0 && p[length + 1] == ']') {
+			length += 2;
+		} else {
+			length = 0;
+		}
+	} else {
+		length = MatchDateTime(p);
+	}
+	if (length != 0) {
+		header.recordStart = true;
+		header.Add(0, length, SCE_LOG_DATETIME);
+		p += length;
+	}
+
+	bool level = false;
+	for (int field = 0; field < maxLogHeaderFields; field++) {
+		while (*p == ' ' || *p == '\t' || *p == '|' || *p == '-') {
+			++p;
+		}
+		if (*p == '\0' || IsEOLChar(*p)) {
+			break;
+		}
+
+		const int start = static_cast<int>(p - s);
+		if (*p == '[' || *p == '<') {
+			// bracketed field: [main], [ERROR], <info>
+			const char chEnd = (*p == '[') ? ']' : '>';
+			const char *q = p + 1;
+			while (*q && *q != chEnd && *q != '[' && !IsEOLChar(*q) && q - p < maxLogFieldLength) {
+				++q;
+			}
+			if (*q != chEnd) {
+				break;
+			}
+			int style = level ? SCE_LOG_DEFAULT : ClassifyLogLevel(p + 1, static_cast<int>(q - p - 1));
+			if (style != SCE_LOG_DEFAULT) {
+				level = true;
+			} else {
+				style = SCE_LOG_THREAD;
+			}
+			header.recordStart |= field == 0 && style != SCE_LOG_THREAD;
+			p = q + 1;
+			header.Add(start, static_cast<int>(p - s), style);
+		} else if (IsLogWordChar(*p)) {
+			const char *q = p;
+			while (IsLogWordChar(*q)) {
+				++q;
+			}
+			if (!level) {
+				const int style = ClassifyLogLevel(p, static_cast<int>(q - p));
+				if (style != SCE_LOG_DEFAULT) {
+					level = true;
+					header.recordStart |= field == 0;
+					header.Add(start, static_cast<int>(q - s), style);
+				}
+			}
+			p = q;
+		} else {
+			// level is not searched inside message
+			break;
+		}
+		if (*p == ':' && !header.recordStart) {
+			break;
+		}
+	}
+}
+
+void ColouriseLogBody(Sci_PositionU pos, Sci_PositionU lineEnd, Accessor &styler) {
+	int chPrev = ' ';
+	while (pos < lineEnd) {
+		const uint8_t ch = styler[pos];
+		if (ch == '\"') {
+			Sci_PositionU end = pos + 1;
+			while (end < lineEnd) {
+				const uint8_t chNext = styler[end++];
+				if (chNext == '\\') {
+					++end;
+				} else if (chNext == '\"') {
+					styler.ColorTo(pos, SCE_LOG_DEFAULT);
+					styler.ColorTo(end, SCE_LOG_STRING);
+					pos = end;
+					break;
+				}
+			}
+			if (pos != end) {
+				++pos; // unterminated
+			}
+			chPrev = ch;
+			continue;
+		}
+
+		if (IsLogWordChar(ch) && !IsLogWordChar(chPrev) && chPrev != '.') {
+			// token with '-' and '.' inside: number, hex number, UUID or hex ID
+			Sci_PositionU end = pos;
+			int hexDigits = 0;
+			int digits = 0;
+			bool hex = true;
+			bool decimal = true;
+			while (end < lineEnd) {
+				const uint8_t chNext = styler[end];
+				if (IsADigit(chNext)) {
+					++digits;
+					++hexDigits;
+				} else if (IsHexDigit(chNext)) {
+					++hexDigits;
+					decimal = false;
+				} else if ((chNext == '-' || chNext == '.') && IsAlphaNumeric(styler[end + 1])) {
+					decimal = decimal && chNext == '.';
+					hex = hex && chNext == '-';
+				} else if (IsLogWordChar(chNext)) {
+					hex = false;
+					decimal = false;
+				} else {
+					break;
+				}
+				++end;
+			}
+
+			int style = SCE_LOG_DEFAULT;
+			Sci_PositionU styleEnd = end;
+			if (hex && digits != 0 && hexDigits != digits && hexDigits >= 16) {
+				style = SCE_LOG_UNIQUE_ID;
+			} else if (decimal) {
+				style = SCE_LOG_NUMBER;
+			} else if (IsADigit(ch)) {
+				styleEnd = pos + 1;
+				if (ch == '0' && UnsafeLower(styler[styleEnd]) == 'x') {
+					// hex number
+					styleEnd++;
+					while (IsHexDigit(styler[styleEnd])) {
+						styleEnd++;
+					}
+				} else {
+					// number with unit: 200ms, 64KB
+					while (IsADigit(styler[styleEnd]) || (styler[styleEnd] == '.' && IsADigit(styler[styleEnd + 1]))) {
+						styleEnd++;
+					}
+				}
+				style = SCE_LOG_NUMBER;
+			}
+			if (style != SCE_LOG_DEFAULT) {
+				styler.ColorTo(pos, SCE_LOG_DEFAULT);
+				styler.ColorTo(styleEnd, style);
+			}
+			chPrev = styler[end - 1];
+			pos = end;
+			continue;
+		}
+
+		chPrev = ch;
+		++pos;
+	}
+	styler.ColorTo(lineEnd, SCE_LOG_DEFAULT);
+}
+
+void ColouriseLogDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int /*initStyle*/, LexerWordList /*keywordLists*/, Accessor &styler) {
+	const bool fold = styler.GetPropertyBool("fold");
+
+	Sci_Line lineCurrent = styler.GetLine(startPos);
+	assert(startPos == static_cast<Sci_PositionU>(styler.LineStart(lineCurrent)));
+	styler.StartAt(startPos);
+	styler.StartSegment(startPos);
+	const Sci_PositionU endPos = startPos + lengthDoc;
+	int prevLevel = (lineCurrent > 0) ? styler.LevelAt(lineCurrent - 1) : SC_FOLDLEVELBASE;
+
+	LogHeader header;
+	char lineBuffer[maxLogHeaderLength];
+	while (startPos < endPos) {
+		const Sci_PositionU lineStartNext = sci::min<Sci_PositionU>(styler.LineStart(lineCurrent + 1), endPos);
+		styler.GetRange(startPos, lineStartNext, lineBuffer, sizeof(lineBuffer));
+
+		ParseLogHeader(lineBuffer, header);
+		const bool blank = lineBuffer[0] == '\0' || IsEOLChar(lineBuffer[0]);
+		Sci_PositionU pos = startPos;
+		if (!header.recordStart && !blank && IsStackTraceLine(lineBuffer)) {
+			styler.ColorTo(lineStartNext, SCE_LOG_STACKTRACE);
+		} else {
+			for (int i = 0; i < header.spanCount; i++) {
+				const LogSpan &span = header.spans[i];
+				ColouriseLogBody(pos, startPos + span.start, styler);
+				styler.ColorTo(startPos + span.end, span.style);
+				pos = startPos + span.end;
+			}
+			ColouriseLogBody(pos, lineStartNext, styler);
+		}
+
+		if (fold) {
+			int level;
+			if (blank) {
+				level = (prevLevel & SC_FOLDLEVELNUMBERMASK) | SC_FOLDLEVELWHITEFLAG;
+			} else {
+				level = header.recordStart ? SC_FOLDLEVELBASE : (SC_FOLDLEVELBASE + 1);
+				// previous non-blank line, record is header only when followed by continuation line
+				Sci_Line linePrev = lineCurrent - 1;
+				int levelPrev = prevLevel;
+				while (linePrev > 0 && (levelPrev & SC_FOLDLEVELWHITEFLAG)) {
+					--linePrev;
+					levelPrev = styler.LevelAt(linePrev);
+				}
+				if (linePrev >= 0 && (levelPrev & ~SC_FOLDLEVELHEADERFLAG) == SC_FOLDLEVELBASE) {
+					const int levelRecord = header.recordStart ? SC_FOLDLEVELBASE : (SC_FOLDLEVELBASE | SC_FOLDLEVELHEADERFLAG);
+					if (levelPrev != levelRecord) {
+						styler.SetLevel(linePrev, levelRecord);
+					}
+				}
+			}
+			styler.SetLevel(lineCurrent, level);
+			prevLevel = level;
+		}
+
+		startPos = lineStartNext;
+		lineCurrent++;
+	}
+}
+
+}
+
+LexerModule lmLog(SCLEX_LOG, ColouriseLogDoc, "log");
@@ -8,6 +8,7 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <unordered_map>
 
 #include "ILexer.h"
 #include "Scintilla.h"
@@ -248,14 +249,27 @@ struct DelimiterRun {
 	}
 };
 
+// inline math that reached paragraph end without closing
+struct UnclosedMath {
+	Sci_PositionU startPos;
+	Sci_PositionU endPos;
+	int style;
+};
+
 struct MarkdownLexer {
 	StyleContext sc;
 	std::vector<int> nestedState;
 	std::vector<Sci_PositionU> backPos;
+	// an unclosed span is rewound and lexed again from next character, remember the result to
+	// avoid rescanning same text for every enclosing unclosed emphasis or every following `$`.
+	// unclosed emphasis is keyed by startPos and style, value is characters to skip after rewinding.
+	std::unordered_map<Sci_PositionU, int> unclosedEmphasis;
+	UnclosedMath unclosedMath {};
 
 	HtmlTagState tagState = HtmlTagState::None; // html tag, link title
 	int indentParent = 0; // parent container's indentChild
 	int delimiterCount = 0; // code fence
+	Sci_PositionU codeSpanStart = 0; // segment is split by autolink inside code span
 	int bracketCount = 0; // link text
 	int parenCount = 0; // link	destination, link title
 	int periodCount = 0; // autoLink domain and path
@@ -291,6 +305,12 @@ struct MarkdownLexer {
 		backPos.pop_back();
 	}
 
+	void SaveUnclosedEmphasis(Sci_PositionU startPos, int style, int advance);
+	int GetUnclosedEmphasis(Sci_PositionU startPos, int style) const;
+	bool IsUnclosedMath(int style) const noexcept {
+		return style == unclosedMath.style && sc.currentPos >= unclosedMath.startPos && sc.currentPos < unclosedMath.endPos;
+	}
+
 	bool IsParagraphEnd(Sci_PositionU pos, uint32_t lineState) const noexcept;
 	bool OnHeaderLine() const noexcept {
 		return !nestedState.empty() && IsHeaderStyle(nestedState.front());
@@ -742,11 +762,37 @@ constexpr uint8_t GetEmphasisDelimiter(int state) noexcept {
 	}
 }
 
+// spans fail in both document order (`~~a ~~b`) and reverse order (`*a *b *c`), a sorted vector
+// would be quadratic for one of them.
+constexpr Sci_PositionU UnclosedEmphasisKey(Sci_PositionU startPos, int style) noexcept {
+	return startPos*8 + (style - SCE_MARKDOWN_EM_ASTERISK);
+}
+
+void MarkdownLexer::SaveUnclosedEmphasis(Sci_PositionU startPos, int style, int advance) {
+	unclosedEmphasis.emplace(UnclosedEmphasisKey(startPos, style), advance);
+}
+
+int MarkdownLexer::GetUnclosedEmphasis(Sci_PositionU startPos, int style) const {
+	const auto it = unclosedEmphasis.find(UnclosedEmphasisKey(startPos, style));
+	return (it == unclosedEmphasis.end()) ? 0 : it->second;
+}
+
 SeekStatus MarkdownLexer::HighlightEmphasis(uint32_t lineState) {
 	HighlightResult result = HighlightResult::None;
 	const int current = sc.state;
 	const int delimiter = GetEmphasisDelimiter(current);
-	if (sc.ch == delimiter && (current != SCE_MARKDOWN_STRIKEOUT || sc.chNext == '~')) {
+	int advance = 0;
+	if (bracketCount == 0 && !unclosedEmphasis.empty()) {
+		// an unclosed emphasis with same style was lexed from here, lexing from here again
+		// gets same result, e.g. outer `*` for `*a *b *c` or outer `**` for `**a *b **c *d`.
+		const Sci_PositionU length = (current >= SCE_MARKDOWN_STRONG_ASTERISK) ? 2 : 1;
+		if (sc.currentPos >= length) {
+			advance = GetUnclosedEmphasis(sc.currentPos - length, current);
+		}
+	}
+	if (advance != 0) {
+		result = HighlightResult::Invalid;
+	} else if (sc.ch == delimiter && (current != SCE_MARKDOWN_STRIKEOUT || sc.chNext == '~')) {
 		DelimiterRun delimiterRun;
 		const int length = GetCurrentDelimiterRun(delimiterRun);
 
@@ -795,10 +841,14 @@ SeekStatus MarkdownLexer::HighlightEmphasis(uint32_t lineState) {
 		sc.ChangeState(outer);
 		// no rewind inside link text to avoid extra stack for bracketCount.
 		if (bracketCount == 0) {
+			if (advance == 0) {
+				advance = ((current == SCE_MARKDOWN_STRIKEOUT)
+					|| (result == HighlightResult::Continue && current >= SCE_MARKDOWN_STRONG_ASTERISK)) ? 2 : 1;
+			}
+			SaveUnclosedEmphasis(startPos, current, advance);
 			const bool multiline = sc.BackTo(startPos);
 			sc.Forward();
-			if ((current == SCE_MARKDOWN_STRIKEOUT)
-				|| (result == HighlightResult::Continue && current >= SCE_MARKDOWN_STRONG_ASTERISK)) {
+			if (advance > 1) {
 				sc.Forward();
 			}
 			return multiline ? SeekStatus::Multiline : SeekStatus::Continue;
@@ -1076,7 +1126,8 @@ bool MarkdownLexer::DetectAutoLink() {
 			constexpr int kMaxSchemeNameLength = 32;
 			const Sci_PositionU startPos = sc.styler.GetStartSegment();
 			const Sci_PositionU endPos = pos;
-			pos -= 2;
+			// current segment may start after scheme name, e.g. `@citation://`
+			pos = sci::max(pos - 2, startPos);
 			uint8_t ch;
 			while (true) {
 				ch = sc.styler.SafeGetCharAt(pos);
@@ -1193,6 +1244,8 @@ bool MarkdownLexer::HighlightAutoLink() {
 							invalid = true;
 						} else {
 							sc.Advance(length - current);
+							// check character after the delimiter run
+							invalid = IsInvalidUrlChar(sc.chNext);
 						}
 					}
 				}
@@ -1628,6 +1681,7 @@ void MarkdownLexer::HighlightInlineText() {
 
 	case '`':
 		delimiterCount = GetMatchedDelimiterCount(sc.styler, sc.currentPos, '`');
+		codeSpanStart = sc.currentPos;
 		sc.SetState(SCE_MARKDOWN_CODE_SPAN);
 		sc.Advance(delimiterCount - 1);
 		break;
@@ -1648,6 +1702,21 @@ void MarkdownLexer::HighlightInlineText() {
 						style += SCE_MARKDOWN_STRONG_ASTERISK - SCE_MARKDOWN_EM_ASTERISK;
 					}
 				}
+				int advance = 0;
+				if (bracketCount == 0) {
+					advance = GetUnclosedEmphasis(sc.currentPos, style);
+				} else {
+					// bracketCount may be reset by nested link text, result inside link text is not reused
+					SaveUnclosedEmphasis(sc.currentPos, style, 0);
+				}
+				if (advance != 0) {
+					// same as rewinding in HighlightEmphasis()
+					sc.SetState(current);
+					if (advance > 1) {
+						sc.Forward();
+					}
+					return;
+				}
 				SaveOuterStart(sc.currentPos);
 				sc.SetState(style);
 			}
@@ -1710,18 +1779,31 @@ void MarkdownLexer::HighlightInlineText() {
 		sc.SetState(SCE_MARKDOWN_DELIMITER);
 		break;
 
-	case '$':
+	case '$': {
+		int style = SCE_MARKDOWN_DEFAULT;
 		if (markdown != Markdown::GitLab) {
 			if (sc.chNext == '$') {
-				sc.SetState(SCE_MARKDOWN_INLINE_DISPLAY_MATH);
+				style = SCE_MARKDOWN_INLINE_DISPLAY_MATH;
 			} else if (IsMathOpenDollar(sc.chNext)) {
-				sc.SetState(SCE_MARKDOWN_INLINE_MATH);
+				style = SCE_MARKDOWN_INLINE_MATH;
 			}
 		} else if (sc.chNext == '`') {
-			sc.SetState(SCE_MARKDOWN_MATH_SPAN);
-			sc.Forward();
+			style = SCE_MARKDOWN_MATH_SPAN;
 		}
-		break;
+		if (style != SCE_MARKDOWN_DEFAULT) {
+			// closing `$` or `$$` doesn't depend on where math starts, so any math
+			// starts inside the unclosed one is also unclosed.
+			if (IsUnclosedMath(style)) {
+				// same as rewinding in HighlightCodeSpan()
+				sc.SetState(current);
+				return;
+			}
+			sc.SetState(style);
+			if (style == SCE_MARKDOWN_MATH_SPAN) {
+				sc.Forward();
+			}
+		}
+	} break;
 
 	case '(':
 		if (markdown == Markdown::Pandoc && sc.chNext == '@') {
@@ -1795,7 +1877,10 @@ SeekStatus MarkdownLexer::HighlightCodeSpan(uint32_t lineState) {
 		return SeekStatus::Continue;
 
 	case HighlightResult::Invalid: {
-		const Sci_PositionU startPos = sc.styler.GetStartSegment();
+		const Sci_PositionU startPos = (sc.state == SCE_MARKDOWN_CODE_SPAN) ? codeSpanStart : sc.styler.GetStartSegment();
+		if (sc.state == SCE_MARKDOWN_INLINE_DISPLAY_MATH || sc.state == SCE_MARKDOWN_INLINE_MATH) {
+			unclosedMath = {startPos, sc.currentPos, sc.state};
+		}
 		sc.ChangeState(TakeOuterStyle());
 		const bool multiline = sc.BackTo(startPos);
 		sc.Forward();
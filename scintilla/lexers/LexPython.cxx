@@ -869,7 +869,12 @@ void ColourisePyDoc(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyl
 			visibleCharsBefore = 0;
 			indentCount = 0;
 		}
-		sc.Forward();
+		if (sc.state == SCE_PY_COMMENTLINE && visibleChars > visibleCharsBefore + 3) {
+			// task marker is only checked near comment start
+			sc.ForwardUntil("");
+		} else {
+			sc.Forward();
+		}
 	}
 
 	sc.Complete();
@@ -13,9 +13,49 @@
 #include "LexAccessor.h"
 #include "CharacterSet.h"
 #include "LexerUtils.h"
+#include "VectorISA.h"
 
 using namespace Lexilla;
 
+namespace {
+
+const char *FindLineEndOrAnyOf(const char *ptr, const char *end, const char *set) noexcept {
+#if NP2_USE_SSE2
+	// unused slots repeat CR, so each block is compared with fixed six bytes.
+	char chars[4] = {'\r', '\r', '\r', '\r'};
+	for (int i = 0; i < 4 && set[i]; i++) {
+		chars[i] = set[i];
+	}
+	const __m128i vectCR = _mm_set1_epi8('\r');
+	const __m128i vectLF = _mm_set1_epi8('\n');
+	const __m128i vect0 = _mm_set1_epi8(chars[0]);
+	const __m128i vect1 = _mm_set1_epi8(chars[1]);
+	const __m128i vect2 = _mm_set1_epi8(chars[2]);
+	const __m128i vect3 = _mm_set1_epi8(chars[3]);
+	// ptr + sizeof(__m128i) could point past the buffer, compare remaining length instead.
+	while (static_cast<size_t>(end - ptr) >= sizeof(__m128i)) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		__m128i match = _mm_or_si128(_mm_cmpeq_epi8(chunk, vectCR), _mm_cmpeq_epi8(chunk, vectLF));
+		match = _mm_or_si128(match, _mm_or_si128(_mm_cmpeq_epi8(chunk, vect0), _mm_cmpeq_epi8(chunk, vect1)));
+		match = _mm_or_si128(match, _mm_or_si128(_mm_cmpeq_epi8(chunk, vect2), _mm_cmpeq_epi8(chunk, vect3)));
+		const uint32_t mask = mm_movemask_epi8(match);
+		if (mask != 0) {
+			return ptr + np2_ctz(mask);
+		}
+		ptr += sizeof(__m128i);
+	}
+#endif
+	for (; ptr < end; ptr++) {
+		const char ch = *ptr;
+		if (ch == '\r' || ch == '\n' || (ch != '\0' && strchr(set, ch) != nullptr)) {
+			break;
+		}
+	}
+	return ptr;
+}
+
+}
+
 namespace Lexilla {
 
 bool LexAccessor::MatchIgnoreCase(Sci_Position pos, const char *s) noexcept {
@@ -55,6 +95,24 @@ void LexAccessor::GetRangeLowered(Sci_PositionU startPos_, Sci_PositionU endPos_
 	ToLowerCase(s);
 }
 
+Sci_PositionU LexAccessor::FindLineEndOrAnyOf(Sci_PositionU position, Sci_PositionU end, const char *set) noexcept {
+	assert(strlen(set) <= 4);
+	while (position < end) {
+		if (static_cast<Sci_Position>(position) < startPos || static_cast<Sci_Position>(position) >= endPos) {
+			Fill(position);
+		}
+		const Sci_PositionU blockEnd = sci::min(end, static_cast<Sci_PositionU>(endPos));
+		const char * const ptr = buf + (position - startPos);
+		const char * const ptrEnd = buf + (blockEnd - startPos);
+		const char * const found = ::FindLineEndOrAnyOf(ptr, ptrEnd, set);
+		if (found != ptrEnd) {
+			return startPos + (found - buf);
+		}
+		position = blockEnd;
+	}
+	return end;
+}
+
 std::string LexAccessor::GetRange(Sci_PositionU startPos_, Sci_PositionU endPos_) {
 	assert(startPos_ < endPos_);
 	const Sci_PositionU len = endPos_ - startPos_;
@@ -23,6 +23,7 @@ class LexAccessor {
 	enum {
 		bufferSize = 4096,
 		slopSize = bufferSize / 8,
+		levelBufferSize = 1024,
 	};
 	char buf[bufferSize + 4];
 	const EncodingType encodingType;
@@ -35,6 +36,9 @@ class LexAccessor {
 	Sci_PositionU validLen = 0;
 	Sci_PositionU startSeg = 0;
 	Sci_Position startPosStyling = 0;
+	Sci_Line startLineLevel = 0;
+	Sci_Line validLevels = 0;
+	int levelBuf[levelBufferSize];
 
 	void Fill(Sci_Position position) noexcept {
 		Sci_Position m = lenDoc - bufferSize;
@@ -143,6 +147,8 @@ public:
 	// Get first len - 1 characters in range [startPos_, endPos_).
 	void GetRange(Sci_PositionU startPos_, Sci_PositionU endPos_, char *s, Sci_PositionU len) noexcept;
 	void GetRangeLowered(Sci_PositionU startPos_, Sci_PositionU endPos_, char *s, Sci_PositionU len) noexcept;
+	// find first CR, LF or byte in set (at most 4 ASCII characters) within [position, end), returns end when not found.
+	Sci_PositionU FindLineEndOrAnyOf(Sci_PositionU position, Sci_PositionU end, const char *set) noexcept;
 	// Get all characters in range [startPos_, endPos_).
 	std::string GetRange(Sci_PositionU startPos_, Sci_PositionU endPos_);
 	std::string GetRangeLowered(Sci_PositionU startPos_, Sci_PositionU endPos_);
@@ -175,6 +181,10 @@ public:
 		return pAccess->LineEnd(line);
 	}
 	int LevelAt(Sci_Line line) const noexcept {
+		const Sci_Line index = line - startLineLevel;
+		if (index >= 0 && index < validLevels) {
+			return levelBuf[index];
+		}
 		return pAccess->GetLevel(line);
 	}
 	constexpr Sci_Position Length() const noexcept {
@@ -238,8 +248,26 @@ public:
 		}
 		startSeg = endPos_;
 	}
+	// levels are committed to document in batch by FlushLevels(), which must be called
+	// at end of Lex() and Fold() function.
 	void SetLevel(Sci_Line line, int level) {
-		pAccess->SetLevel(line, level);
+		const Sci_Line index = line - startLineLevel;
+		if (index >= 0 && index < validLevels) {
+			levelBuf[index] = level;
+			return;
+		}
+		if (index != validLevels || validLevels == levelBufferSize) {
+			FlushLevels();
+			startLineLevel = line;
+		}
+		levelBuf[validLevels++] = level;
+	}
+	void FlushLevels() {
+		if (validLevels != 0) {
+			pAccess->SetLevels(startLineLevel, validLevels, levelBuf);
+			startLineLevel += validLevels;
+			validLevels = 0;
+		}
 	}
 	void IndicatorFill(Sci_Position start, Sci_Position end, int indicator, int value) {
 		pAccess->DecorationSetCurrentIndicator(indicator);
@@ -78,6 +78,7 @@ void SCI_METHOD LexerBase::Lex(Sci_PositionU startPos, Sci_Position lengthDoc, i
 	Accessor styler(pAccess, props);
 	lexer.fnLexer(startPos, lengthDoc, initStyle, keywordLists, styler);
 	styler.Flush();
+	styler.FlushLevels();
 }
 
 void SCI_METHOD LexerBase::Fold(Sci_PositionU startPos, Sci_Position lengthDoc, int initStyle, Scintilla::IDocument *pAccess) {
@@ -97,6 +98,7 @@ void SCI_METHOD LexerBase::Fold(Sci_PositionU startPos, Sci_Position lengthDoc,
 
 		Accessor styler(pAccess, props);
 		lexer.fnFolder(startPos, lengthDoc, initStyle, keywordLists, styler);
+		styler.FlushLevels();
 	}
 }
 
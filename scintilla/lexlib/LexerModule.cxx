@@ -68,6 +68,7 @@ extern LexerModule lmKotlin;
 extern LexerModule lmLatex;
 extern LexerModule lmLisp;
 extern LexerModule lmLLVM;
+extern LexerModule lmLog;
 extern LexerModule lmLua;
 extern LexerModule lmMakefile;
 extern LexerModule lmMarkdown;
@@ -153,6 +154,7 @@ const LexerModule * const lexerCatalogue[] = {
 	&lmLatex,
 	&lmLisp,
 	&lmLLVM,
+	&lmLog,
 	&lmLua,
 	&lmMakefile,
 	&lmMarkdown,
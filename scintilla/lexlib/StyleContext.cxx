@@ -110,6 +110,37 @@ int StyleContext::GetLineNextChar(bool ignoreCurrent) const noexcept {
 	return '\0';
 }
 
+void StyleContext::ForwardUntil(const char *set) noexcept {
+	if (atLineEnd) {
+		Forward();
+		return;
+	}
+	if (multiByteAccess) {
+		// DBCS trail byte can be any ASCII character
+		do {
+			Forward();
+		} while (More() && !atLineEnd && !(ch < 0x80 && (IsEOLChar(ch) || (ch != 0 && strchr(set, ch) != nullptr))));
+		return;
+	}
+
+	// one byte per character, line end is not crossed
+	const Sci_PositionU limit = sci::min(endPos, lineStartNext);
+	Sci_PositionU pos = styler.FindLineEndOrAnyOf(currentPos + 1, limit, set);
+	if (pos == limit) {
+		pos = limit - 1;
+	}
+	if (pos <= currentPos + 1) {
+		Forward();
+		return;
+	}
+
+	atLineStart = false;
+	currentPos = pos;
+	chPrev = static_cast<unsigned char>(styler[pos - 1]);
+	ch = static_cast<unsigned char>(styler[pos]);
+	GetNextChar();
+}
+
 namespace {
 
 constexpr bool IsTaskMarkerPrev(int chPrev) noexcept {
@@ -263,6 +263,12 @@ public:
 		return previousLine != currentLine;
 	}
 
+	// advance at least one character, then stop at first line end or character in set
+	// (at most 4 ASCII characters), skipped characters are not seen by the lexer.
+	// used in states like string body and block comment where most characters
+	// don't change state.
+	void ForwardUntil(const char *set) noexcept;
+
 	void Advance(Sci_Position nb) noexcept {
 		assert(nb >= 0 && currentPos + nb < lineStartNext);
 		if (nb) {
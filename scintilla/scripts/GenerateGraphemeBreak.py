@@ -178,6 +178,10 @@ constexpr bool IsGraphemeClusterBoundary(GraphemeBreakProperty prev, GraphemeBre
 		'tableName': 'GraphemeBreakTable',
 		'tableVarName': 'CharClassify::GraphemeBreakTable',
 		'function': """static GraphemeBreakProperty GetGraphemeBreakProperty(uint32_t ch) noexcept {
+	if (ch < 0x80) {
+		// C0 controls (including CR and LF) and DEL are Control
+		return (ch < 0x20 || ch == 0x7f) ? GraphemeBreakProperty::Control : GraphemeBreakProperty::Other;
+	}
 	if (ch >= maxUnicodeGraphemeBreakCharacter) {
 		return GraphemeBreakProperty::Other;
 	}
@@ -18,6 +18,7 @@ typeAliases = {
 	"colouralpha": "ColourAlpha",
 	"findtext": "TextToFindFull *",
 	"findtextfull": "TextToFindFull *",
+	"findtextall": "TextToFindAll *",
 	"formatrange": "const RangeToFormatFull *",
 	"formatrangefull": "const RangeToFormatFull *",
 	"int": "int",
@@ -32,6 +32,7 @@
 #include "RunStyles.h"
 #include "SparseVector.h"
 #include "ChangeHistory.h"
+#include "CompressedStorage.h"
 #include "CellBuffer.h"
 #include "UndoHistory.h"
 #include "UniConversion.h"
@@ -333,6 +334,42 @@ public:
 	}
 };
 
+namespace {
+
+// count bytes with the high bit set, used to track whether the whole document is ASCII.
+Sci::Position CountNonASCII(const char *s, size_t length) noexcept {
+	Sci::Position count = 0;
+	const char * const end = s + length;
+#if NP2_USE_SSE2
+	while (s + sizeof(__m128i) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+		count += np2::popcount(static_cast<uint32_t>(_mm_movemask_epi8(chunk)));
+		s += sizeof(__m128i);
+	}
+#endif
+	while (s < end) {
+		count += static_cast<unsigned char>(*s) >> 7;
+		++s;
+	}
+	return count;
+}
+
+Sci::Position CountNonASCII(const SplitView &view, size_t position, size_t length) noexcept {
+	Sci::Position count = 0;
+	const size_t end = position + length;
+	if (position < view.length1) {
+		const size_t end1 = std::min(end, view.length1);
+		count = CountNonASCII(view.segment1 + position, end1 - position);
+		position = end1;
+	}
+	if (position < end) {
+		count += CountNonASCII(view.segment2 + position, end - position);
+	}
+	return count;
+}
+
+}
+
 SplitView::SplitView(const SplitVector<char> &instance) noexcept {
 	length = instance.Length();
 	length1 = instance.GapPosition();
@@ -344,11 +381,21 @@ SplitView::SplitView(const SplitVector<char> &instance) noexcept {
 	segment2 = instance.ElementPointer(length1) - length1;
 }
 
+SplitView::SplitView(const CompressedStorage &instance) noexcept {
+	length = instance.Length();
+	compressed = &instance;
+}
+
+char SplitView::CompressedCharAt(size_t position) const noexcept {
+	return compressed->ValueAt(position);
+}
+
 CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
 	hasStyles(hasStyles_), largeDocument(largeDocument_) {
 	readOnly = false;
 	utf8Substance = false;
 	utf8LineEnds = LineEndType::Default;
+	nonASCIICount = 0;
 	collectingUndo = true;
 	uh = std::make_unique<UndoHistory>();
 	if (largeDocument)
@@ -360,29 +407,42 @@ CellBuffer::CellBuffer(bool hasStyles_, bool largeDocument_) :
 CellBuffer::~CellBuffer() noexcept = default;
 
 char CellBuffer::CharAt(Sci::Position position) const noexcept {
+	if (compressedText) {
+		return compressedText->ValueAt(position);
+	}
 	return substance.ValueAt(position);
 }
 
 unsigned char CellBuffer::UCharAt(Sci::Position position) const noexcept {
-	return substance.ValueAt(position);
+	return CharAt(position);
 }
 
 void CellBuffer::GetCharRange(char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const noexcept {
 	if ((position | lengthRetrieve) <= 0) {
 		return;
 	}
-	if ((position + lengthRetrieve) > substance.Length()) {
+	if ((position + lengthRetrieve) > Length()) {
 		//Platform::DebugPrintf("Bad GetCharRange %.0f for %.0f of %.0f\n",
 		//					static_cast<double>(position),
 		//					static_cast<double>(lengthRetrieve),
-		//					static_cast<double>(substance.Length()));
+		//					static_cast<double>(Length()));
+		return;
+	}
+	if (compressedText) {
+		compressedText->GetRange(buffer, position, lengthRetrieve);
 		return;
 	}
 	substance.GetRange(buffer, position, lengthRetrieve);
 }
 
 char CellBuffer::StyleAt(Sci::Position position) const noexcept {
-	return hasStyles ? style.ValueAt(position) : '\0';
+	if (!hasStyles) {
+		return '\0';
+	}
+	if (compressedStyle) {
+		return compressedStyle->ValueAt(position);
+	}
+	return style.ValueAt(position);
 }
 
 void CellBuffer::GetStyleRange(unsigned char *buffer, Sci::Position position, Sci::Position lengthRetrieve) const noexcept {
@@ -393,33 +453,54 @@ void CellBuffer::GetStyleRange(unsigned char *buffer, Sci::Position position, Sc
 		std::fill_n(buffer, lengthRetrieve, static_cast<unsigned char>(0));
 		return;
 	}
-	if ((position + lengthRetrieve) > style.Length()) {
+	if ((position + lengthRetrieve) > Length()) {
 		//Platform::DebugPrintf("Bad GetStyleRange %.0f for %.0f of %.0f\n",
 		//					static_cast<double>(position),
 		//					static_cast<double>(lengthRetrieve),
-		//					static_cast<double>(style.Length()));
+		//					static_cast<double>(Length()));
+		return;
+	}
+	if (compressedStyle) {
+		compressedStyle->GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
 		return;
 	}
 	style.GetRange(reinterpret_cast<char *>(buffer), position, lengthRetrieve);
 }
 
 const char *CellBuffer::BufferPointer() {
+	Decompress();
 	return substance.BufferPointer();
 }
 
 const char *CellBuffer::RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept {
+	if (compressedText) {
+		return compressedText->RangePointer(position, rangeLength);
+	}
 	return substance.RangePointer(position, rangeLength);
 }
 
 const char *CellBuffer::StyleRangePointer(Sci::Position position, Sci::Position rangeLength) noexcept {
-	return hasStyles ? style.RangePointer(position, rangeLength) : nullptr;
+	if (!hasStyles) {
+		return nullptr;
+	}
+	if (compressedStyle) {
+		return compressedStyle->RangePointer(position, rangeLength);
+	}
+	return style.RangePointer(position, rangeLength);
 }
 
 Sci::Position CellBuffer::GapPosition() const noexcept {
+	if (compressedText) {
+		// no gap, text is not moved by RangePointer()
+		return Length();
+	}
 	return substance.GapPosition();
 }
 
 SplitView CellBuffer::AllView() const noexcept {
+	if (compressedText) {
+		return SplitView(*compressedText);
+	}
 	return SplitView(substance);
 }
 
@@ -428,6 +509,7 @@ const char *CellBuffer::InsertString(Sci::Position position, const char *s, Sci:
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	const char *data = s;
 	if (!readOnly) {
+		Decompress();
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
 			// This takes up about half load time
@@ -442,11 +524,17 @@ const char *CellBuffer::InsertString(Sci::Position position, const char *s, Sci:
 	return data;
 }
 
-bool CellBuffer::SetStyleAt(Sci::Position position, char styleValue) noexcept {
+bool CellBuffer::SetStyleAt(Sci::Position position, char styleValue) {
+	if (compressedStyle) {
+		return compressedStyle->SetValueAt(position, styleValue);
+	}
 	return style.UpdateValueAt(position, styleValue);
 }
 
-bool CellBuffer::SetStyleFor(Sci::Position position, Sci::Position lengthStyle, char styleValue) noexcept {
+bool CellBuffer::SetStyleFor(Sci::Position position, Sci::Position lengthStyle, char styleValue) {
+	if (compressedStyle) {
+		return compressedStyle->SetValueFor(position, lengthStyle, styleValue);
+	}
 	bool changed = false;
 	PLATFORM_ASSERT(lengthStyle == 0 ||
 		(lengthStyle > 0 && lengthStyle + position <= style.Length()));
@@ -465,6 +553,7 @@ const char *CellBuffer::DeleteChars(Sci::Position position, Sci::Position delete
 	PLATFORM_ASSERT(deleteLength > 0);
 	const char *data = nullptr;
 	if (!readOnly) {
+		Decompress();
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
 			// The gap would be moved to position anyway for the deletion so this doesn't cost extra
@@ -486,14 +575,53 @@ void CellBuffer::Allocate(Sci::Position newSize) {
 	//if (!largeDocument && (newSize > INT32_MAX)) {
 	//	throw std::runtime_error("CellBuffer::Allocate: size of standard document limited to 2G.");
 	//}
+	Decompress();
 	substance.ReAllocate(newSize);
 	if (hasStyles) {
 		style.ReAllocate(newSize);
 	}
 }
 
+void CellBuffer::Compress() {
+	if (compressedText || substance.Length() == 0) {
+		return;
+	}
+	std::unique_ptr<CompressedStorage> text = std::make_unique<CompressedStorage>(substance);
+	std::unique_ptr<CompressedStorage> styles;
+	if (hasStyles) {
+		styles = std::make_unique<CompressedStorage>(style);
+	}
+	compressedText = std::move(text);
+	compressedStyle = std::move(styles);
+	substance.DeleteAll();
+	style.DeleteAll();
+}
+
+void CellBuffer::Decompress() {
+	if (compressedText) {
+		try {
+			compressedText->DecompressTo(substance);
+			if (compressedStyle) {
+				compressedStyle->DecompressTo(style);
+			}
+		} catch (...) {
+			// keep compressed content
+			substance.DeleteAll();
+			style.DeleteAll();
+			throw;
+		}
+		compressedText.reset();
+		compressedStyle.reset();
+	}
+}
+
+Sci::Position CellBuffer::CompressedLength() const noexcept {
+	return compressedText->Length();
+}
+
 bool CellBuffer::EnsureStyleBuffer(bool hasStyles_) {
 	if (hasStyles != hasStyles_) {
+		Decompress();
 		hasStyles = hasStyles_;
 		if (hasStyles_) {
 			style.InsertValue(0, substance.Length(), 0);
@@ -700,7 +828,7 @@ void CellBuffer::ResetLineEnds() {
 	unsigned char chBeforePrev = 0;
 	unsigned char chPrev = 0;
 	for (Sci::Position i = 0; i < length; i++) {
-		const unsigned char ch = substance.ValueAt(position + i);
+		const unsigned char ch = CharAt(position + i);
 		if (ch == '\r') {
 			InsertLine(lineInsert, (position + i) + 1, atLineStart);
 			lineInsert++;
@@ -770,6 +898,8 @@ void CellBuffer::BasicInsertString(const Sci::Position position, const char * co
 		breakingUTF8LineEnd = UTF8LineEndOverlaps(position);
 	}
 
+	nonASCIICount += CountNonASCII(s, insertLength);
+
 	const Sci::Line linePosition = plv->LineFromPosition(position);
 	Sci::Line lineInsert = linePosition + 1;
 
@@ -1194,7 +1324,12 @@ void CellBuffer::BasicDeleteChars(const Sci::Position position, const Sci::Posit
 		// If whole buffer is being deleted, faster to reinitialise lines data
 		// than to delete each line.
 		plv->Init();
+		nonASCIICount = 0;
 	} else {
+		if (nonASCIICount != 0) {
+			nonASCIICount -= CountNonASCII(SplitView(substance), position, deleteLength);
+		}
+
 		// Have to fix up line positions before doing deletion as looking at text in buffer
 		// to work out which lines have been removed
 
@@ -1319,6 +1454,7 @@ Action CellBuffer::GetUndoStep() const noexcept {
 }
 
 void CellBuffer::PerformUndoStep() {
+	Decompress();
 	const Action previousStep = uh->GetUndoStep();
 	// PreviousBeforeSavePoint and AfterDetachPoint are called since acting on the previous action,
 	// that is currentAction-1
@@ -1357,6 +1493,7 @@ Action CellBuffer::GetRedoStep() const noexcept {
 }
 
 void CellBuffer::PerformRedoStep() {
+	Decompress();
 	const Action actionStep = uh->GetRedoStep();
 	if (actionStep.at == ActionType::insert) {
 		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
@@ -1504,6 +1641,18 @@ void CellBuffer::ChangeLastUndoActionText(size_t length, const char *text) {
 	uh->ChangeLastUndoActionText(length, text);
 }
 
+void CellBuffer::SetUndoActionStyles(ActionStyles &&styles) {
+	uh->SetActionStyles(std::move(styles));
+}
+
+const ActionStyles *CellBuffer::UndoActionStyles(int action) const noexcept {
+	return uh->GetActionStyles(action);
+}
+
+void CellBuffer::DiscardUndoActionStyles() noexcept {
+	uh->DiscardActionStyles();
+}
+
 void CellBuffer::ChangeHistorySet(bool set) {
 	if (set) {
 		if (!changeHistory && !uh->CanUndo()) {
@@ -22,7 +22,9 @@ public:
 };
 
 class UndoHistory;
+struct ActionStyles;
 class ChangeHistory;
+class CompressedStorage;
 
 /**
  * The line vector contains information about each of the lines in a cell buffer.
@@ -47,18 +49,25 @@ struct SplitView {
 	size_t length1 = 0;
 	const char *segment2 = nullptr;
 	size_t length = 0;
+	// for compressed document, both segments are empty
+	const CompressedStorage *compressed = nullptr;
 
 	SplitView(const SplitVector<char> &instance) noexcept;
+	SplitView(const CompressedStorage &instance) noexcept;
 
 	char CharAt(size_t position) const noexcept {
 		if (position < length1) {
 			return segment1[position];
 		}
 		if (position < length) {
+			if (compressed) {
+				return CompressedCharAt(position);
+			}
 			return segment2[position];
 		}
 		return '\0';
 	}
+	char CompressedCharAt(size_t position) const noexcept;
 };
 
 /**
@@ -73,8 +82,12 @@ private:
 	bool readOnly;
 	bool utf8Substance;
 	Scintilla::LineEndType utf8LineEnds;
+	Sci::Position nonASCIICount;	// number of bytes >= 0x80, zero when the whole text is ASCII
 	SplitVector<char> substance;
 	SplitVector<char> style;
+	// substance and style are empty while the document is compressed
+	std::unique_ptr<CompressedStorage> compressedText;
+	std::unique_ptr<CompressedStorage> compressedStyle;
 
 	bool collectingUndo;
 	std::unique_ptr<UndoHistory> uh;
@@ -91,6 +104,9 @@ private:
 	/// Actions without undo
 	void BasicInsertString(Sci::Position position, const char *s, Sci::Position insertLength);
 	void BasicDeleteChars(Sci::Position position, Sci::Position deleteLength);
+	/// Restore plain storage before changing text or whole buffer is accessed.
+	void Decompress();
+	Sci::Position CompressedLength() const noexcept;
 
 public:
 	CellBuffer(bool hasStyles_, bool largeDocument_);
@@ -114,9 +130,18 @@ public:
 	SplitView AllView() const noexcept;
 
 	Sci::Position Length() const noexcept {
-		return substance.Length();
+		return compressedText ? CompressedLength() : substance.Length();
+	}
+	bool AllASCII() const noexcept {
+		return nonASCIICount == 0;
 	}
 	void Allocate(Sci::Position newSize);
+	/// Compress text and styles of a read-mostly document, they are decompressed again
+	/// on modification or when the whole buffer is retrieved.
+	void Compress();
+	bool IsCompressed() const noexcept {
+		return compressedText != nullptr;
+	}
 	bool EnsureStyleBuffer(bool hasStyles_);
 	void SetUTF8Substance(bool utf8Substance_) noexcept {
 		utf8Substance = utf8Substance_;
@@ -143,8 +168,9 @@ public:
 
 	/// Setting styles for positions outside the range of the buffer is safe and has no effect.
 	/// @return true if the style of a character is changed.
-	bool SetStyleAt(Sci::Position position, char styleValue) noexcept;
-	bool SetStyleFor(Sci::Position position, Sci::Position lengthStyle, char styleValue) noexcept;
+	/// Cannot be noexcept as modified compressed block may be compressed again.
+	bool SetStyleAt(Sci::Position position, char styleValue);
+	bool SetStyleFor(Sci::Position position, Sci::Position lengthStyle, char styleValue);
 
 	const char *DeleteChars(Sci::Position position, Sci::Position deleteLength, bool &startSequence);
 
@@ -206,6 +232,11 @@ public:
 	void PushUndoActionType(int type, Sci::Position position);
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
+	/// Styles kept for text removed by an undo action, see Document::CaptureActionStyles().
+	void SetUndoActionStyles(ActionStyles &&styles);
+	const ActionStyles *UndoActionStyles(int action) const noexcept;
+	void DiscardUndoActionStyles() noexcept;
+
 	void ChangeHistorySet(bool set);
 	[[nodiscard]] int EditionAt(Sci::Position pos) const noexcept;
 	[[nodiscard]] Sci::Position EditionEndRun(Sci::Position pos) const noexcept;
@@ -115,6 +115,10 @@ public:
 
 //grapheme function++Autogenerated -- start of section automatically generated
 	static GraphemeBreakProperty GetGraphemeBreakProperty(uint32_t ch) noexcept {
+		if (ch < 0x80) {
+			// C0 controls (including CR and LF) and DEL are Control
+			return (ch < 0x20 || ch == 0x7f) ? GraphemeBreakProperty::Control : GraphemeBreakProperty::Other;
+		}
 		if (ch >= maxUnicodeGraphemeBreakCharacter) {
 			return GraphemeBreakProperty::Other;
 		}
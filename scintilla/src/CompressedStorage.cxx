@@ -0,0 +1,394 @@
+// Scintilla source code edit control
+/** @file CompressedStorage.cxx
+ ** Read-mostly storage of text or styles as independently compressed blocks.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+
+#include <stdexcept>
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+#include "Debugging.h"
+
+#include "Position.h"
+#include "SplitVector.h"
+#include "CompressedStorage.h"
+
+using namespace Scintilla::Internal;
+
+namespace {
+
+// LZ4 block format: each sequence is a token (4 bits literal length, 4 bits match length - 4),
+// extra literal length bytes, literals, 2 bytes little endian offset, extra match length bytes.
+// Last sequence only has literals.
+constexpr size_t MinMatch = 4;
+constexpr size_t MaxOffset = 0xffff;
+constexpr int HashBits = 12;
+
+inline uint32_t Read32(const uint8_t *ptr) noexcept {
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+inline uint64_t Read64(const uint8_t *ptr) noexcept {
+	uint64_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+constexpr uint32_t HashSequence(uint32_t sequence) noexcept {
+	return (sequence * 2654435761U) >> (32 - HashBits);
+}
+
+uint8_t *WriteExtraLength(uint8_t *op, size_t length) noexcept {
+	length -= 15;
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = static_cast<uint8_t>(length);
+	return op;
+}
+
+uint8_t *WriteLiterals(uint8_t *op, const uint8_t *literal, size_t literalLength, size_t matchCode) noexcept {
+	*op++ = static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(matchCode, 15));
+	if (literalLength >= 15) {
+		op = WriteExtraLength(op, literalLength);
+	}
+	memcpy(op, literal, literalLength);
+	return op + literalLength;
+}
+
+bool ReadExtraLength(const uint8_t *&ip, const uint8_t *end, size_t &length) noexcept {
+	uint8_t value;
+	do {
+		if (ip == end) {
+			return false;
+		}
+		value = *ip++;
+		length += value;
+	} while (value == 255);
+	return true;
+}
+
+}
+
+namespace Scintilla::Internal {
+
+size_t LZCompress(const char *source, size_t length, char *dest) noexcept {
+	const uint8_t * const src = reinterpret_cast<const uint8_t *>(source);
+	const uint8_t * const end = src + length;
+	uint8_t *op = reinterpret_cast<uint8_t *>(dest);
+	const uint8_t *ip = src;
+	const uint8_t *anchor = src;
+	uint32_t table[1 << HashBits] {};
+	if (length > MinMatch) {
+		const uint8_t * const limit = end - MinMatch;
+		while (ip <= limit) {
+			const uint32_t sequence = Read32(ip);
+			uint32_t &entry = table[HashSequence(sequence)];
+			const uint8_t *match = src + entry;
+			entry = static_cast<uint32_t>(ip - src);
+			if (match < ip && static_cast<size_t>(ip - match) <= MaxOffset && Read32(match) == sequence) {
+				while (ip > anchor && match > src && ip[-1] == match[-1]) {
+					--ip;
+					--match;
+				}
+				const uint8_t *matchEnd = ip + MinMatch;
+				const uint8_t *ref = match + MinMatch;
+				while (matchEnd + sizeof(uint64_t) <= end && Read64(matchEnd) == Read64(ref)) {
+					matchEnd += sizeof(uint64_t);
+					ref += sizeof(uint64_t);
+				}
+				while (matchEnd < end && *matchEnd == *ref) {
+					++matchEnd;
+					++ref;
+				}
+				const size_t offset = ip - match;
+				const size_t matchCode = (matchEnd - ip) - MinMatch;
+				op = WriteLiterals(op, anchor, ip - anchor, matchCode);
+				*op++ = static_cast<uint8_t>(offset);
+				*op++ = static_cast<uint8_t>(offset >> 8);
+				if (matchCode >= 15) {
+					op = WriteExtraLength(op, matchCode);
+				}
+				ip = matchEnd;
+				anchor = ip;
+				if (ip - 2 <= limit) {
+					table[HashSequence(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - src);
+				}
+			} else {
+				// skip faster over data that doesn't compress
+				ip += 1 + ((ip - anchor) >> 6);
+			}
+		}
+	}
+	op = WriteLiterals(op, anchor, end - anchor, 0);
+	return op - reinterpret_cast<uint8_t *>(dest);
+}
+
+bool LZDecompress(const char *source, size_t srcLength, char *dest, size_t length) noexcept {
+	const uint8_t *ip = reinterpret_cast<const uint8_t *>(source);
+	const uint8_t * const end = ip + srcLength;
+	uint8_t * const dst = reinterpret_cast<uint8_t *>(dest);
+	uint8_t *op = dst;
+	uint8_t * const opEnd = dst + length;
+	while (ip < end) {
+		const uint8_t token = *ip++;
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadExtraLength(ip, end, literalLength)) {
+			return false;
+		}
+		if (literalLength > static_cast<size_t>(end - ip) || literalLength > static_cast<size_t>(opEnd - op)) {
+			return false;
+		}
+		memcpy(op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+		if (ip == end) {
+			break;
+		}
+
+		if (end - ip < 2) {
+			return false;
+		}
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadExtraLength(ip, end, matchLength)) {
+			return false;
+		}
+		matchLength += MinMatch;
+		if (offset == 0 || offset > static_cast<size_t>(op - dst) || matchLength > static_cast<size_t>(opEnd - op)) {
+			return false;
+		}
+		const uint8_t *match = op - offset;
+		if (offset >= matchLength) {
+			memcpy(op, match, matchLength);
+		} else if (offset == 1) {
+			memset(op, *match, matchLength);
+		} else {
+			// overlapped copy repeats the pattern, double copied length each time
+			memcpy(op, match, offset);
+			size_t copied = offset;
+			while (copied < matchLength) {
+				const size_t count = std::min(copied, matchLength - copied);
+				memcpy(op + copied, op, count);
+				copied += count;
+			}
+		}
+		op += matchLength;
+	}
+	return op == opEnd;
+}
+
+CompressedStorage::CompressedStorage(const SplitVector<char> &source) : length{source.Length()} {
+	const size_t count = (length + BlockSize - 1) / BlockSize;
+	blocks.resize(count);
+	packed = std::make_unique<char[]>(LZCompressBound(BlockSize));
+	for (Slot &slot : slots) {
+		slot.data = std::make_unique<char[]>(BlockSize);
+	}
+	for (size_t block = 0; block < count; block++) {
+		const Sci::Position start = static_cast<Sci::Position>(block * BlockSize);
+		blocks[block].length = static_cast<uint32_t>(std::min<Sci::Position>(BlockSize, length - start));
+		source.GetRange(slots[0].data.get(), start, blocks[block].length);
+		Pack(block, slots[0].data.get());
+	}
+}
+
+CompressedStorage::~CompressedStorage() {
+	free(scratch);
+}
+
+void CompressedStorage::DecompressTo(SplitVector<char> &target) const {
+	target.ReAllocate(length + 1);
+	for (size_t block = 0; block < blocks.size(); block++) {
+		target.InsertFromArray(target.Length(), BlockData(block), 0, blocks[block].length);
+	}
+}
+
+void CompressedStorage::GetRange(char *buffer, Sci::Position position, Sci::Position rangeLength) const noexcept {
+	if (position < 0 || rangeLength <= 0 || position + rangeLength > length) {
+		return;
+	}
+	while (rangeLength > 0) {
+		const size_t block = position / BlockSize;
+		const size_t offset = position % BlockSize;
+		const Sci::Position count = std::min<Sci::Position>(rangeLength, blocks[block].length - offset);
+		memcpy(buffer, BlockData(block) + offset, count);
+		buffer += count;
+		position += count;
+		rangeLength -= count;
+	}
+}
+
+const char *CompressedStorage::RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept {
+	if (position >= 0 && position < length) {
+		const size_t block = position / BlockSize;
+		const size_t offset = position % BlockSize;
+		if (rangeLength >= 0 && static_cast<size_t>(rangeLength) <= blocks[block].length - offset) {
+			return BlockData(block) + offset;
+		}
+	}
+	// range spans blocks, copied with a terminating NUL
+	const size_t size = std::max<Sci::Position>(rangeLength, 0) + 1;
+	if (scratchSize < size) {
+		char *buffer = static_cast<char *>(realloc(scratch, size));
+		if (buffer == nullptr) {
+			return nullptr;
+		}
+		scratch = buffer;
+		scratchSize = size;
+	}
+	memset(scratch, 0, size);
+	GetRange(scratch, position, rangeLength);
+	return scratch;
+}
+
+bool CompressedStorage::SetValueAt(Sci::Position position, char value) {
+	if (position < 0 || position >= length || ValueAt(position) == value) {
+		return false;
+	}
+	WritableBlock(position / BlockSize)[position % BlockSize] = value;
+	return true;
+}
+
+bool CompressedStorage::SetValueFor(Sci::Position position, Sci::Position rangeLength, char value) {
+	if (position < 0 || rangeLength <= 0 || position + rangeLength > length) {
+		return false;
+	}
+	bool changed = false;
+	while (rangeLength > 0) {
+		const size_t block = position / BlockSize;
+		const size_t offset = position % BlockSize;
+		const Sci::Position count = std::min<Sci::Position>(rangeLength, blocks[block].length - offset);
+		const char *data = BlockData(block) + offset;
+		const char *differ = std::find_if(data, data + count, [value](char ch) noexcept {
+			return ch != value;
+		});
+		if (differ != data + count) {
+			memset(WritableBlock(block) + offset, value, count);
+			changed = true;
+		}
+		position += count;
+		rangeLength -= count;
+	}
+	return changed;
+}
+
+size_t CompressedStorage::MemoryUsage() const noexcept {
+	size_t size = sizeof(*this) + blocks.capacity() * sizeof(Block)
+		+ SlotCount * BlockSize + LZCompressBound(BlockSize) + scratchSize;
+	for (const Block &block : blocks) {
+		size += block.size;
+	}
+	return size;
+}
+
+char CompressedStorage::SlowValueAt(Sci::Position position) const noexcept {
+	if (position < 0 || position >= length) {
+		return '\0';
+	}
+	const size_t block = position / BlockSize;
+	const char *data = BlockData(block);
+	hotData = data;
+	hotStart = static_cast<Sci::Position>(block * BlockSize);
+	hotLength = blocks[block].length;
+	return data[position - hotStart];
+}
+
+const char *CompressedStorage::BlockData(size_t block) const noexcept {
+	const Block &item = blocks[block];
+	if (item.Raw()) {
+		return item.data.get();
+	}
+	++useCount;
+	int victim = -1;
+	for (int index = 0; index < SlotCount; index++) {
+		Slot &slot = slots[index];
+		if (slot.block == block) {
+			slot.lastUse = useCount;
+			return slot.data.get();
+		}
+		if (index != dirtySlot && (victim < 0 || slot.lastUse < slots[victim].lastUse)) {
+			victim = index;
+		}
+	}
+
+	Slot &slot = slots[victim];
+	if (hotData == slot.data.get()) {
+		hotLength = 0;
+	}
+	if (!LZDecompress(item.data.get(), item.size, slot.data.get(), item.length)) {
+		// not happen for blocks compressed by Pack()
+		memset(slot.data.get(), 0, item.length);
+	}
+	slot.block = block;
+	slot.lastUse = useCount;
+	return slot.data.get();
+}
+
+int CompressedStorage::FindSlot(size_t block) const noexcept {
+	for (int index = 0; index < SlotCount; index++) {
+		if (slots[index].block == block) {
+			return index;
+		}
+	}
+	return -1;
+}
+
+char *CompressedStorage::WritableBlock(size_t block) {
+	Block &item = blocks[block];
+	if (item.Raw()) {
+		return item.data.get();
+	}
+	if (dirtySlot >= 0) {
+		if (slots[dirtySlot].block == block) {
+			return slots[dirtySlot].data.get();
+		}
+		FlushDirty();
+	}
+	BlockData(block);
+	dirtySlot = FindSlot(block);
+	return slots[dirtySlot].data.get();
+}
+
+void CompressedStorage::FlushDirty() {
+	if (dirtySlot >= 0) {
+		Slot &slot = slots[dirtySlot];
+		Pack(slot.block, slot.data.get());
+		if (blocks[slot.block].Raw()) {
+			// raw block is accessed directly
+			slot.block = SIZE_MAX;
+			slot.lastUse = 0;
+		}
+		dirtySlot = -1;
+	}
+}
+
+void CompressedStorage::Pack(size_t block, const char *data) {
+	Block &item = blocks[block];
+	size_t size = LZCompress(data, item.length, packed.get());
+	if (size >= item.length) {
+		size = item.length;
+	} else {
+		data = packed.get();
+	}
+	if (!item.data || item.size != size) {
+		item.data = std::make_unique<char[]>(size);
+		item.size = static_cast<uint32_t>(size);
+	}
+	memcpy(item.data.get(), data, size);
+	hotLength = 0;
+}
+
+}
@@ -0,0 +1,105 @@
+// Scintilla source code edit control
+/** @file CompressedStorage.h
+ ** Read-mostly storage of text or styles as independently compressed blocks.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+#pragma once
+
+namespace Scintilla::Internal {
+
+/// Compress length bytes from src into dst, which has at least LZCompressBound(length) bytes.
+/// Returns compressed size, the format is same as LZ4 block without the end of block restrictions.
+size_t LZCompress(const char *src, size_t length, char *dst) noexcept;
+/// Returns false when src is not a valid compressed block for exactly length bytes.
+bool LZDecompress(const char *src, size_t srcLength, char *dst, size_t length) noexcept;
+constexpr size_t LZCompressBound(size_t length) noexcept {
+	return length + length/255 + 16;
+}
+
+/**
+ * Holds content of a SplitVector<char> as blocks compressed independently.
+ * A few recently used blocks are kept decompressed in slots, the least recently
+ * used slot is reused for another block. Blocks that don't compress are kept raw
+ * and accessed directly.
+ * Only one slot is modified at a time: it is compressed again before another block
+ * is modified, so reading never allocates.
+ * Not thread safe even for const methods, which update the slots.
+ */
+class CompressedStorage {
+public:
+	static constexpr size_t BlockSize = 64*1024;
+	static constexpr int SlotCount = 8;
+
+	/// Compress content of source, source is unchanged.
+	explicit CompressedStorage(const SplitVector<char> &source);
+	// Deleted so CompressedStorage objects can not be copied.
+	CompressedStorage(const CompressedStorage &) = delete;
+	CompressedStorage(CompressedStorage &&) = delete;
+	CompressedStorage &operator=(const CompressedStorage &) = delete;
+	CompressedStorage &operator=(CompressedStorage &&) = delete;
+	~CompressedStorage();
+
+	/// Decompress all content into empty target.
+	void DecompressTo(SplitVector<char> &target) const;
+
+	Sci::Position Length() const noexcept {
+		return length;
+	}
+	/// Retrieving positions outside the range returns 0.
+	char ValueAt(Sci::Position position) const noexcept {
+		const size_t offset = static_cast<size_t>(position - hotStart);
+		if (offset < hotLength) {
+			return hotData[offset];
+		}
+		return SlowValueAt(position);
+	}
+	void GetRange(char *buffer, Sci::Position position, Sci::Position rangeLength) const noexcept;
+	/// Pointer into a slot when the range is inside one block, otherwise range is copied into
+	/// a scratch buffer. The pointer is valid until SlotCount other blocks are accessed or next
+	/// RangePointer() call, returns nullptr when scratch buffer can't be allocated.
+	const char *RangePointer(Sci::Position position, Sci::Position rangeLength) noexcept;
+	/// @return true if the value is changed.
+	bool SetValueAt(Sci::Position position, char value);
+	bool SetValueFor(Sci::Position position, Sci::Position rangeLength, char value);
+
+	/// bytes used by blocks, slots and scratch buffer.
+	size_t MemoryUsage() const noexcept;
+
+private:
+	struct Block {
+		std::unique_ptr<char[]> data;
+		uint32_t size = 0;		// compressed size, same as block length when stored raw
+		uint32_t length = 0;
+		bool Raw() const noexcept {
+			return size == length;
+		}
+	};
+	struct Slot {
+		std::unique_ptr<char[]> data;
+		size_t block = SIZE_MAX;
+		uint64_t lastUse = 0;
+	};
+
+	Sci::Position length;
+	std::vector<Block> blocks;
+	mutable Slot slots[SlotCount];
+	mutable uint64_t useCount = 0;
+	int dirtySlot = -1;
+	// last accessed block, for fast ValueAt()
+	mutable const char *hotData = nullptr;
+	mutable Sci::Position hotStart = 0;
+	mutable size_t hotLength = 0;
+	std::unique_ptr<char[]> packed;
+	char *scratch = nullptr;
+	size_t scratchSize = 0;
+
+	char SlowValueAt(Sci::Position position) const noexcept;
+	/// Decompressed data of block, never evicts the dirty slot.
+	const char *BlockData(size_t block) const noexcept;
+	int FindSlot(size_t block) const noexcept;
+	char *WritableBlock(size_t block);
+	void FlushDirty();
+	void Pack(size_t block, const char *data);
+};
+
+}
@@ -38,7 +38,7 @@
 #include "ILexer.h"
 
 #include "Debugging.h"
-//#include "VectorISA.h"
+#include "VectorISA.h"
 
 #include "CharacterSet.h"
 //#include "CharacterCategory.h"
@@ -47,6 +47,7 @@
 #include "Partitioning.h"
 #include "RunStyles.h"
 #include "CellBuffer.h"
+#include "UndoHistory.h"
 #include "PerLine.h"
 #include "CharClassify.h"
 #include "Decoration.h"
@@ -55,11 +56,61 @@
 #include "RESearch.h"
 #include "UniConversion.h"
 #include "ElapsedPeriod.h"
+#include "ParallelSupport.h"
 
 using namespace Scintilla;
 using namespace Scintilla::Internal;
 using namespace Lexilla;
 
+namespace Scintilla::Internal {
+
+/**
+ * Search pattern prepared for non-regex search, kept in the document and reused
+ * while the pattern, options and direction are unchanged.
+ */
+class SearchThing {
+	std::string pattern;
+	std::string folded;
+	int increment = 0;
+	bool caseSensitive = false;
+public:
+	size_t lenSearch = 0;
+	Sci::Position shiftTable[256];
+
+	/// @return false when already prepared for the same search.
+	bool Reset(const char *search, Sci::Position lengthFind, bool caseSensitive_, int increment_) {
+		increment_ = caseSensitive_ ? increment_ : 0;
+		if (caseSensitive == caseSensitive_ && increment == increment_
+			&& pattern.length() == static_cast<size_t>(lengthFind)
+			&& memcmp(pattern.data(), search, lengthFind) == 0) {
+			return false;
+		}
+		caseSensitive = caseSensitive_;
+		increment = increment_;
+		pattern.assign(search, lengthFind);
+		return true;
+	}
+	void Allocate(size_t size) {
+		folded.assign(size, '\0');
+	}
+	void Invalidate() noexcept {
+		pattern.clear();
+		increment = 0;
+	}
+
+	size_t size() const noexcept {
+		return folded.size();
+	}
+	char* data() noexcept {
+		return folded.data();
+	}
+	const char* data() const noexcept {
+		return folded.data();
+	}
+};
+
+}
+
 LexInterface::LexInterface(Document *pdoc_) noexcept : pdoc(pdoc_), performingStyle(false) {
 }
 
@@ -152,7 +203,6 @@ Document::Document(DocumentOption options) :
 	dbcsCodePage = CpUtf8;
 	lineEndBitSet = LineEndType::Default;
 	endStyled = 0;
-	styleClock = 0;
 	enteredModification = 0;
 	enteredStyling = 0;
 	enteredReadOnlyCount = 0;
@@ -181,9 +231,14 @@ Document::Document(DocumentOption options) :
 }
 
 Document::~Document() {
+	NotifyDeleted();
+}
+
+void Document::NotifyDeleted() noexcept {
 	for (const auto &watcher : watchers) {
 		watcher.watcher->NotifyDeleted(this, watcher.userData);
 	}
+	watchers.clear();
 }
 
 // Increase reference count and return its previous value.
@@ -195,8 +250,16 @@ int SCI_METHOD Document::AddRef() noexcept {
 // Delete the document if reference count reaches zero.
 int SCI_METHOD Document::Release() noexcept {
 	const int curRefCount = --refCount;
-	if (curRefCount == 0)
-		delete this;
+	if (curRefCount == 0) {
+		if (LengthNoExcept() < backgroundDeleteSize) {
+			delete this;
+		} else {
+			// freeing text, undo history and per line data for huge document
+			// takes noticeable time, watchers are notified on current thread.
+			NotifyDeleted();
+			DeleteInBackground(this);
+		}
+	}
 	return curRefCount;
 }
 
@@ -270,6 +333,9 @@ bool Document::SetDBCSCodePage(int dbcsCodePage_) {
 	if (dbcsCodePage != dbcsCodePage_) {
 		dbcsCodePage = dbcsCodePage_;
 		pcf.reset();
+		if (searchThing) {
+			searchThing->Invalidate();
+		}
 		cb.SetLineEndTypes(lineEndBitSet & LineEndTypesSupported());
 		cb.SetUTF8Substance(CpUtf8 == dbcsCodePage);
 		DBCSCharClassify *classify = nullptr;
@@ -630,6 +696,42 @@ int SCI_METHOD Document::SetLevel(Sci_Line line, int level) {
 	return prev;
 }
 
+void SCI_METHOD Document::SetLevels(Sci_Line lineStart, Sci_Line lineCount, const int *levels) {
+	// lines whose header state changed are notified individually to update contraction state,
+	// other changed lines are summarized into one notification with unchanged fold level.
+	LineLevels *lineLevels = Levels();
+	const Sci::Line lines = LinesTotal();
+	Sci::Line firstChanged = -1;
+	Sci::Line lastChanged = -1;
+	for (Sci::Line index = 0; index < lineCount; index++) {
+		const Sci::Line line = lineStart + index;
+		const int level = levels[index];
+		const int prev = lineLevels->SetLevel(line, level, lines);
+		if (prev != level) {
+			const FoldLevel levelNow = static_cast<FoldLevel>(level);
+			const FoldLevel levelPrev = static_cast<FoldLevel>(prev);
+			if (LevelIsHeader(levelNow) != LevelIsHeader(levelPrev)) {
+				DocModification mh(ModificationFlags::ChangeFold | ModificationFlags::ChangeMarker,
+					LineStart(line), 0, 0, nullptr, line);
+				mh.foldLevelNow = levelNow;
+				mh.foldLevelPrev = levelPrev;
+				NotifyModified(mh);
+			} else {
+				if (firstChanged < 0) {
+					firstChanged = line;
+				}
+				lastChanged = line;
+			}
+		}
+	}
+	if (firstChanged >= 0) {
+		const Sci::Position position = LineStart(firstChanged);
+		const DocModification mh(ModificationFlags::ChangeFold | ModificationFlags::ChangeMarker,
+			position, LineStart(lastChanged + 1) - position, 0, nullptr, firstChanged);
+		NotifyModified(mh);
+	}
+}
+
 FoldLevel Document::GetFoldLevel(Sci_Position line) const noexcept {
 	return static_cast<FoldLevel>(Levels()->GetLevel(line));
 }
@@ -862,7 +964,8 @@ Sci::Position Document::MovePositionOutsideChar(Sci::Position pos, Sci::Position
 			return pos - 1;
 	}
 
-	if (dbcsCodePage) {
+	// no lead or trail bytes in pure ASCII text
+	if (dbcsCodePage && !cb.AllASCII()) {
 		if (CpUtf8 == dbcsCodePage) {
 			const unsigned char ch = cb.UCharAt(pos);
 			// If ch is not a trail byte then pos is valid intercharacter position
@@ -1082,7 +1185,14 @@ CharacterExtracted Document::CharacterBefore(Sci::Position position) const noexc
 // Return -1  on out-of-bounds
 Sci_Position SCI_METHOD Document::GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const noexcept {
 	Sci::Position pos = positionStart;
-	if (dbcsCodePage) {
+	if (dbcsCodePage && cb.AllASCII()) {
+		// every character is a single byte
+		if (characterOffset != 0) {
+			pos = positionStart + characterOffset;
+			if (pos < 0 || pos > LengthNoExcept())
+				return Sci::invalidPosition;
+		}
+	} else if (dbcsCodePage) {
 		const int increment = (characterOffset > 0) ? 1 : -1;
 		while (characterOffset != 0) {
 			const Sci::Position posNext = NextPosition(pos, increment);
@@ -1101,7 +1211,14 @@ Sci_Position SCI_METHOD Document::GetRelativePosition(Sci_Position positionStart
 
 Sci::Position Document::GetRelativePositionUTF16(Sci::Position positionStart, Sci::Position characterOffset) const noexcept {
 	Sci::Position pos = positionStart;
-	if (dbcsCodePage) {
+	if (dbcsCodePage && cb.AllASCII()) {
+		// every character is a single byte
+		if (characterOffset != 0) {
+			pos = positionStart + characterOffset;
+			if (pos < 0 || pos > LengthNoExcept())
+				return Sci::invalidPosition;
+		}
+	} else if (dbcsCodePage) {
 		const int increment = (characterOffset > 0) ? 1 : -1;
 		while (characterOffset != 0) {
 			const Sci::Position posNext = NextPosition(pos, increment);
@@ -1291,6 +1408,63 @@ void Document::ModifiedAt(Sci::Position pos) noexcept {
 		endStyled = pos;
 }
 
+namespace {
+
+// styles of smaller text are cheap to lex again
+constexpr Sci::Position minActionStylesLength = 64*1024;
+
+}
+
+// Keep styles of large text removed from document, undo and redo only move the document
+// between identical states, so the styles are valid again when the text is inserted back.
+// Styles are kept from line start, as lexer may style text before position differently
+// (e.g. a word split by the action).
+bool Document::CaptureActionStyles(ActionStyles &styles, Sci::Position position, Sci::Position length) {
+	if (length < minActionStylesLength || !cb.HasStyles() || !cb.IsCollectingUndo()
+		|| !pli || pli->UseContainerLexing() || endStyled < position + length) {
+		return false;
+	}
+	const Sci::Line lineStart = SciLineFromPosition(position);
+	const Sci::Line lineEnd = SciLineFromPosition(position + length);
+	const Sci::Position startPos = LineStart(lineStart);
+	styles.lineStateBefore = GetLineState(lineStart - 1);
+	styles.prefixLength = position - startPos;
+	styles.lineStates.resize(lineEnd - lineStart);
+	styles.levels.resize(lineEnd - lineStart);
+	for (Sci::Line line = lineStart; line < lineEnd; line++) {
+		styles.lineStates[line - lineStart] = GetLineState(line);
+		styles.levels[line - lineStart] = GetLevel(line);
+	}
+	const char *styleData = cb.StyleRangePointer(startPos, styles.prefixLength + length);
+	styles.Compress(styleData, styles.prefixLength + length);
+	return true;
+}
+
+void Document::RestoreActionStyles(const ActionStyles &styles, Sci::Position position, Sci::Position length) {
+	const Sci::Position startPos = position - styles.prefixLength;
+	Sci::Position pos = startPos;
+	for (size_t run = 0; run < styles.Runs(); run++) {
+		const Sci::Position lengthRun = styles.lengths.ValueAt(run);
+		cb.SetStyleFor(pos, lengthRun, styles.styles[run]);
+		pos += lengthRun;
+	}
+	PLATFORM_ASSERT(pos == position + length);
+	NotifyModified(DocModification(ModificationFlags::ChangeStyle | ModificationFlags::User, startPos, pos - startPos));
+
+	// text before the line is styled and lexer state at the boundary is unchanged,
+	// restore per line lexer data and skip lexing the text.
+	const Sci::Line lineStart = SciLineFromPosition(position);
+	PLATFORM_ASSERT(startPos == LineStart(lineStart));
+	if (endStyled >= startPos && GetLineState(lineStart - 1) == styles.lineStateBefore) {
+		Sci::Line line = lineStart;
+		for (size_t index = 0; index < styles.lineStates.size(); index++, line++) {
+			SetLineState(line, styles.lineStates[index]);
+			SetLevel(line, styles.levels[index]);
+		}
+		endStyled = position + length;
+	}
+}
+
 void Document::CheckReadOnly() noexcept {
 	if (cb.IsReadOnly() && enteredReadOnlyCount == 0) {
 		enteredReadOnlyCount++;
@@ -1334,7 +1508,13 @@ bool Document::DeleteChars(Sci::Position pos, Sci::Position len) {
 			const Sci::Line prevLinesTotal = LinesTotal();
 			const bool startSavePoint = cb.IsSavePoint();
 			bool startSequence = false;
+			ActionStyles styles;
+			const bool captured = CaptureActionStyles(styles, pos, len);
 			const char *text = cb.DeleteChars(pos, len, startSequence);
+			if (captured) {
+				styles.action = cb.UndoCurrent() - 1;
+				cb.SetUndoActionStyles(std::move(styles));
+			}
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(false);
 			if ((pos < LengthNoExcept()) || (pos == 0))
@@ -1470,6 +1650,7 @@ Sci::Position Document::Undo() {
 			for (int step = 0; step < steps; step++) {
 				const Sci::Line prevLinesTotal = LinesTotal();
 				const Action action = cb.GetUndoStep();
+				const int actionIndex = cb.UndoCurrent() - 1;
 				if (action.at == ActionType::remove) {
 					NotifyModified(DocModification(
 						ModificationFlags::BeforeInsert | ModificationFlags::Undo, action));
@@ -1480,6 +1661,11 @@ Sci::Position Document::Undo() {
 				} else {
 					NotifyModified(DocModification(
 						ModificationFlags::BeforeDelete | ModificationFlags::Undo, action));
+					ActionStyles styles;
+					if (CaptureActionStyles(styles, action.position, action.lenData)) {
+						styles.action = actionIndex;
+						cb.SetUndoActionStyles(std::move(styles));
+					}
 				}
 				cb.PerformUndoStep();
 				if (action.at != ActionType::container) {
@@ -1514,6 +1700,11 @@ Sci::Position Document::Undo() {
 				}
 				NotifyModified(DocModification(modFlags, action.position, action.lenData,
 					linesAdded, action.data));
+				if (action.at == ActionType::remove) {
+					if (const ActionStyles *styles = cb.UndoActionStyles(actionIndex)) {
+						RestoreActionStyles(*styles, action.position, action.lenData);
+					}
+				}
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -1537,6 +1728,7 @@ Sci::Position Document::Redo() {
 			for (int step = 0; step < steps; step++) {
 				const Sci::Line prevLinesTotal = LinesTotal();
 				const Action action = cb.GetRedoStep();
+				const int actionIndex = cb.UndoCurrent();
 				if (action.at == ActionType::insert) {
 					NotifyModified(DocModification(
 						ModificationFlags::BeforeInsert | ModificationFlags::Redo, action));
@@ -1547,6 +1739,11 @@ Sci::Position Document::Redo() {
 				} else {
 					NotifyModified(DocModification(
 						ModificationFlags::BeforeDelete | ModificationFlags::Redo, action));
+					ActionStyles styles;
+					if (CaptureActionStyles(styles, action.position, action.lenData)) {
+						styles.action = actionIndex;
+						cb.SetUndoActionStyles(std::move(styles));
+					}
 				}
 				cb.PerformRedoStep();
 				if (action.at != ActionType::container) {
@@ -1574,6 +1771,11 @@ Sci::Position Document::Redo() {
 				NotifyModified(
 					DocModification(modFlags, action.position, action.lenData,
 						linesAdded, action.data));
+				if (action.at == ActionType::insert) {
+					if (const ActionStyles *styles = cb.UndoActionStyles(actionIndex)) {
+						RestoreActionStyles(*styles, action.position, action.lenData);
+					}
+				}
 			}
 
 			const bool endSavePoint = cb.IsSavePoint();
@@ -1690,6 +1892,9 @@ Sci::Position Document::GetColumn(Sci::Position pos) const noexcept {
 Sci::Position Document::CountCharacters(Sci::Position startPos, Sci::Position endPos) const noexcept {
 	startPos = MovePositionOutsideChar(startPos, 1, false);
 	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (!dbcsCodePage || cb.AllASCII()) {
+		return std::max<Sci::Position>(endPos - startPos, 0);
+	}
 	Sci::Position count = 0;
 	Sci::Position i = startPos;
 	while (i < endPos) {
@@ -1729,6 +1934,9 @@ void Document::CountCharactersAndColumns(sptr_t lParam) const noexcept {
 Sci::Position Document::CountUTF16(Sci::Position startPos, Sci::Position endPos) const noexcept {
 	startPos = MovePositionOutsideChar(startPos, 1, false);
 	endPos = MovePositionOutsideChar(endPos, -1, false);
+	if (!dbcsCodePage || cb.AllASCII()) {
+		return std::max<Sci::Position>(endPos - startPos, 0);
+	}
 	Sci::Position count = 0;
 	Sci::Position i = startPos;
 	while (i < endPos) {
@@ -2057,43 +2265,6 @@ constexpr bool IsWordEdge(CharacterClass cc, CharacterClass ccNext) noexcept {
 	return (cc != ccNext) && (cc >= CharacterClass::punctuation);
 }
 
-class SearchThing {
-	char *buffer = nullptr;
-	size_t length = 0;
-public:
-	Sci::Position shiftTable[256];
-	void Allocate(size_t size) {
-		length = size;
-		if (size <= sizeof(shiftTable)) {
-			buffer = reinterpret_cast<char *>(shiftTable);
-		} else {
-			buffer = new char[size];
-		}
-		memset(buffer, 0, size);
-	}
-	~SearchThing() noexcept {
-		if (length > sizeof(shiftTable)) {
-			delete[] buffer;
-		}
-	}
-
-	char& operator[](size_t index) noexcept {
-		return buffer[index];
-	}
-	const char& operator[](size_t index) const noexcept {
-		return buffer[index];
-	}
-	size_t size() const noexcept {
-		return length;
-	}
-	char* data() noexcept {
-		return buffer;
-	}
-	const char* data() const noexcept {
-		return buffer;
-	}
-};
-
 }
 
 /**
@@ -2148,6 +2319,9 @@ bool Document::HasCaseFolder() const noexcept {
 
 void Document::SetCaseFolder(std::unique_ptr<CaseFolder> pcf_) noexcept {
 	pcf = std::move(pcf_);
+	if (searchThing) {
+		searchThing->Invalidate();
+	}
 }
 
 CharacterExtracted Document::ExtractCharacter(Sci::Position position) const noexcept {
@@ -2208,15 +2382,18 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			pos = NextPosition(pos, -1);
 		}
 		const SplitView cbView = cb.AllView();
-		SearchThing searchThing;
+		if (!searchThing) {
+			searchThing = std::make_unique<SearchThing>();
+		}
+		const bool changed = searchThing->Reset(search, lengthFind, caseSensitive, increment);
 		if (caseSensitive) {
 			const unsigned char * const searchData = reinterpret_cast<const unsigned char *>(search);
 			// Boyer-Moore-Horspool-Sunday Algorithm / Quick Search Algorithm
 			// https://www-igm.univ-mlv.fr/~lecroq/string/index.html
 			// https://www-igm.univ-mlv.fr/~lecroq/string/node19.html
 			// https://www.inf.hs-flensburg.de/lang/algorithmen/pattern/sundayen.htm
-			auto& shiftTable = searchThing.shiftTable;
-			if (lengthFind != 1) {
+			auto& shiftTable = searchThing->shiftTable;
+			if (changed && lengthFind != 1) {
 				Sci::Position shift = lengthFind;
 				const Sci::Position value = (shift + 1) * increment;
 				//std::fill_n(shiftTable, std::size(shiftTable), value);
@@ -2278,9 +2455,12 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			}
 		} else if (CpUtf8 == dbcsCodePage) {
 			constexpr size_t maxFoldingExpansion = 4;
-			searchThing.Allocate((lengthFind + 1) * UTF8MaxBytes * maxFoldingExpansion + 1);
-			const size_t lenSearch = pcf->Fold(searchThing.data(), searchThing.size(), search, lengthFind);
-			const unsigned char * const searchData = reinterpret_cast<const unsigned char *>(searchThing.data());
+			if (changed) {
+				searchThing->Allocate((lengthFind + 1) * UTF8MaxBytes * maxFoldingExpansion + 1);
+				searchThing->lenSearch = pcf->Fold(searchThing->data(), searchThing->size(), search, lengthFind);
+			}
+			const size_t lenSearch = searchThing->lenSearch;
+			const unsigned char * const searchData = reinterpret_cast<const unsigned char *>(searchThing->data());
 			//while (forward ? (pos < endPos) : (pos >= endPos)) {
 			while ((direction ^ (pos - endPos)) < 0) {
 				int widthFirstCharacter = 1;
@@ -2312,7 +2492,7 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 						char folded[UTF8MaxBytes * maxFoldingExpansion + 1];
 						lenFlat = pcf->Fold(folded, sizeof(folded), bytes, widthChar);
 						// memcmp may examine lenFlat bytes in both arguments so assert it doesn't read past end of searchThing
-						assert((indexSearch + lenFlat) <= searchThing.size());
+						assert((indexSearch + lenFlat) <= searchThing->size());
 						// Does folded match the buffer
 						characterMatches = 0 == memcmp(folded, searchData + indexSearch, lenFlat);
 					}
@@ -2342,9 +2522,12 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 		} else if (dbcsCodePage) {
 			constexpr size_t maxBytesCharacter = 2;
 			constexpr size_t maxFoldingExpansion = 4;
-			searchThing.Allocate((lengthFind + 1) * maxBytesCharacter * maxFoldingExpansion + 1);
-			const size_t lenSearch = pcf->Fold(searchThing.data(), searchThing.size(), search, lengthFind);
-			const unsigned char * const searchData = reinterpret_cast<const unsigned char *>(searchThing.data());
+			if (changed) {
+				searchThing->Allocate((lengthFind + 1) * maxBytesCharacter * maxFoldingExpansion + 1);
+				searchThing->lenSearch = pcf->Fold(searchThing->data(), searchThing->size(), search, lengthFind);
+			}
+			const size_t lenSearch = searchThing->lenSearch;
+			const unsigned char * const searchData = reinterpret_cast<const unsigned char *>(searchThing->data());
 			//while (forward ? (pos < endPos) : (pos >= endPos)) {
 			while ((direction ^ (pos - endPos)) < 0) {
 				int widthFirstCharacter = 0;
@@ -2371,7 +2554,7 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 						char folded[maxBytesCharacter * maxFoldingExpansion + 1];
 						lenFlat = pcf->Fold(folded, sizeof(folded), bytes, widthChar);
 						// memcmp may examine lenFlat bytes in both arguments so assert it doesn't read past end of searchThing
-						assert((indexSearch + lenFlat) <= searchThing.size());
+						assert((indexSearch + lenFlat) <= searchThing->size());
 						// Does folded match the buffer
 						characterMatches = 0 == memcmp(folded, searchData + indexSearch, lenFlat);
 					}
@@ -2400,9 +2583,11 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 			}
 		} else {
 			const Sci::Position endSearch = (startPos <= endPos) ? endPos - lengthFind + 1 : endPos;
-			searchThing.Allocate(lengthFind + 1);
-			pcf->Fold(searchThing.data(), searchThing.size(), search, lengthFind);
-			const char * const searchData = searchThing.data();
+			if (changed) {
+				searchThing->Allocate(lengthFind + 1);
+				pcf->Fold(searchThing->data(), searchThing->size(), search, lengthFind);
+			}
+			const char * const searchData = searchThing->data();
 			//while (forward ? (pos < endSearch) : (pos >= endSearch)) {
 			while ((direction ^ (pos - endSearch)) < 0) {
 				bool found = (pos + lengthFind) <= limitPos;
@@ -2428,6 +2613,80 @@ Sci::Position Document::FindText(Sci::Position minPos, Sci::Position maxPos, con
 	return -1;
 }
 
+namespace {
+
+// find first style not matching the mask state.
+const uint8_t *SkipStyleRun(const uint8_t *ptr, const uint8_t *end, const uint32_t *styleMask, bool included) noexcept {
+	while (ptr < end) {
+		const uint8_t style = *ptr;
+		if (BitTestEx(styleMask, style) != included) {
+			break;
+		}
+#if NP2_USE_SSE2
+		// skip block with same style
+		if (end - ptr >= static_cast<ptrdiff_t>(sizeof(__m128i))) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(style))) == 0xffff) {
+				ptr += sizeof(__m128i);
+				continue;
+			}
+		}
+#endif
+		++ptr;
+	}
+	return ptr;
+}
+
+// backward version of SkipStyleRun(), returns position after the style not matching the mask state.
+const uint8_t *SkipStyleRunBack(const uint8_t *start, const uint8_t *ptr, const uint32_t *styleMask, bool included) noexcept {
+	while (ptr > start) {
+		const uint8_t style = ptr[-1];
+		if (BitTestEx(styleMask, style) != included) {
+			break;
+		}
+#if NP2_USE_SSE2
+		if (ptr - start >= static_cast<ptrdiff_t>(sizeof(__m128i))) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr - sizeof(__m128i)));
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(style))) == 0xffff) {
+				ptr -= sizeof(__m128i);
+				continue;
+			}
+		}
+#endif
+		--ptr;
+	}
+	return ptr;
+}
+
+}
+
+/**
+ * Find the first (or last when minPos > maxPos) run of text with styles in
+ * styleMask inside the range. Returns an empty range when no such run.
+ */
+Range Document::FindStyleRun(Sci::Position minPos, Sci::Position maxPos, const uint32_t *styleMask) noexcept {
+	const bool forward = minPos <= maxPos;
+	const Sci::Position startPos = forward ? minPos : maxPos;
+	const Sci::Position length = std::abs(maxPos - minPos);
+	const uint8_t *styles = reinterpret_cast<const uint8_t *>(StyleRangePointer(startPos, length));
+	if (styles == nullptr) {
+		// not styled, all text has style zero
+		return BitTestEx(styleMask, 0) ? Range(startPos, startPos + length) : Range(minPos);
+	}
+
+	const uint8_t * const end = styles + length;
+	const uint8_t *runStart;
+	const uint8_t *runEnd;
+	if (forward) {
+		runStart = SkipStyleRun(styles, end, styleMask, false);
+		runEnd = SkipStyleRun(runStart, end, styleMask, true);
+	} else {
+		runEnd = SkipStyleRunBack(styles, end, styleMask, false);
+		runStart = SkipStyleRunBack(styles, runEnd, styleMask, true);
+	}
+	return Range(startPos + (runStart - styles), startPos + (runEnd - styles));
+}
+
 const char *Document::SubstituteByPosition(const char *text, Sci::Position *length) {
 	if (regex)
 		return regex->SubstituteByPosition(this, text, length);
@@ -2453,14 +2712,23 @@ void Document::AllocateLines(Sci::Line lines) {
 
 void Document::SetDefaultCharClasses(bool includeWordClass) noexcept {
 	charClass.SetDefaultCharClasses(includeWordClass);
+	if (regex) {
+		regex->ClearCache();
+	}
 }
 
 void Document::SetCharClasses(const unsigned char *chars, CharacterClass newCharClass) noexcept {
 	charClass.SetCharClasses(chars, newCharClass);
+	if (regex) {
+		regex->ClearCache();
+	}
 }
 
 void Document::SetCharClassesEx(const unsigned char *chars, size_t length) noexcept {
 	charClass.SetCharClassesEx(chars, length);
+	if (regex) {
+		regex->ClearCache();
+	}
 }
 
 int Document::GetCharsOfClass(CharacterClass characterClass, unsigned char *buffer) const noexcept {
@@ -2528,7 +2796,6 @@ bool SCI_METHOD Document::SetStyles(Sci_Position length, const unsigned char *st
 
 void Document::EnsureStyledTo(Sci::Position pos) {
 	if ((enteredStyling == 0) && (pos > GetEndStyled())) {
-		IncrementStyleClock();
 		if (pli && !pli->UseContainerLexing()) {
 			const Sci::Position endStyledTo = LineStartPosition(GetEndStyled());
 			pli->Colourise(endStyledTo, pos);
@@ -2554,6 +2821,7 @@ void Document::LexerChanged(bool hasStyles_) { //! removed in Scintilla 5.3
 	if (cb.EnsureStyleBuffer(hasStyles_)) {
 		endStyled = 0;
 	}
+	cb.DiscardUndoActionStyles();
 }
 
 LexInterface *Document::GetLexInterface() const noexcept {
@@ -2702,10 +2970,6 @@ void Document::EOLAnnotationClearAll() {
 	EOLAnnotations()->ClearAll();
 }
 
-void Document::IncrementStyleClock() noexcept {
-	styleClock = (styleClock + 1) % 0x100000;
-}
-
 void SCI_METHOD Document::DecorationSetCurrentIndicator(int indicator) noexcept {
 	decorations->SetCurrentIndicator(indicator);
 }
@@ -2775,8 +3039,14 @@ void Document::NotifySavePoint(bool atSavePoint) noexcept {
 void Document::NotifyModified(DocModification mh) {
 	if (FlagSet(mh.modificationType, ModificationFlags::InsertText)) {
 		decorations->InsertSpace(mh.position, mh.length);
+		if (regex) {
+			regex->ClearCache();
+		}
 	} else if (FlagSet(mh.modificationType, ModificationFlags::DeleteText)) {
 		decorations->DeleteRange(mh.position, mh.length);
+		if (regex) {
+			regex->ClearCache();
+		}
 	}
 	for (const auto &watcher : watchers) {
 		watcher.watcher->NotifyModified(this, mh, watcher.userData);
@@ -2982,6 +3252,31 @@ public:
 	}
 };
 
+/**
+ * DocumentIndexer that also records the maximum position read, used to check whether
+ * a match found with a search end position is unchanged with a smaller end position.
+ */
+class TrackingDocumentIndexer final : public CharacterIndexer {
+	const Document *pdoc;
+	Sci::Position end;
+public:
+	mutable Sci::Position maxIndex = -1;
+	TrackingDocumentIndexer(const Document *pdoc_, Sci::Position end_) noexcept :
+		pdoc(pdoc_), end(end_) {}
+
+	char CharAt(Sci::Position index) const noexcept override {
+		maxIndex = std::max(maxIndex, index);
+		if (IsValidIndex(index, end))
+			return pdoc->CharAt(index);
+		else
+			return '\0';
+	}
+
+	Sci::Position MovePositionOutsideChar(Sci::Position pos, Sci::Position moveDir) const noexcept override {
+		return pdoc->MovePositionOutsideChar(pos, moveDir, false);
+	}
+};
+
 /**
  * Implementation of RegexSearchBase for the default built-in regular expression engine
  */
@@ -2993,6 +3288,10 @@ public:
 
 	const char *SubstituteByPosition(const Document *doc, const char *text, Sci::Position *length) override;
 
+	void ClearCache() noexcept override {
+		backward.line = -1;
+	}
+
 #if defined(BOOST_REGEX_STANDALONE) || !defined(NO_CXX11_REGEX)
 	Sci::Position CxxRegexFindText(const Document *doc, Sci::Position minPos, Sci::Position maxPos, const char *pattern, FindOption flags, Sci::Position *length);
 #endif
@@ -3010,6 +3309,25 @@ private:
 	std::string cachedPattern;
 #endif
 	std::string substituted;
+
+	// matches on a line found by backward search. Find previous searches the line again
+	// with end position moved to start of last match, matches before it are reused
+	// when they didn't read text after the new end position.
+	struct LineMatch {
+		Sci::Position startPos;	// start of the match
+		Sci::Position endPos;	// end of match
+		Sci::Position maxIndex;	// maximum position read by searches until this match
+	};
+	struct BackwardMatchCache {
+		std::string pattern;
+		FindOption flags = FindOption::None;
+		Sci::Line line = -1;
+		Sci::Position startOfLine = 0;
+		Sci::Position endOfLine = 0;
+		std::vector<LineMatch> matches;
+	} backward;
+
+	bool FindLastMatchOnLine(const Document *doc, Sci::Line line, Sci::Position startOfLine, Sci::Position endOfLine, const char *pattern, size_t patternLen, FindOption flags);
 };
 
 /**
@@ -3444,33 +3762,22 @@ Sci::Position BuiltinRegex::FindText(const Document *doc, Sci::Position minPos,
 			}
 		}
 
-		const DocumentIndexer di(doc, endOfLine);
 		search.SetLineRange(lineStartPos, lineEndPos);
-		int success = search.Execute(di, startOfLine, endOfLine);
-		if (success) {
-			Sci::Position endPos = search.eopat[0];
-			// There can be only one start of a line, so no need to look for last match in line
-			if ((resr.increment < 0) && !searchforLineStart) {
-				// Check for the last match on this line.
-				while (success && (endPos < endOfLine)) {
-					const RESearch::MatchPositions bopat = search.bopat;
-					const RESearch::MatchPositions eopat = search.eopat;
-					pos = endPos;
-					if (pos == bopat[0]) {
-						// empty match
-						pos = doc->NextPosition(pos, 1);
-					}
-					success = search.Execute(di, pos, endOfLine);
-					if (success) {
-						endPos = search.eopat[0];
-					} else {
-						search.bopat = bopat;
-						search.eopat = eopat;
-					}
-				}
+		// There can be only one start of a line, so no need to look for last match in line
+		if ((resr.increment < 0) && !searchforLineStart) {
+			if (FindLastMatchOnLine(doc, line, startOfLine, endOfLine, pattern, patternLen, flags)) {
+				pos = search.bopat[0];
+				lenRet = search.eopat[0] - pos;
+				break;
 			}
+			continue;
+		}
+
+		const DocumentIndexer di(doc, endOfLine);
+		const int success = search.Execute(di, startOfLine, endOfLine);
+		if (success) {
 			pos = search.bopat[0];
-			lenRet = endPos - pos;
+			lenRet = search.eopat[0] - pos;
 			break;
 		}
 	}
@@ -3478,6 +3785,76 @@ Sci::Position BuiltinRegex::FindText(const Document *doc, Sci::Position minPos,
 	return pos;
 }
 
+// Find the last match on the line. Each search resumes from end of previous match,
+// so overlapping matches are same as forward search ("aa" in "aaa" is found at 0).
+// For find previous on same line, matches before new end position are reused,
+// the line is scanned only once like forward search.
+bool BuiltinRegex::FindLastMatchOnLine(const Document *doc, Sci::Line line, Sci::Position startOfLine, Sci::Position endOfLine, const char *pattern, size_t patternLen, FindOption flags) {
+	std::vector<LineMatch> &matches = backward.matches;
+	size_t count = 0;
+	bool complete = false;
+	if (backward.line == line && backward.startOfLine == startOfLine && endOfLine <= backward.endOfLine
+		&& backward.flags == flags && backward.pattern.length() == patternLen
+		&& memcmp(backward.pattern.data(), pattern, patternLen) == 0) {
+		if (endOfLine == backward.endOfLine) {
+			count = matches.size();
+			complete = true;
+		} else {
+			// the match is unchanged when the search didn't read text after new end position,
+			// both end position and read position are increasing.
+			const auto it = std::partition_point(matches.begin(), matches.end(), [endOfLine](const LineMatch &match) noexcept {
+				return match.endPos < endOfLine && match.maxIndex < endOfLine;
+			});
+			count = it - matches.begin();
+			if (it != matches.end() && it->endPos == endOfLine && it->maxIndex < endOfLine) {
+				++count;
+			}
+		}
+	} else {
+		backward.pattern.assign(pattern, patternLen);
+		backward.flags = flags;
+		backward.line = line;
+		backward.startOfLine = startOfLine;
+	}
+	backward.endOfLine = endOfLine;
+	matches.resize(count);
+
+	const TrackingDocumentIndexer di(doc, endOfLine);
+	int success = 0;
+	if (count == 0 && !complete) {
+		success = search.Execute(di, startOfLine, endOfLine);
+		if (success) {
+			matches.push_back({search.bopat[0], search.eopat[0], di.maxIndex});
+		}
+	} else {
+		success = !complete;
+	}
+	bool current = success != 0 && count == 0;
+	while (success && matches.back().endPos < endOfLine) {
+		const LineMatch &match = matches.back();
+		Sci::Position pos = match.endPos;
+		if (pos == match.startPos) {
+			// empty match
+			pos = doc->NextPosition(pos, 1);
+		}
+		di.maxIndex = match.maxIndex;
+		success = search.Execute(di, pos, endOfLine);
+		current = success != 0;
+		if (success) {
+			matches.push_back({search.bopat[0], search.eopat[0], di.maxIndex});
+		}
+	}
+	if (matches.empty()) {
+		return false;
+	}
+	if (!current) {
+		// search again to restore sub-expressions for the reused or previous match
+		const LineMatch &match = matches.back();
+		search.Execute(di, match.startPos, endOfLine);
+	}
+	return true;
+}
+
 const char *BuiltinRegex::SubstituteByPosition(const Document *doc, const char *text, Sci::Position *length) {
 	substituted.clear();
 	for (Sci::Position j = 0; j < *length; j++) {
@@ -102,11 +102,16 @@ public:
 
 	///@return String with the substitutions, must remain valid until the next call or destruction
 	virtual const char *SubstituteByPosition(const Document *doc, const char *text, Sci::Position *length) = 0;
+
+	/// Called when document text changed, to discard matches cached from previous search.
+	virtual void ClearCache() noexcept {}
 };
 
 /// Factory function for RegexSearchBase
 extern RegexSearchBase *CreateRegexSearch(const CharClassify *charClassTable);
 
+class SearchThing;
+
 struct StyledText {
 	size_t length;
 	const char *text;
@@ -277,7 +282,6 @@ private:
 #endif
 	std::unique_ptr<CaseFolder> pcf;
 	Sci::Position endStyled;
-	int styleClock;
 	int enteredModification;
 	int enteredStyling;
 	int enteredReadOnlyCount;
@@ -301,7 +305,11 @@ private:
 	LineAnnotation *Annotations() const noexcept;
 	LineAnnotation *EOLAnnotations() const noexcept;
 
+	bool CaptureActionStyles(ActionStyles &styles, Sci::Position position, Sci::Position length);
+	void RestoreActionStyles(const ActionStyles &styles, Sci::Position position, Sci::Position length);
+
 	std::unique_ptr<RegexSearchBase> regex;
+	std::unique_ptr<SearchThing> searchThing;
 	std::unique_ptr<LexInterface> pli;
 	std::unique_ptr<DBCSCharClassify> dbcsCharClass;
 
@@ -560,6 +568,7 @@ public:
 	Sci::Line LineFromPositionAfter(Sci::Line line, Sci::Position length) const noexcept;
 
 	int SCI_METHOD SetLevel(Sci_Line line, int level) override;
+	void SCI_METHOD SetLevels(Sci_Line lineStart, Sci_Line lineCount, const int *levels) override;
 	int SCI_METHOD GetLevel(Sci_Line line) const noexcept override;
 	Scintilla::FoldLevel GetFoldLevel(Sci_Position line) const noexcept;
 	void ClearLevels();
@@ -579,6 +588,12 @@ public:
 	void Allocate(Sci::Position newSize) {
 		cb.Allocate(newSize);
 	}
+	void Compress() {
+		cb.Compress();
+	}
+	bool IsCompressed() const noexcept {
+		return cb.IsCompressed();
+	}
 
 	CharacterExtracted ExtractCharacter(Sci::Position position) const noexcept;
 
@@ -590,6 +605,7 @@ public:
 	bool HasCaseFolder() const noexcept;
 	void SetCaseFolder(std::unique_ptr<CaseFolder> pcf_) noexcept;
 	Sci::Position FindText(Sci::Position minPos, Sci::Position maxPos, const char *search, Scintilla::FindOption flags, Sci::Position *length);
+	Range FindStyleRun(Sci::Position minPos, Sci::Position maxPos, const uint32_t *styleMask) noexcept;
 	const char *SubstituteByPosition(const char *text, Sci::Position *length);
 	Scintilla::LineCharacterIndexType LineCharacterIndex() const noexcept;
 	void AllocateLineCharacterIndex(Scintilla::LineCharacterIndexType lineCharacterIndex);
@@ -616,10 +632,9 @@ public:
 	void EnsureStyledTo(Sci::Position pos);
 	void StyleToAdjustingLineDuration(Sci::Position pos);
 	void LexerChanged(bool hasStyles_);
-	int GetStyleClock() const noexcept {
-		return styleClock;
+	void DiscardUndoStyles() noexcept {
+		cb.DiscardUndoActionStyles();
 	}
-	void IncrementStyleClock() noexcept;
 	void SCI_METHOD DecorationSetCurrentIndicator(int indicator) noexcept override;
 	void SCI_METHOD DecorationFillRange(Sci_Position position, int value, Sci_Position fillLength) override;
 	LexInterface *GetLexInterface() const noexcept;
@@ -666,9 +681,11 @@ public:
 	Sci::Position BraceMatch(Sci::Position position, Sci::Position maxReStyle, Sci::Position startPos, bool useStartPos) const noexcept;
 
 private:
+	static constexpr Sci::Position backgroundDeleteSize = 16*1024*1024;
 	void NotifyModifyAttempt() noexcept;
 	void NotifySavePoint(bool atSavePoint) noexcept;
 	void NotifyModified(DocModification mh);
+	void NotifyDeleted() noexcept;
 };
 
 class DelaySavePoint {
@@ -126,6 +126,15 @@ constexpr ColourRGBA AlphaBlend(ColourRGBA fore, ColourRGBA back, unsigned int a
 }
 #endif
 
+// bidi data is only filled for lines that contain right-to-left text, see UpdateBidiData().
+inline bool UseBidiLayout(const EditModel &model, const LineLayout *ll) noexcept {
+	return ll->bidiData && model.BidirectionalEnabled();
+}
+
+inline bool BidiLayoutRequired(const EditModel &model, const LineLayout *ll) noexcept {
+	return model.BidirectionalEnabled() && (model.BidirectionalR2L() || ll->HasRightToLeft());
+}
+
 int WidthStyledText(Surface *surface, const ViewStyle &vs, int styleOffset,
 	const char *text, const unsigned char *styles, size_t len) {
 	XYPOSITION width = 0;
@@ -338,9 +347,10 @@ LineLayout *EditView::RetrieveLineLayout(Sci::Line lineNumber, const EditModel &
 	const Sci::Position caretPosition = model.sel.MainCaret();
 	const Sci::Line lineCaret = model.pdoc->SciLineFromPosition(caretPosition);
 	const Sci::Line topLine = model.pcs->DocFromDisplay(model.TopLineOfMain());
-	LineLayout *ll = llc.Retrieve(lineNumber, lineCaret,
-		static_cast<int>(posLineEnd - posLineStart), model.pdoc->GetStyleClock(),
-		model.LinesOnScreen() + 1, model.pdoc->LinesTotal(), topLine);
+	// visible document lines after folded and wrapped lines
+	const Sci::Line bottomLine = model.pcs->DocFromDisplay(model.TopLineOfMain() + model.LinesOnScreen());
+	LineLayout *ll = llc.Retrieve(lineNumber, lineCaret, static_cast<int>(posLineEnd - posLineStart),
+		model.LinesOnScreen() + 1, model.pdoc->LinesTotal(), topLine, bottomLine);
 	if (lineNumber == lineCaret) {
 		ll->caretPosition = static_cast<int>(caretPosition - posLineStart);
 	} else {
@@ -433,7 +443,7 @@ struct LayoutWorker {
 	uint32_t Start(Sci::Position posLineStart, uint32_t posInLine, LayoutLineOption option) {
 		const int startPos = ll->lastSegmentEnd;
 		const int endPos = ll->numCharsInLine;
-		if (endPos - startPos > blockSize*2 && !model.BidirectionalEnabled()) {
+		if (endPos - startPos > blockSize*2 && !BidiLayoutRequired(model, ll)) {
 			posInLine = std::max<uint32_t>(posInLine, ll->caretPosition) + blockSize;
 			if (posInLine > static_cast<uint32_t>(endPos)) {
 				posInLine = endPos;
@@ -772,7 +782,8 @@ uint64_t EditView::LayoutLine(const EditModel &model, Surface *surface, const Vi
 // Fill the LineLayout bidirectional data fields according to each char style
 
 void EditView::UpdateBidiData(const EditModel &model, const ViewStyle &vstyle, LineLayout *ll) {
-	if (model.BidirectionalEnabled()) {
+	// pure left-to-right line in left-to-right mode is drawn without bidi reordering
+	if (BidiLayoutRequired(model, ll)) {
 		ll->EnsureBidiData();
 		for (int stylesInLine = 0; stylesInLine < ll->numCharsInLine; stylesInLine++) {
 			ll->bidiData->stylesFonts[stylesInLine] = vstyle.styles[ll->styles[stylesInLine]].font;
@@ -822,7 +833,8 @@ Point EditView::LocationFromPosition(Surface *surface, const EditModel &model, S
 		if (model.BidirectionalEnabled()) {
 			// Fill the line bidi data
 			UpdateBidiData(model, vs, ll);
-
+		}
+		if (UseBidiLayout(model, ll)) {
 			// Find subLine
 			const int subLine = ll->SubLineFromPosition(posInLine, pe);
 			const int lineStart = ll->LineStart(subLine);
@@ -900,7 +912,8 @@ SelectionPosition EditView::SPositionFromLocation(Surface *surface, const EditMo
 			if (model.BidirectionalEnabled()) {
 				// Fill the line bidi data
 				UpdateBidiData(model, vs, ll);
-
+			}
+			if (UseBidiLayout(model, ll)) {
 				const ScreenLine screenLine(ll, subLine, vs, rcClient.right, tabWidthMinimumPixels);
 				const std::unique_ptr<IScreenLineLayout> slLayout = surface->Layout(&screenLine);
 				positionInLine = slLayout->PositionFromX(pt.x, charPosition) +
@@ -1723,7 +1736,7 @@ void EditView::DrawCarets(Surface *surface, const EditModel &model, const ViewSt
 		if (ll->InLine(offset, subLine) && offset <= ll->numCharsBeforeEOL) {
 			const int lineStart = ll->LineStart(subLine);
 			XYPOSITION xposCaret = ll->positions[offset] + virtualOffset - ll->positions[lineStart];
-			if (model.BidirectionalEnabled() && (posCaret.VirtualSpace() == 0)) {
+			if (UseBidiLayout(model, ll) && (posCaret.VirtualSpace() == 0)) {
 				// Get caret point
 				const ScreenLine screenLine(ll, subLine, vsDraw, rcLine.right, tabWidthMinimumPixels);
 
@@ -1855,6 +1868,31 @@ InSelection CharacterInCursesSelection(Sci::Position iDoc, const EditModel &mode
 	return (caretAtStart || caretAtEnd) ? InSelection::inNone : InSelection::inMain;
 }
 
+// Merge fills for adjacent segments with same background colour, dense styled lines
+// (e.g. minified code) otherwise issue one platform call for each style run.
+class BackgroundRun {
+	Surface *surface;
+	PRectangle rc;
+	ColourRGBA back;
+public:
+	explicit BackgroundRun(Surface *surface_) noexcept : surface{surface_} {}
+	void Add(PRectangle rcSegment, ColourRGBA textBack) {
+		if (textBack == back && rcSegment.left == rc.right && !rc.Empty()) {
+			rc.right = rcSegment.right;
+		} else {
+			Flush();
+			rc = rcSegment;
+			back = textBack;
+		}
+	}
+	void Flush() {
+		if (!rc.Empty()) {
+			surface->FillRectangleAligned(rc, Fill(back));
+			rc = PRectangle();
+		}
+	}
+};
+
 void DrawBackground(Surface *surface, const EditModel &model, const ViewStyle &vsDraw, const LineLayout *ll,
 	int xStart, PRectangle rcLine, int subLine, Range lineRange, Sci::Position posLineStart,
 	ColourOptional background) {
@@ -1870,6 +1908,7 @@ void DrawBackground(Surface *surface, const EditModel &model, const ViewStyle &v
 	BreakFinder bfBack(ll, &model.sel, lineRange, posLineStart, xStartVisible, breakFor, model, &vsDraw, 0);
 
 	const bool drawWhitespaceBackground = vsDraw.WhitespaceBackgroundDrawn() && !background;
+	BackgroundRun run(surface);
 
 	// Background drawing loop
 	while (bfBack.More()) {
@@ -1900,14 +1939,15 @@ void DrawBackground(Surface *surface, const EditModel &model, const ViewStyle &v
 					// Blob display
 					inIndentation = false;
 				}
-				surface->FillRectangleAligned(rcSegment, Fill(textBack));
+				run.Add(rcSegment, textBack);
 			} else {
 				// Normal text display
-				surface->FillRectangleAligned(rcSegment, Fill(textBack));
+				run.Add(rcSegment, textBack);
 				if (vsDraw.viewWhitespace != WhiteSpace::Invisible) {
 					for (int cpos = 0; cpos <= i - ts.start; cpos++) {
 						if (ll->chars[cpos + ts.start] == ' ') {
 							if (drawWhitespaceBackground && vsDraw.WhiteSpaceVisible(inIndentation)) {
+								run.Flush();
 								const PRectangle rcSpace = Intersection(rcLine,
 									ll->SpanByte(cpos + ts.start).Offset(horizontalOffset));
 								surface->FillRectangleAligned(rcSpace,
@@ -1923,6 +1963,7 @@ void DrawBackground(Surface *surface, const EditModel &model, const ViewStyle &v
 			break;
 		}
 	}
+	run.Flush();
 }
 
 void DrawEdgeLine(Surface *surface, const ViewStyle &vsDraw, const LineLayout *ll,
@@ -1986,7 +2027,7 @@ void DrawTranslucentSelection(Surface *surface, const EditModel &model, const Vi
 				const ColourRGBA selectionBack = SelectionBackground(model, vsDraw, model.sel.RangeType(r));
 				const XYPOSITION spaceWidth = vsDraw.styles[ll->EndLineStyle()].spaceWidth;
 				const Interval intervalVirtual{ portion.start.VirtualSpace() * spaceWidth, portion.end.VirtualSpace() * spaceWidth };
-				if (model.BidirectionalEnabled()) {
+				if (UseBidiLayout(model, ll)) {
 					const SelectionSegment portionInSubLine = portionInLine.Subtract(lineRange.start);
 
 					const ScreenLine screenLine(ll, subLine, vsDraw, rcLine.right, tabWidthMinimumPixels);
@@ -2194,7 +2235,7 @@ void DrawIndicators(Surface *surface, const EditModel &model, const ViewStyle &v
 					const Sci::Position posSecond = model.pdoc->MovePositionOutsideChar(rangeRun.First() + 1, 1);
 					DrawIndicator(deco->Indicator(), startPos - posLineStart, endPos - posLineStart,
 						surface, vsDraw, ll, xStart, rcLine, posSecond - posLineStart, subLine, state,
-						value, model.BidirectionalEnabled(), tabWidthMinimumPixels);
+						value, UseBidiLayout(model, ll), tabWidthMinimumPixels);
 				}
 				startPos = endPos;
 			}
@@ -2213,7 +2254,7 @@ void DrawIndicators(Surface *surface, const EditModel &model, const ViewStyle &v
 					if (braceOffset < ll->numCharsInLine) {
 						const Sci::Position secondOffset = model.pdoc->MovePositionOutsideChar(model.braces[brace] + 1, 1) - posLineStart;
 						DrawIndicator(braceIndicator, braceOffset, braceOffset + 1, surface, vsDraw, ll, xStart, rcLine, secondOffset,
-							subLine, Indicator::State::normal, 1, model.BidirectionalEnabled(), tabWidthMinimumPixels);
+							subLine, Indicator::State::normal, 1, UseBidiLayout(model, ll), tabWidthMinimumPixels);
 					}
 				}
 			}
@@ -2235,7 +2276,7 @@ void DrawIndicators(Surface *surface, const EditModel &model, const ViewStyle &v
 					const Sci::Position posSecond = model.pdoc->MovePositionOutsideChar(rangeRun.First() + 1, 1);
 					DrawIndicator(indicator, startPos - posLineStart, endPos - posLineStart,
 						surface, vsDraw, ll, xStart, rcLine, posSecond - posLineStart, subLine, Indicator::State::normal,
-						1, model.BidirectionalEnabled(), tabWidthMinimumPixels);
+						1, UseBidiLayout(model, ll), tabWidthMinimumPixels);
 				}
 				startPos = endPos;
 			}
@@ -2251,7 +2292,7 @@ void DrawIndicators(Surface *surface, const EditModel &model, const ViewStyle &v
 						const int indicator = edition * 2 + indexHistory + 1;
 						DrawIndicator(indicator, startPos - posLineStart, posSecond - posLineStart,
 							surface, vsDraw, ll, xStart, rcLine, posSecond - posLineStart, subLine, Indicator::State::normal,
-							1, model.BidirectionalEnabled(), tabWidthMinimumPixels);
+							1, UseBidiLayout(model, ll), tabWidthMinimumPixels);
 					}
 				}
 				startPos = model.pdoc->EditionNextDelete(startPos);
@@ -1495,9 +1495,9 @@ bool Editor::WrapBlock(Surface *surface, Sci::Line lineToWrap, Sci::Line lineToW
 	const SignificantLines significantLines {
 		pdoc->SciLineFromPosition(caretPosition),
 		pcs->DocFromDisplay(topLine),
+		pcs->DocFromDisplay(topLine + LinesOnScreen()),
 		LinesOnScreen() + 1,
 		pdoc->LinesTotal(),
-		pdoc->GetStyleClock(),
 		view.llc.GetLevel(),
 	};
 
@@ -2727,9 +2727,6 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 		}
 	}
 	if (FlagSet(mh.modificationType, ModificationFlags::ChangeStyle | ModificationFlags::ChangeIndicator)) {
-		if (FlagSet(mh.modificationType, ModificationFlags::ChangeStyle)) {
-			pdoc->IncrementStyleClock();
-		}
 		if (paintState == PaintState::notPainting) {
 			const Sci::Line lineDocTop = pcs->DocFromDisplay(topLine);
 			if (mh.position < pdoc->LineStart(lineDocTop)) {
@@ -2740,7 +2737,9 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 			}
 		}
 		if (FlagSet(mh.modificationType, ModificationFlags::ChangeStyle)) {
-			view.llc.Invalidate(LineLayout::ValidLevel::checkTextAndStyle);
+			// only lines whose styles were changed need to be checked again
+			view.llc.InvalidateLines(pdoc->SciLineFromPosition(mh.position),
+				pdoc->SciLineFromPosition(mh.position + mh.length), LineLayout::ValidLevel::checkTextAndStyle);
 		}
 	} else {
 		// Move selection and brace highlights
@@ -2786,8 +2785,10 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 		}
 		//CheckModificationForWrap(mh);
 		if (FlagSet(mh.modificationType, ModificationFlags::InsertText | ModificationFlags::DeleteText)) {
-			view.llc.Invalidate(LineLayout::ValidLevel::checkTextAndStyle);
 			const Sci::Line lineDoc = pdoc->SciLineFromPosition(mh.position);
+			// layouts after changed line are cached with old line numbers when lines added or removed
+			const Sci::Line lineLast = (mh.linesAdded == 0) ? lineDoc : pdoc->LinesTotal() - std::min<Sci::Line>(mh.linesAdded, 0);
+			view.llc.InvalidateLines(lineDoc, lineLast, LineLayout::ValidLevel::checkTextAndStyle);
 			const Sci::Line lines = std::max<Sci::Line>(0, mh.linesAdded);
 			if (Wrapping()) {
 				NeedWrapping(lineDoc, lineDoc + lines + 1);
@@ -2840,7 +2841,12 @@ void Editor::NotifyModified(Document *, DocModification mh, void *) {
 		}
 	}
 	if ((FlagSet(mh.modificationType, ModificationFlags::ChangeFold)) && (FlagSet(foldAutomatic, AutomaticFold::Change))) {
-		FoldChanged(mh.line, mh.foldLevelNow, mh.foldLevelPrev);
+		if (mh.foldLevelNow == mh.foldLevelPrev) {
+			// summarized fold level changes from Document::SetLevels()
+			FoldLevelsChanged(mh.line, pdoc->SciLineFromPosition(mh.position + mh.length));
+		} else {
+			FoldChanged(mh.line, mh.foldLevelNow, mh.foldLevelPrev);
+		}
 	}
 
 	// NOW pay the piper WRT "deferred" visual updates
@@ -4135,6 +4141,35 @@ std::unique_ptr<CaseFolder> Editor::CaseFolderForEncoding() {
 	return std::make_unique<CaseFolderTable>();
 }
 
+/**
+ * Search of a text in the document, only inside text with styles in searchStyleMask.
+ * @return The position of the found text, -1 if not found.
+ */
+Sci::Position Editor::FindTextInStyles(Sci::Position minPos, Sci::Position maxPos, const char *search, FindOption flags, Sci::Position *length) {
+	if (!searchStyleMask) {
+		return pdoc->FindText(minPos, maxPos, search, flags, length);
+	}
+
+	pdoc->EnsureStyledTo(std::max(minPos, maxPos));
+	const bool forward = minPos <= maxPos;
+	Sci::Position pos = minPos;
+	while (forward ? (pos < maxPos) : (pos > maxPos)) {
+		const Range run = pdoc->FindStyleRun(pos, maxPos, searchStyleMask.get());
+		if (run.Empty()) {
+			break;
+		}
+		Sci::Position lengthFound = *length;
+		const Sci::Position found = forward ? pdoc->FindText(run.start, run.end, search, flags, &lengthFound)
+			: pdoc->FindText(run.end, run.start, search, flags, &lengthFound);
+		if (found >= 0) {
+			*length = lengthFound;
+			return found;
+		}
+		pos = forward ? run.end : run.start;
+	}
+	return -1;
+}
+
 /**
  * Search of a text in the document, in the given range.
  * @return The position of the found text, -1 if not found.
@@ -4150,7 +4185,7 @@ Sci::Position Editor::FindTextFull(
 	if (!pdoc->HasCaseFolder())
 		pdoc->SetCaseFolder(CaseFolderForEncoding());
 	try {
-		const Sci::Position pos = pdoc->FindText(
+		const Sci::Position pos = FindTextInStyles(
 			ft->chrg.cpMin,
 			ft->chrg.cpMax,
 			ft->lpstrText,
@@ -4213,6 +4248,56 @@ Sci::Position Editor::FindTextFull(
 #endif
 }
 
+/**
+ * Search all occurrences of a text in the given forward range, the prepared search
+ * state in document is reused for every match.
+ * @return The number of matches stored into @c ranges, -1 on regex error.
+ */
+Sci::Position Editor::FindTextAll(
+	uptr_t wParam,		///< Search modes, same as @c FindTextFull.
+	sptr_t lParam) {	///< @c TextToFindAll structure: The text to search for in the given range.
+
+	TextToFindAll *ft = AsPointer<TextToFindAll *>(lParam);
+	const FindOption flags = static_cast<FindOption>(wParam);
+	const Sci::Position lengthFind = strlen(ft->lpstrText);
+	const Sci::Position maxPos = ft->chrg.cpMax;
+	Sci::Position pos = ft->chrg.cpMin;
+	Sci::Position count = 0;
+	if (!pdoc->HasCaseFolder())
+		pdoc->SetCaseFolder(CaseFolderForEncoding());
+	try {
+		while (count < ft->count && pos < maxPos) {
+			Sci::Position lengthFound = lengthFind;
+			const Sci::Position found = FindTextInStyles(pos, maxPos, ft->lpstrText, flags, &lengthFound);
+			if (found < 0) {
+				pos = maxPos;
+				break;
+			}
+			Sci::Position endPos = found + lengthFound;
+			if (FlagSet(flags, FindOption::MatchToWordEnd)) {
+				endPos = pdoc->ExtendWordSelect(endPos, 1, true);
+			}
+			ft->ranges[count].cpMin = found;
+			ft->ranges[count].cpMax = endPos;
+			++count;
+			if (found == endPos) {
+				// empty regex match
+				endPos = pdoc->NextPosition(endPos, 1);
+				if (endPos == found) {
+					pos = maxPos;
+					break;
+				}
+			}
+			pos = endPos;
+		}
+	} catch (const RegexError &) {
+		errorStatus = Status::RegEx;
+		return -1;
+	}
+	ft->chrg.cpMin = std::min(pos, maxPos);
+	return count;
+}
+
 /**
  * Relocatable search support : Searches relative to current selection
  * point and sets the selection to the found text range with
@@ -4246,11 +4331,11 @@ Sci::Position Editor::SearchText(
 		pdoc->SetCaseFolder(CaseFolderForEncoding());
 	try {
 		if (iMessage == Message::SearchNext) {
-			pos = pdoc->FindText(searchAnchor, pdoc->LengthNoExcept(), txt,
+			pos = FindTextInStyles(searchAnchor, pdoc->LengthNoExcept(), txt,
 				static_cast<FindOption>(wParam),
 				&lengthFound);
 		} else {
-			pos = pdoc->FindText(searchAnchor, 0, txt,
+			pos = FindTextInStyles(searchAnchor, 0, txt,
 				static_cast<FindOption>(wParam),
 				&lengthFound);
 		}
@@ -4292,7 +4377,7 @@ Sci::Position Editor::SearchInTarget(const char *text, Sci::Position length) {
 	if (!pdoc->HasCaseFolder())
 		pdoc->SetCaseFolder(CaseFolderForEncoding());
 	try {
-		const Sci::Position pos = pdoc->FindText(targetRange.start.Position(), targetRange.end.Position(), text,
+		const Sci::Position pos = FindTextInStyles(targetRange.start.Position(), targetRange.end.Position(), text,
 			searchFlags,
 			&lengthFound);
 		if (pos >= 0) {
@@ -5743,6 +5828,40 @@ void Editor::FoldChanged(Sci::Line line, FoldLevel levelNow, FoldLevel levelPrev
 	}
 }
 
+void Editor::FoldLevelsChanged(Sci::Line lineStart, Sci::Line lineEnd) {
+	// fold points are unchanged, only need to check lines are shown or hidden same as their parent.
+	if (!pcs->HiddenLines()) {
+		return;
+	}
+	bool changed = false;
+	Sci::Line parentLine = -1;
+	FoldLevel levelPrev = FoldLevel::None;
+	for (Sci::Line line = lineStart; line <= lineEnd; line++) {
+		const FoldLevel level = pdoc->GetFoldLevel(line);
+		if (line != lineStart && LevelIsHeader(levelPrev) && LevelNumber(levelPrev) < LevelNumber(level)) {
+			parentLine = line - 1;
+		} else if (line == lineStart || LevelIsHeader(levelPrev) || LevelNumber(levelPrev) != LevelNumber(level)) {
+			parentLine = pdoc->GetFoldParent(line);
+		}
+		levelPrev = level;
+		if (LevelIsWhitespace(level)) {
+			continue;
+		}
+		if (!pcs->GetVisible(line)) {
+			if ((parentLine < 0) || (pcs->GetExpanded(parentLine) && pcs->GetVisible(parentLine))) {
+				pcs->SetVisible(line, line, true);
+				changed = true;
+			}
+		} else if ((parentLine >= 0) && !pcs->GetExpanded(parentLine)) {
+			FoldLine(parentLine, FoldAction::Expand);
+		}
+	}
+	if (changed) {
+		SetScrollBars();
+		Redraw();
+	}
+}
+
 void Editor::NeedShown(Sci::Position pos, Sci::Position len) {
 	if (FlagSet(foldAutomatic, AutomaticFold::Show)) {
 		const Sci::Line lineStart = pdoc->SciLineFromPosition(pos);
@@ -6384,6 +6503,17 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::GetSearchFlags:
 		return static_cast<sptr_t>(searchFlags);
 
+	case Message::SetSearchStyleMask:
+		if (lParam == 0) {
+			searchStyleMask.reset();
+		} else {
+			if (!searchStyleMask) {
+				searchStyleMask = std::make_unique<uint32_t[]>(256/32);
+			}
+			memcpy(searchStyleMask.get(), AsPointer<const void *>(lParam), 256/8);
+		}
+		break;
+
 	case Message::GetTag:
 		return GetTag(CharPtrFromSPtr(lParam), static_cast<int>(wParam));
 
@@ -6456,6 +6586,9 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 	case Message::FindTextFull:
 		return FindTextFull(wParam, lParam);
 
+	case Message::FindTextAll:
+		return FindTextAll(wParam, lParam);
+
 	case Message::GetTextRangeFull:
 		if (const TextRangeFull *tr = AsPointer<const TextRangeFull *>(lParam)) {
 			return GetTextRange(tr->lpstrText, tr->chrg.cpMin, tr->chrg.cpMax);
@@ -6671,6 +6804,13 @@ sptr_t Editor::WndProc(Message iMessage, uptr_t wParam, sptr_t lParam) {
 		pdoc->Allocate(PositionFromUPtr(wParam));
 		break;
 
+	case Message::CompressDocument:
+		pdoc->Compress();
+		break;
+
+	case Message::IsDocumentCompressed:
+		return pdoc->IsCompressed();
+
 	case Message::GetCharAt:
 		return pdoc->UCharAt(PositionFromUPtr(wParam));
 
@@ -261,6 +261,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	Sci::Position wordSelectInitialCaretPos;
 	SelectionSegment targetRange;
 	Scintilla::FindOption searchFlags;
+	std::unique_ptr<uint32_t[]> searchStyleMask;
 	Sci::Line topLine;
 	Sci::Position posTopLine;
 	Sci::Position lengthForEncode;
@@ -522,7 +523,9 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	void Indent(bool forwards);
 
 	virtual std::unique_ptr<CaseFolder> CaseFolderForEncoding();
+	Sci::Position FindTextInStyles(Sci::Position minPos, Sci::Position maxPos, const char *search, Scintilla::FindOption flags, Sci::Position *length);
 	Sci::Position FindTextFull(Scintilla::uptr_t wParam, Scintilla::sptr_t lParam);
+	Sci::Position FindTextAll(Scintilla::uptr_t wParam, Scintilla::sptr_t lParam);
 	void SearchAnchor() noexcept;
 	Sci::Position SearchText(Scintilla::Message iMessage, Scintilla::uptr_t wParam, Scintilla::sptr_t lParam);
 	Sci::Position SearchInTarget(const char *text, Sci::Position length);
@@ -602,6 +605,7 @@ protected:	// ScintillaBase subclass needs access to much of Editor
 	Sci::Line ContractedFoldNext(Sci::Line lineStart) const noexcept;
 	void EnsureLineVisible(Sci::Line lineDoc, bool enforcePolicy);
 	void FoldChanged(Sci::Line line, Scintilla::FoldLevel levelNow, Scintilla::FoldLevel levelPrev);
+	void FoldLevelsChanged(Sci::Line lineStart, Sci::Line lineEnd);
 	void NeedShown(Sci::Position pos, Sci::Position len);
 	void FoldAll(Scintilla::FoldAction action);
 
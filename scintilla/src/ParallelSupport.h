@@ -26,6 +26,34 @@ inline bool WaitableTimerExpired(HANDLE timer) noexcept {
 	return WaitForSingleObject(timer, 0) == WAIT_OBJECT_0;
 }
 
+// delete object on thread pool, used to release huge document without blocking UI thread.
+#if USE_WIN32_PTP_WORK
+template <typename T>
+VOID CALLBACK DeleteObjectCallback([[maybe_unused]] PTP_CALLBACK_INSTANCE instance, PVOID context) noexcept {
+	delete static_cast<T *>(context);
+}
+#elif USE_WIN32_WORK_ITEM
+template <typename T>
+DWORD WINAPI DeleteObjectCallback(LPVOID lpParameter) noexcept {
+	delete static_cast<T *>(lpParameter);
+	return 0;
+}
+#endif
+
+template <typename T>
+void DeleteInBackground(T *object) noexcept {
+#if USE_WIN32_PTP_WORK
+	if (TrySubmitThreadpoolCallback(DeleteObjectCallback<T>, object, nullptr)) {
+		return;
+	}
+#elif USE_WIN32_WORK_ITEM
+	if (QueueUserWorkItem(DeleteObjectCallback<T>, object, WT_EXECUTELONGFUNCTION)) {
+		return;
+	}
+#endif
+	delete object;
+}
+
 // MSVC Code Analysis
 #ifndef _Acquires_lock_
 #define _Acquires_lock_(x)
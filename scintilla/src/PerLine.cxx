@@ -12,7 +12,6 @@
 #include <stdexcept>
 #include <string_view>
 #include <vector>
-#include <forward_list>
 #include <optional>
 #include <algorithm>
 #include <memory>
@@ -31,23 +30,38 @@
 
 using namespace Scintilla::Internal;
 
-MarkerHandleSet::MarkerHandleSet() noexcept = default;
+MarkerHandleNumber *MarkerHandlePool::Allocate(int handle, int number, MarkerHandleNumber *next) {
+	MarkerHandleNumber *mhn = freeList;
+	if (mhn) {
+		freeList = mhn->next;
+	} else {
+		if (blockUsed == blockSize) {
+			blocks.push_back(std::make_unique<MarkerHandleNumber[]>(blockSize));
+			blockUsed = 0;
+		}
+		mhn = &blocks.back()[blockUsed++];
+	}
+	*mhn = {handle, number, next};
+	return mhn;
+}
 
-bool MarkerHandleSet::Empty() const noexcept {
-	return mhList.empty();
+void MarkerHandlePool::Clear() noexcept {
+	blocks.clear();
+	freeList = nullptr;
+	blockUsed = blockSize;
 }
 
 MarkerMask MarkerHandleSet::MarkValue() const noexcept {
 	MarkerMask m = 0;
-	for (const MarkerHandleNumber &mhn : mhList) {
-		m |= (1U << mhn.number);
+	for (const MarkerHandleNumber *mhn = head; mhn; mhn = mhn->next) {
+		m |= (1U << mhn->number);
 	}
 	return m;
 }
 
 bool MarkerHandleSet::Contains(int handle) const noexcept {
-	for (const MarkerHandleNumber &mhn : mhList) {
-		if (mhn.handle == handle) {
+	for (const MarkerHandleNumber *mhn = head; mhn; mhn = mhn->next) {
+		if (mhn->handle == handle) {
 			return true;
 		}
 	}
@@ -55,41 +69,68 @@ bool MarkerHandleSet::Contains(int handle) const noexcept {
 }
 
 MarkerHandleNumber const *MarkerHandleSet::GetMarkerHandleNumber(int which) const noexcept {
-	for (const MarkerHandleNumber &mhn : mhList) {
+	for (const MarkerHandleNumber *mhn = head; mhn; mhn = mhn->next) {
 		if (which == 0)
-			return &mhn;
+			return mhn;
 		which--;
 	}
 	return nullptr;
 }
 
-bool MarkerHandleSet::InsertHandle(int handle, int markerNum) {
-	mhList.emplace_front(handle, markerNum);
-	return true;
+void MarkerHandleSet::InsertHandle(MarkerHandlePool &pool, int handle, int markerNum) {
+	head = pool.Allocate(handle, markerNum, head);
 }
 
-void MarkerHandleSet::RemoveHandle(int handle) {
-	mhList.remove_if([handle](const MarkerHandleNumber &mhn) noexcept { return mhn.handle == handle; });
+void MarkerHandleSet::RemoveHandle(MarkerHandlePool &pool, int handle) noexcept {
+	MarkerHandleNumber **link = &head;
+	while (MarkerHandleNumber *mhn = *link) {
+		if (mhn->handle == handle) {
+			*link = mhn->next;
+			pool.Free(mhn);
+		} else {
+			link = &mhn->next;
+		}
+	}
 }
 
-bool MarkerHandleSet::RemoveNumber(int markerNum, bool all) {
+bool MarkerHandleSet::RemoveNumber(MarkerHandlePool &pool, int markerNum, bool all) noexcept {
 	bool performedDeletion = false;
-	mhList.remove_if([&](const MarkerHandleNumber &mhn) noexcept {
-		if ((all || !performedDeletion) && (mhn.number == markerNum)) {
+	MarkerHandleNumber **link = &head;
+	while (MarkerHandleNumber *mhn = *link) {
+		if ((all || !performedDeletion) && (mhn->number == markerNum)) {
 			performedDeletion = true;
-			return true;
+			*link = mhn->next;
+			pool.Free(mhn);
+		} else {
+			link = &mhn->next;
 		}
-		return false;
-	});
+	}
 	return performedDeletion;
 }
 
-void MarkerHandleSet::CombineWith(MarkerHandleSet *other) noexcept {
-	mhList.splice_after(mhList.before_begin(), other->mhList);
+void MarkerHandleSet::RemoveAll(MarkerHandlePool &pool) noexcept {
+	while (MarkerHandleNumber *mhn = head) {
+		head = mhn->next;
+		pool.Free(mhn);
+	}
+}
+
+void MarkerHandleSet::CombineWith(MarkerHandleSet &other) noexcept {
+	// other's handles go in front, same as std::forward_list::splice_after(before_begin())
+	if (MarkerHandleNumber *tail = other.head) {
+		while (tail->next) {
+			tail = tail->next;
+		}
+		tail->next = head;
+		head = other.head;
+		other.head = nullptr;
+	}
 }
 
 void LineMarkers::Init() {
+	// nodes are owned by the pool, no need to walk each line
 	markers.DeleteAll();
+	pool.Clear();
 }
 
 bool LineMarkers::IsActive() const noexcept {
@@ -98,7 +139,7 @@ bool LineMarkers::IsActive() const noexcept {
 
 void LineMarkers::InsertLine(Sci::Line line) {
 	if (markers.Length()) {
-		markers.Insert(line, nullptr);
+		markers.Insert(line, {});
 	}
 }
 
@@ -113,6 +154,8 @@ void LineMarkers::RemoveLine(Sci::Line line) {
 	if (markers.Length()) {
 		if (line > 0) {
 			MergeMarkers(line - 1);
+		} else {
+			markers[line].RemoveAll(pool);
 		}
 		markers.Delete(line);
 	}
@@ -120,7 +163,7 @@ void LineMarkers::RemoveLine(Sci::Line line) {
 
 Sci::Line LineMarkers::LineFromHandle(int markerHandle) const noexcept {
 	for (Sci::Line line = 0; line < markers.Length(); line++) {
-		if (markers[line] && markers[line]->Contains(markerHandle)) {
+		if (markers[line].Contains(markerHandle)) {
 			return line;
 		}
 	}
@@ -128,33 +171,28 @@ Sci::Line LineMarkers::LineFromHandle(int markerHandle) const noexcept {
 }
 
 int LineMarkers::HandleFromLine(Sci::Line line, int which) const noexcept {
-	if (IsValidIndex(line, markers.Length()) && markers[line]) {
-		MarkerHandleNumber const *pnmh = markers[line]->GetMarkerHandleNumber(which);
+	if (IsValidIndex(line, markers.Length())) {
+		MarkerHandleNumber const *pnmh = markers[line].GetMarkerHandleNumber(which);
 		return pnmh ? pnmh->handle : -1;
 	}
 	return -1;
 }
 
 int LineMarkers::NumberFromLine(Sci::Line line, int which) const noexcept {
-	if (IsValidIndex(line, markers.Length()) && markers[line]) {
-		MarkerHandleNumber const *pnmh = markers[line]->GetMarkerHandleNumber(which);
+	if (IsValidIndex(line, markers.Length())) {
+		MarkerHandleNumber const *pnmh = markers[line].GetMarkerHandleNumber(which);
 		return pnmh ? pnmh->number : -1;
 	}
 	return -1;
 }
 
 void LineMarkers::MergeMarkers(Sci::Line line) {
-	if (markers[line + 1]) {
-		if (!markers[line])
-			markers[line] = std::make_unique<MarkerHandleSet>();
-		markers[line]->CombineWith(markers[line + 1].get());
-		markers[line + 1].reset();
-	}
+	markers[line].CombineWith(markers[line + 1]);
 }
 
 MarkerMask LineMarkers::MarkValue(Sci::Line line) const noexcept {
-	if (IsValidIndex(line, markers.Length()) && markers[line])
-		return markers[line]->MarkValue();
+	if (IsValidIndex(line, markers.Length()))
+		return markers[line].MarkValue();
 	else
 		return 0;
 }
@@ -164,8 +202,8 @@ Sci::Line LineMarkers::MarkerNext(Sci::Line lineStart, MarkerMask mask) const no
 		lineStart = 0;
 	const Sci::Line length = markers.Length();
 	for (Sci::Line iLine = lineStart; iLine < length; iLine++) {
-		const MarkerHandleSet *onLine = markers[iLine].get();
-		if (onLine && ((onLine->MarkValue() & mask) != 0))
+		const MarkerHandleSet &onLine = markers[iLine];
+		if (!onLine.Empty() && ((onLine.MarkValue() & mask) != 0))
 			return iLine;
 	}
 	return -1;
@@ -176,27 +214,20 @@ int LineMarkers::AddMark(Sci::Line line, int markerNum, Sci::Line lines) {
 		// No existing markers so allocate one element per line
 		markers.InsertEmpty(0, lines);
 	}
-	if (!markers[line]) {
-		// Need new structure to hold marker handle
-		markers[line] = std::make_unique<MarkerHandleSet>();
-	}
 
 	handleCurrent++;
-	markers[line]->InsertHandle(handleCurrent, markerNum);
+	markers[line].InsertHandle(pool, handleCurrent, markerNum);
 	return handleCurrent;
 }
 
 bool LineMarkers::DeleteMark(Sci::Line line, int markerNum, bool all) {
 	bool someChanges = false;
-	if (IsValidIndex(line, markers.Length()) && markers[line]) {
+	if (IsValidIndex(line, markers.Length()) && !markers[line].Empty()) {
 		if (markerNum < 0) {
 			someChanges = true;
-			markers[line].reset();
+			markers[line].RemoveAll(pool);
 		} else {
-			someChanges = markers[line]->RemoveNumber(markerNum, all);
-			if (markers[line]->Empty()) {
-				markers[line].reset();
-			}
+			someChanges = markers[line].RemoveNumber(pool, markerNum, all);
 		}
 	}
 	return someChanges;
@@ -205,10 +236,7 @@ bool LineMarkers::DeleteMark(Sci::Line line, int markerNum, bool all) {
 void LineMarkers::DeleteMarkFromHandle(int markerHandle) {
 	const Sci::Line line = LineFromHandle(markerHandle);
 	if (line >= 0) {
-		markers[line]->RemoveHandle(markerHandle);
-		if (markers[line]->Empty()) {
-			markers[line].reset();
-		}
+		markers[line].RemoveHandle(pool, markerHandle);
 	}
 }
 
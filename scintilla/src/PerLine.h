@@ -15,29 +15,51 @@ namespace Scintilla::Internal {
 struct MarkerHandleNumber {
 	int handle;
 	int number;
-	MarkerHandleNumber(int handle_, int number_) noexcept : handle(handle_), number(number_) {}
+	MarkerHandleNumber *next;
+};
+
+/**
+ * MarkerHandleNumbers of all lines are allocated in blocks owned by the document,
+ * so markers on millions of lines are released in bulk instead of node by node.
+ */
+class MarkerHandlePool {
+	static constexpr size_t blockSize = 1024;
+	std::vector<std::unique_ptr<MarkerHandleNumber[]>> blocks;
+	MarkerHandleNumber *freeList = nullptr;
+	size_t blockUsed = blockSize;
+public:
+	MarkerHandleNumber *Allocate(int handle, int number, MarkerHandleNumber *next);
+	void Free(MarkerHandleNumber *mhn) noexcept {
+		mhn->next = freeList;
+		freeList = mhn;
+	}
+	void Clear() noexcept;
 };
 
 /**
  * A marker handle set contains any number of MarkerHandleNumbers.
+ * Empty set holds no storage, nodes are owned by MarkerHandlePool.
  */
 class MarkerHandleSet {
-	std::forward_list<MarkerHandleNumber> mhList;
+	MarkerHandleNumber *head = nullptr;
 
 public:
-	MarkerHandleSet() noexcept;
-	bool Empty() const noexcept;
+	bool Empty() const noexcept {
+		return head == nullptr;
+	}
 	MarkerMask MarkValue() const noexcept;	///< Bit set of marker numbers.
 	bool Contains(int handle) const noexcept;
-	bool InsertHandle(int handle, int markerNum);
-	void RemoveHandle(int handle);
-	bool RemoveNumber(int markerNum, bool all);
-	void CombineWith(MarkerHandleSet *other) noexcept;
+	void InsertHandle(MarkerHandlePool &pool, int handle, int markerNum);
+	void RemoveHandle(MarkerHandlePool &pool, int handle) noexcept;
+	bool RemoveNumber(MarkerHandlePool &pool, int markerNum, bool all) noexcept;
+	void RemoveAll(MarkerHandlePool &pool) noexcept;
+	void CombineWith(MarkerHandleSet &other) noexcept;
 	MarkerHandleNumber const *GetMarkerHandleNumber(int which) const noexcept;
 };
 
 class LineMarkers final : public PerLine {
-	SplitVector<std::unique_ptr<MarkerHandleSet>> markers;
+	SplitVector<MarkerHandleSet> markers;
+	MarkerHandlePool pool;
 	/// Handles are allocated sequentially and should never have to be reused as 32 bit ints are very big.
 	int handleCurrent;
 public:
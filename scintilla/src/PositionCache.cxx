@@ -82,6 +82,8 @@ LineLayout::LineLayout(Sci::Line lineNumber_, int maxLineLength_) :
 	bracePreviousStyles{},
 	edgeColumn(0),
 	caretPosition(0),
+	lastUsed(0),
+	memoryCounted(0),
 	widthLine(wrapWidthInfinite),
 	lines(1),
 	wrapIndent(0) {
@@ -123,6 +125,48 @@ void LineLayout::EnsureBidiData() {
 	}
 }
 
+namespace {
+
+// strong right-to-left characters and explicit directional formatting characters
+constexpr bool IsBidiCharacter(unsigned int ch) noexcept {
+	return (ch >= 0x0590 && ch <= 0x08FF) // Hebrew, Arabic, Syriac, Thaana, NKo, Samaritan, Mandaic
+		|| (ch >= 0x200E && ch <= 0x200F) || (ch >= 0x202A && ch <= 0x202E) || (ch >= 0x2066 && ch <= 0x2069)
+		|| (ch >= 0xFB1D && ch <= 0xFDFF) || (ch >= 0xFE70 && ch <= 0xFEFF)
+		|| (ch >= 0x10800 && ch <= 0x10FFF) || (ch >= 0x1E800 && ch <= 0x1EFFF);
+}
+
+}
+
+// line without right-to-left text can be laid out and drawn without bidi reordering
+bool LineLayout::HasRightToLeft() const noexcept {
+	const unsigned char *ptr = reinterpret_cast<const unsigned char *>(chars.get());
+	const unsigned char * const end = ptr + numCharsInLine;
+	while (ptr < end) {
+#if NP2_USE_SSE2
+		// skip ASCII block
+		if (end - ptr >= static_cast<ptrdiff_t>(sizeof(__m128i))) {
+			const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+			if (_mm_movemask_epi8(chunk) == 0) {
+				ptr += sizeof(__m128i);
+				continue;
+			}
+		}
+#endif
+		const unsigned char ch = *ptr;
+		if (ch < 0x80) {
+			++ptr;
+			continue;
+		}
+		// all candidates are 2 to 4 bytes, lead byte >= 0xD6
+		const int byteCount = UTF8BytesOfLead(ch);
+		if (ch >= 0xD6 && ptr + byteCount <= end && IsBidiCharacter(UnicodeFromUTF8(ptr))) {
+			return true;
+		}
+		ptr += byteCount;
+	}
+	return false;
+}
+
 void LineLayout::Free() noexcept {
 	chars.reset();
 	styles.reset();
@@ -132,6 +176,16 @@ void LineLayout::Free() noexcept {
 	bidiData.reset();
 }
 
+size_t LineLayout::MemoryUsage() const noexcept {
+	const size_t lineAllocation = chars ? maxLineLength + 1 : 0;
+	size_t size = sizeof(LineLayout) + lineAllocation*(sizeof(char) + sizeof(unsigned char))
+		+ (lineAllocation + 1)*sizeof(XYPOSITION) + lenLineStarts*sizeof(int);
+	if (bidiData) {
+		size += sizeof(BidiData) + lineAllocation*(sizeof(std::shared_ptr<Font>) + sizeof(XYPOSITION));
+	}
+	return size;
+}
+
 void LineLayout::ClearPositions() const noexcept {
 	//std::fill_n(positions.get(), maxLineLength + 2, 0.0f);
 	memset(positions.get(), 0, (maxLineLength + 2) * sizeof(XYPOSITION));
@@ -563,7 +617,7 @@ bool SignificantLines::LineMayCache(Sci::Line line) const noexcept {
 LineLayoutCache::LineLayoutCache() noexcept:
 	lastCaretSlot(SIZE_MAX),
 	level(LineCache::None),
-	maxValidity(LineLayout::ValidLevel::invalid), styleClock(-1) {
+	maxValidity(LineLayout::ValidLevel::invalid), useClock(0), memoryUsed(0), memoryLimit(memoryBudget) {
 }
 
 LineLayoutCache::~LineLayoutCache() = default;
@@ -705,6 +759,11 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 	}
 	if (lengthForLevel != shortCache.size()) {
 		maxValidity = LineLayout::ValidLevel::lines;
+		for (size_t pos = lengthForLevel; pos < shortCache.size(); pos++) {
+			if (shortCache[pos]) {
+				memoryUsed -= shortCache[pos]->memoryCounted;
+			}
+		}
 		shortCache.resize(lengthForLevel);
 		//printf("%s level=%d, size=%zu/%zu, LineLayout=%zu/%zu, BidiData=%zu, XYPOSITION=%zu\n",
 		//	__func__, level, shortCache.size(), shortCache.capacity(), sizeof(LineLayout),
@@ -716,6 +775,8 @@ void LineLayoutCache::AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesI
 void LineLayoutCache::Deallocate() noexcept {
 	maxValidity = LineLayout::ValidLevel::invalid;
 	lastCaretSlot = SIZE_MAX;
+	memoryUsed = 0;
+	memoryLimit = memoryBudget;
 	shortCache.clear();
 	longCache.clear();
 }
@@ -736,24 +797,98 @@ void LineLayoutCache::Invalidate(LineLayout::ValidLevel validity_) noexcept {
 	}
 }
 
+void LineLayoutCache::InvalidateLines(Sci::Line lineFirst, Sci::Line lineLast, LineLayout::ValidLevel validity_) noexcept {
+	if (maxValidity > validity_) {
+		if (level == LineCache::Document) {
+			// layout for each line is cached at the slot of its line number
+			const Sci::Line last = std::min<Sci::Line>(lineLast + 1, shortCache.size());
+			for (Sci::Line line = lineFirst; line < last; line++) {
+				const auto &ll = shortCache[line];
+				if (ll) {
+					ll->Invalidate(validity_);
+				}
+			}
+		} else {
+			for (const auto &ll : shortCache) {
+				if (ll && ll->LineNumber() >= lineFirst && ll->LineNumber() <= lineLast) {
+					ll->Invalidate(validity_);
+				}
+			}
+		}
+		for (const auto &ll : longCache) {
+			if (ll->LineNumber() >= lineFirst && ll->LineNumber() <= lineLast) {
+				ll->Invalidate(validity_);
+			}
+		}
+	}
+}
+
 void LineLayoutCache::SetLevel(LineCache level_) noexcept {
 	if (level != level_) {
 		level = level_;
 		maxValidity = LineLayout::ValidLevel::invalid;
 		lastCaretSlot = SIZE_MAX;
+		memoryUsed = 0;
+		memoryLimit = memoryBudget;
 		shortCache.clear();
 		longCache.clear();
 	}
 }
 
-LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
-	Sci::Line linesOnScreen, Sci::Line linesInDoc, Sci::Line topLine) {
-	AllocateForLevel(linesOnScreen, linesInDoc);
-	if (styleClock != styleClock_) {
-		Invalidate(LineLayout::ValidLevel::checkTextAndStyle);
-		styleClock = styleClock_;
+// memoryUsed misses growth of layouts after they were retrieved, so recount all layouts.
+void LineLayoutCache::Trim(Sci::Line lineNumber, Sci::Line lineCaret, Sci::Line topLine, Sci::Line bottomLine) {
+	size_t used = 0;
+	std::vector<std::pair<uint64_t, std::unique_ptr<LineLayout> *>> candidates;
+	const auto collect = [&](std::unique_ptr<LineLayout> &ll) {
+		if (ll) {
+			const size_t size = ll->MemoryUsage();
+			ll->memoryCounted = size;
+			used += size;
+			// keep requested, caret and visible lines
+			const Sci::Line line = ll->LineNumber();
+			if (line != lineNumber && line != lineCaret && (line < topLine || line > bottomLine)) {
+				const uint64_t age = static_cast<uint32_t>(useClock - ll->lastUsed) + UINT64_C(1);
+				candidates.emplace_back(age*size, &ll);
+			}
+		}
+	};
+	for (auto &ll : shortCache) {
+		collect(ll);
 	}
+	for (auto &ll : longCache) {
+		collect(ll);
+	}
+	if (used <= memoryBudget) {
+		memoryUsed = used;
+		memoryLimit = memoryBudget;
+		return;
+	}
+
+	// evict older and larger layouts first, leave some room to avoid trimming again soon.
+	std::sort(candidates.begin(), candidates.end(), [](const auto &lhs, const auto &rhs) noexcept {
+		return lhs.first > rhs.first;
+	});
+	constexpr size_t memoryTarget = memoryBudget/2;
+	for (const auto &[score, slot] : candidates) {
+		if (used <= memoryTarget) {
+			break;
+		}
+		used -= (*slot)->memoryCounted;
+		slot->reset();
+	}
+	longCache.erase(std::remove(longCache.begin(), longCache.end(), nullptr), longCache.end());
+	// when kept lines alone are over the target, wait for another half budget of new layouts.
+	memoryUsed = used;
+	memoryLimit = std::max(memoryBudget, used + memoryTarget);
+}
+
+LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars,
+	Sci::Line linesOnScreen, Sci::Line linesInDoc, Sci::Line topLine, Sci::Line bottomLine) {
+	AllocateForLevel(linesOnScreen, linesInDoc);
 	maxValidity = LineLayout::ValidLevel::lines;
+	if (memoryUsed > memoryLimit) {
+		Trim(lineNumber, lineCaret, topLine, bottomLine);
+	}
 
 	size_t pos = 0;
 	LineLayout *ret = nullptr;
@@ -775,7 +910,7 @@ LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret,
 		pos = 1 + (lineNumber % gap) + ((diff < gap) ? 0 : gap);
 		// first slot reserved for caret line, which is rapidly retrieved when caret blinking.
 		if (lineNumber == lineCaret) {
-			if (lastCaretSlot == 0 && shortCache[0]->LineNumber() == lineCaret) {
+			if (lastCaretSlot == 0 && shortCache[0] && shortCache[0]->LineNumber() == lineCaret) {
 				pos = 0;
 			} else {
 				lastCaretSlot = pos;
@@ -798,6 +933,7 @@ LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret,
 		if (!ret->CanHold(lineNumber, maxChars)) {
 			//printf("USE line=%zd/%zd, caret=%zd/%zd top=%zd, pos=%zu, clock=%d\n",
 			//	lineNumber, ret->lineNumber, lineCaret, lastCaretSlot, topLine, pos, styleClock_);
+			memoryUsed -= ret->memoryCounted;
 			ret->Free();
 			new (ret) LineLayout(lineNumber, maxChars);
 		} else {
@@ -816,6 +952,11 @@ LineLayout *LineLayoutCache::Retrieve(Sci::Line lineNumber, Sci::Line lineCaret,
 		}
 	}
 
+	ret->lastUsed = ++useClock;
+	// count growth since last retrieved, e.g. wrapped line starts and bidirectional data.
+	const size_t size = ret->MemoryUsage();
+	memoryUsed += size - ret->memoryCounted;
+	ret->memoryCounted = size;
 	// LineLineCache::None is not supported, we only use LineCache::Page.
 	return ret;
 }
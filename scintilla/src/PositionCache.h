@@ -66,6 +66,8 @@ public:
 	unsigned char bracePreviousStyles[2];
 	int edgeColumn;
 	int caretPosition;
+	uint32_t lastUsed;	// LineLayoutCache clock when last retrieved
+	size_t memoryCounted;	// MemoryUsage() included in LineLayoutCache memory total
 	std::unique_ptr<char[]> chars;
 	std::unique_ptr<unsigned char[]> styles;
 	std::unique_ptr<XYPOSITION[]> positions;
@@ -87,7 +89,9 @@ public:
 	void Resize(int maxLineLength_);
 	void Reset(Sci::Line lineNumber_, Sci::Position maxLineLength_);
 	void EnsureBidiData();
+	bool HasRightToLeft() const noexcept;
 	void Free() noexcept;
+	size_t MemoryUsage() const noexcept;
 	void ClearPositions() const noexcept;
 	void Invalidate(ValidLevel validity_) noexcept;
 	Sci::Line LineNumber() const noexcept {
@@ -153,9 +157,9 @@ struct ScreenLine final : public IScreenLine {
 struct SignificantLines {
 	Sci::Line lineCaret;
 	Sci::Line lineTop;
+	Sci::Line lineBottom;	// last visible document line
 	Sci::Line linesOnScreen;
 	Sci::Line linesTotal;
-	int styleClock;
 	Scintilla::LineCache level;
 	bool LineMayCache(Sci::Line line) const noexcept;
 };
@@ -169,9 +173,15 @@ private:
 	size_t lastCaretSlot;
 	Scintilla::LineCache level;
 	LineLayout::ValidLevel maxValidity;
-	int styleClock;
+	uint32_t useClock;
+	size_t memoryUsed;
+	size_t memoryLimit;
 	void AllocateForLevel(Sci::Line linesOnScreen, Sci::Line linesInDoc);
+	void Trim(Sci::Line lineNumber, Sci::Line lineCaret, Sci::Line topLine, Sci::Line bottomLine);
 public:
+	// layouts beyond this size are evicted, least recently used and largest first.
+	static constexpr size_t memoryBudget = 64*1024*1024;
+
 	LineLayoutCache() noexcept;
 	// Deleted so LineLayoutCache objects can not be copied.
 	LineLayoutCache(const LineLayoutCache &) = delete;
@@ -181,16 +191,20 @@ public:
 	~LineLayoutCache();
 	void Deallocate() noexcept;
 	void Invalidate(LineLayout::ValidLevel validity_) noexcept;
+	void InvalidateLines(Sci::Line lineFirst, Sci::Line lineLast, LineLayout::ValidLevel validity_) noexcept;
 	void SetLevel(Scintilla::LineCache level_) noexcept;
 	Scintilla::LineCache GetLevel() const noexcept {
 		return level;
 	}
-	LineLayout* SCICALL Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars, int styleClock_,
-		Sci::Line linesOnScreen, Sci::Line linesInDoc, Sci::Line topLine);
+	// memory of cached layouts when they were last retrieved or trimmed.
+	size_t MemoryUsage() const noexcept {
+		return memoryUsed;
+	}
+	LineLayout* SCICALL Retrieve(Sci::Line lineNumber, Sci::Line lineCaret, int maxChars,
+		Sci::Line linesOnScreen, Sci::Line linesInDoc, Sci::Line topLine, Sci::Line bottomLine);
 	LineLayout* Retrieve(Sci::Line lineNumber, const SignificantLines &significantLines, int maxChars) {
-		return Retrieve(lineNumber, significantLines.lineCaret,
-			maxChars, significantLines.styleClock,
-			significantLines.linesOnScreen, significantLines.linesTotal, significantLines.lineTop);
+		return Retrieve(lineNumber, significantLines.lineCaret, maxChars,
+			significantLines.linesOnScreen, significantLines.linesTotal, significantLines.lineTop, significantLines.lineBottom);
 	}
 
 	static constexpr int UseLongCache(unsigned maxChars) noexcept {
@@ -686,6 +686,7 @@ void LexState::SetWordList(int n, int attribute, const char *wl) {
 		const Sci_Position firstModification = instance->WordListSet(n, attribute, wl);
 		if (firstModification >= 0) {
 			pdoc->ModifiedAt(firstModification);
+			pdoc->DiscardUndoStyles();
 		}
 	}
 }
@@ -741,6 +742,7 @@ void LexState::PropSet(const char *key, const char *val) {
 		const Sci_Position firstModification = instance->PropertySet(key, val);
 		if (firstModification >= 0) {
 			pdoc->ModifiedAt(firstModification);
+			pdoc->DiscardUndoStyles();
 		}
 	}
 }
@@ -815,6 +817,7 @@ void LexState::SetIdentifiers(int style, const char *identifiers) {
 	if (instance) {
 		instance->SetIdentifiers(style, identifiers);
 		pdoc->ModifiedAt(0);
+		pdoc->DiscardUndoStyles();
 	}
 }
 
@@ -298,6 +298,22 @@ const char *ScrapStack::TextAt(size_t position) const noexcept {
 	return stack.data() + position;
 }
 
+void ActionStyles::Compress(const char *styleData, size_t length) {
+	styles.clear();
+	lengths.Clear();
+	size_t index = 0;
+	while (index < length) {
+		const char style = styleData[index];
+		const size_t start = index;
+		do {
+			++index;
+		} while (index < length && styleData[index] == style);
+		styles.push_back(style);
+		lengths.PushBack();
+		lengths.SetValueAt(styles.length() - 1, index - start);
+	}
+}
+
 // The undo history stores a sequence of user operations that represent the user's view of the
 // commands executed on the text.
 // Each user operation contains a sequence of text insertion and text deletion actions.
@@ -319,6 +335,13 @@ int UndoHistory::PreviousAction() const noexcept {
 	return currentAction - 1;
 }
 
+void UndoHistory::TruncateActionStyles(int action) noexcept {
+	// drop styles for actions at or after action
+	while (!actionStyles.empty() && actionStyles.back().action >= action) {
+		actionStyles.pop_back();
+	}
+}
+
 UndoHistory::UndoHistory() {
 	scraps = std::make_unique<ScrapStack>();
 }
@@ -399,6 +422,7 @@ const char *UndoHistory::AppendAction(ActionType at, Sci::Position position, con
 		actions.PushBack();
 	} else {
 		actions.Truncate(currentAction + 1);
+		TruncateActionStyles(currentAction);
 	}
 	actions.Create(currentAction, at, position, lengthData, mayCoalesce);
 	currentAction++;
@@ -436,6 +460,7 @@ void UndoHistory::DeleteUndoHistory() noexcept {
 	tentativePoint = -1;
 	scraps->Clear();
 	memory = {};
+	DiscardActionStyles();
 }
 
 int UndoHistory::Actions() const noexcept {
@@ -530,6 +555,7 @@ bool UndoHistory::Validate(intptr_t lengthDocument) const noexcept {
 void UndoHistory::SetCurrent(int action, intptr_t lengthDocument) {
 	// Find position in scraps for action
 	memory = {};
+	DiscardActionStyles();
 	const size_t lengthSum = actions.LengthTo(action);
 	scraps->SetCurrent(lengthSum);
 	currentAction = action;
@@ -591,6 +617,29 @@ void UndoHistory::ChangeLastUndoActionText(size_t length, const char *text) {
 	scraps->Push(text, length);
 }
 
+void UndoHistory::SetActionStyles(ActionStyles &&styles) {
+	const auto it = std::lower_bound(actionStyles.begin(), actionStyles.end(), styles.action,
+		[](const ActionStyles &entry, int action) noexcept { return entry.action < action; });
+	if (it != actionStyles.end() && it->action == styles.action) {
+		*it = std::move(styles);
+	} else {
+		actionStyles.insert(it, std::move(styles));
+	}
+}
+
+const ActionStyles *UndoHistory::GetActionStyles(int action) const noexcept {
+	const auto it = std::lower_bound(actionStyles.begin(), actionStyles.end(), action,
+		[](const ActionStyles &entry, int act) noexcept { return entry.action < act; });
+	if (it != actionStyles.end() && it->action == action) {
+		return &*it;
+	}
+	return nullptr;
+}
+
+void UndoHistory::DiscardActionStyles() noexcept {
+	actionStyles.clear();
+}
+
 void UndoHistory::SetTentative(int action) noexcept {
 	tentativePoint = action;
 }
@@ -607,6 +656,7 @@ void UndoHistory::TentativeCommit() noexcept {
 	tentativePoint = -1;
 	// Truncate undo history
 	actions.Truncate(currentAction);
+	TruncateActionStyles(currentAction);
 }
 
 bool UndoHistory::TentativeActive() const noexcept {
@@ -74,6 +74,23 @@ public:
 	[[nodiscard]] const char *TextAt(size_t position) const noexcept;
 };
 
+// Styles and lexer line data of text removed from document by a large action, so that
+// undo or redo inserting the text again can restore styling instead of lexing it again.
+struct ActionStyles {
+	int action = 0;
+	int lineStateBefore = 0;		// line state of the line before the action
+	Sci::Position prefixLength = 0;	// styles start from the line containing the action
+	std::string styles;				// style of each run
+	ScaledVector lengths;			// length of each run
+	std::vector<int> lineStates;	// for each line ending inside the text
+	std::vector<int> levels;
+
+	void Compress(const char *styleData, size_t length);
+	[[nodiscard]] size_t Runs() const noexcept {
+		return styles.length();
+	}
+};
+
 constexpr int coalesceFlag = 0x100;
 
 /**
@@ -89,8 +106,10 @@ class UndoHistory final {
 	std::unique_ptr<ScrapStack> scraps;
 	struct actPos { int act; size_t position; };
 	std::optional<actPos> memory;
+	std::vector<ActionStyles> actionStyles;	// sorted by action
 
 	int PreviousAction() const noexcept;
+	void TruncateActionStyles(int action) noexcept;
 
 public:
 	UndoHistory();
@@ -133,6 +152,10 @@ public:
 	void PushUndoActionType(int type, Sci::Position position);
 	void ChangeLastUndoActionText(size_t length, const char *text);
 
+	void SetActionStyles(ActionStyles &&styles);
+	[[nodiscard]] const ActionStyles *GetActionStyles(int action) const noexcept;
+	void DiscardActionStyles() noexcept;
+
 	// Tentative actions are used for input composition so that it can be undone cleanly
 	void SetTentative(int action) noexcept;
 	[[nodiscard]] int TentativePoint() const noexcept;
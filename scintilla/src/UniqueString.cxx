@@ -5,6 +5,7 @@
 // Copyright 2017 by Neil Hodgson <neilh@scintilla.org>
 // The License.txt file describes the conditions under which this software may be distributed.
 
+#include <cstring>
 #include <string_view>
 #include <vector>
 #include <algorithm>
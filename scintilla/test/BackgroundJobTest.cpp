@@ -0,0 +1,141 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include "../../src/BackgroundJob.h"
+
+// Drives jobs through InlineJobExecutor and executor steps: commit, failure, cancellation inside Run(),
+// stale generations, progress and snapshot release.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 BackgroundJobTest.cpp ../../src/BackgroundJob.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 BackgroundJobTest.cpp ../../src/BackgroundJob.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra BackgroundJobTest.cpp ../../src/BackgroundJob.cpp
+
+namespace {
+
+// counts given character in the snapshot, optionally cancels or fails halfway.
+class CountJob final : public BackgroundJob {
+public:
+	char ch = 'a';
+	bool cancelHalfway = false;
+	bool fail = false;
+	size_t count = 0;
+	int applied = 0;
+	size_t result = 0;
+
+protected:
+	bool Run() noexcept override {
+		count = 0;
+		const char *text = Text();
+		const size_t length = Length();
+		for (size_t i = 0; i < length; i++) {
+			if (cancelHalfway && i == length/2) {
+				Cancel();
+			}
+			if (!Continue()) {
+				return false;
+			}
+			count += text[i] == ch;
+			ReportProgress(i + 1, length, 1);
+		}
+		return !fail;
+	}
+	void Apply() noexcept override {
+		++applied;
+		result = count;
+	}
+};
+
+int failures = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		++failures;
+		printf("failed: %s\n", what);
+	}
+}
+
+}
+
+int main() {
+	InlineJobExecutor executor;
+	const char text[] = "banana bandana";
+	const size_t length = strlen(text);
+
+	{
+		CountJob job;
+		Check(job.State() == JobState::Idle, "new job is idle");
+		Check(job.TakeSnapshot(text, length), "take snapshot");
+		Check(job.Length() == length && job.Text()[length] == '\0', "snapshot is NUL-terminated copy");
+		Check(job.Text() != text && memcmp(job.Text(), text, length) == 0, "snapshot content");
+		Check(executor.Submit(job), "submit");
+		Check(job.applied == 1 && job.result == 6, "finished job is applied");
+		Check(job.State() == JobState::Idle && job.Text() == nullptr && job.Length() == 0, "snapshot released after commit");
+	}
+	{
+		// empty document
+		CountJob job;
+		Check(job.TakeSnapshot(text, 0), "take empty snapshot");
+		Check(job.Text() != nullptr && job.Text()[0] == '\0', "empty snapshot is NUL-terminated");
+		executor.Submit(job);
+		Check(job.applied == 1 && job.result == 0, "empty job is applied");
+	}
+	{
+		CountJob job;
+		job.fail = true;
+		job.TakeSnapshot(text, length);
+		executor.Submit(job);
+		Check(job.applied == 0, "failed job is not applied");
+		Check(job.State() == JobState::Idle && job.Text() == nullptr, "failed job is discarded");
+	}
+	{
+		CountJob job;
+		job.cancelHalfway = true;
+		job.TakeSnapshot(text, length);
+		executor.Submit(job);
+		Check(job.applied == 0, "cancelled job is not applied");
+		Check(job.count < 6, "cancelled job stopped early");
+		Check(job.State() == JobState::Idle && job.Text() == nullptr, "cancelled job is discarded");
+
+		// token is reset for next run
+		job.cancelHalfway = false;
+		job.TakeSnapshot(text, length);
+		executor.Submit(job);
+		Check(job.applied == 1 && job.result == 6, "job runs again after cancel");
+	}
+	{
+		// executor steps: completion of old generation is ignored
+		CountJob job;
+		job.TakeSnapshot(text, length);
+		job.Start();
+		const uint32_t generation = job.Generation();
+		Check(job.Busy(), "started job is busy");
+		Check(!job.Commit(generation), "running job is not committed");
+		job.Execute();
+		Check(job.State() == JobState::Finished, "executed job is finished");
+		const JobProgress progress = job.Progress();
+		Check(progress.done == length && progress.total == length && progress.phase == 1, "progress of finished job");
+		Check(!job.Commit(generation - 1), "stale generation is ignored");
+		Check(job.applied == 0 && job.Text() != nullptr, "stale commit keeps result");
+		Check(job.Commit(generation), "current generation is committed");
+		Check(job.applied == 1 && !job.Commit(generation), "job is committed once");
+
+		job.TakeSnapshot(text, length);
+		job.Start();
+		const JobProgress started = job.Progress();
+		Check(started.done == 0 && started.total == 0 && started.phase == 0, "progress is reset on start");
+		job.Discard();
+	}
+	{
+		CountJob job;
+		job.TakeSnapshot(text, length);
+		executor.Cancel(job);
+		Check(job.State() == JobState::Idle && job.Text() == nullptr, "cancel drops snapshot");
+		Check(job.applied == 0, "cancelled job is not applied");
+	}
+
+	printf("%s\n", (failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
@@ -0,0 +1,384 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <forward_list>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <random>
+
+#include "ScintillaTypes.h"
+#include "ScintillaMessages.h"
+#include "ScintillaStructures.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+#include "CharacterSet.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CompressedStorage.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+
+// Checks block codec and compressed document (SCI_COMPRESSDOCUMENT) against a plain document
+// with random reads, style writes, search and edits, then measures memory, scanning, searching
+// and scrolling on generated log text.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib CompressedStorageTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib CompressedStorageTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -DNO_CXX11_REGEX -I../include -I../src -I../lexlib CompressedStorageTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+// defined in PlatWin.cxx, styling duration is not measured here
+namespace Scintilla::Internal {
+int64_t QueryPerformanceFrequency() noexcept {
+	return 1;
+}
+int64_t QueryPerformanceCounter() noexcept {
+	return 0;
+}
+}
+
+namespace {
+
+size_t failures = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s\n", what);
+		}
+	}
+}
+
+double Elapsed(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// log lines with timestamp, level, source and message, messages repeat with different numbers.
+std::string MakeLog(std::mt19937 &rng, size_t length) {
+	static const char *const levels[] = {"INFO ", "DEBUG", "WARN ", "ERROR", "TRACE"};
+	static const char *const sources[] = {"http.server", "db.pool", "cache", "auth", "scheduler", "worker-12", "worker-7"};
+	static const char *const messages[] = {
+		"request completed status=200 bytes=", "connection acquired from pool, active=", "cache miss for key user:",
+		"token refreshed for session ", "job finished in ms=", "retrying operation attempt=", "slow query detected duration=",
+		"GET /api/v2/items?page=", "queue length=", "Ünïcode payload size=",
+	};
+	std::string text;
+	text.reserve(length + 256);
+	unsigned seconds = 0;
+	char line[256];
+	while (text.length() < length) {
+		seconds += rng() % 3;
+		const int count = snprintf(line, sizeof(line), "2026-10-%02u %02u:%02u:%02u.%03u [%s] %s: %s%u\r\n",
+			1 + seconds/86400 % 28, seconds/3600 % 24, seconds/60 % 60, seconds % 60, static_cast<unsigned>(rng() % 1000),
+			levels[rng() % std::size(levels)], sources[rng() % std::size(sources)],
+			messages[rng() % std::size(messages)], static_cast<unsigned>(rng() % 100000));
+		text.append(line, count);
+	}
+	text.resize(length);
+	return text;
+}
+
+void TestCodec(std::mt19937 &rng) {
+	std::vector<std::string> samples;
+	samples.push_back(MakeLog(rng, 70000));
+	samples.emplace_back(65536, '\0');
+	std::string random(65536, '\0');
+	for (char &ch : random) {
+		ch = static_cast<char>(rng());
+	}
+	samples.push_back(random);
+	std::string periodic;
+	while (periodic.length() < 40000) {
+		periodic += "abc";
+		if (rng() % 50 == 0) {
+			periodic += static_cast<char>(rng());
+		}
+	}
+	samples.push_back(periodic);
+	for (size_t length = 0; length < 40; length++) {
+		samples.emplace_back(length, 'x');
+		samples.push_back(random.substr(0, length));
+	}
+
+	std::vector<char> packed;
+	std::vector<char> unpacked;
+	bool same = true;
+	bool bounded = true;
+	for (const std::string &sample : samples) {
+		packed.resize(LZCompressBound(sample.length()));
+		const size_t size = LZCompress(sample.data(), sample.length(), packed.data());
+		bounded = bounded && size <= packed.size();
+		unpacked.assign(sample.length() + 1, '\xff');
+		same = same && LZDecompress(packed.data(), size, unpacked.data(), sample.length())
+			&& memcmp(unpacked.data(), sample.data(), sample.length()) == 0 && unpacked.back() == '\xff';
+	}
+	Check(bounded, "compressed size within bound");
+	Check(same, "decompressed data same as original");
+
+	// broken input must be rejected or decoded within the output buffer
+	const std::string &sample = samples[0];
+	packed.resize(LZCompressBound(sample.length()));
+	const size_t size = LZCompress(sample.data(), sample.length(), packed.data());
+	printf("codec: log block %zu -> %zu bytes\n", sample.length(), size);
+	bool rejected = true;
+	for (size_t length = 0; length < size; length += 1 + length/16) {
+		rejected = rejected && !LZDecompress(packed.data(), length, unpacked.data(), sample.length());
+	}
+	Check(rejected, "truncated input");
+	for (int round = 0; round < 2000; round++) {
+		std::vector<char> broken(packed.begin(), packed.begin() + size);
+		broken[rng() % size] = static_cast<char>(rng());
+		LZDecompress(broken.data(), broken.size(), unpacked.data(), sample.length());
+	}
+}
+
+std::unique_ptr<Document> NewDocument(const std::string &text) {
+	std::unique_ptr<Document> doc = std::make_unique<Document>(DocumentOption::Default);
+	doc->SetDBCSCodePage(CpUtf8);
+	doc->SetCaseFolder(std::make_unique<CaseFolderUnicode>());
+	doc->InsertString(0, text);
+	doc->SetUndoCollection(true);
+	return doc;
+}
+
+void SetStyles(Document *doc, Sci::Position position, Sci::Position length, unsigned char style) {
+	doc->StartStyling(position);
+	doc->SetStyleFor(length, style);
+}
+
+bool SameDocument(const Document *lhs, const Document *rhs) {
+	const Sci::Position length = lhs->Length();
+	if (length != rhs->Length() || lhs->LinesTotal() != rhs->LinesTotal()) {
+		return false;
+	}
+	std::string text1(length, '\0');
+	std::string text2(length, '\0');
+	lhs->GetCharRange(text1.data(), 0, length);
+	rhs->GetCharRange(text2.data(), 0, length);
+	if (text1 != text2) {
+		return false;
+	}
+	for (Sci::Position pos = 0; pos < length; pos++) {
+		if (lhs->StyleAt(pos) != rhs->StyleAt(pos)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void TestDocument(std::mt19937 &rng) {
+	const std::string text = MakeLog(rng, 40*CompressedStorage::BlockSize + 1234);
+	std::unique_ptr<Document> plain = NewDocument(text);
+	std::unique_ptr<Document> doc = NewDocument(text);
+	const Sci::Position length = plain->Length();
+	for (Sci::Position pos = 0; pos < length; pos += 1 + rng() % 5000) {
+		const Sci::Position count = std::min<Sci::Position>(1 + rng() % 3000, length - pos);
+		const unsigned char style = rng() % 4;
+		SetStyles(plain.get(), pos, count, style);
+		SetStyles(doc.get(), pos, count, style);
+	}
+	doc->Compress();
+	Check(doc->IsCompressed() && !plain->IsCompressed(), "compressed");
+
+	bool sameChars = true;
+	bool sameRanges = true;
+	bool sameStyles = true;
+	bool samePointers = true;
+	bool sameFound = true;
+	std::string buffer1;
+	std::string buffer2;
+	for (int round = 0; round < 20000; round++) {
+		const Sci::Position pos = static_cast<Sci::Position>(rng() % (length + 2)) - 1;
+		switch (rng() % 8) {
+		case 0:
+			sameChars = sameChars && plain->CharAt(pos) == doc->CharAt(pos) && plain->StyleAt(pos) == doc->StyleAt(pos);
+			break;
+		case 1: {
+			const Sci::Position start = std::max<Sci::Position>(pos, 0);
+			const Sci::Position count = std::min<Sci::Position>(rng() % 200000, length - start);
+			buffer1.assign(count, '\0');
+			buffer2.assign(count, '\0');
+			plain->GetCharRange(buffer1.data(), start, count);
+			doc->GetCharRange(buffer2.data(), start, count);
+			sameRanges = sameRanges && buffer1 == buffer2;
+			plain->GetStyleRange(reinterpret_cast<unsigned char *>(buffer1.data()), start, count);
+			doc->GetStyleRange(reinterpret_cast<unsigned char *>(buffer2.data()), start, count);
+			sameStyles = sameStyles && buffer1 == buffer2;
+		} break;
+		case 2:
+		case 3: {
+			// within block, or spans blocks
+			const Sci::Position start = std::max<Sci::Position>(pos, 0);
+			const Sci::Position count = std::min<Sci::Position>(rng() % ((round & 1) ? 300 : 150000), length - start);
+			const char *data1 = plain->RangePointer(start, count);
+			const char *data2 = doc->RangePointer(start, count);
+			samePointers = samePointers && memcmp(data1, data2, count) == 0;
+			data1 = plain->StyleRangePointer(start, count);
+			data2 = doc->StyleRangePointer(start, count);
+			samePointers = samePointers && memcmp(data1, data2, count) == 0;
+		} break;
+		case 4:
+		case 5: {
+			const Sci::Position start = std::max<Sci::Position>(pos, 0);
+			const Sci::Position count = std::min<Sci::Position>(1 + rng() % ((round & 1) ? 100 : 100000), length - start);
+			const unsigned char style = rng() % 8;
+			SetStyles(plain.get(), start, count, style);
+			SetStyles(doc.get(), start, count, style);
+		} break;
+		case 6: {
+			const unsigned char style = rng() % 8;
+			const Sci::Position start = std::max<Sci::Position>(pos, 0);
+			plain->StartStyling(start);
+			doc->StartStyling(start);
+			const Sci::Position count = std::min<Sci::Position>(rng() % 100, length - start);
+			std::vector<unsigned char> styles(count, style);
+			for (unsigned char &ch : styles) {
+				ch = static_cast<unsigned char>(ch + (rng() & 1));
+			}
+			plain->SetStyles(count, styles.data());
+			doc->SetStyles(count, styles.data());
+		} break;
+		default: {
+			static const char *const words[] = {"status=200 bytes=99", "ERROR] auth", "Ünïcode payload size=4", "not found"};
+			const char *word = words[rng() % std::size(words)];
+			const Sci::Position start = std::max<Sci::Position>(pos, 0);
+			const Sci::Position end = (round & 1) ? length : 0;
+			const FindOption flags = (round & 2) ? FindOption::MatchCase : FindOption::None;
+			Sci::Position length1 = strlen(word);
+			Sci::Position length2 = length1;
+			sameFound = sameFound && plain->FindText(start, end, word, flags, &length1) == doc->FindText(start, end, word, flags, &length2)
+				&& length1 == length2;
+		} break;
+		}
+	}
+	Check(doc->IsCompressed(), "still compressed after reading and styling");
+	Check(sameChars, "CharAt and StyleAt");
+	Check(sameRanges, "GetCharRange");
+	Check(sameStyles, "GetStyleRange");
+	Check(samePointers, "RangePointer and StyleRangePointer");
+	Check(sameFound, "FindText");
+	Check(SameDocument(plain.get(), doc.get()), "same content after styling");
+
+	// modification decompress the document
+	const Sci::Position pos = length / 3;
+	plain->InsertString(pos, "inserted\r\n");
+	doc->InsertString(pos, "inserted\r\n");
+	Check(!doc->IsCompressed() && SameDocument(plain.get(), doc.get()), "insert");
+	doc->Compress();
+	plain->Undo();
+	doc->Undo();
+	Check(!doc->IsCompressed() && SameDocument(plain.get(), doc.get()), "undo");
+	doc->Compress();
+	plain->DeleteChars(0, length / 2);
+	doc->DeleteChars(0, length / 2);
+	Check(!doc->IsCompressed() && SameDocument(plain.get(), doc.get()), "delete");
+	doc->Compress();
+	Check(strcmp(plain->BufferPointer(), doc->BufferPointer()) == 0 && !doc->IsCompressed(), "BufferPointer");
+}
+
+void Benchmark(std::mt19937 &rng) {
+	const std::string text = MakeLog(rng, 64*1024*1024);
+	// styles of a log lexer: timestamp, level and source, default for message
+	std::string styles(text.length(), '\0');
+	for (size_t pos = 0; pos < text.length();) {
+		const size_t lineEnd = std::min(text.find('\n', pos), text.length() - 1) + 1;
+		std::fill_n(styles.begin() + pos, std::min<size_t>(24, lineEnd - pos), 1);
+		if (lineEnd - pos > 24) {
+			std::fill_n(styles.begin() + pos + 24, std::min<size_t>(8, lineEnd - pos - 24), 2);
+		}
+		pos = lineEnd;
+	}
+
+	for (const std::string *data : {&text, static_cast<const std::string *>(&styles)}) {
+		SplitVector<char> vector;
+		vector.InsertFromArray(0, data->data(), 0, data->length());
+		auto start = std::chrono::steady_clock::now();
+		std::unique_ptr<CompressedStorage> storage = std::make_unique<CompressedStorage>(vector);
+		const double compressTime = Elapsed(start);
+		SplitVector<char> restored;
+		start = std::chrono::steady_clock::now();
+		storage->DecompressTo(restored);
+		const double decompressTime = Elapsed(start);
+		printf("%-6s %zu MiB: %6.2f MiB compressed (%4.1fx), compress %4.0f ms, decompress %4.0f ms\n",
+			(data == &text) ? "text" : "styles", data->length() >> 20, storage->MemoryUsage()/1048576.0,
+			static_cast<double>(data->length())/storage->MemoryUsage(), compressTime, decompressTime);
+		Check(restored.Length() == vector.Length() && memcmp(restored.BufferPointer(), data->data(), data->length()) == 0, "restored");
+	}
+
+	std::unique_ptr<Document> plain = NewDocument(text);
+	std::unique_ptr<Document> doc = NewDocument(text);
+	for (Document *pdoc : {plain.get(), doc.get()}) {
+		pdoc->StartStyling(0);
+		pdoc->SetStyles(pdoc->Length(), reinterpret_cast<const unsigned char *>(styles.data()));
+	}
+	doc->Compress();
+
+	const Sci::Position length = plain->Length();
+	for (Document *pdoc : {plain.get(), doc.get()}) {
+		const char *name = pdoc->IsCompressed() ? "compressed" : "plain";
+		auto start = std::chrono::steady_clock::now();
+		unsigned sum = 0;
+		for (Sci::Position pos = 0; pos < length; pos++) {
+			sum += static_cast<unsigned char>(pdoc->CharAt(pos));
+		}
+		const double scan = Elapsed(start);
+
+		start = std::chrono::steady_clock::now();
+		Sci::Position found = 0;
+		for (const FindOption flags : {FindOption::MatchCase, FindOption::None}) {
+			Sci::Position lengthFound = 9;
+			found += pdoc->FindText(0, length, "not found", flags, &lengthFound);
+		}
+		const double search = Elapsed(start);
+
+		// scroll pages of 60 lines, jump to random position sometimes
+		std::mt19937 scroll{1234};
+		start = std::chrono::steady_clock::now();
+		const Sci::Line lines = pdoc->LinesTotal();
+		Sci::Line line = 0;
+		for (int page = 0; page < 20000; page++) {
+			line = (page % 100 == 0) ? static_cast<Sci::Line>(scroll() % lines) : std::min<Sci::Line>(line + 60, lines - 60);
+			for (Sci::Line index = line; index < line + 60; index++) {
+				const Sci::Position lineStart = pdoc->LineStart(index);
+				const Sci::Position lineLength = pdoc->LineStart(index + 1) - lineStart;
+				sum += static_cast<unsigned char>(*pdoc->RangePointer(lineStart, lineLength));
+				sum += static_cast<unsigned char>(*pdoc->StyleRangePointer(lineStart, lineLength));
+			}
+		}
+		const double scrolling = Elapsed(start);
+		printf("%-10s CharAt scan %6.1f ms, search %6.1f ms, scroll %5.2f us per page (%u, %zd)\n",
+			name, scan, search, scrolling*1000/20000, sum & 1, found);
+	}
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20261019};
+	TestCodec(rng);
+	TestDocument(rng);
+	Benchmark(rng);
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
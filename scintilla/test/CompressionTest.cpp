@@ -0,0 +1,180 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../src/Compression.h"
+
+// Round trip and corrupt input checks for gzip and Zstandard codecs used to load and save compressed files.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include CompressionTest.cpp ../../src/Compression.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include CompressionTest.cpp ../../src/Compression.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -I../include CompressionTest.cpp ../../src/Compression.cpp
+
+namespace {
+
+constexpr size_t padding = 16;
+int failures = 0;
+
+void Check(bool condition, const char *what, const char *name) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s, %s\n", what, name);
+		}
+	}
+}
+
+void *GrowBuffer(void *block, size_t size) noexcept {
+	if (size == 0) {
+		free(block);
+		return nullptr;
+	}
+	return realloc(block, size);
+}
+
+std::string Compress(CompressionFormat format, const std::string &text) {
+	Compressor compressor{format};
+	// written in pieces like saving a document with gap buffer
+	const size_t half = text.length() / 2;
+	if (!compressor.Write(text.data(), half) || !compressor.Write(text.data() + half, text.length() - half)
+		|| !compressor.Finish()) {
+		return {};
+	}
+	return std::string(static_cast<const char *>(compressor.Data()), compressor.Length());
+}
+
+DecompressStatus Decompress(const std::string &data, size_t maxSize, int threads, std::string &text) {
+	text.clear();
+	Decompressor decompressor;
+	const CompressionFormat format = DetectCompression(data.data(), data.length());
+	if (decompressor.Prepare(format, data.data(), data.length(), maxSize, padding, GrowBuffer)) {
+		std::vector<std::thread> workers;
+		if (decompressor.Segments() > 1) {
+			for (int i = 1; i < threads; i++) {
+				workers.emplace_back([&decompressor] { decompressor.Run(); });
+			}
+		}
+		decompressor.Run();
+		for (auto &worker : workers) {
+			worker.join();
+		}
+	}
+	const DecompressStatus status = decompressor.Status();
+	if (status == DecompressStatus::Ok) {
+		const size_t length = decompressor.Length();
+		char *output = decompressor.Detach();
+		if (output != nullptr) {
+			text.assign(output, length);
+			for (size_t i = 0; i < padding; i++) {
+				if (output[length + i] != '\0') {
+					Check(false, "padding is zeroed", "");
+					break;
+				}
+			}
+			free(output);
+		}
+	}
+	return status;
+}
+
+void CheckRoundTrip(CompressionFormat format, const char *name, const std::string &text) {
+	const std::string data = Compress(format, text);
+	Check(!data.empty(), "compress", name);
+	Check(DetectCompression(data.data(), data.length()) == format, "detect format", name);
+
+	std::string output;
+	Check(Decompress(data, SIZE_MAX/2, 1, output) == DecompressStatus::Ok && output == text, "round trip", name);
+	Check(Decompress(data, SIZE_MAX/2, 4, output) == DecompressStatus::Ok && output == text, "round trip with threads", name);
+
+	// concatenated members or frames
+	const std::string second = Compress(format, "second part\n");
+	Check(Decompress(data + second, SIZE_MAX/2, 4, output) == DecompressStatus::Ok && output == text + "second part\n",
+		"concatenated", name);
+
+	if (!text.empty()) {
+		Check(Decompress(data, text.length() - 1, 4, output) == DecompressStatus::TooLarge, "size limit", name);
+		Check(Decompress(data, text.length(), 4, output) == DecompressStatus::Ok && output == text, "size equals limit", name);
+	}
+}
+
+// truncated or damaged data must fail or decode to the original text (e.g. change in header field
+// not covered by checksum), it must never crash or return other content.
+void CheckCorrupt(CompressionFormat format, const char *name, const std::string &text, std::mt19937 &rng) {
+	const std::string data = Compress(format, text);
+	std::string output;
+	for (size_t length = 0; length < data.length(); length += 1 + length/8) {
+		const DecompressStatus status = Decompress(data.substr(0, length), SIZE_MAX/2, 4, output);
+		Check(status != DecompressStatus::Ok || output.empty() || output == text, "truncated data", name);
+		Check(status != DecompressStatus::Ok || length != 0, "empty data", name);
+	}
+	for (int round = 0; round < 500; round++) {
+		std::string damaged = data;
+		const size_t count = 1 + rng() % 3;
+		for (size_t i = 0; i < count; i++) {
+			damaged[rng() % damaged.length()] ^= static_cast<char>(1 << (rng() % 8));
+		}
+		const DecompressStatus status = Decompress(damaged, text.length() + 4096, 4, output);
+		Check(status != DecompressStatus::Ok || output == text, "damaged data", name);
+	}
+}
+
+std::string MakeText(std::mt19937 &rng, size_t length, bool random) {
+	static const char *const words[] = {
+		"int", "return", "value", "index", "{", "}", "(", ")", ";", "\n", "\t", " ", "0x7f", "nullptr",
+	};
+	std::string text;
+	while (text.length() < length) {
+		if (random) {
+			text.push_back(static_cast<char>(rng()));
+		} else {
+			text += words[rng() % std::size(words)];
+		}
+	}
+	text.resize(length);
+	return text;
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20260101};
+	const std::string texts[] = {
+		"",
+		"a",
+		"Hello, world!\n",
+		std::string(100000, 'x'),
+		MakeText(rng, 5000, false),
+		MakeText(rng, 3*1024*1024 + 123, false),
+		MakeText(rng, 70000, true),
+	};
+	const char *const names[] = {
+		"empty", "one byte", "short", "repeated", "code", "large code", "random bytes",
+	};
+	const CompressionFormat formats[] = {CompressionFormat::Gzip, CompressionFormat::Zstd};
+	const char *const formatNames[] = {"gzip", "zstd"};
+
+	for (int k = 0; k < 2; k++) {
+		for (size_t i = 0; i < std::size(texts); i++) {
+			std::string name = std::string(formatNames[k]) + " " + names[i];
+			CheckRoundTrip(formats[k], name.c_str(), texts[i]);
+			if (texts[i].length() <= 100000) {
+				CheckCorrupt(formats[k], name.c_str(), texts[i], rng);
+			}
+		}
+	}
+
+	// plain text is not detected as compressed
+	Check(DetectCompression(texts[4].data(), texts[4].length()) == CompressionFormat::None, "detect plain text", "");
+	Check(DetectCompression("\x1f", 1) == CompressionFormat::None, "detect short data", "");
+
+	printf("%s\n", (failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
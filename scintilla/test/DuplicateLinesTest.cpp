@@ -0,0 +1,182 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <random>
+
+#include "../../src/DuplicateLines.h"
+
+// Checks removing duplicate or unique lines against a std::unordered_map based implementation,
+// then measures time and memory for grouping 10M lines.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 DuplicateLinesTest.cpp ../../src/DuplicateLines.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 DuplicateLinesTest.cpp ../../src/DuplicateLines.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra DuplicateLinesTest.cpp ../../src/DuplicateLines.cpp
+
+namespace {
+
+size_t failures = 0;
+
+void Check(bool condition, const char *what, unsigned flags) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s, flags %u\n", what, flags);
+		}
+	}
+}
+
+struct Line {
+	std::string_view content;
+	std::string_view eol;
+};
+
+std::vector<Line> SplitLines(std::string_view text) {
+	std::vector<Line> lines;
+	size_t pos = 0;
+	while (pos < text.length()) {
+		const size_t end = std::min(text.find_first_of("\r\n", pos), text.length());
+		size_t next = end;
+		if (next < text.length()) {
+			next += (text[next] == '\r' && next + 1 < text.length() && text[next + 1] == '\n') ? 2 : 1;
+		}
+		lines.push_back({text.substr(pos, end - pos), text.substr(end, next - end)});
+		pos = next;
+	}
+	return lines;
+}
+
+std::string Expected(std::string_view text, unsigned flags, uint32_t &dropped) {
+	const std::vector<Line> lines = SplitLines(text);
+	std::unordered_map<std::string_view, uint32_t> counts;
+	for (const Line &line : lines) {
+		counts[line.content]++;
+	}
+	std::unordered_map<std::string_view, bool> seen;
+	std::string result;
+	size_t lastEOL = 0;
+	dropped = 0;
+	for (const Line &line : lines) {
+		unsigned drop;
+		if (counts[line.content] == 1) {
+			drop = DuplicateLineDropUnique;
+		} else if (!seen[line.content]) {
+			drop = DuplicateLineDropFirst;
+		} else {
+			drop = DuplicateLineDropRepeat;
+		}
+		seen[line.content] = true;
+		if (flags & drop) {
+			++dropped;
+		} else {
+			result += line.content;
+			result += line.eol;
+			lastEOL = line.eol.length();
+		}
+	}
+	if (!text.empty() && text.back() != '\r' && text.back() != '\n') {
+		result.resize(result.length() - lastEOL);
+	}
+	return result;
+}
+
+void CheckText(DuplicateLineFinder &finder, std::string_view text) {
+	const bool found = finder.Find(text.data(), text.length());
+	Check(found, "find", 0);
+	if (!found) {
+		return;
+	}
+	Check(finder.LineCount() == SplitLines(text).size(), "line count", 0);
+	std::string output;
+	for (unsigned flags = 0; flags <= (DuplicateLineDropUnique | DuplicateLineDropFirst | DuplicateLineDropRepeat); flags++) {
+		uint32_t dropped = 0;
+		const std::string expected = Expected(text, flags, dropped);
+		output.assign(text.length() + 1, '\0');
+		output.resize(finder.Filter(output.data(), flags));
+		Check(output == expected, "filter", flags);
+		Check(finder.DropCount(flags) == dropped, "drop count", flags);
+	}
+}
+
+void TestSample() {
+	DuplicateLineFinder finder;
+	// line endings are not part of content, last line without line ending
+	CheckText(finder, "a\nb\r\na\rc\na\r\nb");
+	CheckText(finder, "a\nb\na\n");
+	CheckText(finder, "\n\n\r\n\r\r\n");
+	CheckText(finder, "x");
+	CheckText(finder, "");
+	// prefix of another line
+	CheckText(finder, "ab\na\nab\na");
+
+	constexpr unsigned merge = DuplicateLineDropRepeat;
+	const std::string_view text = "b\na\nb\nc\na";
+	finder.Find(text.data(), text.length());
+	char output[16]{};
+	const size_t length = finder.Filter(output, merge);
+	Check(std::string_view(output, length) == "b\na\nc", "merge keeps order", merge);
+	Check(finder.GroupCount() == 3, "group count", merge);
+}
+
+void TestRandom(std::mt19937 &rng) {
+	static constexpr std::string_view eols[] = {"\n", "\r\n", "\r"};
+	DuplicateLineFinder finder;
+	for (int round = 0; round < 400; round++) {
+		// few distinct lines for many duplicates, or many for hash table growth
+		const unsigned distinct = (round % 4 == 0) ? 5000 : 1 + rng() % 30;
+		const unsigned lines = 1 + rng() % ((round % 4 == 0) ? 20000 : 200);
+		std::string text;
+		for (unsigned line = 0; line < lines; line++) {
+			const unsigned value = rng() % distinct;
+			text += std::string(value % 3, ' ');
+			text += std::to_string(value);
+			text += eols[rng() % std::size(eols)];
+		}
+		if (rng() & 1) {
+			text.pop_back();
+		}
+		CheckText(finder, text);
+	}
+}
+
+void Benchmark(std::mt19937 &rng) {
+	constexpr unsigned lines = 10'000'000;
+	std::string text;
+	text.reserve(lines*32);
+	for (unsigned line = 0; line < lines; line++) {
+		// about half of lines repeat an earlier line
+		const unsigned value = rng() % (lines/2);
+		text += "2026-10-19 12:00:00 item ";
+		text += std::to_string(value);
+		text += '\n';
+	}
+
+	DuplicateLineFinder finder;
+	auto start = std::chrono::steady_clock::now();
+	finder.Find(text.data(), text.length());
+	const std::chrono::duration<double, std::milli> find = std::chrono::steady_clock::now() - start;
+	std::string output(text.length() + 1, '\0');
+	start = std::chrono::steady_clock::now();
+	const size_t length = finder.Filter(output.data(), DuplicateLineDropRepeat);
+	const std::chrono::duration<double, std::milli> filter = std::chrono::steady_clock::now() - start;
+	printf("%u lines (%zu MiB), %u distinct: find %.0f ms, filter %.0f ms, %.1f MiB (%.1f bytes per line), output %zu MiB\n",
+		finder.LineCount(), text.length() >> 20, finder.GroupCount(), find.count(), filter.count(),
+		finder.MemoryUsage()/1048576.0, static_cast<double>(finder.MemoryUsage())/lines, length >> 20);
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20261019};
+	TestSample();
+	TestRandom(rng);
+	Benchmark(rng);
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
@@ -0,0 +1,496 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <forward_list>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <chrono>
+
+#include "ParallelSupport.h"
+#include "ScintillaTypes.h"
+#include "ScintillaMessages.h"
+#include "ScintillaStructures.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+#include "Geometry.h"
+#include "Platform.h"
+
+#include "CharacterSet.h"
+#include "Position.h"
+#include "UniqueString.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "ContractionState.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "KeyMap.h"
+#include "Indicator.h"
+#include "LineMarker.h"
+#include "Style.h"
+#include "ViewStyle.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "UniConversion.h"
+#include "Selection.h"
+#include "PositionCache.h"
+#include "EditModel.h"
+#include "MarginView.h"
+#include "EditView.h"
+
+// Paints text with EditView onto a Surface that records draw calls instead of drawing, to check
+// number of platform calls per line and pixels covered by background fills, checks lines with
+// right-to-left text are detected, then measures frame cost.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib EditViewDrawTest.cpp ../src/EditView.cxx ../src/EditModel.cxx ../src/MarginView.cxx ../src/PositionCache.cxx ../src/ViewStyle.cxx ../src/Style.cxx ../src/Indicator.cxx ../src/LineMarker.cxx ../src/XPM.cxx ../src/Geometry.cxx ../src/Selection.cxx ../src/ContractionState.cxx ../src/UniqueString.cxx ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib EditViewDrawTest.cpp ../src/EditView.cxx ../src/EditModel.cxx ../src/MarginView.cxx ../src/PositionCache.cxx ../src/ViewStyle.cxx ../src/Style.cxx ../src/Indicator.cxx ../src/LineMarker.cxx ../src/XPM.cxx ../src/Geometry.cxx ../src/Selection.cxx ../src/ContractionState.cxx ../src/UniqueString.cxx ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -DNO_CXX11_REGEX -I../include -I../src -I../lexlib EditViewDrawTest.cpp ../src/EditView.cxx ../src/EditModel.cxx ../src/MarginView.cxx ../src/PositionCache.cxx ../src/ViewStyle.cxx ../src/Style.cxx ../src/Indicator.cxx ../src/LineMarker.cxx ../src/XPM.cxx ../src/Geometry.cxx ../src/Selection.cxx ../src/ContractionState.cxx ../src/UniqueString.cxx ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+namespace {
+
+constexpr int CharWidth = 8;
+constexpr int LineHeight = 16;
+constexpr int ClientWidth = 1600;
+constexpr int ClientHeight = 60*LineHeight;
+
+struct DrawCounts {
+	int fills = 0;
+	int texts = 0;
+	int others = 0;
+};
+
+// Fixed pitch metrics, every byte is CharWidth pixels wide.
+// Fills of the first text row are applied to pixels so tests can check final background colour.
+class RecordingSurface final : public Surface {
+public:
+	DrawCounts counts;
+	std::vector<ColourRGBA> row;
+
+	void Reset() {
+		counts = {};
+		row.assign(ClientWidth, ColourRGBA());
+	}
+	void Fill(PRectangle rc, ColourRGBA colour) {
+		counts.fills++;
+		if (rc.top <= 0 && rc.bottom > 0 && !row.empty()) {
+			const int left = std::clamp(static_cast<int>(std::lround(rc.left)), 0, ClientWidth);
+			const int right = std::clamp(static_cast<int>(std::lround(rc.right)), 0, ClientWidth);
+			std::fill(row.begin() + left, row.begin() + std::max(left, right), colour);
+		}
+	}
+
+	void Init(WindowID) noexcept override {}
+	void Init(SurfaceID, WindowID, bool) noexcept override {}
+	std::unique_ptr<Surface> AllocatePixMap(int, int) override {
+		return std::make_unique<RecordingSurface>();
+	}
+	void SetMode(SurfaceMode) noexcept override {}
+	void SetRenderingParams(void *, void *) noexcept override {}
+	void Release() noexcept override {}
+	bool SupportsFeature(Supports) const noexcept override {
+		return false;
+	}
+	bool Initialised() const noexcept override {
+		return true;
+	}
+	int LogPixelsY() const noexcept override {
+		return 96;
+	}
+	int PixelDivisions() const noexcept override {
+		return 1;
+	}
+	int DeviceHeightFont(int points) const noexcept override {
+		return points*96/72;
+	}
+	void SCICALL LineDraw(Point, Point, Stroke) override {
+		counts.others++;
+	}
+	void SCICALL PolyLine(const Point *, size_t, Stroke) override {
+		counts.others++;
+	}
+	void SCICALL Polygon(const Point *, size_t, FillStroke) override {
+		counts.others++;
+	}
+	void SCICALL RectangleDraw(PRectangle rc, FillStroke fillStroke) override {
+		Fill(rc, fillStroke.fill.colour);
+	}
+	void SCICALL RectangleFrame(PRectangle, Stroke) override {
+		counts.others++;
+	}
+	void SCICALL FillRectangle(PRectangle rc, Scintilla::Internal::Fill fill) override {
+		Fill(rc, fill.colour);
+	}
+	void SCICALL FillRectangleAligned(PRectangle rc, Scintilla::Internal::Fill fill) override {
+		Fill(rc, fill.colour);
+	}
+	void SCICALL FillRectangle(PRectangle, Surface &) override {
+		counts.others++;
+	}
+	void SCICALL RoundedRectangle(PRectangle, FillStroke) override {
+		counts.others++;
+	}
+	void SCICALL AlphaRectangle(PRectangle, XYPOSITION, FillStroke) override {
+		counts.others++;
+	}
+	void SCICALL GradientRectangle(PRectangle, const std::vector<ColourStop> &, GradientOptions) override {
+		counts.others++;
+	}
+	void SCICALL DrawRGBAImage(PRectangle, int, int, const unsigned char *) override {
+		counts.others++;
+	}
+	void SCICALL Ellipse(PRectangle, FillStroke) override {
+		counts.others++;
+	}
+	void SCICALL Stadium(PRectangle, FillStroke, Ends) override {
+		counts.others++;
+	}
+	void SCICALL Copy(PRectangle, Point, Surface &) override {
+		counts.others++;
+	}
+	std::unique_ptr<IScreenLineLayout> Layout(const IScreenLine *) override {
+		return {};
+	}
+
+	void SCICALL DrawTextNoClip(PRectangle rc, const Font *, XYPOSITION, std::string_view, ColourRGBA, ColourRGBA back) override {
+		counts.texts++;
+		Fill(rc, back);
+		counts.fills--;
+	}
+	void SCICALL DrawTextClipped(PRectangle rc, const Font *font_, XYPOSITION ybase, std::string_view text, ColourRGBA fore, ColourRGBA back) override {
+		DrawTextNoClip(rc, font_, ybase, text, fore, back);
+	}
+	void SCICALL DrawTextTransparent(PRectangle, const Font *, XYPOSITION, std::string_view, ColourRGBA) override {
+		counts.texts++;
+	}
+	void SCICALL MeasureWidths(const Font *, std::string_view text, XYPOSITION *positions) override {
+		for (size_t i = 0; i < text.length(); i++) {
+			positions[i] = static_cast<XYPOSITION>((i + 1)*CharWidth);
+		}
+	}
+	XYPOSITION WidthText(const Font *, std::string_view text) override {
+		return static_cast<XYPOSITION>(text.length()*CharWidth);
+	}
+
+	void SCICALL DrawTextNoClipUTF8(PRectangle rc, const Font *font_, XYPOSITION ybase, std::string_view text, ColourRGBA fore, ColourRGBA back) override {
+		DrawTextNoClip(rc, font_, ybase, text, fore, back);
+	}
+	void SCICALL DrawTextClippedUTF8(PRectangle rc, const Font *font_, XYPOSITION ybase, std::string_view text, ColourRGBA fore, ColourRGBA back) override {
+		DrawTextNoClip(rc, font_, ybase, text, fore, back);
+	}
+	void SCICALL DrawTextTransparentUTF8(PRectangle rc, const Font *font_, XYPOSITION ybase, std::string_view text, ColourRGBA fore) override {
+		DrawTextTransparent(rc, font_, ybase, text, fore);
+	}
+	void SCICALL MeasureWidthsUTF8(const Font *font_, std::string_view text, XYPOSITION *positions) override {
+		MeasureWidths(font_, text, positions);
+	}
+	XYPOSITION WidthTextUTF8(const Font *font_, std::string_view text) override {
+		return WidthText(font_, text);
+	}
+
+	XYPOSITION Ascent(const Font *) noexcept override {
+		return 12;
+	}
+	XYPOSITION Descent(const Font *) noexcept override {
+		return LineHeight - 12;
+	}
+	XYPOSITION InternalLeading(const Font *) noexcept override {
+		return 0;
+	}
+	XYPOSITION Height(const Font *) noexcept override {
+		return LineHeight;
+	}
+	XYPOSITION AverageCharWidth(const Font *) override {
+		return CharWidth;
+	}
+
+	void SCICALL SetClip(PRectangle) noexcept override {}
+	void PopClip() noexcept override {}
+	void FlushCachedState() noexcept override {}
+	void FlushDrawing() noexcept override {}
+};
+
+class Model final : public EditModel {
+public:
+	Model() {
+		pdoc->Release();
+		pdoc = new Document(DocumentOption::Default);
+		pdoc->AddRef();
+		pdoc->SetDBCSCodePage(CpUtf8);
+	}
+	void SetText(const std::string &text, const std::string &styles) {
+		pdoc->DeleteChars(0, pdoc->Length());
+		pdoc->InsertString(0, text);
+		pdoc->StartStyling(0);
+		pdoc->SetStyles(pdoc->Length(), reinterpret_cast<const unsigned char *>(styles.data()));
+		pcs->Clear();
+		pcs->InsertLines(0, pdoc->LinesTotal() - 1);
+	}
+	Sci::Line TopLineOfMain() const noexcept override {
+		return 0;
+	}
+	Point GetVisibleOriginInMain() const noexcept override {
+		return Point();
+	}
+	Sci::Line LinesOnScreen() const noexcept override {
+		return ClientHeight/LineHeight;
+	}
+	void OnLineWrapped(Sci::Line, int) override {}
+};
+
+constexpr ColourRGBA Back0 {0xff, 0xff, 0xff};
+constexpr ColourRGBA Back1 {0xe0, 0xe0, 0xff};
+constexpr ColourRGBA WhiteSpaceBack {0xff, 0xe0, 0xe0};
+constexpr int StyleCount = 8;
+
+struct Painter {
+	RecordingSurface surface;
+	Model model;
+	ViewStyle vs;
+	EditView view;
+
+	Painter() {
+		view.bufferedDraw = false;
+		for (MarginStyle &margin : vs.ms) {
+			margin.width = 0;
+		}
+		vs.leftMarginWidth = 0;
+		vs.rightMarginWidth = 0;
+		for (int style = 0; style < StyleCount; style++) {
+			vs.styles[style].fore = ColourRGBA(style*30, 0, 0);
+			vs.styles[style].back = Back0;
+		}
+		vs.Refresh(surface, 4);
+	}
+	void SetText(const std::string &text, const std::string &styles) {
+		model.SetText(text, styles);
+		view.llc.Invalidate(LineLayout::ValidLevel::invalid);
+	}
+	// background of odd styles differs when alternate is true.
+	void SetAlternateBack(bool alternate) {
+		for (int style = 1; style < StyleCount; style += 2) {
+			vs.styles[style].back = alternate ? Back1 : Back0;
+		}
+		vs.Refresh(surface, 4);
+		view.llc.Invalidate(LineLayout::ValidLevel::invalid);
+	}
+	void SetWhiteSpaceBack(bool visible) {
+		vs.viewWhitespace = visible ? WhiteSpace::VisibleAlways : WhiteSpace::Invisible;
+		if (visible) {
+			vs.SetElementColour(Element::WhiteSpaceBack, WhiteSpaceBack);
+		} else {
+			vs.ResetElement(Element::WhiteSpaceBack);
+		}
+		vs.Refresh(surface, 4);
+		view.llc.Invalidate(LineLayout::ValidLevel::invalid);
+	}
+	DrawCounts Paint(int lines) {
+		surface.Reset();
+		const PRectangle rcClient(0, 0, ClientWidth, static_cast<XYPOSITION>(ClientHeight));
+		const PRectangle rcArea(0, 0, ClientWidth, static_cast<XYPOSITION>(lines*LineHeight));
+		view.PaintText(&surface, model, vs, rcArea, rcClient);
+		return surface.counts;
+	}
+};
+
+// minified code: a style run every few characters, spaces between some tokens
+void MakeDenseLine(std::string &text, std::string &styles, int length, unsigned seed) {
+	static constexpr std::string_view tokens[] = {
+		"var", " ", "a", "=", "function", "(", "b", ",", "c", ")", "{", "return", " ", "b", "+", "c", ";", "}", "1234", "\"str\"",
+	};
+	int style = 0;
+	const size_t start = text.length();
+	while (static_cast<int>(text.length() - start) + 8 < length) {
+		seed = seed*1103515245 + 12345;
+		const std::string_view token = tokens[(seed >> 16) % std::size(tokens)];
+		text += token;
+		styles.append(token.length(), static_cast<char>(style));
+		style = (style + 1) % StyleCount;
+	}
+	text += '\n';
+	styles += '\0';
+}
+
+int StyleRuns(const std::string &styles, size_t length) {
+	int runs = 1;
+	for (size_t i = 1; i < length; i++) {
+		runs += styles[i] != styles[i - 1];
+	}
+	return runs;
+}
+
+int failures = 0;
+
+void Check(bool condition, const char *name) {
+	if (!condition) {
+		++failures;
+		printf("%s failed\n", name);
+	}
+}
+
+// background colour for each character of first line from style and whitespace.
+bool SameBackground(const Painter &painter, const std::string &text, const std::string &styles) {
+	const int start = static_cast<int>(painter.vs.textStart);
+	const size_t length = std::min<size_t>(text.find('\n'), (ClientWidth - start)/CharWidth);
+	for (size_t i = 0; i < length; i++) {
+		ColourRGBA expected = painter.vs.styles[static_cast<unsigned char>(styles[i])].back;
+		if (text[i] == ' ' && painter.vs.viewWhitespace != WhiteSpace::Invisible) {
+			expected = WhiteSpaceBack;
+		}
+		for (int x = 0; x < CharWidth; x++) {
+			if (painter.surface.row[start + i*CharWidth + x] != expected) {
+				printf("    background differs at character %zu pixel %d\n", i, x);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+void TestLine() {
+	Painter painter;
+	std::string plain(160, 'a');
+	plain += '\n';
+	std::string dense;
+	std::string styles;
+	MakeDenseLine(dense, styles, 161, 1);
+	const int runs = StyleRuns(styles, dense.length() - 1);
+
+	painter.SetText(plain, std::string(plain.length(), '\0'));
+	const DrawCounts single = painter.Paint(1);
+	painter.SetText(dense, styles);
+	const DrawCounts merged = painter.Paint(1);
+	printf("one line: %d style runs, %d fills and %d texts (single style: %d fills and %d texts)\n",
+		runs, merged.fills, merged.texts, single.fills, single.texts);
+	// same background for every run is filled once
+	Check(merged.fills == single.fills, "dense line fill count");
+	Check(merged.texts == runs, "dense line text count");
+	Check(SameBackground(painter, dense, styles), "dense line background");
+
+	painter.SetAlternateBack(true);
+	const DrawCounts alternate = painter.Paint(1);
+	// every run has different background from its neighbours
+	Check(alternate.fills == single.fills + runs - 1, "alternate background fill count");
+	Check(SameBackground(painter, dense, styles), "alternate background");
+	painter.SetAlternateBack(false);
+
+	painter.SetWhiteSpaceBack(true);
+	painter.Paint(1);
+	Check(SameBackground(painter, dense, styles), "whitespace background");
+	painter.SetWhiteSpaceBack(false);
+}
+
+// bidi characters before, across and after 16-byte ASCII blocks.
+void TestRightToLeft() {
+	struct Sample {
+		std::string_view utf8;
+		bool rtl;
+	};
+	static constexpr Sample samples[] = {
+		{"\xD7\x90", true},			// U+05D0 Hebrew letter alef
+		{"\xD8\xA7", true},			// U+0627 Arabic letter alef
+		{"\xE2\x80\x8F", true},		// U+200F right-to-left mark
+		{"\xEF\xBB\xBF", true},		// U+FEFF in Arabic presentation forms-B
+		{"\xC3\xA9", false},			// U+00E9 Latin small letter e with acute
+		{"\xD4\xB1", false},			// U+0531 Armenian capital letter ayb
+		{"\xE4\xB8\xAD", false},		// U+4E2D CJK ideograph
+		{"\xF0\x9F\x98\x80", false},	// U+1F600 emoji
+	};
+	LineLayout ll(0, 80);
+	for (const Sample &sample : samples) {
+		for (size_t length = sample.utf8.length(); length <= 48; length++) {
+			for (size_t pos = 0; pos + sample.utf8.length() <= length; pos++) {
+				std::string line(length, 'a');
+				line.replace(pos, sample.utf8.length(), sample.utf8);
+				memcpy(ll.chars.get(), line.data(), length);
+				ll.numCharsInLine = static_cast<int>(length);
+				Check(ll.HasRightToLeft() == sample.rtl, "right-to-left");
+			}
+			// character cut by line end is not checked
+			std::string line(length, 'a');
+			line.replace(length - 1, 1, sample.utf8.substr(0, 1));
+			memcpy(ll.chars.get(), line.data(), length);
+			ll.numCharsInLine = static_cast<int>(length);
+			Check(!ll.HasRightToLeft(), "right-to-left lead byte at end");
+		}
+	}
+}
+
+void Benchmark() {
+	Painter painter;
+	std::string text;
+	std::string styles;
+	for (unsigned line = 0; line < 60; line++) {
+		MakeDenseLine(text, styles, 200, line + 1);
+	}
+	painter.SetText(text, styles);
+	const int runs = StyleRuns(styles, styles.length());
+
+	for (const bool alternate : {false, true}) {
+		painter.SetAlternateBack(alternate);
+		DrawCounts counts = painter.Paint(60);
+		constexpr int frames = 2000;
+		const auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			counts = painter.Paint(60);
+		}
+		const std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+		printf("60 lines, %d style runs, %s background: %d fills, %d texts, %d other calls, %.1f us per frame\n",
+			runs, alternate ? "alternate" : "same", counts.fills, counts.texts, counts.others, elapsed.count()/frames);
+	}
+}
+
+}
+
+// defined in PlatWin.cxx
+namespace Scintilla::Internal {
+int64_t QueryPerformanceFrequency() noexcept {
+	return 1;
+}
+int64_t QueryPerformanceCounter() noexcept {
+	return 0;
+}
+std::shared_ptr<Font> Font::Allocate([[maybe_unused]] const FontParameters &fp) {
+	return std::make_shared<Font>();
+}
+std::unique_ptr<Surface> Surface::Allocate([[maybe_unused]] Technology technology) {
+	return std::make_unique<RecordingSurface>();
+}
+ColourRGBA Platform::Chrome() noexcept {
+	return ColourRGBA(0xf0, 0xf0, 0xf0);
+}
+ColourRGBA Platform::ChromeHighlight() noexcept {
+	return ColourRGBA(0xff, 0xff, 0xff);
+}
+const char *Platform::DefaultFont() noexcept {
+	return "Consolas";
+}
+int Platform::DefaultFontSize() noexcept {
+	return 10;
+}
+}
+
+int main() {
+	TestLine();
+	TestRightToLeft();
+	Benchmark();
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
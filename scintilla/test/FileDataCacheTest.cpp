@@ -0,0 +1,100 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+
+#include "../../src/Compression.h"
+#include "../../src/FileDataCache.h"
+
+// Checks raw file data kept for reloading with another encoding is only returned for the same
+// unchanged file, is returned at most once, and content longer than the limit is not kept.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 FileDataCacheTest.cpp ../../src/FileDataCache.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 FileDataCacheTest.cpp ../../src/FileDataCache.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra FileDataCacheTest.cpp ../../src/FileDataCache.cpp
+
+namespace {
+
+int failures = 0;
+int allocated = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		++failures;
+		printf("failed: %s\n", what);
+	}
+}
+
+void *Realloc(void *block, size_t size) noexcept {
+	if (size == 0) {
+		if (block != nullptr) {
+			--allocated;
+			free(block);
+		}
+		return nullptr;
+	}
+	if (block == nullptr) {
+		++allocated;
+	}
+	return realloc(block, size);
+}
+
+char *NewData(size_t length) {
+	char *data = static_cast<char *>(Realloc(nullptr, length + 1));
+	memset(data, 'a', length);
+	return data;
+}
+
+void TestCache() {
+	const FileDataKey key = {L"C:\\test\\file.txt", 10, 1234};
+	size_t length = 0;
+	CompressionFormat compression = CompressionFormat::None;
+	{
+		FileDataCache cache{Realloc};
+		char *data = NewData(10);
+		cache.Keep(data, 10, CompressionFormat::Gzip, key);
+		Check(!cache.Empty(), "kept");
+		char *taken = cache.Take(key, length, compression);
+		Check(taken == data && length == 10 && compression == CompressionFormat::Gzip, "same file");
+		Check(cache.Empty() && cache.Take(key, length, compression) == nullptr, "taken once");
+		Realloc(taken, 0);
+
+		// file changed on disk or another file
+		const FileDataKey changed[] = {
+			{key.path, key.size + 1, key.lastWrite},
+			{key.path, key.size, key.lastWrite + 1},
+			{L"C:\\test\\file2.txt", key.size, key.lastWrite},
+		};
+		for (const FileDataKey &other : changed) {
+			cache.Keep(NewData(10), 10, CompressionFormat::None, key);
+			Check(cache.Take(other, length, compression) == nullptr, "changed file");
+			Check(cache.Empty() && allocated == 0, "changed file freed");
+		}
+
+		// content longer than limit is freed instead of kept
+		cache.Keep(NewData(FileDataCache::MaxLength + 1), FileDataCache::MaxLength + 1, CompressionFormat::None, key);
+		Check(cache.Empty() && allocated == 0, "too large");
+		cache.Keep(NewData(FileDataCache::MaxLength), FileDataCache::MaxLength, CompressionFormat::None, key);
+		Check(!cache.Empty(), "limit");
+
+		// keeping another file replaces old data
+		cache.Keep(NewData(5), 5, CompressionFormat::Zstd, {L"C:\\test\\other.txt", 5, 1});
+		Check(allocated == 1, "replaced");
+		cache.Clear();
+		Check(cache.Empty() && allocated == 0, "cleared");
+
+		cache.Keep(NewData(5), 5, CompressionFormat::None, key);
+	}
+	Check(allocated == 0, "freed on destruction");
+}
+
+}
+
+int main() {
+	TestCache();
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
@@ -0,0 +1,388 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+#include "PropSetSimple.h"
+#include "WordList.h"
+#include "LexAccessor.h"
+#include "Accessor.h"
+#include "StyleContext.h"
+#include "LexerModule.h"
+
+// Compares LexAccessor::FindLineEndOrAnyOf() with a byte by byte scan for ranges around the 16 byte
+// SSE2 blocks and the 4 KiB accessor buffer, checks StyleContext::ForwardUntil() only skips bytes
+// Forward() would step over, then measures scanning 64 MiB comment text and lexing 64 MiB comment
+// heavy C++ source.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include /I../lexlib ForwardUntilTest.cpp ../lexers/LexCPP.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include /I../lexlib ForwardUntilTest.cpp ../lexers/LexCPP.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -I../include -I../lexlib ForwardUntilTest.cpp ../lexers/LexCPP.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// To compare with C++ lexer without ForwardUntil(), add /DCPP_REFERENCE (-DCPP_REFERENCE) and
+// LexCPPReference.cxx saved from that revision, built with /DlmCPP=lmCPPReference /DIsCppInDefine=IsCppInDefineReference.
+
+using namespace Scintilla;
+using namespace Lexilla;
+
+extern LexerModule lmCPP;
+#if defined(CPP_REFERENCE)
+extern LexerModule lmCPPReference;
+#endif
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		++failures;
+		printf("failed: %s\n", what);
+	}
+}
+
+class TestDocument final : public IDocument {
+	std::string text;
+	std::vector<Sci_Position> lineStarts;
+	Sci_Position stylingPos = 0;
+	const int codePage;
+public:
+	std::vector<unsigned char> styles;
+	std::vector<int> levels;
+	std::vector<int> states;
+
+	explicit TestDocument(std::string_view text_, int codePage_ = SC_CP_UTF8) : text{text_}, codePage{codePage_}, styles(text_.length()) {
+		lineStarts.push_back(0);
+		for (size_t i = 0; i < text.length(); i++) {
+			if (text[i] == '\n' || (text[i] == '\r' && (i + 1 == text.length() || text[i + 1] != '\n'))) {
+				lineStarts.push_back(i + 1);
+			}
+		}
+		levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+		states.assign(lineStarts.size(), 0);
+	}
+	Sci_Line LineCount() const noexcept {
+		return lineStarts.size();
+	}
+
+	int SCI_METHOD Version() const noexcept override {
+		return Scintilla::dvRelease4;
+	}
+	void SCI_METHOD SetErrorStatus([[maybe_unused]] int status) noexcept override {}
+	Sci_Position SCI_METHOD Length() const noexcept override {
+		return text.length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const noexcept override {
+		memcpy(buffer, text.data() + position, lengthRetrieve);
+	}
+	unsigned char SCI_METHOD StyleAt(Sci_Position position) const noexcept override {
+		return (position >= 0 && position < Length()) ? styles[position] : 0;
+	}
+	Sci_Line SCI_METHOD LineFromPosition(Sci_Position position) const noexcept override {
+		return std::upper_bound(lineStarts.begin() + 1, lineStarts.end(), position) - lineStarts.begin() - 1;
+	}
+	Sci_Position SCI_METHOD LineStart(Sci_Line line) const noexcept override {
+		if (line < 0) {
+			return 0;
+		}
+		return (line < LineCount()) ? lineStarts[line] : Length();
+	}
+	int SCI_METHOD GetLevel(Sci_Line line) const noexcept override {
+		return (line >= 0 && line < LineCount()) ? levels[line] : SC_FOLDLEVELBASE;
+	}
+	int SCI_METHOD SetLevel(Sci_Line line, int level) override {
+		if (line >= 0 && line < LineCount()) {
+			levels[line] = level;
+		}
+		return 0;
+	}
+	void SCI_METHOD SetLevels(Sci_Line lineStart, Sci_Line lineCount, const int *levels_) override {
+		for (Sci_Line line = 0; line < lineCount; line++) {
+			SetLevel(lineStart + line, levels_[line]);
+		}
+	}
+	int SCI_METHOD GetLineState(Sci_Line line) const noexcept override {
+		return (line >= 0 && line < LineCount()) ? states[line] : 0;
+	}
+	int SCI_METHOD SetLineState(Sci_Line line, int state) override {
+		if (line >= 0 && line < LineCount()) {
+			states[line] = state;
+		}
+		return 0;
+	}
+	void SCI_METHOD StartStyling(Sci_Position position) noexcept override {
+		stylingPos = position;
+	}
+	bool SCI_METHOD SetStyleFor(Sci_Position length, unsigned char style) override {
+		length = std::min(length, Length() - stylingPos);
+		memset(styles.data() + stylingPos, style, length);
+		stylingPos += length;
+		return true;
+	}
+	bool SCI_METHOD SetStyles(Sci_Position length, const unsigned char *styles_) override {
+		length = std::min(length, Length() - stylingPos);
+		memcpy(styles.data() + stylingPos, styles_, length);
+		stylingPos += length;
+		return true;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator([[maybe_unused]] int indicator) noexcept override {}
+	void SCI_METHOD DecorationFillRange([[maybe_unused]] Sci_Position position, [[maybe_unused]] int value, [[maybe_unused]] Sci_Position fillLength) override {}
+	void SCI_METHOD ChangeLexerState([[maybe_unused]] Sci_Position start, [[maybe_unused]] Sci_Position end) override {}
+	int SCI_METHOD CodePage() const noexcept override {
+		return codePage;
+	}
+	bool SCI_METHOD IsDBCSLeadByte([[maybe_unused]] unsigned char ch) const noexcept override {
+		return false;
+	}
+	const char * SCI_METHOD BufferPointer() override {
+		return text.c_str();
+	}
+	int SCI_METHOD GetLineIndentation(Sci_Line line) const noexcept override {
+		int indent = 0;
+		for (Sci_Position pos = LineStart(line); pos < Length(); pos++) {
+			if (text[pos] == ' ') {
+				++indent;
+			} else if (text[pos] == '\t') {
+				indent = (indent/4 + 1)*4;
+			} else {
+				break;
+			}
+		}
+		return indent;
+	}
+	Sci_Position SCI_METHOD LineEnd(Sci_Line line) const noexcept override {
+		Sci_Position pos = LineStart(line + 1);
+		if (line + 1 < LineCount()) {
+			--pos;
+			if (pos > 0 && text[pos] == '\n' && text[pos - 1] == '\r') {
+				--pos;
+			}
+		}
+		return pos;
+	}
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const noexcept override {
+		return positionStart + characterOffset;
+	}
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const noexcept override {
+		if (pWidth) {
+			*pWidth = 1;
+		}
+		return (position >= 0 && position < Length()) ? static_cast<unsigned char>(text[position]) : 0;
+	}
+	CharacterClass SCI_METHOD GetCharacterClass(unsigned int character) const noexcept override {
+		if (character == ' ' || character == '\t' || character == '\r' || character == '\n') {
+			return CharacterClass::space;
+		}
+		if (character < 0x80 && !(character >= '0' && character <= '9') && !((character | 0x20) >= 'a' && (character | 0x20) <= 'z') && character != '_') {
+			return CharacterClass::punctuation;
+		}
+		return CharacterClass::word;
+	}
+};
+
+constexpr const char *stopSets[] = {"", "*", "\\", "*\\", "*/#@"};
+
+constexpr bool IsStop(char ch, const char *set) noexcept {
+	return ch == '\r' || ch == '\n' || (ch != '\0' && strchr(set, ch) != nullptr);
+}
+
+Sci_PositionU ReferenceFind(std::string_view text, Sci_PositionU position, Sci_PositionU end, const char *set) noexcept {
+	while (position < end && !IsStop(text[position], set)) {
+		++position;
+	}
+	return position;
+}
+
+// long runs of plain bytes (including bytes above 127 and NUL) with sparse stop characters.
+std::string GenerateText(std::mt19937 &rng, size_t length, unsigned density) {
+	static constexpr char plain[] = {'a', ' ', '\t', '/', '\x80', '\xe4', '\xff', '\0'};
+	static constexpr char stops[] = {'*', '\\', '#', '@', '\r', '\n'};
+	std::string text(length, 'a');
+	for (char &ch : text) {
+		ch = (rng() % density == 0) ? stops[rng() % std::size(stops)] : plain[rng() % std::size(plain)];
+	}
+	return text;
+}
+
+void TestFind(std::mt19937 &rng) {
+	int mismatches = 0;
+	for (int round = 0; round < 2000; round++) {
+		const std::string text = GenerateText(rng, rng() % (3*4096), 1 + rng() % 200);
+		TestDocument doc{text, 0};
+		LexAccessor styler(&doc);
+		const Sci_PositionU length = text.length();
+		for (int query = 0; query < 20; query++) {
+			const Sci_PositionU position = length ? rng() % (length + 1) : 0;
+			const Sci_PositionU end = position + ((length > position) ? rng() % (length - position + 1) : 0);
+			const char *set = stopSets[rng() % std::size(stopSets)];
+			const Sci_PositionU found = styler.FindLineEndOrAnyOf(position, end, set);
+			const Sci_PositionU expected = ReferenceFind(text, position, end, set);
+			if (found != expected && ++mismatches <= 5) {
+				printf("mismatch length=%zu range=%zu-%zu set=\"%s\": %zu, expected %zu\n", static_cast<size_t>(length),
+					static_cast<size_t>(position), static_cast<size_t>(end), set, static_cast<size_t>(found), static_cast<size_t>(expected));
+			}
+		}
+	}
+	Check(mismatches == 0, "FindLineEndOrAnyOf");
+}
+
+bool SameContext(const StyleContext &sc, const StyleContext &reference) noexcept {
+	return sc.currentPos == reference.currentPos && sc.currentLine == reference.currentLine
+		&& sc.lineStartNext == reference.lineStartNext && sc.atLineStart == reference.atLineStart
+		&& sc.atLineEnd == reference.atLineEnd && sc.chPrev == reference.chPrev
+		&& sc.ch == reference.ch && sc.chNext == reference.chNext;
+}
+
+// steps one StyleContext with ForwardUntil() and another with Forward(), every byte
+// skipped by ForwardUntil() must not be a stop character or line end.
+void TestStyleContext(std::mt19937 &rng) {
+	int mismatches = 0;
+	for (int round = 0; round < 1000; round++) {
+		const std::string text = GenerateText(rng, 1 + rng() % 9000, 1 + rng() % 100);
+		TestDocument doc{text, 0};
+		const Sci_PositionU length = text.length();
+		const Sci_PositionU startPos = doc.LineStart(rng() % doc.LineCount());
+		const Sci_PositionU rangeLength = rng() % (length - startPos + 1);
+		const char *set = stopSets[rng() % std::size(stopSets)];
+		LexAccessor styler(&doc);
+		LexAccessor referenceStyler(&doc);
+		StyleContext sc(startPos, rangeLength, 0, styler);
+		StyleContext reference(startPos, rangeLength, 0, referenceStyler);
+		bool same = true;
+		while (same && sc.More()) {
+			const Sci_PositionU previous = sc.currentPos;
+			sc.ForwardUntil(set);
+			reference.Forward();
+			while (reference.currentPos < sc.currentPos) {
+				// skipped byte
+				same = !reference.atLineEnd && !IsStop(static_cast<char>(reference.ch), set);
+				reference.Forward();
+			}
+			same = same && SameContext(sc, reference);
+			// stopped at first stop byte, range end or line end
+			same = same && (sc.currentPos == previous + 1 || !sc.More() || sc.atLineEnd || IsStop(static_cast<char>(sc.ch), set)
+				|| sc.currentPos + 1 == sc.lineStartNext || sc.currentPos + 1 == startPos + rangeLength);
+		}
+		same = same && !reference.More();
+		if (!same && ++mismatches <= 5) {
+			printf("mismatch length=%zu range=%zu+%zu set=\"%s\" at %zu\n", static_cast<size_t>(length), static_cast<size_t>(startPos),
+				static_cast<size_t>(rangeLength), set, static_cast<size_t>(sc.currentPos));
+		}
+	}
+	Check(mismatches == 0, "ForwardUntil");
+}
+
+struct LexResult {
+	std::vector<unsigned char> styles;
+	std::vector<int> levels;
+	double duration;
+
+	bool operator==(const LexResult &other) const noexcept {
+		return styles == other.styles && levels == other.levels;
+	}
+};
+
+LexResult Lex(const LexerModule &module, std::string_view text) {
+	TestDocument doc{text};
+	PropSetSimple props;
+	props.Set("fold", "1");
+	const WordList keywordLists[KEYWORDSET_MAX];
+
+	const auto start = std::chrono::steady_clock::now();
+	Accessor styler(&doc, props);
+	module.fnLexer(0, doc.Length(), 0, keywordLists, styler);
+	module.fnFolder(0, doc.Length(), 0, keywordLists, styler);
+	styler.Flush();
+	styler.FlushLevels();
+	const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+	return {std::move(doc.styles), std::move(doc.levels), duration.count()};
+}
+
+constexpr std::string_view commentLines[] = {
+	"/**\n",
+	" * Returns number of items in the list, or zero when the list is empty or not loaded yet.\n",
+	" * @param list the list to count, may be null.\n",
+	" * @return item count, see CountItemsEx() for lists with hidden items.\n",
+	" */\n",
+	"// Items are counted on every call, cache the result when called inside a loop over list.\n",
+	"\t// TODO: update count when item is inserted or removed, then remove this function.\n",
+	"/* single line block comment before function definition, describes how items are kept */\n",
+};
+
+constexpr std::string_view codeLines[] = {
+	"int CountItems(const List *list) {\n",
+	"\treturn list ? list->count : 0; // null check\n",
+	"}\n",
+	"\n",
+	"#define ITEM_COUNT(list) \\\n\tCountItems(list)\n",
+};
+
+std::string GenerateSource(std::mt19937 &rng, size_t length) {
+	std::string text;
+	text.reserve(length + 256);
+	while (text.length() < length) {
+		if (rng() % 4) {
+			text += commentLines[rng() % std::size(commentLines)];
+		} else {
+			text += codeLines[rng() % std::size(codeLines)];
+		}
+	}
+	return text;
+}
+
+void Benchmark(std::mt19937 &rng) {
+	const std::string source = GenerateSource(rng, 64*1024*1024);
+	{
+		// comment text, stop at line end or comment end
+		TestDocument doc{source, 0};
+		LexAccessor styler(&doc);
+		const Sci_PositionU length = source.length();
+		size_t stops = 0;
+		auto start = std::chrono::steady_clock::now();
+		for (Sci_PositionU pos = 0; pos < length; pos++) {
+			pos = styler.FindLineEndOrAnyOf(pos, length, "*\\");
+			stops += pos < length;
+		}
+		const std::chrono::duration<double, std::milli> forward = std::chrono::steady_clock::now() - start;
+		size_t expected = 0;
+		start = std::chrono::steady_clock::now();
+		for (Sci_PositionU pos = 0; pos < length; pos++) {
+			const char ch = styler[pos];
+			expected += ch == '\r' || ch == '\n' || ch == '*' || ch == '\\';
+		}
+		const std::chrono::duration<double, std::milli> reference = std::chrono::steady_clock::now() - start;
+		Check(stops == expected, "benchmark stops");
+		printf("%zu MiB source, %zu stops: FindLineEndOrAnyOf %.1f ms, byte by byte %.1f ms\n",
+			source.length() >> 20, stops, forward.count(), reference.count());
+	}
+
+	const LexResult result = Lex(lmCPP, source);
+	printf("C++ lexer %.1f ms, %.0f MiB/s\n", result.duration, source.length()/1048576.0/(result.duration/1000));
+#if defined(CPP_REFERENCE)
+	const LexResult expected = Lex(lmCPPReference, source);
+	Check(result == expected, "same as reference");
+	printf("reference C++ lexer %.1f ms, %.0f MiB/s\n", expected.duration, source.length()/1048576.0/(expected.duration/1000));
+#endif
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20261019};
+	TestFind(rng);
+	TestStyleContext(rng);
+	Benchmark(rng);
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
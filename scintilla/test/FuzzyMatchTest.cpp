@@ -0,0 +1,173 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "../../src/FuzzyMatch.h"
+
+// Checks fuzzy matcher used by auto-completion against ranking all words with FuzzyScore(),
+// then measures matching 100k words for each typed character.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include FuzzyMatchTest.cpp ../../src/FuzzyMatch.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include FuzzyMatchTest.cpp ../../src/FuzzyMatch.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -I../include FuzzyMatchTest.cpp ../../src/FuzzyMatch.cpp
+
+namespace {
+
+size_t failures = 0;
+
+void Check(bool condition, const char *what, const char *root) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s, root \"%s\"\n", what, root);
+		}
+	}
+}
+
+int Score(const char *root, const std::string &word) {
+	return FuzzyScore(root, static_cast<uint32_t>(strlen(root)), word.c_str(), static_cast<uint32_t>(word.length()));
+}
+
+void TestScore() {
+	const std::string word = "getHttpResponseHeader";
+	Check(Score("ghrh", word) >= 0, "camelCase initials", "ghrh");
+	Check(Score("respheader", word) >= 0, "inner match", "respheader");
+	Check(Score("GETHTTP", word) >= 0, "case insensitive", "GETHTTP");
+	Check(Score("ghx", word) < 0, "not match", "ghx");
+	Check(Score("hg", word) < 0, "order", "hg");
+	Check(Score("getHttpResponseHeaders", word) < 0, "longer than word", "getHttpResponseHeaders");
+	Check(Score("get", word) > Score("get", "target_value"), "prefix first", "get");
+	Check(Score("rh", word) > Score("rh", "graph"), "word boundary first", "rh");
+	Check(Score("sn", "snake_name") > Score("sn", "isnan"), "snake_case", "sn");
+}
+
+std::vector<std::string> MakeWords(std::mt19937 &rng, size_t count) {
+	static const char *const parts[] = {
+		"get", "set", "Http", "Response", "Header", "read", "write", "Buffer", "_size", "_count",
+		"file", "Name", "Path", "max", "min", "Value", "index", "2", "utf8", "Text", "-case", "is",
+	};
+	std::vector<std::string> words;
+	words.reserve(count);
+	while (words.size() < count) {
+		std::string word;
+		const unsigned length = 1 + rng() % 5;
+		for (unsigned i = 0; i < length; i++) {
+			word += parts[rng() % std::size(parts)];
+		}
+		word += std::to_string(words.size());
+		words.push_back(std::move(word));
+	}
+	return words;
+}
+
+// compare results with ranking all words, which must be same for any previous root.
+void CheckMatch(FuzzyMatcher &matcher, const std::vector<std::string> &words, const char *root, uint32_t maxResult) {
+	std::vector<std::pair<int, const std::string *>> expected;
+	for (const std::string &word : words) {
+		const int score = Score(root, word);
+		if (score >= 0) {
+			expected.emplace_back(-score, &word);
+		}
+	}
+	std::sort(expected.begin(), expected.end(), [](const auto &lhs, const auto &rhs) {
+		return (lhs.first != rhs.first) ? lhs.first < rhs.first : *lhs.second < *rhs.second;
+	});
+
+	const uint32_t count = matcher.Match(root, static_cast<uint32_t>(strlen(root)), maxResult);
+	Check(count == expected.size(), "matched count", root);
+	const uint32_t shown = std::min<uint32_t>(count, maxResult);
+	Check(matcher.ResultCount() == shown, "result count", root);
+	bool same = true;
+	for (uint32_t index = 0; same && index < matcher.ResultCount() && index < expected.size(); index++) {
+		uint32_t length;
+		const char *word = matcher.Result(index, length);
+		same = *expected[index].second == std::string(word, length) && matcher.ResultScore(index) == -expected[index].first;
+	}
+	Check(same, "ranked results", root);
+}
+
+void TestMatcher(const std::vector<std::string> &words) {
+	FuzzyMatcher matcher;
+	matcher.Reset("r", 1);
+	std::vector<std::string> candidates;
+	for (const std::string &word : words) {
+		if (FuzzyIsSubsequence("r", 1, word.c_str(), static_cast<uint32_t>(word.length()))) {
+			candidates.push_back(word);
+			matcher.AddWord(word.c_str(), static_cast<uint32_t>(word.length()));
+		}
+	}
+	Check(matcher.WordCount() == candidates.size(), "word count", "r");
+	Check(matcher.Covers("RespH", 5) && !matcher.Covers("x", 1) && !matcher.Covers("", 0), "covers", "r");
+
+	// typing, then deleting characters and typing other characters
+	static const char *const roots[] = {"r", "re", "res", "resp", "respheader", "respheaders", "resp", "resb", "rb", "R", "rHt", "rht2"};
+	for (const char *root : roots) {
+		CheckMatch(matcher, candidates, root, 256);
+	}
+	CheckMatch(matcher, candidates, "re", 0);
+	CheckMatch(matcher, candidates, "rea", 1);
+	CheckMatch(matcher, candidates, "read", 100000);
+
+	// words added after match
+	matcher.AddWord("rZz", 3);
+	candidates.push_back("rZz");
+	CheckMatch(matcher, candidates, "rz", 10);
+
+	matcher.Reset("", 0);
+	Check(matcher.Match("a", 1, 10) == 0 && matcher.ResultCount() == 0, "empty", "a");
+	Check(matcher.Covers("a", 1), "empty root", "a");
+}
+
+double Elapsed(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Benchmark(const std::vector<std::string> &words) {
+	const char *const typed = "gethttpresp";
+	FuzzyMatcher matcher;
+	auto start = std::chrono::steady_clock::now();
+	matcher.Reset(typed, 1);
+	for (const std::string &word : words) {
+		if (FuzzyIsSubsequence(typed, 1, word.c_str(), static_cast<uint32_t>(word.length()))) {
+			matcher.AddWord(word.c_str(), static_cast<uint32_t>(word.length()));
+		}
+	}
+	printf("collect %u of %zu words: %.3f ms\n", matcher.WordCount(), words.size(), Elapsed(start));
+
+	const uint32_t length = static_cast<uint32_t>(strlen(typed));
+	for (uint32_t rootLength = 1; rootLength <= length; rootLength++) {
+		start = std::chrono::steady_clock::now();
+		const uint32_t count = matcher.Match(typed, rootLength, 256);
+		const double incremental = Elapsed(start);
+		// rank all collected words again, as when the root is not extended
+		FuzzyMatcher full;
+		full.Reset(typed, 1);
+		for (const std::string &word : words) {
+			if (FuzzyIsSubsequence(typed, 1, word.c_str(), static_cast<uint32_t>(word.length()))) {
+				full.AddWord(word.c_str(), static_cast<uint32_t>(word.length()));
+			}
+		}
+		start = std::chrono::steady_clock::now();
+		full.Match(typed, rootLength, 256);
+		const double rescan = Elapsed(start);
+		printf("%-12.*s %6u matched: %7.3f ms, all words %7.3f ms\n", static_cast<int>(rootLength), typed, count, incremental, rescan);
+	}
+}
+
+}
+
+int main() {
+	TestScore();
+	std::mt19937 rng{20260101};
+	TestMatcher(MakeWords(rng, 20000));
+	Benchmark(MakeWords(rng, 100000));
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
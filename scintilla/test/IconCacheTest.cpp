@@ -0,0 +1,144 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdio>
+#include <cwchar>
+#include <iterator>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+#include "../../matepath/src/IconCache.h"
+
+// Checks work queue and file type icon cache shared by icon threads of matepath directory list.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 IconCacheTest.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 IconCacheTest.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -pthread IconCacheTest.cpp
+
+namespace {
+
+size_t failures = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		++failures;
+		printf("failed: %s\n", what);
+	}
+}
+
+constexpr int ThreadCount = 4;
+
+void TestQueueOrder() {
+	IconWorkQueue queue;
+	queue.Reset(5, 3);
+	int order[6];
+	for (int &item : order) {
+		item = queue.Take();
+	}
+	Check(order[0] == 3 && order[1] == 4 && order[2] == 0 && order[3] == 1 && order[4] == 2 && order[5] == -1, "visible items first");
+
+	queue.Reset(3, 7);
+	Check(queue.Take() == 0, "top index out of range");
+	queue.Reset(0, 0);
+	Check(queue.Take() == -1, "empty list");
+}
+
+void TestQueueThreads() {
+	constexpr int count = 100000;
+	IconWorkQueue queue;
+	queue.Reset(count, count/3);
+	std::vector<std::atomic<int>> taken(count);
+	std::vector<std::thread> threads;
+	for (int i = 0; i < ThreadCount; i++) {
+		threads.emplace_back([&queue, &taken] {
+			int item;
+			while ((item = queue.Take()) >= 0) {
+				taken[item].fetch_add(1, std::memory_order_relaxed);
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	bool once = true;
+	for (const std::atomic<int> &value : taken) {
+		once = once && value.load() == 1;
+	}
+	Check(once, "each item is taken exactly once");
+}
+
+void TestCache() {
+	IconTypeCache *cache = new IconTypeCache;
+	IconTypeCache::Entry *entry = cache->Find(L".txt", false);
+	Check(entry != nullptr && entry->Icon() == -1, "new entry");
+	entry->SetIcon(3);
+	Check(cache->Find(L".TXT", false) == entry && entry->Icon() == 3, "extension is case insensitive");
+	Check(cache->Find(L".txt", true) != entry, "folder is part of key");
+	Check(cache->Find(L".txt1", false) != entry, "different extension");
+	Check(cache->Find(L"", true) == cache->Find(L"", true), "folder without extension");
+	Check(cache->Find(L".0123456789abcde", false) == nullptr, "long extension isn't cached");
+	Check(cache->Find(L".0123456789abcd", false) != nullptr, "longest extension");
+	delete cache;
+
+	cache = new IconTypeCache;
+	wchar_t ext[8];
+	unsigned found = 0;
+	for (unsigned i = 0; i < IconTypeCache::Size; i++) {
+		swprintf(ext, std::size(ext), L".%u", i);
+		found += cache->Find(ext, false) != nullptr;
+	}
+	Check(found == IconTypeCache::Size - 1 && cache->Count() == found, "full cache");
+	Check(cache->Find(L".0", false) != nullptr && cache->Find(L".x", false) == nullptr, "lookup in full cache");
+	delete cache;
+}
+
+void TestCacheThreads() {
+	constexpr unsigned types = 200;
+	IconTypeCache *cache = new IconTypeCache;
+	std::vector<IconTypeCache::Entry *> entries[ThreadCount];
+	std::vector<std::thread> threads;
+	for (int i = 0; i < ThreadCount; i++) {
+		threads.emplace_back([cache, &result = entries[i], i] {
+			wchar_t ext[8];
+			result.resize(types);
+			for (unsigned round = 0; round < 100; round++) {
+				for (unsigned type = 0; type < types; type++) {
+					const unsigned value = (type*7 + i + round) % types;
+					swprintf(ext, std::size(ext), (round & 1) ? L".T%u" : L".t%u", value);
+					IconTypeCache::Entry *entry = cache->Find(ext, false);
+					if (entry->Icon() < 0) {
+						entry->SetIcon(static_cast<int>(value));
+					}
+					if (result[value] == nullptr) {
+						result[value] = entry;
+					} else if (result[value] != entry || entry->Icon() != static_cast<int>(value)) {
+						result[value] = nullptr;
+						return;
+					}
+				}
+			}
+		});
+	}
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+	bool same = cache->Count() == types;
+	for (unsigned type = 0; same && type < types; type++) {
+		for (int i = 0; same && i < ThreadCount; i++) {
+			same = entries[i][type] != nullptr && entries[i][type] == entries[0][type];
+		}
+	}
+	Check(same, "threads share same entry for each type");
+	delete cache;
+}
+
+}
+
+int main() {
+	TestQueueOrder();
+	TestQueueThreads();
+	TestCache();
+	TestCacheThreads();
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
@@ -0,0 +1,273 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <set>
+#include <forward_list>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <random>
+
+#include "ParallelSupport.h"
+#include "ScintillaTypes.h"
+#include "ScintillaMessages.h"
+#include "ScintillaStructures.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+#include "Geometry.h"
+#include "Platform.h"
+
+#include "CharacterSet.h"
+#include "Position.h"
+#include "UniqueString.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "ContractionState.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "KeyMap.h"
+#include "Indicator.h"
+#include "LineMarker.h"
+#include "Style.h"
+#include "ViewStyle.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "UniConversion.h"
+#include "Selection.h"
+#include "PositionCache.h"
+#include "EditModel.h"
+
+// Checks memory of cached line layouts is counted when layouts are created, replaced, grow or
+// are dropped, layouts over the budget are evicted while keeping requested, caret and visible
+// lines, then measures time for retrieving layouts when scrolling through 1M lines.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib LineLayoutCacheTest.cpp ../src/PositionCache.cxx ../src/EditModel.cxx ../src/ViewStyle.cxx ../src/Style.cxx ../src/Indicator.cxx ../src/LineMarker.cxx ../src/XPM.cxx ../src/Geometry.cxx ../src/Selection.cxx ../src/ContractionState.cxx ../src/UniqueString.cxx ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib LineLayoutCacheTest.cpp ../src/PositionCache.cxx ../src/EditModel.cxx ../src/ViewStyle.cxx ../src/Style.cxx ../src/Indicator.cxx ../src/LineMarker.cxx ../src/XPM.cxx ../src/Geometry.cxx ../src/Selection.cxx ../src/ContractionState.cxx ../src/UniqueString.cxx ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -DNO_CXX11_REGEX -I../include -I../src -I../lexlib LineLayoutCacheTest.cpp ../src/PositionCache.cxx ../src/EditModel.cxx ../src/ViewStyle.cxx ../src/Style.cxx ../src/Indicator.cxx ../src/LineMarker.cxx ../src/XPM.cxx ../src/Geometry.cxx ../src/Selection.cxx ../src/ContractionState.cxx ../src/UniqueString.cxx ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+namespace {
+
+constexpr Sci::Line LinesOnScreen = 60;
+
+size_t failures = 0;
+
+void Check(bool condition, const char *what, Sci::Line line) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s, line %zd\n", what, static_cast<size_t>(line));
+		}
+	}
+}
+
+struct View {
+	Sci::Line lineCaret = 0;
+	Sci::Line topLine = 0;
+	Sci::Line bottomLine = LinesOnScreen - 1;
+	Sci::Line linesTotal = 0;
+};
+
+LineLayout *Retrieve(LineLayoutCache &llc, const View &view, Sci::Line line, int length) {
+	LineLayout *ll = llc.Retrieve(line, view.lineCaret, length, LinesOnScreen + 1, view.linesTotal, view.topLine, view.bottomLine);
+	// mark as laid out, to tell cached layout from new one
+	ll->validity = LineLayout::ValidLevel::lines;
+	return ll;
+}
+
+bool IsCached(LineLayoutCache &llc, const View &view, Sci::Line line, int length) {
+	const LineLayout *ll = llc.Retrieve(line, view.lineCaret, length, LinesOnScreen + 1, view.linesTotal, view.topLine, view.bottomLine);
+	return ll->validity != LineLayout::ValidLevel::invalid;
+}
+
+// total is same as sum of MemoryUsage() for each layout while below budget.
+void TestCounting(std::mt19937 &rng) {
+	for (const LineCache level : {LineCache::Caret, LineCache::Page, LineCache::Document}) {
+		LineLayoutCache llc;
+		llc.SetLevel(level);
+		View view;
+		view.linesTotal = 500;
+		// same line may be cached in two slots with page level
+		std::set<LineLayout *> layouts;
+		for (int round = 0; round < 5000; round++) {
+			const Sci::Line line = rng() % view.linesTotal;
+			view.lineCaret = (round % 50 == 0) ? line : view.lineCaret;
+			LineLayout *ll = Retrieve(llc, view, line, 1 + rng() % 200);
+			Check(ll->memoryCounted == ll->MemoryUsage(), "retrieved layout counted", line);
+			if (rng() % 8 == 0) {
+				// grows after retrieved
+				ll->EnsureBidiData();
+			}
+			layouts.insert(ll);
+			size_t expected = 0;
+			for (const LineLayout *item : layouts) {
+				// layouts not yet retrieved again may have grown
+				expected += item->memoryCounted;
+			}
+			Check(llc.MemoryUsage() == expected, "memory counted", line);
+		}
+		// dropped by shrinking Document level cache
+		if (level == LineCache::Document) {
+			view.linesTotal = 64;
+			std::erase_if(layouts, [&view](const LineLayout *item) noexcept {
+				return item->LineNumber() >= view.linesTotal;
+			});
+			layouts.insert(Retrieve(llc, view, 0, 10));
+			size_t expected = 0;
+			for (const LineLayout *item : layouts) {
+				expected += item->memoryCounted;
+			}
+			Check(llc.MemoryUsage() == expected, "dropped by resize", view.linesTotal);
+		}
+		llc.Deallocate();
+		Check(llc.MemoryUsage() == 0, "deallocate", 0);
+	}
+}
+
+// visible lines after folded lines are kept, older lines are evicted first.
+void TestTrim() {
+	constexpr int length = 1000;
+	LineLayoutCache llc;
+	llc.SetLevel(LineCache::Document);
+	View view;
+	view.linesTotal = 100'000;
+	view.lineCaret = 50;
+	// 60 display lines show document lines 1000 to 2000 with folded blocks
+	view.topLine = 1000;
+	view.bottomLine = 2000;
+	for (Sci::Line line = view.topLine; line <= view.bottomLine; line++) {
+		Retrieve(llc, view, line, length);
+	}
+	Retrieve(llc, view, view.lineCaret, length);
+	size_t maxUsed = 0;
+	const size_t layoutSize = llc.Retrieve(3000, view.lineCaret, length, LinesOnScreen + 1, view.linesTotal, view.topLine, view.bottomLine)->MemoryUsage();
+	for (Sci::Line line = 3000; line < view.linesTotal; line++) {
+		Retrieve(llc, view, line, length);
+		maxUsed = std::max(maxUsed, llc.MemoryUsage());
+	}
+	Check(maxUsed <= LineLayoutCache::memoryBudget + layoutSize, "within budget", 0);
+	Check(IsCached(llc, view, view.lineCaret, length), "caret line kept", view.lineCaret);
+	bool visible = true;
+	for (Sci::Line line = view.topLine; line <= view.bottomLine; line++) {
+		visible = visible && IsCached(llc, view, line, length);
+	}
+	Check(visible, "visible lines kept", view.topLine);
+	Check(IsCached(llc, view, view.linesTotal - 1, length), "recent line kept", view.linesTotal - 1);
+	Check(!IsCached(llc, view, 3000, length), "old line evicted", 3000);
+
+	// visible lines alone over budget do not trim on every retrieve
+	view.topLine = 0;
+	view.bottomLine = view.linesTotal;
+	LineLayoutCache all;
+	all.SetLevel(LineCache::Document);
+	const auto start = std::chrono::steady_clock::now();
+	for (Sci::Line line = 0; line < view.linesTotal; line++) {
+		Retrieve(all, view, line, 100);
+	}
+	const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	Check(IsCached(all, view, 0, 100), "all visible kept", 0);
+	printf("%zd visible lines, %.0f MiB kept: %.0f ms\n", static_cast<size_t>(view.linesTotal),
+		all.MemoryUsage()/1048576.0, elapsed.count());
+}
+
+// long lines are cached separately
+void TestLongCache() {
+	constexpr int length = 3*1024*1024;
+	LineLayoutCache llc;
+	llc.SetLevel(LineCache::Page);
+	View view;
+	view.linesTotal = 100;
+	for (Sci::Line line = LinesOnScreen; line < view.linesTotal; line++) {
+		Retrieve(llc, view, line, length);
+	}
+	Check(llc.MemoryUsage() < LineLayoutCache::memoryBudget + 2*length*sizeof(XYPOSITION), "long lines within budget", 0);
+	Check(IsCached(llc, view, view.linesTotal - 1, length), "recent long line kept", view.linesTotal - 1);
+}
+
+void Benchmark() {
+	constexpr Sci::Line lines = 1'000'000;
+	for (const LineCache level : {LineCache::Page, LineCache::Document}) {
+		LineLayoutCache llc;
+		llc.SetLevel(level);
+		View view;
+		view.linesTotal = lines;
+		size_t maxUsed = 0;
+		auto start = std::chrono::steady_clock::now();
+		// scroll down one page at a time
+		for (Sci::Line top = 0; top + LinesOnScreen <= lines; top += LinesOnScreen) {
+			view.topLine = top;
+			view.bottomLine = top + LinesOnScreen - 1;
+			for (Sci::Line line = top; line <= view.bottomLine; line++) {
+				Retrieve(llc, view, line, 40 + line % 400);
+			}
+			maxUsed = std::max(maxUsed, llc.MemoryUsage());
+		}
+		const std::chrono::duration<double, std::milli> scroll = std::chrono::steady_clock::now() - start;
+		// caret blinking and redrawing same page
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < 10000; frame++) {
+			for (Sci::Line line = view.topLine; line <= view.bottomLine; line++) {
+				Retrieve(llc, view, line, 40 + line % 400);
+			}
+		}
+		const std::chrono::duration<double, std::milli> redraw = std::chrono::steady_clock::now() - start;
+		printf("%s level, %zd lines: scroll %.0f ns per line, max %.1f MiB, redraw %.1f ns per line\n",
+			(level == LineCache::Page) ? "page" : "document", static_cast<size_t>(lines),
+			scroll.count()*1e6/lines, maxUsed/1048576.0, redraw.count()*1e6/(10000*LinesOnScreen));
+	}
+}
+
+}
+
+// defined in PlatWin.cxx
+namespace Scintilla::Internal {
+int64_t QueryPerformanceFrequency() noexcept {
+	return 1;
+}
+int64_t QueryPerformanceCounter() noexcept {
+	return 0;
+}
+std::shared_ptr<Font> Font::Allocate([[maybe_unused]] const FontParameters &fp) {
+	return std::make_shared<Font>();
+}
+ColourRGBA Platform::Chrome() noexcept {
+	return ColourRGBA(0xf0, 0xf0, 0xf0);
+}
+ColourRGBA Platform::ChromeHighlight() noexcept {
+	return ColourRGBA(0xff, 0xff, 0xff);
+}
+const char *Platform::DefaultFont() noexcept {
+	return "Consolas";
+}
+int Platform::DefaultFontSize() noexcept {
+	return 10;
+}
+}
+
+int main() {
+	std::mt19937 rng{20261019};
+	TestCounting(rng);
+	TestTrim();
+	TestLongCache();
+	Benchmark();
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
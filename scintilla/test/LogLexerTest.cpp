@@ -0,0 +1,381 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+#include "PropSetSimple.h"
+#include "WordList.h"
+#include "LexAccessor.h"
+#include "Accessor.h"
+#include "LexerModule.h"
+
+// Lexes generated logs whole and from every line like Scintilla does on typing, checks styles and
+// fold levels are the same, then measures throughput for 64 MiB log with the log lexer and with
+// the null (plain text), diff, properties and C++ lexers.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include /I../lexlib LogLexerTest.cpp ../lexers/LexLog.cxx ../lexers/LexNull.cxx ../lexers/LexDiff.cxx ../lexers/LexProps.cxx ../lexers/LexCPP.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include /I../lexlib LogLexerTest.cpp ../lexers/LexLog.cxx ../lexers/LexNull.cxx ../lexers/LexDiff.cxx ../lexers/LexProps.cxx ../lexers/LexCPP.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -I../include -I../lexlib LogLexerTest.cpp ../lexers/LexLog.cxx ../lexers/LexNull.cxx ../lexers/LexDiff.cxx ../lexers/LexProps.cxx ../lexers/LexCPP.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// LogLexerTest path lexes a log file with each lexer and prints time.
+
+using namespace Scintilla;
+using namespace Lexilla;
+
+extern LexerModule lmLog;
+extern LexerModule lmNull;
+extern LexerModule lmDiff;
+extern LexerModule lmProps;
+extern LexerModule lmCPP;
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		++failures;
+		printf("failed: %s\n", what);
+	}
+}
+
+class TestDocument final : public IDocument {
+	std::string text;
+	std::vector<Sci_Position> lineStarts;
+	Sci_Position stylingPos = 0;
+public:
+	std::vector<unsigned char> styles;
+	std::vector<int> levels;
+	std::vector<int> states;
+
+	explicit TestDocument(std::string_view text_) : text{text_}, styles(text_.length()) {
+		lineStarts.push_back(0);
+		for (size_t i = 0; i < text.length(); i++) {
+			if (text[i] == '\n' || (text[i] == '\r' && (i + 1 == text.length() || text[i + 1] != '\n'))) {
+				lineStarts.push_back(i + 1);
+			}
+		}
+		levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+		states.assign(lineStarts.size(), 0);
+	}
+	Sci_Line LineCount() const noexcept {
+		return lineStarts.size();
+	}
+
+	int SCI_METHOD Version() const noexcept override {
+		return Scintilla::dvRelease4;
+	}
+	void SCI_METHOD SetErrorStatus([[maybe_unused]] int status) noexcept override {}
+	Sci_Position SCI_METHOD Length() const noexcept override {
+		return text.length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const noexcept override {
+		memcpy(buffer, text.data() + position, lengthRetrieve);
+	}
+	unsigned char SCI_METHOD StyleAt(Sci_Position position) const noexcept override {
+		return (position >= 0 && position < Length()) ? styles[position] : 0;
+	}
+	Sci_Line SCI_METHOD LineFromPosition(Sci_Position position) const noexcept override {
+		return std::upper_bound(lineStarts.begin() + 1, lineStarts.end(), position) - lineStarts.begin() - 1;
+	}
+	Sci_Position SCI_METHOD LineStart(Sci_Line line) const noexcept override {
+		if (line < 0) {
+			return 0;
+		}
+		return (line < LineCount()) ? lineStarts[line] : Length();
+	}
+	int SCI_METHOD GetLevel(Sci_Line line) const noexcept override {
+		return (line >= 0 && line < LineCount()) ? levels[line] : SC_FOLDLEVELBASE;
+	}
+	int SCI_METHOD SetLevel(Sci_Line line, int level) override {
+		if (line >= 0 && line < LineCount()) {
+			levels[line] = level;
+		}
+		return 0;
+	}
+	void SCI_METHOD SetLevels(Sci_Line lineStart, Sci_Line lineCount, const int *levels_) override {
+		for (Sci_Line line = 0; line < lineCount; line++) {
+			SetLevel(lineStart + line, levels_[line]);
+		}
+	}
+	int SCI_METHOD GetLineState(Sci_Line line) const noexcept override {
+		return (line >= 0 && line < LineCount()) ? states[line] : 0;
+	}
+	int SCI_METHOD SetLineState(Sci_Line line, int state) override {
+		if (line >= 0 && line < LineCount()) {
+			states[line] = state;
+		}
+		return 0;
+	}
+	void SCI_METHOD StartStyling(Sci_Position position) noexcept override {
+		stylingPos = position;
+	}
+	bool SCI_METHOD SetStyleFor(Sci_Position length, unsigned char style) override {
+		length = std::min(length, Length() - stylingPos);
+		memset(styles.data() + stylingPos, style, length);
+		stylingPos += length;
+		return true;
+	}
+	bool SCI_METHOD SetStyles(Sci_Position length, const unsigned char *styles_) override {
+		length = std::min(length, Length() - stylingPos);
+		memcpy(styles.data() + stylingPos, styles_, length);
+		stylingPos += length;
+		return true;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator([[maybe_unused]] int indicator) noexcept override {}
+	void SCI_METHOD DecorationFillRange([[maybe_unused]] Sci_Position position, [[maybe_unused]] int value, [[maybe_unused]] Sci_Position fillLength) override {}
+	void SCI_METHOD ChangeLexerState([[maybe_unused]] Sci_Position start, [[maybe_unused]] Sci_Position end) override {}
+	int SCI_METHOD CodePage() const noexcept override {
+		return SC_CP_UTF8;
+	}
+	bool SCI_METHOD IsDBCSLeadByte([[maybe_unused]] unsigned char ch) const noexcept override {
+		return false;
+	}
+	const char * SCI_METHOD BufferPointer() override {
+		return text.c_str();
+	}
+	int SCI_METHOD GetLineIndentation(Sci_Line line) const noexcept override {
+		int indent = 0;
+		for (Sci_Position pos = LineStart(line); pos < Length(); pos++) {
+			if (text[pos] == ' ') {
+				++indent;
+			} else if (text[pos] == '\t') {
+				indent = (indent/4 + 1)*4;
+			} else {
+				break;
+			}
+		}
+		return indent;
+	}
+	Sci_Position SCI_METHOD LineEnd(Sci_Line line) const noexcept override {
+		Sci_Position pos = LineStart(line + 1);
+		if (line + 1 < LineCount()) {
+			--pos;
+			if (pos > 0 && text[pos] == '\n' && text[pos - 1] == '\r') {
+				--pos;
+			}
+		}
+		return pos;
+	}
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const noexcept override {
+		return positionStart + characterOffset;
+	}
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const noexcept override {
+		if (pWidth) {
+			*pWidth = 1;
+		}
+		return (position >= 0 && position < Length()) ? static_cast<unsigned char>(text[position]) : 0;
+	}
+	CharacterClass SCI_METHOD GetCharacterClass(unsigned int character) const noexcept override {
+		if (character == ' ' || character == '\t' || character == '\r' || character == '\n') {
+			return CharacterClass::space;
+		}
+		if (character < 0x80 && !(character >= '0' && character <= '9') && !((character | 0x20) >= 'a' && (character | 0x20) <= 'z') && character != '_') {
+			return CharacterClass::punctuation;
+		}
+		return CharacterClass::word;
+	}
+};
+
+struct LexResult {
+	std::vector<unsigned char> styles;
+	std::vector<int> levels;
+	double duration;
+
+	bool operator==(const LexResult &other) const noexcept {
+		return styles == other.styles && levels == other.levels;
+	}
+};
+
+// lexes from start of line after every chunk bytes, restarts with style before it.
+LexResult Lex(const LexerModule &module, std::string_view text, Sci_Position chunk) {
+	TestDocument doc{text};
+	PropSetSimple props;
+	props.Set("fold", "1");
+	const WordList keywordLists[KEYWORDSET_MAX];
+
+	const auto start = std::chrono::steady_clock::now();
+	const Sci_Position length = doc.Length();
+	Sci_Position pos = 0;
+	while (pos < length) {
+		Sci_Position end = std::min(length, pos + chunk);
+		end = (end == length) ? length : doc.LineStart(doc.LineFromPosition(end) + 1);
+		if (end <= pos) {
+			end = length;
+		}
+		const int initStyle = (pos == 0) ? 0 : doc.StyleAt(pos - 1);
+		Accessor styler(&doc, props);
+		module.fnLexer(pos, end - pos, initStyle, keywordLists, styler);
+		if (module.fnFolder) {
+			module.fnFolder(pos, end - pos, initStyle, keywordLists, styler);
+		}
+		styler.Flush();
+		styler.FlushLevels();
+		pos = end;
+	}
+	const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+	return {std::move(doc.styles), std::move(doc.levels), duration.count()};
+}
+
+constexpr std::string_view levels[] = {
+	"INFO", "DEBUG", "WARN", "ERROR", "TRACE", "info", "Warning", "FATAL", "notice", "crit",
+};
+
+constexpr std::string_view messages[] = {
+	"Started server on port 8080 in 1.532 seconds",
+	"request id=3f2b9c1e-8d4a-4b6f-9e2a-7c5d1f0a9b3e path=\"/api/items?id=42\" took 12ms",
+	"miss ratio 0.42 exceeds limit 0.25, size 64KB",
+	"Request failed: \"item \\\"42\\\" not found\"",
+	"job 0x7ffd5a3c finished with status 0",
+	"unterminated \"quote",
+	"Accepted publickey for admin from 192.168.1.10 port 52514 ssh2",
+	"",
+};
+
+constexpr std::string_view continuations[] = {
+	"java.lang.IllegalStateException: item 42 not found",
+	"\tat com.example.app.ItemService.find(ItemService.java:87)",
+	"\t... 42 more",
+	"Caused by: java.io.FileNotFoundException: /data/items/42.json",
+	"Traceback (most recent call last):",
+	"  File \"/srv/app/tasks.py\", line 27, in run",
+	"ValueError: math domain error",
+	"continuation of previous record",
+	"",
+	"   ",
+};
+
+// timestamp, level and thread in various formats, or continuation line.
+void AddLine(std::mt19937 &rng, std::string &text, unsigned index) {
+	const unsigned kind = rng() % 10;
+	if (kind >= 7) {
+		text += continuations[rng() % std::size(continuations)];
+		text += (rng() % 8) ? "\n" : "\r\n";
+		return;
+	}
+
+	char line[128];
+	const unsigned second = index % 60;
+	const unsigned millisecond = index % 1000;
+	const std::string_view level = levels[rng() % std::size(levels)];
+	const int width = static_cast<int>(level.length());
+	switch (kind) {
+	case 0:
+		snprintf(line, sizeof(line), "2024-01-02 15:04:%02u,%03u %-5.*s [thread-%u] c.e.app.Server - ", second, millisecond, width, level.data(), index % 16);
+		break;
+	case 1:
+		snprintf(line, sizeof(line), "2024-01-02T15:04:%02u.%03uZ [%.*s] ", second, millisecond, width, level.data());
+		break;
+	case 2:
+		snprintf(line, sizeof(line), "[2024-01-02 15:04:%02u] production.%.*s: ", second, width, level.data());
+		break;
+	case 3:
+		snprintf(line, sizeof(line), "Jan  2 15:04:%02u host sshd[%u]: ", second, index % 4096);
+		break;
+	case 4:
+		snprintf(line, sizeof(line), "15:04:%02u.%03u [worker-%u] %.*s ", second, millisecond, index % 8, width, level.data());
+		break;
+	case 5:
+		snprintf(line, sizeof(line), "<%.*s> ", width, level.data());
+		break;
+	default:
+		snprintf(line, sizeof(line), "%.*s: ", width, level.data());
+		break;
+	}
+	text += line;
+	text += messages[rng() % std::size(messages)];
+	text += (rng() % 8) ? "\n" : "\r\n";
+}
+
+std::string GenerateLog(std::mt19937 &rng, size_t length) {
+	std::string text;
+	text.reserve(length + 256);
+	for (unsigned index = 0; text.length() < length; index++) {
+		AddLine(rng, text, index);
+	}
+	return text;
+}
+
+void TestRandom(std::mt19937 &rng) {
+	int mismatches = 0;
+	for (int round = 0; round < 2000; round++) {
+		const std::string text = GenerateLog(rng, 1 + rng() % 2000);
+		const Sci_Position chunk = 1 + rng() % 200;
+		if (!(Lex(lmLog, text, chunk) == Lex(lmLog, text, text.length())) && ++mismatches <= 5) {
+			printf("mismatch chunk=%d:\n%s\n----\n", static_cast<int>(chunk), text.c_str());
+		}
+	}
+	Check(mismatches == 0, "random logs");
+}
+
+void CompareLexers(const char *name, std::string_view text) {
+	struct Lexer {
+		const LexerModule &module;
+		const char *name;
+	};
+	static const Lexer lexers[] = {
+		{lmLog, "log"},
+		{lmNull, "null"},
+		{lmDiff, "diff"},
+		{lmProps, "props"},
+		{lmCPP, "cpp"},
+	};
+	printf("%s, %zu MiB:", name, text.length() >> 20);
+	for (const Lexer &lexer : lexers) {
+		const LexResult result = Lex(lexer.module, text, text.length());
+		printf(" %s %.0f MiB/s", lexer.name, text.length()/1048576.0/(result.duration/1000));
+	}
+	puts("");
+}
+
+void Benchmark(std::mt19937 &rng) {
+	const std::string text = GenerateLog(rng, 64*1024*1024);
+	CompareLexers("generated log", text);
+	// lexing from every 64 KiB like idle styling
+	const LexResult whole = Lex(lmLog, text, text.length());
+	const LexResult chunked = Lex(lmLog, text, 64*1024);
+	Check(whole == chunked, "benchmark chunks");
+	printf("log lexer whole %.1f ms, 64 KiB chunks %.1f ms\n", whole.duration, chunked.duration);
+}
+
+int LexFile(const char *path) {
+	FILE *fp = fopen(path, "rb");
+	if (fp == nullptr) {
+		printf("can't open %s\n", path);
+		return 1;
+	}
+	std::string text;
+	char buffer[4096];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), fp)) != 0) {
+		text.append(buffer, length);
+	}
+	fclose(fp);
+	CompareLexers(path, text);
+	return 0;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1) {
+		return LexFile(argv[1]);
+	}
+
+	std::mt19937 rng{20261019};
+	TestRandom(rng);
+	Benchmark(rng);
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
@@ -0,0 +1,339 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "ILexer.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+#include "PropSetSimple.h"
+#include "WordList.h"
+#include "LexAccessor.h"
+#include "Accessor.h"
+#include "LexerModule.h"
+
+// Lexes random Markdown documents whole and in small chunks like Scintilla does on typing,
+// checks styles, line states and fold levels are the same, then measures lexing time for
+// paragraphs with many unclosed emphasis, code span and math delimiters.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include /I../lexlib MarkdownLexerTest.cpp ../lexers/LexMarkdown.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include /I../lexlib MarkdownLexerTest.cpp ../lexers/LexMarkdown.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -I../include -I../lexlib MarkdownLexerTest.cpp ../lexers/LexMarkdown.cxx ../lexlib/Accessor.cxx ../lexlib/LexAccessor.cxx ../lexlib/PropSetSimple.cxx ../lexlib/StyleContext.cxx ../lexlib/WordList.cxx ../lexlib/CharacterCategory.cxx
+// To compare with another revision of the lexer, add /DMARKDOWN_REFERENCE (-DMARKDOWN_REFERENCE) and
+// LexMarkdownReference.cxx saved from that revision, built with /DlmMarkdown=lmMarkdownReference.
+
+using namespace Scintilla;
+using namespace Lexilla;
+
+extern LexerModule lmMarkdown;
+#if defined(MARKDOWN_REFERENCE)
+extern LexerModule lmMarkdownReference;
+#endif
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char *what) {
+	if (!condition) {
+		++failures;
+		printf("failed: %s\n", what);
+	}
+}
+
+class TestDocument final : public IDocument {
+	std::string text;
+	std::vector<Sci_Position> lineStarts;
+	Sci_Position stylingPos = 0;
+public:
+	std::vector<unsigned char> styles;
+	std::vector<int> levels;
+	std::vector<int> states;
+
+	explicit TestDocument(std::string_view text_) : text{text_}, styles(text_.length()) {
+		lineStarts.push_back(0);
+		for (size_t i = 0; i < text.length(); i++) {
+			if (text[i] == '\n' || (text[i] == '\r' && (i + 1 == text.length() || text[i + 1] != '\n'))) {
+				lineStarts.push_back(i + 1);
+			}
+		}
+		levels.assign(lineStarts.size(), SC_FOLDLEVELBASE);
+		states.assign(lineStarts.size(), 0);
+	}
+	Sci_Line LineCount() const noexcept {
+		return lineStarts.size();
+	}
+
+	int SCI_METHOD Version() const noexcept override {
+		return Scintilla::dvRelease4;
+	}
+	void SCI_METHOD SetErrorStatus([[maybe_unused]] int status) noexcept override {}
+	Sci_Position SCI_METHOD Length() const noexcept override {
+		return text.length();
+	}
+	void SCI_METHOD GetCharRange(char *buffer, Sci_Position position, Sci_Position lengthRetrieve) const noexcept override {
+		memcpy(buffer, text.data() + position, lengthRetrieve);
+	}
+	unsigned char SCI_METHOD StyleAt(Sci_Position position) const noexcept override {
+		return (position >= 0 && position < Length()) ? styles[position] : 0;
+	}
+	Sci_Line SCI_METHOD LineFromPosition(Sci_Position position) const noexcept override {
+		return std::upper_bound(lineStarts.begin() + 1, lineStarts.end(), position) - lineStarts.begin() - 1;
+	}
+	Sci_Position SCI_METHOD LineStart(Sci_Line line) const noexcept override {
+		if (line < 0) {
+			return 0;
+		}
+		return (line < LineCount()) ? lineStarts[line] : Length();
+	}
+	int SCI_METHOD GetLevel(Sci_Line line) const noexcept override {
+		return (line >= 0 && line < LineCount()) ? levels[line] : SC_FOLDLEVELBASE;
+	}
+	int SCI_METHOD SetLevel(Sci_Line line, int level) override {
+		if (line >= 0 && line < LineCount()) {
+			levels[line] = level;
+		}
+		return 0;
+	}
+	void SCI_METHOD SetLevels(Sci_Line lineStart, Sci_Line lineCount, const int *levels_) override {
+		for (Sci_Line line = 0; line < lineCount; line++) {
+			SetLevel(lineStart + line, levels_[line]);
+		}
+	}
+	int SCI_METHOD GetLineState(Sci_Line line) const noexcept override {
+		return (line >= 0 && line < LineCount()) ? states[line] : 0;
+	}
+	int SCI_METHOD SetLineState(Sci_Line line, int state) override {
+		if (line >= 0 && line < LineCount()) {
+			states[line] = state;
+		}
+		return 0;
+	}
+	void SCI_METHOD StartStyling(Sci_Position position) noexcept override {
+		stylingPos = position;
+	}
+	bool SCI_METHOD SetStyleFor(Sci_Position length, unsigned char style) override {
+		length = std::min(length, Length() - stylingPos);
+		memset(styles.data() + stylingPos, style, length);
+		stylingPos += length;
+		return true;
+	}
+	bool SCI_METHOD SetStyles(Sci_Position length, const unsigned char *styles_) override {
+		length = std::min(length, Length() - stylingPos);
+		memcpy(styles.data() + stylingPos, styles_, length);
+		stylingPos += length;
+		return true;
+	}
+	void SCI_METHOD DecorationSetCurrentIndicator([[maybe_unused]] int indicator) noexcept override {}
+	void SCI_METHOD DecorationFillRange([[maybe_unused]] Sci_Position position, [[maybe_unused]] int value, [[maybe_unused]] Sci_Position fillLength) override {}
+	void SCI_METHOD ChangeLexerState([[maybe_unused]] Sci_Position start, [[maybe_unused]] Sci_Position end) override {}
+	int SCI_METHOD CodePage() const noexcept override {
+		return SC_CP_UTF8;
+	}
+	bool SCI_METHOD IsDBCSLeadByte([[maybe_unused]] unsigned char ch) const noexcept override {
+		return false;
+	}
+	const char * SCI_METHOD BufferPointer() override {
+		return text.c_str();
+	}
+	int SCI_METHOD GetLineIndentation(Sci_Line line) const noexcept override {
+		int indent = 0;
+		for (Sci_Position pos = LineStart(line); pos < Length(); pos++) {
+			if (text[pos] == ' ') {
+				++indent;
+			} else if (text[pos] == '\t') {
+				indent = (indent/4 + 1)*4;
+			} else {
+				break;
+			}
+		}
+		return indent;
+	}
+	Sci_Position SCI_METHOD LineEnd(Sci_Line line) const noexcept override {
+		Sci_Position pos = LineStart(line + 1);
+		if (line + 1 < LineCount()) {
+			--pos;
+			if (pos > 0 && text[pos] == '\n' && text[pos - 1] == '\r') {
+				--pos;
+			}
+		}
+		return pos;
+	}
+	Sci_Position SCI_METHOD GetRelativePosition(Sci_Position positionStart, Sci_Position characterOffset) const noexcept override {
+		return positionStart + characterOffset;
+	}
+	int SCI_METHOD GetCharacterAndWidth(Sci_Position position, Sci_Position *pWidth) const noexcept override {
+		if (pWidth) {
+			*pWidth = 1;
+		}
+		return (position >= 0 && position < Length()) ? static_cast<unsigned char>(text[position]) : 0;
+	}
+	CharacterClass SCI_METHOD GetCharacterClass(unsigned int character) const noexcept override {
+		if (character == ' ' || character == '\t' || character == '\r' || character == '\n') {
+			return CharacterClass::space;
+		}
+		if (character < 0x80 && !(character >= '0' && character <= '9') && !((character | 0x20) >= 'a' && (character | 0x20) <= 'z') && character != '_') {
+			return CharacterClass::punctuation;
+		}
+		return CharacterClass::word;
+	}
+};
+
+struct LexResult {
+	std::vector<unsigned char> styles;
+	std::vector<int> levels;
+	std::vector<int> states;
+	double duration;
+
+	bool operator==(const LexResult &other) const noexcept {
+		return styles == other.styles && levels == other.levels && states == other.states;
+	}
+};
+
+// lexes from start of line after every chunk bytes, restarts with style before it.
+LexResult Lex(const LexerModule &module, std::string_view text, int lang, Sci_Position chunk) {
+	TestDocument doc{text};
+	PropSetSimple props;
+	props.Set("fold", "1");
+	props.Set("lexer.lang", std::to_string(lang).c_str());
+	const WordList keywordLists[KEYWORDSET_MAX];
+
+	const auto start = std::chrono::steady_clock::now();
+	const Sci_Position length = doc.Length();
+	Sci_Position pos = 0;
+	while (pos < length) {
+		Sci_Position end = std::min(length, pos + chunk);
+		end = (end == length) ? length : doc.LineStart(doc.LineFromPosition(end) + 1);
+		if (end <= pos) {
+			end = length;
+		}
+		const int initStyle = (pos == 0) ? 0 : doc.StyleAt(pos - 1);
+		Accessor styler(&doc, props);
+		module.fnLexer(pos, end - pos, initStyle, keywordLists, styler);
+		styler.Flush();
+		styler.FlushLevels();
+		pos = end;
+	}
+	const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start;
+	return {std::move(doc.styles), std::move(doc.levels), std::move(doc.states), duration.count()};
+}
+
+constexpr std::string_view tokens[] = {
+	"a", "b", "word", " ", " ", " ", "  ", "\t", "\n", "\n", "\n\n", "*", "**", "***", "_", "__", "~~", "~", "`", "``", "$", "$$", "$`", "`$",
+	"[", "]", "(", ")", "![", "](", "<", ">", "<b>", "</b>", "#", "# ", "- ", "1. ", "> ", "\\", "\\*", "&amp;", ":", "|", "http://x.y", "x@y.z",
+	"{++", "++}", "[-", "-]", "^", "@", "=", "-", ",", ".", "!", "\"", "'",
+};
+
+void TestRandom(std::mt19937 &rng) {
+	int mismatches = 0;
+	for (int round = 0; round < 20000; round++) {
+		std::string text;
+		const unsigned count = 1 + rng() % 40;
+		for (unsigned i = 0; i < count; i++) {
+			text += tokens[rng() % std::size(tokens)];
+		}
+		if (rng() & 1) {
+			text += "\n\nnext\n";
+		}
+		const int lang = rng() % 3;
+		const Sci_Position chunk = 1 + rng() % 40;
+#if defined(MARKDOWN_REFERENCE)
+		const bool same = Lex(lmMarkdown, text, lang, chunk) == Lex(lmMarkdownReference, text, lang, chunk);
+#else
+		const bool same = Lex(lmMarkdown, text, lang, chunk) == Lex(lmMarkdown, text, lang, text.length());
+#endif
+		if (!same && ++mismatches <= 5) {
+			printf("mismatch lang=%d chunk=%d:\n%s\n----\n", lang, static_cast<int>(chunk), text.c_str());
+		}
+	}
+	Check(mismatches == 0, "random documents");
+}
+
+void Benchmark() {
+	struct Pattern {
+		std::string_view repeat;
+		size_t length;
+	};
+	static constexpr Pattern patterns[] = {
+		{"*a ", 100'000},
+		{"_a ", 100'000},
+		{"~~a ", 100'000},
+		{"`a ", 100'000},
+		{"$a ", 40'000},
+		{"$`a ", 32'000},
+		{"**a *b ", 14'000},
+		{"*a **b ", 14'000},
+		{"*a _b ~~c ", 100'000},
+	};
+	for (const Pattern &pattern : patterns) {
+		std::string text;
+		while (text.length() < pattern.length) {
+			text += pattern.repeat;
+		}
+		text += "\n\nnext paragraph\n";
+		for (int lang = 0; lang < 3; lang += 1) {
+			const LexResult result = Lex(lmMarkdown, text, lang, text.length());
+#if defined(MARKDOWN_REFERENCE)
+			const LexResult reference = Lex(lmMarkdownReference, text, lang, text.length());
+			Check(result == reference, "benchmark");
+			printf("`%.*s` x %zu, lang %d: %.1f ms, reference %.1f ms\n", static_cast<int>(pattern.repeat.length()), pattern.repeat.data(),
+				text.length()/pattern.repeat.length(), lang, result.duration, reference.duration);
+#else
+			printf("`%.*s` x %zu, lang %d: %.1f ms\n", static_cast<int>(pattern.repeat.length()), pattern.repeat.data(),
+				text.length()/pattern.repeat.length(), lang, result.duration);
+#endif
+		}
+	}
+}
+
+// MarkdownLexerTest path [lang [chunk]], lexes a file and prints time.
+int LexFile(const char *path, int lang, Sci_Position chunk) {
+	FILE *fp = fopen(path, "rb");
+	if (fp == nullptr) {
+		printf("can't open %s\n", path);
+		return 1;
+	}
+	std::string text;
+	char buffer[4096];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), fp)) != 0) {
+		text.append(buffer, length);
+	}
+	fclose(fp);
+	if (chunk <= 0) {
+		chunk = text.length();
+	}
+	const LexResult result = Lex(lmMarkdown, text, lang, chunk);
+#if defined(MARKDOWN_REFERENCE)
+	const LexResult reference = Lex(lmMarkdownReference, text, lang, chunk);
+	printf("%s: %zu bytes, %.1f ms, reference %.1f ms, %s\n", path, text.length(), result.duration, reference.duration,
+		(result == reference) ? "same" : "different");
+	return result != reference;
+#else
+	printf("%s: %zu bytes, %.1f ms\n", path, text.length(), result.duration);
+	return 0;
+#endif
+}
+
+}
+
+int main(int argc, char *argv[]) {
+	if (argc > 1) {
+		return LexFile(argv[1], (argc > 2) ? atoi(argv[2]) : 0, (argc > 3) ? atoi(argv[3]) : 0);
+	}
+
+	std::mt19937 rng{20261019};
+	TestRandom(rng);
+	Benchmark();
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
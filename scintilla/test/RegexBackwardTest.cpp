@@ -0,0 +1,242 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <forward_list>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "ScintillaTypes.h"
+#include "ScintillaMessages.h"
+#include "ScintillaStructures.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+#include "CharacterSet.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "RESearch.h"
+
+// Compares backward search of built-in regex engine (BuiltinRegex::FindText) against
+// previous implementation that searches the whole line for each find previous.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib RegexBackwardTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib RegexBackwardTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -DNO_CXX11_REGEX -I../include -I../src -I../lexlib RegexBackwardTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+// defined in PlatWin.cxx, search duration is not measured here
+namespace Scintilla::Internal {
+int64_t QueryPerformanceFrequency() noexcept {
+	return 1;
+}
+int64_t QueryPerformanceCounter() noexcept {
+	return 0;
+}
+}
+
+namespace {
+
+class TextIndexer final : public CharacterIndexer {
+	const Document *pdoc;
+	Sci::Position end;
+public:
+	TextIndexer(const Document *pdoc_, Sci::Position end_) noexcept : pdoc(pdoc_), end(end_) {}
+	char CharAt(Sci::Position index) const noexcept override {
+		return (index >= 0 && index < end) ? pdoc->CharAt(index) : '\0';
+	}
+	Sci::Position MovePositionOutsideChar(Sci::Position pos, Sci::Position moveDir) const noexcept override {
+		return pdoc->MovePositionOutsideChar(pos, moveDir, false);
+	}
+};
+
+struct Match {
+	Sci::Position pos;
+	Sci::Position length;
+	std::string group1;
+};
+
+// backward search before the cache, each search scans the line from start.
+Match ReferenceFindPrevious(const Document *doc, RESearch &search, Sci::Position minPos, const std::string &pattern, FindOption flags) {
+	Match result{-1, 0, {}};
+	if (search.Compile(pattern.data(), pattern.length(), flags)) {
+		return result;
+	}
+	const Sci::Position startPos = doc->MovePositionOutsideChar(minPos, 1, true);
+	const Sci::Line lineRangeStart = doc->SciLineFromPosition(startPos);
+	const bool searchforLineStart = pattern[0] == '^';
+	const bool searchforLineEnd = pattern.back() == '$' && (pattern.length() < 2 || pattern[pattern.length() - 2] != '\\');
+	for (Sci::Line line = lineRangeStart; line >= 0; line--) {
+		const Sci::Position lineStartPos = doc->LineStart(line);
+		const Sci::Position lineEndPos = doc->LineEnd(line);
+		const Sci::Position startOfLine = lineStartPos;
+		Sci::Position endOfLine = lineEndPos;
+		if (line == 0 && startOfLine != 0 && searchforLineStart) {
+			continue;
+		}
+		if (line == lineRangeStart) {
+			if (startPos != endOfLine && searchforLineEnd) {
+				continue;
+			}
+			endOfLine = startPos;
+		}
+		const TextIndexer di(doc, endOfLine);
+		search.SetLineRange(lineStartPos, lineEndPos);
+		int success = search.Execute(di, startOfLine, endOfLine);
+		if (success) {
+			Sci::Position endPos = search.eopat[0];
+			if (!searchforLineStart) {
+				while (success && (endPos < endOfLine)) {
+					const RESearch::MatchPositions bopat = search.bopat;
+					const RESearch::MatchPositions eopat = search.eopat;
+					Sci::Position pos = endPos;
+					if (pos == bopat[0]) {
+						pos = doc->NextPosition(pos, 1);
+					}
+					success = search.Execute(di, pos, endOfLine);
+					if (success) {
+						endPos = search.eopat[0];
+					} else {
+						search.bopat = bopat;
+						search.eopat = eopat;
+					}
+				}
+			}
+			result.pos = search.bopat[0];
+			result.length = endPos - result.pos;
+			if (search.bopat[1] >= 0 && search.eopat[1] > search.bopat[1]) {
+				for (Sci::Position i = search.bopat[1]; i < search.eopat[1]; i++) {
+					result.group1.push_back(doc->CharAt(i));
+				}
+			}
+			break;
+		}
+	}
+	return result;
+}
+
+Match DocumentFindPrevious(Document *doc, Sci::Position minPos, const std::string &pattern, FindOption flags) {
+	Sci::Position length = pattern.length();
+	Match result{-1, 0, {}};
+	result.pos = doc->FindText(minPos, 0, pattern.data(), flags, &length);
+	if (result.pos >= 0) {
+		result.length = length;
+		Sci::Position lenSub = 2;
+		const char *sub = doc->SubstituteByPosition("\\1", &lenSub);
+		result.group1.assign(sub, lenSub);
+	}
+	return result;
+}
+
+const char *const patterns[] = {
+	"a", "aa", "a+", "a*", "ab*", "b.*a", "[0-9]+", "[a-z]*", ".", "x*",
+	"\\<\\w+", "\\w+\\>", "\\<", "\\>", "\\<a", "a\\>", "a$", "^a", "^.*b",
+	"\\(a\\)b", "\\([ab]\\)\\1", "\\(b+\\)a*\\1", "\\(\\w+\\) \\1", "a.b", "b[^a]",
+};
+
+std::string RandomLine(std::mt19937 &rng, size_t maxLength) {
+	static const char alphabet[] = "aaabbb  01_.x";
+	std::string line;
+	const size_t length = rng() % (maxLength + 1);
+	for (size_t i = 0; i < length; i++) {
+		line.push_back(alphabet[rng() % (sizeof(alphabet) - 1)]);
+	}
+	return line;
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20260101};
+	Document *doc = new Document(DocumentOption::Default);
+	doc->AddRef();
+	const CharClassify charClass;
+	RESearch search{&charClass};
+	size_t searches = 0;
+	size_t failures = 0;
+
+	auto check = [&](Sci::Position pos, const std::string &pattern, FindOption flags) {
+		const Match expected = ReferenceFindPrevious(doc, search, pos, pattern, flags);
+		const Match actual = DocumentFindPrevious(doc, pos, pattern, flags);
+		++searches;
+		if (expected.pos != actual.pos || expected.length != actual.length || expected.group1 != actual.group1) {
+			++failures;
+			if (failures <= 10) {
+				printf("mismatch pattern=\"%s\" from=%zd: expected %zd+%zd \"%s\", got %zd+%zd \"%s\"\n",
+					pattern.c_str(), static_cast<size_t>(pos),
+					static_cast<size_t>(expected.pos), static_cast<size_t>(expected.length), expected.group1.c_str(),
+					static_cast<size_t>(actual.pos), static_cast<size_t>(actual.length), actual.group1.c_str());
+			}
+		}
+		return actual;
+	};
+
+	// overlapping matches are resolved like forward search
+	doc->InsertString(0, "aaa", 3);
+	const Match overlap = check(3, "aa", FindOption::RegExp | FindOption::MatchCase);
+	if (overlap.pos != 0 || overlap.length != 2) {
+		++failures;
+		printf("\"aa\" in \"aaa\" found at %zd\n", static_cast<size_t>(overlap.pos));
+	}
+	doc->DeleteChars(0, 3);
+
+	for (int round = 0; round < 40; round++) {
+		std::string text;
+		const int lineCount = 1 + rng() % 8;
+		for (int i = 0; i < lineCount; i++) {
+			if (i != 0) {
+				text += (rng() & 1) ? "\n" : "\r\n";
+			}
+			text += RandomLine(rng, (rng() % 4 == 0) ? 2000 : 60);
+		}
+		doc->DeleteChars(0, doc->Length());
+		doc->InsertString(0, text.data(), text.length());
+
+		for (const char *pattern : patterns) {
+			const FindOption flags = FindOption::RegExp | ((rng() & 1) ? FindOption::MatchCase : FindOption::None);
+			// repeated find previous from document end, with random edits and jumps
+			Sci::Position pos = doc->Length();
+			while (pos >= 0) {
+				const Match match = check(pos, pattern, flags);
+				if (match.pos < 0) {
+					break;
+				}
+				pos = (match.pos < pos) ? match.pos : pos - 1;
+				const unsigned action = rng() % 64;
+				if (action == 0 && doc->Length() != 0) {
+					const Sci::Position where = rng() % doc->Length();
+					doc->InsertString(where, "ab", 2);
+				} else if (action == 1 && doc->Length() > 2) {
+					const Sci::Position where = rng() % (doc->Length() - 2);
+					doc->DeleteChars(doc->MovePositionOutsideChar(where, 1, true), 1);
+				} else if (action == 2) {
+					pos = rng() % (doc->Length() + 1);
+				}
+				pos = std::min(pos, doc->Length());
+			}
+		}
+	}
+
+	doc->Release();
+	printf("%zu searches, %zu mismatches\n", searches, failures);
+	return failures != 0;
+}
@@ -0,0 +1,229 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <forward_list>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <chrono>
+#include <random>
+
+#include "ScintillaTypes.h"
+#include "ScintillaMessages.h"
+#include "ScintillaStructures.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+#include "CharacterSet.h"
+#include "VectorISA.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+
+// Compares Document::FindStyleRun (used by SCI_SETSEARCHSTYLEMASK) against a byte by byte scan,
+// with run boundaries at every offset around the 16 byte blocks skipped with SSE2 in both directions,
+// then measures time for finding all runs in 64 MiB styles.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib StyleRunTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib StyleRunTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -DNO_CXX11_REGEX -I../include -I../src -I../lexlib StyleRunTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+// defined in PlatWin.cxx, styling duration is not measured here
+namespace Scintilla::Internal {
+int64_t QueryPerformanceFrequency() noexcept {
+	return 1;
+}
+int64_t QueryPerformanceCounter() noexcept {
+	return 0;
+}
+}
+
+namespace {
+
+size_t failures = 0;
+
+void Check(bool condition, const char *what, Sci::Position minPos, Sci::Position maxPos) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s, range %zd - %zd\n", what, static_cast<size_t>(minPos), static_cast<size_t>(maxPos));
+		}
+	}
+}
+
+struct StyleMask {
+	uint32_t bits[8]{};
+	void Add(int style) noexcept {
+		bits[style >> 5] |= 1U << (style & 31);
+	}
+};
+
+Document *NewDocument(const std::vector<unsigned char> &styles) {
+	Document *doc = new Document(DocumentOption::Default);
+	doc->AddRef();
+	const std::string text(styles.size(), 'a');
+	doc->InsertString(0, text.data(), text.length());
+	doc->StartStyling(0);
+	doc->SetStyles(styles.size(), styles.data());
+	return doc;
+}
+
+// same result as FindStyleRun(): empty range at maxPos when not found.
+Range ReferenceFindStyleRun(const std::vector<unsigned char> &styles, Sci::Position minPos, Sci::Position maxPos, const uint32_t *styleMask) noexcept {
+	if (minPos <= maxPos) {
+		Sci::Position start = minPos;
+		while (start < maxPos && !BitTestEx(styleMask, styles[start])) {
+			++start;
+		}
+		Sci::Position end = start;
+		while (end < maxPos && BitTestEx(styleMask, styles[end])) {
+			++end;
+		}
+		return Range(start, end);
+	}
+	Sci::Position end = minPos;
+	while (end > maxPos && !BitTestEx(styleMask, styles[end - 1])) {
+		--end;
+	}
+	Sci::Position start = end;
+	while (start > maxPos && BitTestEx(styleMask, styles[start - 1])) {
+		--start;
+	}
+	return Range(start, end);
+}
+
+void CheckRanges(Document *doc, const std::vector<unsigned char> &styles, const uint32_t *styleMask, const char *what) {
+	const Sci::Position length = styles.size();
+	for (Sci::Position minPos = 0; minPos <= length; minPos++) {
+		for (Sci::Position maxPos = 0; maxPos <= length; maxPos++) {
+			const Range run = doc->FindStyleRun(minPos, maxPos, styleMask);
+			const Range expected = ReferenceFindStyleRun(styles, minPos, maxPos, styleMask);
+			Check(run.start == expected.start && run.end == expected.end, what, minPos, maxPos);
+		}
+	}
+}
+
+// two or three runs of same style, every boundary offset inside and around two 16 byte blocks.
+void TestBoundary() {
+	StyleMask first;
+	first.Add(1);
+	StyleMask second;
+	second.Add(2);
+	StyleMask both = first;
+	both.Add(2);
+	const StyleMask none;
+	for (size_t length = 0; length <= 48; length++) {
+		for (size_t split = 0; split <= length; split++) {
+			std::vector<unsigned char> styles(length, 2);
+			std::fill(styles.begin(), styles.begin() + split, 1);
+			Document *doc = NewDocument(styles);
+			CheckRanges(doc, styles, first.bits, "first run");
+			CheckRanges(doc, styles, second.bits, "second run");
+			CheckRanges(doc, styles, both.bits, "adjacent runs");
+			CheckRanges(doc, styles, none.bits, "no run");
+			// single byte of another style inside a block
+			if (split < length) {
+				styles[split] = 3;
+				doc->StartStyling(split);
+				doc->SetStyleFor(1, 3);
+				CheckRanges(doc, styles, second.bits, "single byte");
+			}
+			doc->Release();
+		}
+	}
+}
+
+// runs with random length and style, styles above 127 check sign of the SSE2 compare.
+void TestRandom(std::mt19937 &rng) {
+	static constexpr unsigned char pool[] = {0, 1, 2, 31, 32, 128, 200, 255};
+	for (int round = 0; round < 50; round++) {
+		std::vector<unsigned char> styles;
+		while (styles.size() < 200) {
+			const size_t count = 1 + rng() % 40;
+			styles.insert(styles.end(), count, pool[rng() % std::size(pool)]);
+		}
+		StyleMask mask;
+		for (const unsigned char style : pool) {
+			if (rng() & 1) {
+				mask.Add(style);
+			}
+		}
+		Document *doc = NewDocument(styles);
+		CheckRanges(doc, styles, mask.bits, "random runs");
+		doc->Release();
+	}
+}
+
+void Benchmark(std::mt19937 &rng) {
+	constexpr size_t length = 64*1024*1024;
+	// long comment and string runs between short code tokens
+	std::vector<unsigned char> styles;
+	styles.reserve(length + 4096);
+	while (styles.size() < length) {
+		const unsigned kind = rng() % 4;
+		const size_t count = (kind == 0) ? 200 + rng() % 2000 : 1 + rng() % 12;
+		styles.insert(styles.end(), count, static_cast<unsigned char>(kind + 1));
+	}
+	styles.resize(length);
+	StyleMask code;
+	code.Add(2);
+	code.Add(3);
+	code.Add(4);
+
+	Document *doc = NewDocument(styles);
+	size_t runs = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (Sci::Position pos = 0; pos < static_cast<Sci::Position>(length);) {
+		const Range run = doc->FindStyleRun(pos, length, code.bits);
+		if (run.Empty()) {
+			break;
+		}
+		++runs;
+		pos = run.end;
+	}
+	const std::chrono::duration<double, std::milli> forward = std::chrono::steady_clock::now() - start;
+	start = std::chrono::steady_clock::now();
+	size_t expected = 0;
+	for (Sci::Position pos = 0; pos < static_cast<Sci::Position>(length);) {
+		const Range run = ReferenceFindStyleRun(styles, pos, length, code.bits);
+		if (run.Empty()) {
+			break;
+		}
+		++expected;
+		pos = run.end;
+	}
+	const std::chrono::duration<double, std::milli> reference = std::chrono::steady_clock::now() - start;
+	Check(runs == expected, "run count", 0, length);
+	printf("%zu MiB styles, %zu code runs: FindStyleRun %.1f ms, byte by byte %.1f ms\n",
+		length >> 20, runs, forward.count(), reference.count());
+	doc->Release();
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20261019};
+	TestBoundary();
+	TestRandom(rng);
+	Benchmark(rng);
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
@@ -0,0 +1,265 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#include "../../src/TagIndex.h"
+
+// Checks matching tag, enclosing element and sibling queries for XML and HTML, then compares index
+// built in small slices, after invalidation and after shifting for random plain text edits against
+// index built at once, then measures indexing 64 MiB XML and editing it.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 TagIndexTest.cpp ../../src/TagIndex.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 TagIndexTest.cpp ../../src/TagIndex.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra TagIndexTest.cpp ../../src/TagIndex.cpp
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char *what, size_t value) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s, %zu\n", what, value);
+		}
+	}
+}
+
+const char *GetText(void *param, size_t position, size_t length) noexcept {
+	const std::string &doc = *static_cast<const std::string *>(param);
+	return (position + length <= doc.length()) ? doc.data() + position : nullptr;
+}
+
+// same as ExtendTagIndex() in Edit.cpp without styles: slice is doubled for tag longer than it.
+void ExtendSlice(TagPairIndex &index, const std::string &doc, size_t sliceSize) noexcept {
+	const size_t start = index.ValidUntil();
+	while (true) {
+		const size_t end = std::min(doc.length(), start + sliceSize);
+		index.Extend(doc.data() + start, end - start, end == doc.length(), nullptr, GetText, const_cast<std::string *>(&doc));
+		if (index.ValidUntil() != start || index.Finished()) {
+			return;
+		}
+		sliceSize *= 2;
+	}
+}
+
+void ExtendAll(TagPairIndex &index, const std::string &doc, size_t sliceSize) noexcept {
+	while (!index.Finished()) {
+		ExtendSlice(index, doc, sliceSize);
+	}
+}
+
+bool SameIndex(const TagPairIndex &index, const TagPairIndex &expected) noexcept {
+	if (index.Count() != expected.Count() || index.ValidUntil() != expected.ValidUntil()) {
+		return false;
+	}
+	for (uint32_t i = 0; i < index.Count(); i++) {
+		const TagEntry tag = index[i];
+		const TagEntry other = expected[i];
+		if (tag.start != other.start || tag.length != other.length || tag.pair != other.pair || tag.parent != other.parent
+			|| tag.nameLength != other.nameLength || tag.kind != other.kind || tag.matched != other.matched) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t Find(std::string_view doc, std::string_view tag, size_t from = 0) noexcept {
+	return doc.find(tag, from);
+}
+
+void TestQueries() {
+	const std::string xml = "<root><a x='1>'>t</a><!-- <b> --><br/><b><c></c></b><![CDATA[</root>]]></root>";
+	TagPairIndex index;
+	index.Reset(false);
+	Check(index.TagAt(0) == TagPairIndex::pending, "pending before extend", 0);
+	ExtendAll(index, xml, xml.length());
+	Check(index.Count() == 9, "XML count", index.Count());
+	const uint32_t root = index.TagAt(0);
+	const uint32_t a = index.TagAt(Find(xml, "<a") + 3);
+	const uint32_t br = index.TagAt(Find(xml, "<br"));
+	const uint32_t b = index.TagAt(Find(xml, "<b>", Find(xml, "-->")));
+	const uint32_t rootEnd = index.TagAt(xml.length() - 1);
+	Check(root == 0 && a == 1 && br == 3 && b == 4 && rootEnd == 8, "XML tags", a);
+	Check(index.TagAt(Find(xml, "<!--") + 5) == TagPairIndex::npos, "tag in comment", 0);
+	Check(index.MatchingTag(root) == rootEnd && index.MatchingTag(rootEnd) == root, "XML matching", root);
+	Check(index.MatchingTag(a) == 2 && index.MatchingTag(br) == TagPairIndex::npos, "XML matching empty", a);
+	Check(index.EnclosingElement(Find(xml, ">t<") + 1) == a, "enclosing text", a);
+	Check(index.EnclosingElement(Find(xml, "</c>")) == 5, "enclosing end tag", 5);
+	Check(index.EnclosingElement(Find(xml, "<br")) == br, "enclosing empty", br);
+	Check(index.NextSibling(Find(xml, "<a") + 1) == br && index.NextSibling(Find(xml, "<br")) == b, "next sibling", a);
+	Check(index.NextSibling(Find(xml, "<b>", Find(xml, "-->"))) == TagPairIndex::npos, "last sibling", b);
+	Check(index.PreviousSibling(Find(xml, "<b>", Find(xml, "-->"))) == br && index.PreviousSibling(Find(xml, "<br")) == a, "previous sibling", b);
+	Check(index.PreviousSibling(Find(xml, "<a") + 1) == TagPairIndex::npos, "first sibling", a);
+
+	// implicitly closed and void elements, case insensitive names
+	const std::string html = "<UL><li>a<li>b<BR></ul><p>t";
+	index.Reset(true);
+	ExtendAll(index, html, 4);
+	Check(index.Count() == 6, "HTML count", index.Count());
+	Check(index.MatchingTag(0) == 4 && index.MatchingTag(4) == 0, "HTML matching", 0);
+	Check(index.MatchingTag(1) == TagPairIndex::npos && index[1].pair == 4, "implicitly closed", 1);
+	Check(index[3].kind == TagKind_Empty && index.EnclosingElement(Find(html, "<BR")) == 3, "void element", 3);
+	Check(index.NextSibling(Find(html, "<li>")) == 2, "next item", 2);
+	Check(index.MatchingTag(5) == TagPairIndex::npos, "not closed", 5);
+
+	// start tag not yet closed in indexed text
+	const std::string partial = "<a><b></b>";
+	index.Reset(false);
+	index.Extend(partial.data(), partial.length(), false, nullptr, GetText, const_cast<std::string *>(&partial));
+	Check(index.MatchingTag(0) == TagPairIndex::pending && index.NextSibling(1) == TagPairIndex::pending, "pending query", 0);
+}
+
+std::string RandomDocument(std::mt19937 &rng, size_t length) {
+	static constexpr const char *names[] = {"a", "b", "item", "Item", "li", "p"};
+	std::string doc;
+	std::string stack[64];
+	size_t depth = 0;
+	while (doc.length() < length) {
+		switch (rng() % 6) {
+		case 0:
+		case 1:
+			if (depth < std::size(stack)) {
+				stack[depth] = names[rng() % std::size(names)];
+				// unquoted value, quote removed by edit may span tags
+				doc += '<' + stack[depth] + ((rng() & 1) ? " id=1>" : ">");
+				++depth;
+			}
+			break;
+		case 2:
+			if (depth != 0) {
+				--depth;
+				// mismatched end tag
+				doc += "</" + ((rng() % 8) ? stack[depth] : std::string{names[rng() % std::size(names)]}) + '>';
+			}
+			break;
+		case 3:
+			doc += "<br/>";
+			break;
+		default:
+			doc.append(1 + rng() % 12, static_cast<char>('a' + rng() % 26));
+			doc += ' ';
+			break;
+		}
+	}
+	return doc;
+}
+
+// edits are classified same as EditTagIndexModified() in Edit.cpp, where lexer styles text after '<'
+// without '>' (e.g. tag without '>', or </ after deleting name) as markup, which may form a tag.
+void RandomEdit(std::mt19937 &rng, TagPairIndex &index, std::string &doc) {
+	const size_t position = rng() % (doc.length() + 1);
+	const size_t open = (position == 0) ? std::string::npos : doc.rfind('<', position - 1);
+	const bool afterBracket = open != std::string::npos && doc.find('>', open) >= position;
+	if ((rng() & 1) || position == doc.length()) {
+		const std::string text(1 + rng() % 8, 'x');
+		doc.insert(position, text);
+		if (afterBracket) {
+			index.Invalidate(position);
+		} else {
+			index.InsertText(position, text.length());
+		}
+	} else {
+		const size_t length = std::min<size_t>(1 + rng() % 8, doc.length() - position);
+		const std::string_view text = std::string_view{doc}.substr(position, length);
+		const bool markup = afterBracket || text.find_first_of("<>") != std::string_view::npos;
+		doc.erase(position, length);
+		if (markup) {
+			index.Invalidate(position);
+		} else {
+			index.DeleteText(position, length);
+		}
+	}
+}
+
+void TestEdits(std::mt19937 &rng) {
+	for (int round = 0; round < 200; round++) {
+		std::string doc = RandomDocument(rng, 200 + rng() % 2000);
+		const bool html = (round & 1) != 0;
+		TagPairIndex index;
+		index.Reset(html);
+		ExtendAll(index, doc, 1 + rng() % 64);
+		TagPairIndex expected;
+		expected.Reset(html);
+		ExtendAll(expected, doc, doc.length());
+		Check(SameIndex(index, expected), "slices", round);
+
+		// invalidate then extend in slices
+		index.Invalidate(rng() % doc.length());
+		ExtendAll(index, doc, 1 + rng() % 64);
+		Check(SameIndex(index, expected), "invalidate", round);
+
+		// edits with partly indexed text
+		for (int edit = 0; edit < 50; edit++) {
+			RandomEdit(rng, index, doc);
+			if (rng() % 4 == 0) {
+				ExtendSlice(index, doc, 1 + rng() % 256);
+			}
+		}
+		ExtendAll(index, doc, 1 + rng() % 256);
+		expected.Reset(html);
+		ExtendAll(expected, doc, doc.length());
+		Check(SameIndex(index, expected), "edits", round);
+	}
+}
+
+void Benchmark(std::mt19937 &rng) {
+	constexpr size_t length = 64*1024*1024;
+	constexpr size_t sliceSize = 1024*1024;
+	std::string doc = RandomDocument(rng, length);
+	TagPairIndex index;
+	index.Reset(false);
+	auto start = std::chrono::steady_clock::now();
+	ExtendAll(index, doc, sliceSize);
+	const std::chrono::duration<double, std::milli> build = std::chrono::steady_clock::now() - start;
+
+	// typing before tags around a caret moving through the document, then query matching tag.
+	// only index is timed, as inserting into std::string moves all text after it.
+	constexpr int edits = 2000;
+	std::chrono::duration<double, std::milli> shift{};
+	size_t matched = 0;
+	uint32_t tag = 0;
+	for (int edit = 0; edit < edits; edit++) {
+		tag = (tag + rng() % 64) % index.Count();
+		const size_t position = index[tag].start;
+		doc.insert(position, 1, 'x');
+		start = std::chrono::steady_clock::now();
+		index.InsertText(position, 1);
+		matched += index.MatchingTag(tag) < index.Count();
+		shift += std::chrono::steady_clock::now() - start;
+	}
+	TagPairIndex expected;
+	expected.Reset(false);
+	ExtendAll(expected, doc, doc.length());
+	Check(SameIndex(index, expected), "benchmark", matched);
+
+	// dropping tags after edit then indexing them again
+	constexpr int rebuilds = 10;
+	start = std::chrono::steady_clock::now();
+	for (int edit = 0; edit < rebuilds; edit++) {
+		index.Invalidate(rng() % doc.length());
+		ExtendAll(index, doc, sliceSize);
+	}
+	const std::chrono::duration<double, std::milli> rebuild = std::chrono::steady_clock::now() - start;
+	printf("%zu MiB, %u tags: index %.1f ms, shift %.3f us per edit, invalidate and index again %.1f ms per edit\n",
+		doc.length() >> 20, index.Count(), build.count(), shift.count()*1000/edits, rebuild.count()/rebuilds);
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20261019};
+	TestQueries();
+	TestEdits(rng);
+	Benchmark(rng);
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
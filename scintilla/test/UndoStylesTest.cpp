@@ -0,0 +1,225 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <forward_list>
+#include <optional>
+#include <algorithm>
+#include <memory>
+#include <random>
+
+#include "ScintillaTypes.h"
+#include "ScintillaMessages.h"
+#include "ScintillaStructures.h"
+#include "ILoader.h"
+#include "ILexer.h"
+
+#include "Debugging.h"
+#include "CharacterSet.h"
+#include "Position.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "RunStyles.h"
+#include "CellBuffer.h"
+#include "PerLine.h"
+#include "CharClassify.h"
+#include "Decoration.h"
+#include "CaseFolder.h"
+#include "Document.h"
+#include "Scintilla.h"
+#include "SciLexer.h"
+#include "WordList.h"
+#include "LexerModule.h"
+
+// Checks styles, line states and fold levels restored from undo history (Document::RestoreActionStyles)
+// after undo or redo inserting at least 64 KiB of text against lexing the same text from scratch.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib UndoStylesTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx ../lexlib/*.cxx ../lexers/*.cxx
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /DNO_CXX11_REGEX /I../include /I../src /I../lexlib UndoStylesTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx ../lexlib/*.cxx ../lexers/*.cxx
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -DNO_CXX11_REGEX -I../include -I../src -I../lexlib UndoStylesTest.cpp ../src/Document.cxx ../src/CellBuffer.cxx ../src/CompressedStorage.cxx ../src/UndoHistory.cxx ../src/ChangeHistory.cxx ../src/PerLine.cxx ../src/RunStyles.cxx ../src/Decoration.cxx ../src/CaseFolder.cxx ../src/CaseConvert.cxx ../src/CharClassify.cxx ../src/RESearch.cxx ../src/UniConversion.cxx ../lexlib/*.cxx ../lexers/*.cxx
+
+using namespace Scintilla;
+using namespace Scintilla::Internal;
+
+// defined in PlatWin.cxx, styling duration is not measured here
+namespace Scintilla::Internal {
+int64_t QueryPerformanceFrequency() noexcept {
+	return 1;
+}
+int64_t QueryPerformanceCounter() noexcept {
+	return 0;
+}
+}
+
+namespace {
+
+class TestLexInterface final : public LexInterface {
+public:
+	explicit TestLexInterface(Document *pdoc_) : LexInterface(pdoc_) {
+		instance.reset(Lexilla::LexerModule::Find(SCLEX_CPP)->Create());
+		instance->PropertySet("fold", "1");
+	}
+};
+
+Document *NewDocument() {
+	Document *doc = new Document(DocumentOption::Default);
+	doc->AddRef();
+	doc->SetLexInterface(std::make_unique<TestLexInterface>(doc));
+	doc->LexerChanged(true);
+	return doc;
+}
+
+// code with block comments, strings and preprocessor spanning lines, so
+// line states and fold levels depend on text before the edit.
+std::string MakeCode(std::mt19937 &rng, size_t length) {
+	static const char *const lines[] = {
+		"int main(int argc, char *argv[]) {\n",
+		"\treturn argc > 1 ? atoi(argv[1]) : 0;\n",
+		"}\n",
+		"/* block comment\n",
+		" * continued */\n",
+		"\tconst char *s = \"string with \\\" quote\";\n",
+		"#if defined(_WIN32)\n",
+		"#define MACRO(x) \\\n",
+		"\t((x) + 1)\n",
+		"#endif\n",
+		"\t// line comment\n",
+		"\tfor (int i = 0; i < 10; i++) { value += 'c'; }\n",
+		"R\"(raw\n",
+		"string)\";\n",
+		"\n",
+	};
+	std::string text;
+	while (text.length() < length) {
+		text += lines[rng() % std::size(lines)];
+	}
+	return text;
+}
+
+size_t failures = 0;
+
+void Check(bool condition, const char *what, int step) {
+	if (!condition) {
+		++failures;
+		if (failures <= 20) {
+			printf("failed: %s, step %d\n", what, step);
+		}
+	}
+}
+
+// lex whole document, then lex same text in a new document and compare
+void CheckStyles(Document *doc, int step) {
+	const Sci::Position length = doc->Length();
+	doc->EnsureStyledTo(length);
+
+	Document *fresh = NewDocument();
+	fresh->InsertString(0, doc->BufferPointer(), length);
+	fresh->EnsureStyledTo(length);
+	Sci::Position pos = 0;
+	while (pos < length && doc->StyleAt(pos) == fresh->StyleAt(pos)) {
+		++pos;
+	}
+	Check(pos == length, "styles", step);
+	bool sameLines = doc->LinesTotal() == fresh->LinesTotal();
+	for (Sci::Line line = 0; sameLines && line < doc->LinesTotal(); line++) {
+		sameLines = doc->GetLineState(line) == fresh->GetLineState(line)
+			&& doc->GetLevel(line) == fresh->GetLevel(line);
+	}
+	Check(sameLines, "line states and fold levels", step);
+	fresh->Release();
+}
+
+}
+
+int main() {
+	std::mt19937 rng{20260101};
+	constexpr Sci::Position minLength = 64*1024;
+	const std::string code = MakeCode(rng, 8*minLength);
+	const std::string paste = MakeCode(rng, minLength + 1000);
+
+	Document *doc = NewDocument();
+	doc->SetUndoCollection(false);
+	doc->InsertString(0, code.data(), code.length());
+	doc->SetUndoCollection(true);
+	doc->EnsureStyledTo(doc->Length());
+
+	int restored = 0;
+	auto undoRedo = [&](bool undo) {
+		const Sci::Position length = doc->Length();
+		const Sci::Position pos = undo ? doc->Undo() : doc->Redo();
+		// inserted text is already styled when styles are restored
+		restored += doc->Length() - length >= minLength && doc->GetEndStyled() >= pos;
+	};
+	{
+		// undo of a small edit leaves text before the large action with stale styles,
+		// which must be lexed again instead of being skipped.
+		const Sci::Position pos = doc->Length()/2;
+		doc->DeleteChars(pos, 2*minLength);
+		doc->EnsureStyledTo(doc->Length());
+		// outside comment and string
+		const Sci::Position where = code.find("\nint main(", pos/2) + 1;
+		doc->InsertString(where, "/*", 2);
+		doc->EnsureStyledTo(doc->Length());
+		undoRedo(true);
+		undoRedo(true);
+		CheckStyles(doc, 0);
+		undoRedo(false);
+		undoRedo(false);
+		CheckStyles(doc, 0);
+	}
+
+	for (int step = 1; step < 300; step++) {
+		const Sci::Position length = doc->Length();
+		const unsigned action = rng() % 8;
+		if (action < 2 && length > 2*minLength) {
+			// large delete starting inside a line, token or comment
+			const Sci::Position pos = rng() % (length - 2*minLength);
+			doc->DeleteChars(pos, minLength + rng() % minLength);
+		} else if (action == 2) {
+			// large paste, undo removes it
+			doc->InsertString(rng() % (length + 1), paste.data(), paste.length());
+		} else if (action == 3) {
+			// small edit changes lexer state for following text
+			static const char *const edits[] = {"/*", "*/", "\"", "{", "}", "#if 0\n", "\n", "R\"("};
+			const char *edit = edits[rng() % std::size(edits)];
+			doc->InsertString(rng() % (length + 1), edit, strlen(edit));
+		} else if (action < 6) {
+			if (doc->CanUndo()) {
+				undoRedo(true);
+			}
+		} else if (doc->CanRedo()) {
+			undoRedo(false);
+		}
+
+		// document may be partly styled before next action
+		if (rng() % 4 == 0) {
+			doc->EnsureStyledTo(rng() % (doc->Length() + 1));
+		} else {
+			CheckStyles(doc, step);
+		}
+	}
+	CheckStyles(doc, -1);
+
+	// undo back to the beginning, then redo all
+	while (doc->CanUndo()) {
+		undoRedo(true);
+		CheckStyles(doc, -2);
+	}
+	Check(doc->Length() == static_cast<Sci::Position>(code.length()) && memcmp(doc->BufferPointer(), code.data(), code.length()) == 0,
+		"undo to original text", -2);
+	while (doc->CanRedo()) {
+		undoRedo(false);
+		CheckStyles(doc, -3);
+	}
+	Check(restored != 0, "styles are restored", -1);
+
+	doc->Release();
+	printf("%d restored, %s\n", restored, (failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
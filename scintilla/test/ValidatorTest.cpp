@@ -0,0 +1,189 @@
+// This file is part of Notepad4.
+// See License.txt for details about distribution and modification.
+#define _CRT_SECURE_NO_WARNINGS
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <algorithm>
+#include <chrono>
+
+#include "../../src/Validator.h"
+
+// Checks position and message of first error for JSON (RFC 8259) and XML 1.0 well-formedness
+// on accepted and rejected samples, cancellation and deep nesting, then measures throughput
+// for about 256 MiB JSON and XML.
+// cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include ValidatorTest.cpp ../../src/Validator.cpp
+// clang-cl /EHsc /std:c++20 /DNDEBUG /O2 /W4 /I../include ValidatorTest.cpp ../../src/Validator.cpp
+// g++ -std=gnu++20 -DNDEBUG -O2 -Wall -Wextra -I../include ValidatorTest.cpp ../../src/Validator.cpp
+
+namespace {
+
+int failures = 0;
+
+void Check(bool condition, const char *what, std::string_view text) {
+	if (!condition) {
+		++failures;
+		printf("failed: %s, %.*s\n", what, static_cast<int>(std::min<size_t>(text.length(), 60)), text.data());
+	}
+}
+
+struct Sample {
+	std::string_view text;
+	size_t position;		// SIZE_MAX when well-formed
+	const char *message;
+};
+
+constexpr Sample jsonSamples[] = {
+	{"[\"\xc3\xa9\", \"\\ud83d\\ude00\", -0.5e+10, 1E2, true, false, null, {}]", SIZE_MAX, nullptr},
+	{" \t\r\n{\"a\": [1, {\"b\": null}], \"c\": \"\\\"\\\\\\/\\b\\f\\n\\r\\t\"} \n", SIZE_MAX, nullptr},
+	{"0", SIZE_MAX, nullptr},
+	{"\"\"", SIZE_MAX, nullptr},
+	{"", 0, "value expected"},
+	{"tru", 0, "value expected"},
+	{"[1,]", 3, "value expected"},
+	{"[1 2]", 3, "',' or ']' expected"},
+	{"[01]", 2, "',' or ']' expected"},
+	{"{\"a\" 1}", 5, "':' expected"},
+	{"{1:2}", 1, "property name expected"},
+	{"{\"a\":1,}", 7, "property name expected"},
+	{"01", 1, "unexpected character after value"},
+	{"[1]]", 3, "unexpected character after value"},
+	{"1.", 2, "digit expected"},
+	{"-", 1, "digit expected"},
+	{"\"abc", 0, "unterminated string"},
+	{"\"\\x\"", 1, "invalid escape sequence"},
+	{"\"\\u12\"", 1, "invalid \\u escape sequence"},
+	{"\"a\tb\"", 2, "control character in string"},
+	{"\"\xff\"", 1, "invalid UTF-8 sequence"},
+	// overlong encoding and surrogate
+	{"\"\xc0\x80\"", 1, "invalid UTF-8 sequence"},
+	{"\"\xed\xa0\x80\"", 1, "invalid UTF-8 sequence"},
+};
+
+constexpr Sample xmlSamples[] = {
+	{"<?xml version=\"1.0\"?>\n<!-- c -->\n<a x=\"1\" y='2'>t&amp;&#x41;&#65;<![CDATA[<]]><b/><?pi x?></a>\n", SIZE_MAX, nullptr},
+	{"<!DOCTYPE a [<!ENTITY e \"x\">]><a>&e;</a>", SIZE_MAX, nullptr},
+	{"<a/>  <!-- ok --> <?pi?>\n", SIZE_MAX, nullptr},
+	{"<a>\xc3\xa9</a>", SIZE_MAX, nullptr},
+	{"", 0, "root element expected"},
+	{"<a>", 0, "element is not closed"},
+	{"</a>", 0, "end tag without start tag"},
+	{"<a></b>", 3, "end tag does not match start tag"},
+	{"<a x=\"1\" x=\"2\"/>", 9, "duplicate attribute"},
+	{"<a/><b/>", 4, "only one root element is allowed"},
+	{"text<a/>", 0, "text not allowed outside root element"},
+	{"<a>]]></a>", 3, "']]>' not allowed in text"},
+	{"<a x=1/>", 5, "quoted attribute value expected"},
+	{"<a x=\"<\"/>", 6, "'<' not allowed in attribute value"},
+	{"<a x='1'y='2'/>", 8, "whitespace expected"},
+	{"<1a/>", 1, "element name expected"},
+	{"<a>&foo;</a>", 3, "undefined entity"},
+	{"<a>&amp</a>", 3, "';' expected after entity reference"},
+	{"<a>&#xD800;</a>", 3, "invalid character reference"},
+	{"<a>\x01</a>", 3, "invalid character"},
+	{"<a><!-- -- --></a>", 8, "'--' not allowed in comment"},
+	{"<a><![CDATA[x</a>", 3, "unterminated CDATA section"},
+	{" <?xml version=\"1.0\"?><a/>", 1, "XML declaration must be at start of document"},
+	{"<!DOCTYPE a><!DOCTYPE a><a/>", 12, "document type declaration not allowed here"},
+	{"<a><!DOCTYPE a></a>", 3, "document type declaration not allowed here"},
+	{"<a>\xff</a>", 3, "invalid UTF-8 sequence"},
+};
+
+bool CheckText(bool xml, std::string_view text, bool utf8, WellFormedResult &result, WellFormedContinueProc continueProc = nullptr, void *param = nullptr) noexcept {
+	return xml ? CheckXMLWellFormed(text.data(), text.length(), utf8, result, continueProc, param)
+		: CheckJSONWellFormed(text.data(), text.length(), utf8, result, continueProc, param);
+}
+
+void TestSamples(bool xml, const Sample *samples, size_t count) {
+	for (size_t index = 0; index < count; index++) {
+		const Sample &sample = samples[index];
+		WellFormedResult result;
+		Check(CheckText(xml, sample.text, true, result), "not cancelled", sample.text);
+		if (sample.message == nullptr) {
+			Check(result.message == nullptr, result.message ? result.message : "", sample.text);
+		} else {
+			Check(result.message != nullptr && strcmp(result.message, sample.message) == 0, sample.message, sample.text);
+			Check(result.position == sample.position, "position", sample.text);
+		}
+	}
+	// bytes are not validated for other encodings
+	WellFormedResult result;
+	CheckText(xml, xml ? "<a>\xff</a>" : "\"\xff\"", false, result);
+	Check(result.message == nullptr, "not UTF-8", "\\xff");
+}
+
+bool CancelProc(void *param) noexcept {
+	int &calls = *static_cast<int *>(param);
+	++calls;
+	return false;
+}
+
+// nesting deeper than thread stack could hold with recursion, cancelled on large text.
+void TestNesting() {
+	constexpr size_t depth = 4*1024*1024;
+	const std::string json = std::string(depth, '[') + std::string(depth, ']');
+	std::string xml;
+	for (size_t level = 0; level < depth/4; level++) {
+		xml += "<a>";
+	}
+	for (size_t level = 0; level < depth/4; level++) {
+		xml += "</a>";
+	}
+	WellFormedResult result;
+	CheckText(false, json, true, result);
+	Check(result.message == nullptr, "deep JSON", "[[[");
+	CheckText(true, xml, true, result);
+	Check(result.message == nullptr, "deep XML", "<a><a>");
+	CheckText(false, json.substr(0, json.length() - 1), true, result);
+	Check(result.message != nullptr && result.position == json.length() - 1, "deep JSON not closed", "[[[");
+
+	int calls = 0;
+	Check(!CheckText(false, json, true, result, CancelProc, &calls) && calls == 1, "cancel JSON", "[[[");
+	calls = 0;
+	Check(!CheckText(true, xml, true, result, CancelProc, &calls) && calls == 1, "cancel XML", "<a><a>");
+}
+
+void Benchmark() {
+	constexpr size_t length = 256*1024*1024;
+	std::string json = "[\n";
+	std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<items>\n";
+	json.reserve(length + 1024);
+	xml.reserve(length + 1024);
+	for (unsigned index = 0; json.length() < length; index++) {
+		json += "{\"id\": ";
+		json += std::to_string(index);
+		json += ", \"name\": \"item \\u00e9 \xe4\xb8\xad\", \"price\": 12.5e-1, \"tags\": [\"a\", \"b\"], \"note\": \"lorem ipsum dolor sit amet consectetur\"},\n";
+	}
+	json += "null]";
+	for (unsigned index = 0; xml.length() < length; index++) {
+		xml += "<item id=\"";
+		xml += std::to_string(index);
+		xml += "\" name='item \xe4\xb8\xad'><price>12.5</price><!-- note --><note>lorem &amp; ipsum dolor sit amet consectetur</note></item>\n";
+	}
+	xml += "</items>\n";
+
+	for (const bool isXml : {false, true}) {
+		const std::string &text = isXml ? xml : json;
+		WellFormedResult result;
+		const auto start = std::chrono::steady_clock::now();
+		CheckText(isXml, text, true, result);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		Check(result.message == nullptr, "benchmark", isXml ? "XML" : "JSON");
+		printf("%s %zu MiB: %.0f ms, %.0f MiB/s\n", isXml ? "XML" : "JSON", text.length() >> 20,
+			elapsed.count()*1000, text.length()/1048576.0/elapsed.count());
+	}
+}
+
+}
+
+int main() {
+	TestSamples(false, jsonSamples, std::size(jsonSamples));
+	TestSamples(true, xmlSamples, std::size(xmlSamples));
+	TestNesting();
+	Benchmark();
+	puts((failures == 0) ? "all passed" : "failed");
+	return failures != 0;
+}
@@ -0,0 +1,87 @@
+// Cancellable background job for long-running commands
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "BackgroundJob.h"
+
+BackgroundJob::~BackgroundJob() {
+	ReleaseSnapshot();
+}
+
+bool BackgroundJob::TakeSnapshot(const char *text, size_t length) noexcept {
+	ReleaseSnapshot();
+	snapshot = static_cast<char *>(malloc(length + 1));
+	if (snapshot == nullptr) {
+		return false;
+	}
+	memcpy(snapshot, text, length);
+	snapshot[length] = '\0';
+	snapshotLength = length;
+	return true;
+}
+
+void BackgroundJob::ReleaseSnapshot() noexcept {
+	free(snapshot);
+	snapshot = nullptr;
+	snapshotLength = 0;
+}
+
+void BackgroundJob::ReportProgress(uint64_t done, uint64_t total, uint32_t phase) noexcept {
+	progressPhase.store(phase, std::memory_order_relaxed);
+	progressTotal.store(total, std::memory_order_relaxed);
+	progressDone.store(done, std::memory_order_relaxed);
+}
+
+JobProgress BackgroundJob::Progress() const noexcept {
+	return {
+		progressDone.load(std::memory_order_relaxed),
+		progressTotal.load(std::memory_order_relaxed),
+		progressPhase.load(std::memory_order_relaxed),
+	};
+}
+
+void BackgroundJob::Start() noexcept {
+	++generation;
+	token.Reset();
+	ReportProgress(0, 0);
+	state.store(JobState::Running, std::memory_order_release);
+}
+
+void BackgroundJob::Execute() noexcept {
+	const bool done = Run();
+	const JobState result = token.IsCancelled() ? JobState::Cancelled : (done ? JobState::Finished : JobState::Failed);
+	state.store(result, std::memory_order_release);
+}
+
+bool BackgroundJob::Commit(uint32_t jobGeneration) noexcept {
+	// completion for a discarded job may arrive after new job started
+	if (jobGeneration != generation || Busy()) {
+		return false;
+	}
+	const bool finished = State() == JobState::Finished && !token.IsCancelled();
+	if (finished) {
+		Apply();
+	}
+	Discard();
+	return finished;
+}
+
+void BackgroundJob::Discard() noexcept {
+	++generation;
+	ReleaseSnapshot();
+	state.store(JobState::Idle, std::memory_order_release);
+}
+
+bool InlineJobExecutor::Submit(BackgroundJob &job) noexcept {
+	job.Start();
+	job.Execute();
+	job.Commit(job.Generation());
+	return true;
+}
+
+void InlineJobExecutor::Cancel(BackgroundJob &job) noexcept {
+	job.Cancel();
+	job.Discard();
+}
@@ -0,0 +1,126 @@
+// Cancellable background job for long-running commands
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+
+// A job copies what it needs from the document (a snapshot) on UI thread, Run()
+// works on the snapshot where the executor decides (worker thread or inline),
+// then Apply() commits the result on UI thread. The job core has no dependency
+// on Windows or Scintilla, ThreadJobExecutor is in ThreadJobExecutor.h.
+
+enum class JobState : uint8_t {
+	Idle,
+	Running,
+	Finished,	// Run() succeeded, waiting for Commit()
+	Failed,
+	Cancelled,
+};
+
+struct JobProgress {
+	uint64_t done;
+	uint64_t total;		// zero when unknown
+	uint32_t phase;		// job specific stage
+};
+
+class CancellationToken {
+public:
+	void Cancel() noexcept {
+		cancelled.store(true, std::memory_order_relaxed);
+	}
+	void Reset() noexcept {
+		cancelled.store(false, std::memory_order_relaxed);
+	}
+	bool IsCancelled() const noexcept {
+		return cancelled.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<bool> cancelled = false;
+};
+
+class BackgroundJob {
+public:
+	BackgroundJob() noexcept = default;
+	BackgroundJob(const BackgroundJob &) = delete;
+	BackgroundJob &operator=(const BackgroundJob &) = delete;
+	virtual ~BackgroundJob();
+
+	// copy text for Run(), the copy is NUL-terminated. returns false on out of memory.
+	bool TakeSnapshot(const char *text, size_t length) noexcept;
+	const char *Text() const noexcept {
+		return snapshot;
+	}
+	size_t Length() const noexcept {
+		return snapshotLength;
+	}
+
+	// called from Run()
+	bool Continue() const noexcept {
+		return !token.IsCancelled();
+	}
+	// compatible with WellFormedContinueProc, param is the job.
+	static bool ContinueProc(void *param) noexcept {
+		return static_cast<const BackgroundJob *>(param)->Continue();
+	}
+	void ReportProgress(uint64_t done, uint64_t total, uint32_t phase = 0) noexcept;
+
+	// called on UI thread, progress is reset when the job starts.
+	JobProgress Progress() const noexcept;
+	JobState State() const noexcept {
+		return state.load(std::memory_order_acquire);
+	}
+	bool Busy() const noexcept {
+		return State() == JobState::Running;
+	}
+	uint32_t Generation() const noexcept {
+		return generation;
+	}
+	// request cancellation, Run() stops at its next Continue() check.
+	void Cancel() noexcept {
+		token.Cancel();
+	}
+
+	// called by executor
+	void Start() noexcept;
+	void Execute() noexcept;
+	// calls Apply() when the job of the generation finished, then releases the snapshot.
+	bool Commit(uint32_t jobGeneration) noexcept;
+	// drop snapshot and result, completion of current generation is ignored.
+	void Discard() noexcept;
+
+protected:
+	// returns false when cancelled or failed.
+	virtual bool Run() noexcept = 0;
+	virtual void Apply() noexcept = 0;
+
+private:
+	CancellationToken token;
+	std::atomic<JobState> state = JobState::Idle;
+	std::atomic<uint64_t> progressDone = 0;
+	std::atomic<uint64_t> progressTotal = 0;
+	std::atomic<uint32_t> progressPhase = 0;
+	char *snapshot = nullptr;
+	size_t snapshotLength = 0;
+	uint32_t generation = 0;
+
+	void ReleaseSnapshot() noexcept;
+};
+
+class JobExecutor {
+public:
+	virtual ~JobExecutor() = default;
+	// returns false when the job is not started.
+	virtual bool Submit(BackgroundJob &job) noexcept = 0;
+	// cancel the job and wait for Run() to return, pending commit is discarded.
+	virtual void Cancel(BackgroundJob &job) noexcept = 0;
+};
+
+// runs and commits the job on calling thread, for small input where starting
+// a thread costs more than the work, and for deterministic execution.
+class InlineJobExecutor final : public JobExecutor {
+public:
+	bool Submit(BackgroundJob &job) noexcept override;
+	void Cancel(BackgroundJob &job) noexcept override;
+};
@@ -0,0 +1,2731 @@
+// gzip and Zstandard compression for loading and saving compressed files
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <iterator>
+#include <new>
+#include "VectorISA.h"
+#include "Compression.h"
+
+namespace {
+
+// all supported targets are little endian
+inline uint16_t LoadLE16(const uint8_t *ptr) noexcept {
+	uint16_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+inline uint32_t LoadLE32(const uint8_t *ptr) noexcept {
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+inline uint64_t LoadLE64(const uint8_t *ptr) noexcept {
+	uint64_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+}
+
+inline void StoreLE32(uint8_t *ptr, uint32_t value) noexcept {
+	memcpy(ptr, &value, sizeof(value));
+}
+
+inline void StoreLE64(uint8_t *ptr, uint64_t value) noexcept {
+	memcpy(ptr, &value, sizeof(value));
+}
+
+inline uint64_t RotateLeft64(uint64_t value, uint32_t count) noexcept {
+	return (value << count) | (value >> (64 - count));
+}
+
+constexpr uint32_t ReverseBits(uint32_t code, uint32_t length) noexcept {
+	uint32_t result = 0;
+	for (uint32_t i = 0; i < length; i++) {
+		result = (result << 1) | (code & 1);
+		code >>= 1;
+	}
+	return result;
+}
+
+constexpr uint32_t gzipMagic = 0x088b1f;		// ID1, ID2, CM = deflate
+constexpr uint32_t zstdMagic = 0xFD2FB528;
+constexpr uint32_t zstdSkippableMagic = 0x184D2A50;	// low 4 bits are user defined
+constexpr size_t compressChunkSize = 1 << 30;	// keeps positions in match finder within 32-bit
+
+enum {
+	GzipFlag_Text = 1,
+	GzipFlag_HeaderCRC = 2,
+	GzipFlag_Extra = 4,
+	GzipFlag_Name = 8,
+	GzipFlag_Comment = 16,
+	GzipFlag_Reserved = 0xe0,
+};
+
+// CRC-32 for gzip, slicing by 8 bytes
+struct CRC32Table {
+	uint32_t table[8][256];
+	constexpr CRC32Table() noexcept : table{} {
+		for (uint32_t i = 0; i < 256; i++) {
+			uint32_t crc = i;
+			for (int k = 0; k < 8; k++) {
+				crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1)));
+			}
+			table[0][i] = crc;
+		}
+		for (uint32_t i = 0; i < 256; i++) {
+			for (int k = 1; k < 8; k++) {
+				table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+			}
+		}
+	}
+};
+
+constexpr CRC32Table crc32Table;
+
+uint32_t UpdateCRC32(uint32_t crc, const uint8_t *data, size_t length) noexcept {
+	const auto &table = crc32Table.table;
+	crc = ~crc;
+	while (length >= 8) {
+		const uint32_t low = LoadLE32(data) ^ crc;
+		const uint32_t high = LoadLE32(data + 4);
+		crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^ table[5][(low >> 16) & 0xff] ^ table[4][low >> 24]
+			^ table[3][high & 0xff] ^ table[2][(high >> 8) & 0xff] ^ table[1][(high >> 16) & 0xff] ^ table[0][high >> 24];
+		data += 8;
+		length -= 8;
+	}
+	while (length != 0) {
+		crc = (crc >> 8) ^ table[0][(crc ^ *data++) & 0xff];
+		--length;
+	}
+	return ~crc;
+}
+
+// XXH64 for Zstandard content checksum
+constexpr uint64_t xxhPrime1 = UINT64_C(0x9E3779B185EBCA87);
+constexpr uint64_t xxhPrime2 = UINT64_C(0xC2B2AE3D27D4EB4F);
+constexpr uint64_t xxhPrime3 = UINT64_C(0x165667B19E3779F9);
+constexpr uint64_t xxhPrime4 = UINT64_C(0x85EBCA77C2B2AE63);
+constexpr uint64_t xxhPrime5 = UINT64_C(0x27D4EB2F165667C5);
+
+inline uint64_t XXH64Round(uint64_t acc, uint64_t input) noexcept {
+	acc += input * xxhPrime2;
+	acc = RotateLeft64(acc, 31);
+	return acc * xxhPrime1;
+}
+
+inline uint64_t XXH64MergeRound(uint64_t acc, uint64_t value) noexcept {
+	acc ^= XXH64Round(0, value);
+	return acc * xxhPrime1 + xxhPrime4;
+}
+
+uint64_t XXH64(const uint8_t *data, size_t length) noexcept {
+	const uint8_t * const end = data + length;
+	uint64_t hash;
+	if (length >= 32) {
+		uint64_t v1 = xxhPrime1 + xxhPrime2;
+		uint64_t v2 = xxhPrime2;
+		uint64_t v3 = 0;
+		uint64_t v4 = 0 - xxhPrime1;
+		const uint8_t * const limit = end - 32;
+		do {
+			v1 = XXH64Round(v1, LoadLE64(data));
+			v2 = XXH64Round(v2, LoadLE64(data + 8));
+			v3 = XXH64Round(v3, LoadLE64(data + 16));
+			v4 = XXH64Round(v4, LoadLE64(data + 24));
+			data += 32;
+		} while (data <= limit);
+		hash = RotateLeft64(v1, 1) + RotateLeft64(v2, 7) + RotateLeft64(v3, 12) + RotateLeft64(v4, 18);
+		hash = XXH64MergeRound(hash, v1);
+		hash = XXH64MergeRound(hash, v2);
+		hash = XXH64MergeRound(hash, v3);
+		hash = XXH64MergeRound(hash, v4);
+	} else {
+		hash = xxhPrime5;
+	}
+	hash += length;
+	while (end - data >= 8) {
+		hash ^= XXH64Round(0, LoadLE64(data));
+		hash = RotateLeft64(hash, 27) * xxhPrime1 + xxhPrime4;
+		data += 8;
+	}
+	if (end - data >= 4) {
+		hash ^= LoadLE32(data) * xxhPrime1;
+		hash = RotateLeft64(hash, 23) * xxhPrime2 + xxhPrime3;
+		data += 4;
+	}
+	while (data < end) {
+		hash ^= *data++ * xxhPrime5;
+		hash = RotateLeft64(hash, 11) * xxhPrime1;
+	}
+	hash ^= hash >> 33;
+	hash *= xxhPrime2;
+	hash ^= hash >> 29;
+	hash *= xxhPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+// copies match from already decoded output, source and destination may overlap.
+inline void CopyMatch(uint8_t *dst, size_t distance, size_t length) noexcept {
+	const uint8_t *src = dst - distance;
+	if (distance >= length) {
+		memcpy(dst, src, length);
+	} else if (distance == 1) {
+		memset(dst, *src, length);
+	} else {
+		while (length != 0) {
+			const size_t count = (distance < length) ? distance : length;
+			memcpy(dst, dst - distance, count);
+			dst += count;
+			length -= count;
+		}
+	}
+}
+
+// decoded content for whole input (growable) or for one segment (fixed size).
+struct OutputBuffer {
+	uint8_t *data;
+	size_t length;
+	size_t capacity;
+	size_t maxSize;
+	size_t padding;
+	CompressionReallocProc reallocProc;	// nullptr for fixed size segment
+	DecompressStatus error;
+
+	bool Reserve(size_t count) noexcept {
+		return count <= capacity - length || Grow(count);
+	}
+	bool Grow(size_t count) noexcept {
+		if (reallocProc == nullptr) {
+			// more content than recorded size
+			error = DecompressStatus::Corrupt;
+			return false;
+		}
+		if (count > maxSize - length) {
+			error = DecompressStatus::TooLarge;
+			return false;
+		}
+		const size_t required = length + count;
+		size_t size = capacity + capacity/2;
+		if (size < required) {
+			size = (required < 64*1024) ? 64*1024 : required;
+		}
+		if (size > maxSize) {
+			size = maxSize;
+		}
+		void *block = reallocProc(data, size + padding);
+		if (block == nullptr) {
+			error = DecompressStatus::OutOfMemory;
+			return false;
+		}
+		data = static_cast<uint8_t *>(block);
+		capacity = size;
+		return true;
+	}
+};
+
+//------------------------------------------------------------------------------
+// DEFLATE, RFC 1951
+
+constexpr uint16_t lengthBase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+constexpr uint8_t lengthExtra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+constexpr uint16_t distanceBase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+};
+constexpr uint8_t distanceExtra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+constexpr uint8_t codeLengthOrder[19] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+};
+
+constexpr uint32_t deflateMaxBits = 15;
+constexpr uint32_t deflateWindowSize = 32*1024;
+constexpr uint32_t deflateMaxMatch = 258;
+constexpr uint32_t litlenSymbolCount = 288;
+constexpr uint32_t distanceSymbolCount = 32;
+constexpr uint32_t codeLengthSymbolCount = 19;
+
+// Huffman decoding table entry: symbol << 16 | code length.
+// Codes longer than table bits use a subtable: offset << 16 | huffmanSubtable | subtable bits.
+constexpr uint32_t huffmanSubtable = 0x8000;
+constexpr uint32_t litlenTableBits = 10;
+constexpr uint32_t distanceTableBits = 8;
+constexpr uint32_t codeLengthTableBits = 7;
+// main table, plus at most one subtable of 2^(15 - table bits) entries for each symbol
+constexpr size_t litlenTableSize = (1 << litlenTableBits) + litlenSymbolCount*(1 << (deflateMaxBits - litlenTableBits));
+constexpr size_t distanceTableSize = (1 << distanceTableBits) + distanceSymbolCount*(1 << (deflateMaxBits - distanceTableBits));
+
+// builds decoding table for canonical Huffman code, incomplete code is allowed, lookup
+// for missing code returns zero entry.
+bool BuildDecodeTable(uint32_t *table, size_t capacity, uint32_t tableBits, const uint8_t *lengths, uint32_t count) noexcept {
+	uint32_t lengthCount[deflateMaxBits + 1]{};
+	for (uint32_t symbol = 0; symbol < count; symbol++) {
+		lengthCount[lengths[symbol]]++;
+	}
+	lengthCount[0] = 0;
+	uint32_t maxLength = deflateMaxBits;
+	while (maxLength != 0 && lengthCount[maxLength] == 0) {
+		--maxLength;
+	}
+
+	const uint32_t mainSize = 1U << tableBits;
+	memset(table, 0, mainSize*sizeof(uint32_t));
+	if (maxLength == 0) {
+		return true;
+	}
+
+	// reject over-subscribed code
+	int32_t left = 1;
+	for (uint32_t length = 1; length <= deflateMaxBits; length++) {
+		left = 2*left - static_cast<int32_t>(lengthCount[length]);
+		if (left < 0) {
+			return false;
+		}
+	}
+
+	uint32_t offsets[deflateMaxBits + 1];
+	offsets[1] = 0;
+	for (uint32_t length = 1; length < deflateMaxBits; length++) {
+		offsets[length + 1] = offsets[length] + lengthCount[length];
+	}
+	uint16_t sorted[litlenSymbolCount];
+	for (uint32_t symbol = 0; symbol < count; symbol++) {
+		if (lengths[symbol] != 0) {
+			sorted[offsets[lengths[symbol]]++] = static_cast<uint16_t>(symbol);
+		}
+	}
+
+	uint32_t remaining[deflateMaxBits + 1];
+	memcpy(remaining, lengthCount, sizeof(remaining));
+	const uint32_t mask = mainSize - 1;
+	size_t next = mainSize;
+	size_t subtable = 0;
+	uint32_t subtableBits = 0;
+	uint32_t currentLow = UINT32_MAX;
+	uint32_t code = 0;
+	uint32_t index = 0;
+	for (uint32_t length = 1; length <= maxLength; length++) {
+		for (uint32_t k = 0; k < lengthCount[length]; k++, code++) {
+			const uint32_t entry = (static_cast<uint32_t>(sorted[index++]) << 16) | length;
+			const uint32_t reversed = ReverseBits(code, length);
+			if (length <= tableBits) {
+				for (uint32_t i = reversed; i <= mask; i += 1U << length) {
+					table[i] = entry;
+				}
+			} else {
+				const uint32_t low = reversed & mask;
+				if (low != currentLow) {
+					// size subtable to hold all remaining codes sharing the prefix
+					currentLow = low;
+					subtableBits = length - tableBits;
+					int32_t available = 1 << subtableBits;
+					while (subtableBits + tableBits < maxLength) {
+						available -= static_cast<int32_t>(remaining[subtableBits + tableBits]);
+						if (available <= 0) {
+							break;
+						}
+						++subtableBits;
+						available <<= 1;
+					}
+					subtable = next;
+					next += static_cast<size_t>(1) << subtableBits;
+					if (next > capacity) {
+						return false;
+					}
+					memset(table + subtable, 0, (static_cast<size_t>(1) << subtableBits)*sizeof(uint32_t));
+					table[low] = static_cast<uint32_t>(subtable << 16) | huffmanSubtable | subtableBits;
+				}
+				for (uint32_t i = reversed >> tableBits; i < (1U << subtableBits); i += 1U << (length - tableBits)) {
+					table[subtable + i] = entry;
+				}
+			}
+			remaining[length]--;
+		}
+		code <<= 1;
+	}
+	return true;
+}
+
+class Inflater {
+public:
+	void Init() noexcept {
+		fixedTables = false;
+	}
+	// decodes one gzip member, returns member size in consumed.
+	DecompressStatus InflateGzipMember(const uint8_t *src, size_t length, size_t &consumed, OutputBuffer &out) noexcept;
+
+private:
+	const uint8_t *in;
+	const uint8_t *inEnd;
+	uint64_t bitBuffer;
+	uint32_t bitCount;
+	uint32_t overrun;		// zero bytes appended after end of input
+	bool fixedTables;
+	uint32_t litlenTable[litlenTableSize];
+	uint32_t distanceTable[distanceTableSize];
+
+	// ensures at least 56 bits in bit buffer. bits above bitCount are either zero or
+	// following input bytes, so or-ing same byte again is harmless.
+	void Refill() noexcept {
+		if (inEnd - in >= 8) {
+			bitBuffer |= LoadLE64(in) << bitCount;
+			in += (63 - bitCount) >> 3;
+			bitCount |= 56;
+		} else {
+			while (bitCount <= 56) {
+				uint64_t byte = 0;
+				if (in < inEnd) {
+					byte = *in++;
+				} else {
+					++overrun;
+				}
+				bitBuffer |= byte << bitCount;
+				bitCount += 8;
+			}
+		}
+	}
+	uint32_t Bits(uint32_t count) noexcept {
+		const uint32_t value = static_cast<uint32_t>(bitBuffer & ((UINT64_C(1) << count) - 1));
+		bitBuffer >>= count;
+		bitCount -= count;
+		return value;
+	}
+	// discards remaining bits of current byte, returns input position or nullptr when
+	// bytes after end of input were consumed.
+	const uint8_t *AlignToByte() noexcept {
+		const uint32_t bytes = bitCount >> 3;
+		if (bytes < overrun) {
+			return nullptr;
+		}
+		in -= bytes - overrun;
+		bitBuffer = 0;
+		bitCount = 0;
+		overrun = 0;
+		return in;
+	}
+	DecompressStatus Inflate(const uint8_t *src, size_t length, size_t &consumed, OutputBuffer &out) noexcept;
+	DecompressStatus ReadDynamicTables() noexcept;
+	DecompressStatus DecodeBlock(OutputBuffer &out, size_t start) noexcept;
+};
+
+DecompressStatus Inflater::ReadDynamicTables() noexcept {
+	Refill();
+	const uint32_t litlenCount = Bits(5) + 257;
+	const uint32_t distanceCount = Bits(5) + 1;
+	const uint32_t codeLengthCount = Bits(4) + 4;
+	if (litlenCount > 286 || distanceCount > 30) {
+		return DecompressStatus::Corrupt;
+	}
+
+	uint8_t codeLengths[codeLengthSymbolCount]{};
+	for (uint32_t i = 0; i < codeLengthCount; i++) {
+		Refill();
+		codeLengths[codeLengthOrder[i]] = static_cast<uint8_t>(Bits(3));
+	}
+	uint32_t codeLengthTable[1 << codeLengthTableBits];
+	if (!BuildDecodeTable(codeLengthTable, std::size(codeLengthTable), codeLengthTableBits, codeLengths, codeLengthSymbolCount)) {
+		return DecompressStatus::Corrupt;
+	}
+
+	uint8_t lengths[286 + 30];
+	const uint32_t total = litlenCount + distanceCount;
+	for (uint32_t i = 0; i < total;) {
+		Refill();
+		if (overrun > 8) {
+			return DecompressStatus::Corrupt;
+		}
+		const uint32_t entry = codeLengthTable[bitBuffer & ((1 << codeLengthTableBits) - 1)];
+		const uint32_t length = entry & 0xff;
+		if (length == 0) {
+			return DecompressStatus::Corrupt;
+		}
+		Bits(length);
+		const uint32_t symbol = entry >> 16;
+		if (symbol < 16) {
+			lengths[i++] = static_cast<uint8_t>(symbol);
+			continue;
+		}
+		uint32_t repeat;
+		uint8_t value = 0;
+		if (symbol == 16) {
+			if (i == 0) {
+				return DecompressStatus::Corrupt;
+			}
+			value = lengths[i - 1];
+			repeat = 3 + Bits(2);
+		} else if (symbol == 17) {
+			repeat = 3 + Bits(3);
+		} else {
+			repeat = 11 + Bits(7);
+		}
+		if (repeat > total - i) {
+			return DecompressStatus::Corrupt;
+		}
+		memset(lengths + i, value, repeat);
+		i += repeat;
+	}
+	if (lengths[256] == 0
+		|| !BuildDecodeTable(litlenTable, litlenTableSize, litlenTableBits, lengths, litlenCount)
+		|| !BuildDecodeTable(distanceTable, distanceTableSize, distanceTableBits, lengths + litlenCount, distanceCount)) {
+		return DecompressStatus::Corrupt;
+	}
+	fixedTables = false;
+	return DecompressStatus::Ok;
+}
+
+DecompressStatus Inflater::DecodeBlock(OutputBuffer &out, size_t start) noexcept {
+	constexpr uint32_t litlenMask = (1 << litlenTableBits) - 1;
+	constexpr uint32_t distanceMask = (1 << distanceTableBits) - 1;
+	while (true) {
+		// litlen code, length extra bits, distance code and distance extra bits
+		// take at most 15 + 5 + 15 + 13 = 48 bits.
+		Refill();
+		if (overrun > 8) {
+			return DecompressStatus::Corrupt;
+		}
+		uint32_t entry = litlenTable[bitBuffer & litlenMask];
+		if (entry & huffmanSubtable) {
+			entry = litlenTable[(entry >> 16) + ((bitBuffer >> litlenTableBits) & ((1U << (entry & 0xff)) - 1))];
+		}
+		uint32_t length = entry & 0xff;
+		if (length == 0) {
+			return DecompressStatus::Corrupt;
+		}
+		Bits(length);
+		uint32_t symbol = entry >> 16;
+		if (symbol < 256) {
+			if (out.length == out.capacity && !out.Grow(1)) {
+				return out.error;
+			}
+			out.data[out.length++] = static_cast<uint8_t>(symbol);
+			continue;
+		}
+		if (symbol == 256) {
+			return DecompressStatus::Ok;
+		}
+		symbol -= 257;
+		if (symbol >= 29) {
+			return DecompressStatus::Corrupt;
+		}
+		const uint32_t matchLength = lengthBase[symbol] + Bits(lengthExtra[symbol]);
+
+		entry = distanceTable[bitBuffer & distanceMask];
+		if (entry & huffmanSubtable) {
+			entry = distanceTable[(entry >> 16) + ((bitBuffer >> distanceTableBits) & ((1U << (entry & 0xff)) - 1))];
+		}
+		length = entry & 0xff;
+		if (length == 0) {
+			return DecompressStatus::Corrupt;
+		}
+		Bits(length);
+		symbol = entry >> 16;
+		if (symbol >= 30) {
+			return DecompressStatus::Corrupt;
+		}
+		const uint32_t distance = distanceBase[symbol] + Bits(distanceExtra[symbol]);
+		if (distance > out.length - start) {
+			return DecompressStatus::Corrupt;
+		}
+		if (!out.Reserve(matchLength)) {
+			return out.error;
+		}
+		CopyMatch(out.data + out.length, distance, matchLength);
+		out.length += matchLength;
+	}
+}
+
+DecompressStatus Inflater::Inflate(const uint8_t *src, size_t length, size_t &consumed, OutputBuffer &out) noexcept {
+	in = src;
+	inEnd = src + length;
+	bitBuffer = 0;
+	bitCount = 0;
+	overrun = 0;
+	const size_t start = out.length;
+	bool final;
+	do {
+		Refill();
+		final = Bits(1) != 0;
+		const uint32_t type = Bits(2);
+		DecompressStatus result = DecompressStatus::Ok;
+		if (type == 0) {
+			// stored block
+			const uint8_t *ptr = AlignToByte();
+			if (ptr == nullptr || inEnd - ptr < 4) {
+				return DecompressStatus::Corrupt;
+			}
+			const uint32_t size = LoadLE16(ptr);
+			if (size != (~LoadLE16(ptr + 2) & 0xffffU) || static_cast<size_t>(inEnd - ptr - 4) < size) {
+				return DecompressStatus::Corrupt;
+			}
+			if (!out.Reserve(size)) {
+				return out.error;
+			}
+			memcpy(out.data + out.length, ptr + 4, size);
+			out.length += size;
+			in = ptr + 4 + size;
+			continue;
+		}
+		if (type == 1) {
+			if (!fixedTables) {
+				uint8_t lengths[litlenSymbolCount + distanceSymbolCount];
+				memset(lengths, 8, 144);
+				memset(lengths + 144, 9, 256 - 144);
+				memset(lengths + 256, 7, 280 - 256);
+				memset(lengths + 280, 8, litlenSymbolCount - 280);
+				memset(lengths + litlenSymbolCount, 5, distanceSymbolCount);
+				BuildDecodeTable(litlenTable, litlenTableSize, litlenTableBits, lengths, litlenSymbolCount);
+				BuildDecodeTable(distanceTable, distanceTableSize, distanceTableBits, lengths + litlenSymbolCount, distanceSymbolCount);
+				fixedTables = true;
+			}
+		} else if (type == 2) {
+			result = ReadDynamicTables();
+		} else {
+			result = DecompressStatus::Corrupt;
+		}
+		if (result == DecompressStatus::Ok) {
+			result = DecodeBlock(out, start);
+		}
+		if (result != DecompressStatus::Ok) {
+			return result;
+		}
+	} while (!final);
+
+	const uint8_t *end = AlignToByte();
+	if (end == nullptr) {
+		return DecompressStatus::Corrupt;
+	}
+	consumed = end - src;
+	return DecompressStatus::Ok;
+}
+
+// returns header size of gzip member, or zero when header is invalid.
+size_t GzipHeaderSize(const uint8_t *data, size_t length) noexcept {
+	// header, at least 2 bytes compressed data and 8 bytes trailer
+	if (length < 20 || (LoadLE32(data) & 0xffffff) != gzipMagic) {
+		return 0;
+	}
+	const uint8_t flags = data[3];
+	if (flags & GzipFlag_Reserved) {
+		return 0;
+	}
+	size_t pos = 10;
+	if (flags & GzipFlag_Extra) {
+		pos += 2 + LoadLE16(data + pos);
+	}
+	if (flags & GzipFlag_Name) {
+		if (pos >= length) {
+			return 0;
+		}
+		const void *end = memchr(data + pos, 0, length - pos);
+		if (end == nullptr) {
+			return 0;
+		}
+		pos = static_cast<const uint8_t *>(end) - data + 1;
+	}
+	if (flags & GzipFlag_Comment) {
+		if (pos >= length) {
+			return 0;
+		}
+		const void *end = memchr(data + pos, 0, length - pos);
+		if (end == nullptr) {
+			return 0;
+		}
+		pos = static_cast<const uint8_t *>(end) - data + 1;
+	}
+	if (flags & GzipFlag_HeaderCRC) {
+		pos += 2;
+	}
+	return (pos < length && length - pos >= 10) ? pos : 0;
+}
+
+// BGZF (blocked gzip used by bgzip, samtools and tabix) records member size in
+// "BC" extra subfield, returns zero for other gzip member.
+size_t BgzfMemberSize(const uint8_t *data, size_t length) noexcept {
+	if (length < 28 || (LoadLE32(data) & 0xffffff) != gzipMagic || (data[3] & GzipFlag_Extra) == 0) {
+		return 0;
+	}
+	const size_t end = 12 + LoadLE16(data + 10);
+	if (end > length) {
+		return 0;
+	}
+	size_t pos = 12;
+	while (pos + 4 <= end) {
+		const size_t size = LoadLE16(data + pos + 2);
+		if (data[pos] == 'B' && data[pos + 1] == 'C' && size == 2 && pos + 6 <= end) {
+			return LoadLE16(data + pos + 4) + 1;
+		}
+		pos += 4 + size;
+	}
+	return 0;
+}
+
+DecompressStatus Inflater::InflateGzipMember(const uint8_t *src, size_t length, size_t &consumed, OutputBuffer &out) noexcept {
+	const size_t header = GzipHeaderSize(src, length);
+	if (header == 0) {
+		return DecompressStatus::Corrupt;
+	}
+	const size_t start = out.length;
+	size_t size = 0;
+	const DecompressStatus result = Inflate(src + header, length - header, size, out);
+	if (result != DecompressStatus::Ok) {
+		return result;
+	}
+	const size_t trailer = header + size;
+	if (length - trailer < 8) {
+		return DecompressStatus::Corrupt;
+	}
+	size = out.length - start;
+	if (LoadLE32(src + trailer + 4) != static_cast<uint32_t>(size)
+		|| LoadLE32(src + trailer) != UpdateCRC32(0, out.data + start, size)) {
+		return DecompressStatus::Corrupt;
+	}
+	consumed = trailer + 8;
+	return DecompressStatus::Ok;
+}
+
+//------------------------------------------------------------------------------
+// Zstandard, RFC 8878
+
+constexpr uint32_t zstdBlockSizeMax = 128*1024;
+constexpr uint32_t huffmanMaxBits = 11;
+constexpr uint32_t huffmanWeightMaxLog = 6;
+constexpr uint32_t huffmanWeightMaxSymbol = 12;
+constexpr uint32_t literalLengthMaxLog = 9;
+constexpr uint32_t matchLengthMaxLog = 9;
+constexpr uint32_t offsetMaxLog = 8;
+constexpr uint32_t literalLengthMaxSymbol = 35;
+constexpr uint32_t matchLengthMaxSymbol = 52;
+constexpr uint32_t offsetMaxSymbol = 31;
+constexpr uint32_t literalLengthDefaultLog = 6;
+constexpr uint32_t matchLengthDefaultLog = 6;
+constexpr uint32_t offsetDefaultLog = 5;
+constexpr uint64_t zstdUnknownSize = UINT64_MAX;
+
+constexpr uint32_t literalLengthBase[36] = {
+	0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+	16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096,
+	8192, 16384, 32768, 65536,
+};
+constexpr uint8_t literalLengthBits[36] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12,
+	13, 14, 15, 16,
+};
+constexpr uint32_t matchLengthBase[53] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+	19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34,
+	35, 37, 39, 41, 43, 47, 51, 59, 67, 83, 99, 131, 259, 515, 1027, 2051,
+	4099, 8195, 16387, 32771, 65539,
+};
+constexpr uint8_t matchLengthBits[53] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	1, 1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 7, 8, 9, 10, 11,
+	12, 13, 14, 15, 16,
+};
+// predefined distributions, -1 means probability less than one
+constexpr int16_t literalLengthDefaultNorm[36] = {
+	4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1,
+	-1, -1, -1, -1,
+};
+constexpr int16_t matchLengthDefaultNorm[53] = {
+	1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, -1, -1,
+	-1, -1, -1, -1, -1,
+};
+constexpr int16_t offsetDefaultNorm[29] = {
+	1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+	1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1,
+};
+
+struct FSEDecodeEntry {
+	uint16_t baseline;
+	uint8_t symbol;
+	uint8_t bits;
+};
+
+// reads little endian bits from first byte, bytes after end are read as zero.
+class ForwardBitReader {
+	const uint8_t *data;
+	size_t length;
+	size_t position = 0;
+public:
+	ForwardBitReader(const uint8_t *data_, size_t length_) noexcept : data{data_}, length{length_} {}
+	uint32_t Peek(uint32_t count) const noexcept {
+		const size_t index = position >> 3;
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < 4 && index + i < length; i++) {
+			value |= static_cast<uint32_t>(data[index + i]) << (8*i);
+		}
+		return (value >> (position & 7)) & ((1U << count) - 1);
+	}
+	void Skip(uint32_t count) noexcept {
+		position += count;
+	}
+	uint32_t Read(uint32_t count) noexcept {
+		const uint32_t value = Peek(count);
+		position += count;
+		return value;
+	}
+	size_t Bytes() const noexcept {
+		return (position + 7) >> 3;
+	}
+};
+
+// reads bitstream backward from the highest bit below the end mark in last byte.
+// bits before start of stream are read as zero.
+class BackwardBitReader {
+	const uint8_t *data;
+	const uint8_t *limit;	// end of readable memory, at least end of stream
+	ptrdiff_t position;
+public:
+	bool Init(const uint8_t *src, size_t size, const uint8_t *limit_) noexcept {
+		if (size == 0 || src[size - 1] == 0) {
+			return false;
+		}
+		data = src;
+		limit = limit_;
+		position = static_cast<ptrdiff_t>((size - 1)*8 + np2_bsr(src[size - 1]));
+		return true;
+	}
+	uint32_t Extract(ptrdiff_t pos, uint32_t count) const noexcept {
+		if (pos < 0) {
+			const ptrdiff_t high = pos + count;
+			if (high <= 0) {
+				return 0;
+			}
+			return Extract(0, static_cast<uint32_t>(high)) << (-pos);
+		}
+		const uint8_t *ptr = data + (pos >> 3);
+		uint64_t value = 0;
+		if (limit - ptr >= 8) {
+			value = LoadLE64(ptr);
+		} else {
+			memcpy(&value, ptr, limit - ptr);
+		}
+		return static_cast<uint32_t>((value >> (pos & 7)) & ((UINT64_C(1) << count) - 1));
+	}
+	uint32_t Peek(uint32_t count) const noexcept {
+		return Extract(position - count, count);
+	}
+	void Consume(uint32_t count) noexcept {
+		position -= count;
+	}
+	uint32_t Read(uint32_t count) noexcept {
+		position -= count;
+		return Extract(position, count);
+	}
+	bool Overflowed() const noexcept {
+		return position < 0;
+	}
+	bool Finished() const noexcept {
+		return position == 0;
+	}
+};
+
+// reads FSE table description, returns bytes consumed or zero when invalid.
+size_t ReadFSEDistribution(const uint8_t *src, size_t length, int16_t *norm, uint32_t maxSymbol, uint32_t maxLog, uint32_t &accuracyLog, uint32_t &symbolCount) noexcept {
+	if (length == 0) {
+		return 0;
+	}
+	ForwardBitReader reader{src, length};
+	const uint32_t log = reader.Read(4) + 5;
+	if (log > maxLog) {
+		return 0;
+	}
+	int32_t remaining = (1 << log) + 1;
+	int32_t threshold = 1 << log;
+	uint32_t bits = log + 1;
+	uint32_t symbol = 0;
+	bool previousZero = false;
+	while (remaining > 1 && symbol <= maxSymbol) {
+		if (previousZero) {
+			uint32_t repeat;
+			do {
+				repeat = reader.Read(2);
+				for (uint32_t i = 0; i < repeat; i++) {
+					if (symbol > maxSymbol) {
+						return 0;
+					}
+					norm[symbol++] = 0;
+				}
+			} while (repeat == 3);
+			if (symbol > maxSymbol) {
+				return 0;
+			}
+		}
+		const int32_t max = 2*threshold - 1 - remaining;
+		const uint32_t value = reader.Peek(bits);
+		int32_t count;
+		if (static_cast<int32_t>(value & (threshold - 1)) < max) {
+			count = value & (threshold - 1);
+			reader.Skip(bits - 1);
+		} else {
+			count = value & (2*threshold - 1);
+			if (count >= threshold) {
+				count -= max;
+			}
+			reader.Skip(bits);
+		}
+		--count;
+		remaining -= (count < 0) ? -count : count;
+		norm[symbol++] = static_cast<int16_t>(count);
+		previousZero = count == 0;
+		if (remaining < 1) {
+			return 0;
+		}
+		while (remaining < threshold) {
+			--bits;
+			threshold >>= 1;
+		}
+	}
+	if (remaining != 1 || reader.Bytes() > length) {
+		return 0;
+	}
+	accuracyLog = log;
+	symbolCount = symbol;
+	return reader.Bytes();
+}
+
+constexpr uint32_t FSESpreadStep(uint32_t tableSize) noexcept {
+	return (tableSize >> 1) + (tableSize >> 3) + 3;
+}
+
+bool BuildFSEDecodeTable(FSEDecodeEntry *table, const int16_t *norm, uint32_t symbolCount, uint32_t log) noexcept {
+	const uint32_t tableSize = 1U << log;
+	const uint32_t mask = tableSize - 1;
+	uint32_t high = tableSize - 1;
+	uint16_t next[matchLengthMaxSymbol + 1];
+	for (uint32_t symbol = 0; symbol < symbolCount; symbol++) {
+		if (norm[symbol] == -1) {
+			table[high--].symbol = static_cast<uint8_t>(symbol);
+			next[symbol] = 1;
+		} else {
+			next[symbol] = static_cast<uint16_t>(norm[symbol]);
+		}
+	}
+	const uint32_t step = FSESpreadStep(tableSize);
+	uint32_t position = 0;
+	for (uint32_t symbol = 0; symbol < symbolCount; symbol++) {
+		for (int32_t i = 0; i < norm[symbol]; i++) {
+			table[position].symbol = static_cast<uint8_t>(symbol);
+			do {
+				position = (position + step) & mask;
+			} while (position > high);
+		}
+	}
+	if (position != 0) {
+		return false;
+	}
+	for (uint32_t i = 0; i < tableSize; i++) {
+		FSEDecodeEntry &entry = table[i];
+		const uint32_t state = next[entry.symbol]++;
+		const uint32_t bits = log - np2_bsr(state);
+		entry.bits = static_cast<uint8_t>(bits);
+		entry.baseline = static_cast<uint16_t>((state << bits) - tableSize);
+	}
+	return true;
+}
+
+struct ZstdFrameHeader {
+	size_t headerSize;
+	uint64_t contentSize;
+	bool checksum;
+};
+
+DecompressStatus ParseZstdFrameHeader(const uint8_t *src, size_t length, ZstdFrameHeader &header) noexcept {
+	if (length < 5 || LoadLE32(src) != zstdMagic) {
+		return DecompressStatus::Corrupt;
+	}
+	const uint8_t descriptor = src[4];
+	if (descriptor & 0x08) {
+		// reserved bit
+		return DecompressStatus::Corrupt;
+	}
+	const bool singleSegment = (descriptor & 0x20) != 0;
+	constexpr uint8_t dictionaryIdSize[4] = {0, 1, 2, 4};
+	constexpr uint8_t contentSizeSize[4] = {0, 2, 4, 8};
+	const uint32_t dictionarySize = dictionaryIdSize[descriptor & 3];
+	uint32_t fieldSize = contentSizeSize[descriptor >> 6];
+	if (fieldSize == 0 && singleSegment) {
+		fieldSize = 1;
+	}
+	size_t pos = singleSegment ? 5 : 6;	// window descriptor
+	if (length < pos + dictionarySize + fieldSize) {
+		return DecompressStatus::Corrupt;
+	}
+	uint32_t dictionaryId = 0;
+	for (uint32_t i = 0; i < dictionarySize; i++) {
+		dictionaryId |= static_cast<uint32_t>(src[pos + i]) << (8*i);
+	}
+	if (dictionaryId != 0) {
+		return DecompressStatus::Unsupported;
+	}
+	pos += dictionarySize;
+	switch (fieldSize) {
+	case 1:
+		header.contentSize = src[pos];
+		break;
+	case 2:
+		header.contentSize = LoadLE16(src + pos) + 256;
+		break;
+	case 4:
+		header.contentSize = LoadLE32(src + pos);
+		break;
+	case 8:
+		header.contentSize = LoadLE64(src + pos);
+		break;
+	default:
+		header.contentSize = zstdUnknownSize;
+		break;
+	}
+	header.headerSize = pos + fieldSize;
+	header.checksum = (descriptor & 0x04) != 0;
+	return DecompressStatus::Ok;
+}
+
+// walks block headers, returns frame size or zero when frame is truncated.
+size_t ZstdFrameSize(const uint8_t *src, size_t length, const ZstdFrameHeader &header) noexcept {
+	size_t pos = header.headerSize;
+	while (true) {
+		if (length - pos < 3) {
+			return 0;
+		}
+		const uint32_t blockHeader = src[pos] | (src[pos + 1] << 8) | (src[pos + 2] << 16);
+		const uint32_t type = (blockHeader >> 1) & 3;
+		if (type == 3) {
+			return 0;
+		}
+		const size_t size = (type == 1) ? 1 : (blockHeader >> 3);
+		pos += 3;
+		if (length - pos < size) {
+			return 0;
+		}
+		pos += size;
+		if (blockHeader & 1) {
+			break;
+		}
+	}
+	if (header.checksum) {
+		if (length - pos < 4) {
+			return 0;
+		}
+		pos += 4;
+	}
+	return pos;
+}
+
+class ZstdDecoder {
+public:
+	void Init() noexcept;
+	// decodes one frame or skips one skippable frame, returns frame size in consumed.
+	DecompressStatus DecodeFrame(const uint8_t *src, size_t length, size_t &consumed, OutputBuffer &out) noexcept;
+
+private:
+	const uint8_t *inputEnd;
+	const FSEDecodeEntry *literalLengthCurrent;
+	const FSEDecodeEntry *offsetCurrent;
+	const FSEDecodeEntry *matchLengthCurrent;
+	uint32_t literalLengthLog;
+	uint32_t offsetLog;
+	uint32_t matchLengthLog;
+	uint32_t huffmanBits;	// zero when no previous Huffman table
+	size_t repeatOffsets[3];
+	FSEDecodeEntry literalLengthTable[1 << literalLengthMaxLog];
+	FSEDecodeEntry offsetTable[1 << offsetMaxLog];
+	FSEDecodeEntry matchLengthTable[1 << matchLengthMaxLog];
+	FSEDecodeEntry literalLengthDefault[1 << literalLengthDefaultLog];
+	FSEDecodeEntry offsetDefault[1 << offsetDefaultLog];
+	FSEDecodeEntry matchLengthDefault[1 << matchLengthDefaultLog];
+	uint16_t huffmanTable[1 << huffmanMaxBits];	// symbol << 8 | code length
+	uint8_t literals[zstdBlockSizeMax];
+
+	uint32_t DecodeHuffmanWeights(const uint8_t *src, size_t length, uint8_t *weights) const noexcept;
+	size_t ReadHuffmanTable(const uint8_t *src, size_t length) noexcept;
+	bool DecodeHuffmanStream(const uint8_t *src, size_t length, uint8_t *dst, size_t count) const noexcept;
+	bool DecodeLiterals(const uint8_t *src, size_t length, size_t count, bool singleStream) noexcept;
+	bool ReadSequenceTable(uint32_t mode, const uint8_t *src, size_t length, size_t &pos, FSEDecodeEntry *table,
+		const FSEDecodeEntry *defaultTable, uint32_t defaultLog, uint32_t maxSymbol, uint32_t maxLog,
+		const FSEDecodeEntry *&current, uint32_t &currentLog) noexcept;
+	DecompressStatus DecodeSequences(const uint8_t *src, size_t length, const uint8_t *lit, size_t litSize, OutputBuffer &out, size_t frameStart) noexcept;
+	DecompressStatus DecodeBlock(const uint8_t *src, size_t length, OutputBuffer &out, size_t frameStart) noexcept;
+};
+
+void ZstdDecoder::Init() noexcept {
+	BuildFSEDecodeTable(literalLengthDefault, literalLengthDefaultNorm, std::size(literalLengthDefaultNorm), literalLengthDefaultLog);
+	BuildFSEDecodeTable(offsetDefault, offsetDefaultNorm, std::size(offsetDefaultNorm), offsetDefaultLog);
+	BuildFSEDecodeTable(matchLengthDefault, matchLengthDefaultNorm, std::size(matchLengthDefaultNorm), matchLengthDefaultLog);
+}
+
+// FSE compressed Huffman weights use two interleaved states, returns weight count.
+uint32_t ZstdDecoder::DecodeHuffmanWeights(const uint8_t *src, size_t length, uint8_t *weights) const noexcept {
+	int16_t norm[huffmanWeightMaxSymbol + 1];
+	uint32_t log;
+	uint32_t symbolCount;
+	const size_t used = ReadFSEDistribution(src, length, norm, huffmanWeightMaxSymbol, huffmanWeightMaxLog, log, symbolCount);
+	FSEDecodeEntry table[1 << huffmanWeightMaxLog];
+	BackwardBitReader reader;
+	if (used == 0 || !BuildFSEDecodeTable(table, norm, symbolCount, log) || !reader.Init(src + used, length - used, inputEnd)) {
+		return 0;
+	}
+	uint32_t state1 = reader.Read(log);
+	uint32_t state2 = reader.Read(log);
+	uint32_t count = 0;
+	while (true) {
+		if (count > 253) {
+			return 0;
+		}
+		weights[count++] = table[state1].symbol;
+		state1 = table[state1].baseline + reader.Read(table[state1].bits);
+		if (reader.Overflowed()) {
+			weights[count++] = table[state2].symbol;
+			break;
+		}
+		weights[count++] = table[state2].symbol;
+		state2 = table[state2].baseline + reader.Read(table[state2].bits);
+		if (reader.Overflowed()) {
+			weights[count++] = table[state1].symbol;
+			break;
+		}
+	}
+	return count;
+}
+
+size_t ZstdDecoder::ReadHuffmanTable(const uint8_t *src, size_t length) noexcept {
+	if (length == 0) {
+		return 0;
+	}
+	uint8_t weights[256];
+	uint32_t count;
+	size_t used;
+	const uint32_t header = src[0];
+	if (header >= 128) {
+		count = header - 127;
+		used = 1 + (count + 1)/2;
+		if (used > length) {
+			return 0;
+		}
+		for (uint32_t i = 0; i < count; i++) {
+			const uint8_t value = src[1 + i/2];
+			weights[i] = (i & 1) ? (value & 15) : (value >> 4);
+		}
+	} else {
+		used = 1 + header;
+		if (header == 0 || used > length) {
+			return 0;
+		}
+		count = DecodeHuffmanWeights(src + 1, header, weights);
+		if (count == 0) {
+			return 0;
+		}
+	}
+
+	uint32_t rankCount[huffmanMaxBits + 1]{};
+	uint32_t total = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		const uint32_t weight = weights[i];
+		if (weight > huffmanMaxBits) {
+			return 0;
+		}
+		rankCount[weight]++;
+		total += (1U << weight) >> 1;
+	}
+	if (total == 0) {
+		return 0;
+	}
+	// weight of last symbol makes total a power of two
+	const uint32_t maxBits = np2_bsr(total) + 1;
+	if (maxBits > huffmanMaxBits) {
+		return 0;
+	}
+	const uint32_t rest = (1U << maxBits) - total;
+	const uint32_t lastWeight = np2_bsr(rest) + 1;
+	if (rest != (1U << (lastWeight - 1))) {
+		return 0;
+	}
+	weights[count++] = static_cast<uint8_t>(lastWeight);
+	rankCount[lastWeight]++;
+
+	// symbols with smaller weight (longer code) come first, then by symbol value
+	uint32_t start[huffmanMaxBits + 1];
+	uint32_t next = 0;
+	for (uint32_t weight = 1; weight <= maxBits; weight++) {
+		start[weight] = next;
+		next += rankCount[weight] << (weight - 1);
+	}
+	for (uint32_t symbol = 0; symbol < count; symbol++) {
+		const uint32_t weight = weights[symbol];
+		if (weight != 0) {
+			const uint16_t entry = static_cast<uint16_t>((symbol << 8) | (maxBits + 1 - weight));
+			const uint32_t size = 1U << (weight - 1);
+			uint16_t *ptr = huffmanTable + start[weight];
+			for (uint32_t i = 0; i < size; i++) {
+				ptr[i] = entry;
+			}
+			start[weight] += size;
+		}
+	}
+	huffmanBits = maxBits;
+	return used;
+}
+
+bool ZstdDecoder::DecodeHuffmanStream(const uint8_t *src, size_t length, uint8_t *dst, size_t count) const noexcept {
+	BackwardBitReader reader;
+	if (!reader.Init(src, length, inputEnd)) {
+		return false;
+	}
+	const uint32_t bits = huffmanBits;
+	for (size_t i = 0; i < count; i++) {
+		const uint16_t entry = huffmanTable[reader.Peek(bits)];
+		dst[i] = static_cast<uint8_t>(entry >> 8);
+		reader.Consume(entry & 0xff);
+	}
+	return reader.Finished();
+}
+
+bool ZstdDecoder::DecodeLiterals(const uint8_t *src, size_t length, size_t count, bool singleStream) noexcept {
+	if (singleStream) {
+		return DecodeHuffmanStream(src, length, literals, count);
+	}
+	// jump table with sizes of first three streams
+	if (length < 6) {
+		return false;
+	}
+	const size_t size1 = LoadLE16(src);
+	const size_t size2 = LoadLE16(src + 2);
+	const size_t size3 = LoadLE16(src + 4);
+	const size_t segment = (count + 3)/4;
+	if (size1 + size2 + size3 > length - 6 || 3*segment > count) {
+		return false;
+	}
+	const size_t size4 = length - 6 - size1 - size2 - size3;
+	src += 6;
+	return DecodeHuffmanStream(src, size1, literals, segment)
+		&& DecodeHuffmanStream(src + size1, size2, literals + segment, segment)
+		&& DecodeHuffmanStream(src + size1 + size2, size3, literals + 2*segment, segment)
+		&& DecodeHuffmanStream(src + size1 + size2 + size3, size4, literals + 3*segment, count - 3*segment);
+}
+
+bool ZstdDecoder::ReadSequenceTable(uint32_t mode, const uint8_t *src, size_t length, size_t &pos, FSEDecodeEntry *table,
+	const FSEDecodeEntry *defaultTable, uint32_t defaultLog, uint32_t maxSymbol, uint32_t maxLog,
+	const FSEDecodeEntry *&current, uint32_t &currentLog) noexcept {
+	switch (mode) {
+	case 0:	// predefined
+		current = defaultTable;
+		currentLog = defaultLog;
+		return true;
+	case 1:	// RLE
+		if (pos >= length || src[pos] > maxSymbol) {
+			return false;
+		}
+		table[0] = {0, src[pos], 0};
+		++pos;
+		current = table;
+		currentLog = 0;
+		return true;
+	case 2: {	// FSE compressed
+		int16_t norm[matchLengthMaxSymbol + 1];
+		uint32_t log;
+		uint32_t symbolCount;
+		const size_t used = ReadFSEDistribution(src + pos, length - pos, norm, maxSymbol, maxLog, log, symbolCount);
+		if (used == 0 || !BuildFSEDecodeTable(table, norm, symbolCount, log)) {
+			return false;
+		}
+		pos += used;
+		current = table;
+		currentLog = log;
+		return true;
+	}
+	default:	// repeat table of previous block
+		return current != nullptr;
+	}
+}
+
+DecompressStatus ZstdDecoder::DecodeSequences(const uint8_t *src, size_t length, const uint8_t *lit, size_t litSize, OutputBuffer &out, size_t frameStart) noexcept {
+	if (length == 0) {
+		return DecompressStatus::Corrupt;
+	}
+	uint32_t count = src[0];
+	size_t pos = 1;
+	if (count >= 128) {
+		if (count < 255) {
+			if (length < 2) {
+				return DecompressStatus::Corrupt;
+			}
+			count = ((count - 128) << 8) + src[1];
+			pos = 2;
+		} else {
+			if (length < 3) {
+				return DecompressStatus::Corrupt;
+			}
+			count = LoadLE16(src + 1) + 0x7F00;
+			pos = 3;
+		}
+	}
+
+	size_t litPos = 0;
+	if (count != 0) {
+		if (pos >= length) {
+			return DecompressStatus::Corrupt;
+		}
+		const uint32_t modes = src[pos++];
+		if ((modes & 3) != 0
+			|| !ReadSequenceTable(modes >> 6, src, length, pos, literalLengthTable, literalLengthDefault, literalLengthDefaultLog,
+				literalLengthMaxSymbol, literalLengthMaxLog, literalLengthCurrent, literalLengthLog)
+			|| !ReadSequenceTable((modes >> 4) & 3, src, length, pos, offsetTable, offsetDefault, offsetDefaultLog,
+				offsetMaxSymbol, offsetMaxLog, offsetCurrent, offsetLog)
+			|| !ReadSequenceTable((modes >> 2) & 3, src, length, pos, matchLengthTable, matchLengthDefault, matchLengthDefaultLog,
+				matchLengthMaxSymbol, matchLengthMaxLog, matchLengthCurrent, matchLengthLog)) {
+			return DecompressStatus::Corrupt;
+		}
+
+		BackwardBitReader reader;
+		if (!reader.Init(src + pos, length - pos, inputEnd)) {
+			return DecompressStatus::Corrupt;
+		}
+		uint32_t literalLengthState = reader.Read(literalLengthLog);
+		uint32_t offsetState = reader.Read(offsetLog);
+		uint32_t matchLengthState = reader.Read(matchLengthLog);
+		while (true) {
+			const FSEDecodeEntry literalLengthEntry = literalLengthCurrent[literalLengthState];
+			const FSEDecodeEntry offsetEntry = offsetCurrent[offsetState];
+			const FSEDecodeEntry matchLengthEntry = matchLengthCurrent[matchLengthState];
+			const uint32_t offsetCode = offsetEntry.symbol;
+			const uint32_t offsetValue = (1U << offsetCode) + reader.Read(offsetCode);
+			const uint32_t matchLength = matchLengthBase[matchLengthEntry.symbol] + reader.Read(matchLengthBits[matchLengthEntry.symbol]);
+			const uint32_t literalLength = literalLengthBase[literalLengthEntry.symbol] + reader.Read(literalLengthBits[literalLengthEntry.symbol]);
+
+			size_t offset;
+			if (offsetValue > 3) {
+				offset = offsetValue - 3;
+				repeatOffsets[2] = repeatOffsets[1];
+				repeatOffsets[1] = repeatOffsets[0];
+				repeatOffsets[0] = offset;
+			} else {
+				// repeat offset, shifted by one when literal length is zero
+				const uint32_t index = offsetValue - 1 + (literalLength == 0);
+				if (index == 0) {
+					offset = repeatOffsets[0];
+				} else {
+					offset = (index == 3) ? repeatOffsets[0] - 1 : repeatOffsets[index];
+					if (index != 1) {
+						repeatOffsets[2] = repeatOffsets[1];
+					}
+					repeatOffsets[1] = repeatOffsets[0];
+					repeatOffsets[0] = offset;
+				}
+			}
+
+			--count;
+			if (count != 0) {
+				literalLengthState = literalLengthEntry.baseline + reader.Read(literalLengthEntry.bits);
+				matchLengthState = matchLengthEntry.baseline + reader.Read(matchLengthEntry.bits);
+				offsetState = offsetEntry.baseline + reader.Read(offsetEntry.bits);
+			}
+
+			if (literalLength > litSize - litPos) {
+				return DecompressStatus::Corrupt;
+			}
+			if (!out.Reserve(static_cast<size_t>(literalLength) + matchLength)) {
+				return out.error;
+			}
+			memcpy(out.data + out.length, lit + litPos, literalLength);
+			out.length += literalLength;
+			litPos += literalLength;
+			if (offset == 0 || offset > out.length - frameStart) {
+				return DecompressStatus::Corrupt;
+			}
+			CopyMatch(out.data + out.length, offset, matchLength);
+			out.length += matchLength;
+			if (count == 0) {
+				break;
+			}
+		}
+		if (!reader.Finished()) {
+			return DecompressStatus::Corrupt;
+		}
+	}
+
+	const size_t rest = litSize - litPos;
+	if (!out.Reserve(rest)) {
+		return out.error;
+	}
+	memcpy(out.data + out.length, lit + litPos, rest);
+	out.length += rest;
+	return DecompressStatus::Ok;
+}
+
+DecompressStatus ZstdDecoder::DecodeBlock(const uint8_t *src, size_t length, OutputBuffer &out, size_t frameStart) noexcept {
+	if (length == 0) {
+		return DecompressStatus::Corrupt;
+	}
+	const uint32_t type = src[0] & 3;
+	const uint32_t sizeFormat = (src[0] >> 2) & 3;
+	const uint8_t *lit;
+	size_t litSize;
+	size_t pos;
+	if (type < 2) {
+		// raw or RLE literals
+		switch (sizeFormat) {
+		case 1:
+			if (length < 2) {
+				return DecompressStatus::Corrupt;
+			}
+			litSize = (src[0] >> 4) | (src[1] << 4);
+			pos = 2;
+			break;
+		case 3:
+			if (length < 3) {
+				return DecompressStatus::Corrupt;
+			}
+			litSize = (src[0] >> 4) | (src[1] << 4) | (src[2] << 12);
+			pos = 3;
+			break;
+		default:
+			litSize = src[0] >> 3;
+			pos = 1;
+			break;
+		}
+		if (litSize > zstdBlockSizeMax) {
+			return DecompressStatus::Corrupt;
+		}
+		if (type == 0) {
+			if (length - pos < litSize) {
+				return DecompressStatus::Corrupt;
+			}
+			lit = src + pos;
+			pos += litSize;
+		} else {
+			if (pos >= length) {
+				return DecompressStatus::Corrupt;
+			}
+			memset(literals, src[pos], litSize);
+			lit = literals;
+			++pos;
+		}
+	} else {
+		// Huffman compressed literals, type 3 reuses previous table
+		const uint32_t headerSize = (sizeFormat < 2) ? 3 : sizeFormat + 2;
+		const uint32_t sizeBits = (sizeFormat < 2) ? 10 : 4*sizeFormat + 6;
+		if (length < headerSize) {
+			return DecompressStatus::Corrupt;
+		}
+		uint64_t header = 0;
+		memcpy(&header, src, headerSize);
+		header >>= 4;
+		const uint32_t mask = (1U << sizeBits) - 1;
+		litSize = static_cast<size_t>(header & mask);
+		const size_t compressedSize = static_cast<size_t>((header >> sizeBits) & mask);
+		if (litSize > zstdBlockSizeMax || compressedSize > length - headerSize) {
+			return DecompressStatus::Corrupt;
+		}
+		const uint8_t *ptr = src + headerSize;
+		size_t size = compressedSize;
+		if (type == 2) {
+			const size_t used = ReadHuffmanTable(ptr, size);
+			if (used == 0) {
+				return DecompressStatus::Corrupt;
+			}
+			ptr += used;
+			size -= used;
+		} else if (huffmanBits == 0) {
+			return DecompressStatus::Corrupt;
+		}
+		if (!DecodeLiterals(ptr, size, litSize, sizeFormat == 0)) {
+			return DecompressStatus::Corrupt;
+		}
+		lit = literals;
+		pos = headerSize + compressedSize;
+	}
+	return DecodeSequences(src + pos, length - pos, lit, litSize, out, frameStart);
+}
+
+DecompressStatus ZstdDecoder::DecodeFrame(const uint8_t *src, size_t length, size_t &consumed, OutputBuffer &out) noexcept {
+	if (length < 8) {
+		return DecompressStatus::Corrupt;
+	}
+	if ((LoadLE32(src) & 0xFFFFFFF0U) == zstdSkippableMagic) {
+		const size_t size = LoadLE32(src + 4);
+		if (size > length - 8) {
+			return DecompressStatus::Corrupt;
+		}
+		consumed = 8 + size;
+		return DecompressStatus::Ok;
+	}
+
+	ZstdFrameHeader header;
+	DecompressStatus result = ParseZstdFrameHeader(src, length, header);
+	if (result != DecompressStatus::Ok) {
+		return result;
+	}
+	const size_t frameStart = out.length;
+	if (header.contentSize != zstdUnknownSize) {
+		if (header.contentSize > out.maxSize - out.length && out.reallocProc != nullptr) {
+			return DecompressStatus::TooLarge;
+		}
+		if (!out.Reserve(static_cast<size_t>(header.contentSize))) {
+			return out.error;
+		}
+	}
+
+	inputEnd = src + length;
+	literalLengthCurrent = nullptr;
+	offsetCurrent = nullptr;
+	matchLengthCurrent = nullptr;
+	huffmanBits = 0;
+	repeatOffsets[0] = 1;
+	repeatOffsets[1] = 4;
+	repeatOffsets[2] = 8;
+	size_t pos = header.headerSize;
+	while (true) {
+		if (length - pos < 3) {
+			return DecompressStatus::Corrupt;
+		}
+		const uint32_t blockHeader = src[pos] | (src[pos + 1] << 8) | (src[pos + 2] << 16);
+		const uint32_t type = (blockHeader >> 1) & 3;
+		const size_t size = blockHeader >> 3;
+		pos += 3;
+		if (type == 0) {
+			// raw block
+			if (length - pos < size) {
+				return DecompressStatus::Corrupt;
+			}
+			if (!out.Reserve(size)) {
+				return out.error;
+			}
+			memcpy(out.data + out.length, src + pos, size);
+			out.length += size;
+			pos += size;
+		} else if (type == 1) {
+			// RLE block, size is repeat count
+			if (pos >= length) {
+				return DecompressStatus::Corrupt;
+			}
+			if (!out.Reserve(size)) {
+				return out.error;
+			}
+			memset(out.data + out.length, src[pos], size);
+			out.length += size;
+			++pos;
+		} else if (type == 2) {
+			if (length - pos < size || size > zstdBlockSizeMax) {
+				return DecompressStatus::Corrupt;
+			}
+			result = DecodeBlock(src + pos, size, out, frameStart);
+			if (result != DecompressStatus::Ok) {
+				return result;
+			}
+			pos += size;
+		} else {
+			return DecompressStatus::Corrupt;
+		}
+		if (blockHeader & 1) {
+			break;
+		}
+	}
+
+	const size_t size = out.length - frameStart;
+	if (header.contentSize != zstdUnknownSize && header.contentSize != size) {
+		return DecompressStatus::Corrupt;
+	}
+	if (header.checksum) {
+		if (length - pos < 4 || LoadLE32(src + pos) != static_cast<uint32_t>(XXH64(out.data + frameStart, size))) {
+			return DecompressStatus::Corrupt;
+		}
+		pos += 4;
+	}
+	consumed = pos;
+	return DecompressStatus::Ok;
+}
+
+//------------------------------------------------------------------------------
+// compression
+
+class ByteBuffer {
+public:
+	uint8_t *data = nullptr;
+	size_t length = 0;
+	size_t capacity = 0;
+
+	ByteBuffer() noexcept = default;
+	ByteBuffer(const ByteBuffer &) = delete;
+	ByteBuffer &operator=(const ByteBuffer &) = delete;
+	~ByteBuffer() {
+		free(data);
+	}
+	bool Reserve(size_t count) noexcept {
+		if (count <= capacity - length) {
+			return true;
+		}
+		size_t size = capacity + capacity/2;
+		if (size < length + count) {
+			size = length + count + 64*1024;
+		}
+		void *block = realloc(data, size);
+		if (block == nullptr) {
+			return false;
+		}
+		data = static_cast<uint8_t *>(block);
+		capacity = size;
+		return true;
+	}
+	void Append(const void *src, size_t count) noexcept {
+		memcpy(data + length, src, count);
+		length += count;
+	}
+	void AppendByte(uint8_t value) noexcept {
+		data[length++] = value;
+	}
+	uint8_t *Detach() noexcept {
+		uint8_t *result = data;
+		data = nullptr;
+		capacity = 0;
+		return result;
+	}
+};
+
+// writes bits from least significant bit, caller reserves space in buffer.
+class BitWriter {
+	ByteBuffer &buffer;
+	uint64_t bitBuffer = 0;
+	uint32_t bitCount = 0;
+public:
+	explicit BitWriter(ByteBuffer &buffer_) noexcept : buffer{buffer_} {}
+	void Add(uint32_t value, uint32_t count) noexcept {
+		bitBuffer |= static_cast<uint64_t>(value & ((UINT64_C(1) << count) - 1)) << bitCount;
+		bitCount += count;
+		if (bitCount >= 32) {
+			StoreLE32(buffer.data + buffer.length, static_cast<uint32_t>(bitBuffer));
+			buffer.length += 4;
+			bitBuffer >>= 32;
+			bitCount -= 32;
+		}
+	}
+	// pads last byte with zero bits
+	void Flush() noexcept {
+		while (bitCount != 0) {
+			buffer.AppendByte(static_cast<uint8_t>(bitBuffer));
+			bitBuffer >>= 8;
+			bitCount = (bitCount > 8) ? bitCount - 8 : 0;
+		}
+		bitBuffer = 0;
+	}
+};
+
+constexpr uint32_t minMatchLength = 4;
+constexpr uint32_t matchHashBits = 16;
+
+// LZ77 match finder with hash chains, positions are relative to chunk start.
+class MatchFinder {
+	uint32_t *head = nullptr;	// position + 1, zero for empty
+	uint32_t *chain = nullptr;
+	uint32_t windowMask = 0;
+	uint32_t chainLimit = 0;
+public:
+	MatchFinder() noexcept = default;
+	MatchFinder(const MatchFinder &) = delete;
+	MatchFinder &operator=(const MatchFinder &) = delete;
+	~MatchFinder() {
+		free(head);
+		free(chain);
+	}
+	bool Init(uint32_t windowBits, uint32_t maxChain) noexcept {
+		head = static_cast<uint32_t *>(malloc(sizeof(uint32_t) << matchHashBits));
+		chain = static_cast<uint32_t *>(malloc(sizeof(uint32_t) << windowBits));
+		windowMask = (1U << windowBits) - 1;
+		chainLimit = maxChain;
+		return head != nullptr && chain != nullptr;
+	}
+	void Reset() noexcept {
+		memset(head, 0, sizeof(uint32_t) << matchHashBits);
+	}
+	static uint32_t Hash(const uint8_t *ptr) noexcept {
+		return (LoadLE32(ptr) * 2654435761U) >> (32 - matchHashBits);
+	}
+	// caller ensures 4 bytes are readable at position
+	void Insert(const uint8_t *base, uint32_t position) noexcept {
+		const uint32_t hash = Hash(base + position);
+		chain[position & windowMask] = head[hash];
+		head[hash] = position + 1;
+	}
+	// returns length of longest match before end, or zero when not found.
+	uint32_t Find(const uint8_t *base, uint32_t position, uint32_t end, uint32_t maxDistance, uint32_t maxLength, uint32_t &distance) const noexcept {
+		const uint8_t * const current = base + position;
+		const uint32_t available = (end - position < maxLength) ? end - position : maxLength;
+		uint32_t best = minMatchLength - 1;
+		uint32_t candidate = head[Hash(current)];
+		for (uint32_t depth = 0; candidate != 0 && depth < chainLimit; depth++) {
+			--candidate;
+			if (position - candidate > maxDistance) {
+				break;
+			}
+			const uint8_t * const match = base + candidate;
+			if (match[best] == current[best] && LoadLE32(match) == LoadLE32(current)) {
+				uint32_t length = 4;
+				while (length + 4 <= available) {
+					const uint32_t diff = LoadLE32(match + length) ^ LoadLE32(current + length);
+					if (diff != 0) {
+						length += np2_ctz(diff) >> 3;
+						goto done;
+					}
+					length += 4;
+				}
+				while (length < available && match[length] == current[length]) {
+					++length;
+				}
+done:
+				if (length > best) {
+					best = length;
+					distance = position - candidate;
+					if (length >= available) {
+						break;
+					}
+				}
+			}
+			candidate = chain[candidate & windowMask];
+		}
+		return (best >= minMatchLength) ? best : 0;
+	}
+};
+
+// builds length limited Huffman code lengths, at least two symbols must be used.
+void BuildCodeLengths(const uint32_t *freqs, uint32_t count, uint32_t maxLength, uint8_t *lengths) noexcept {
+	uint16_t leaves[litlenSymbolCount];
+	uint32_t leafCount = 0;
+	memset(lengths, 0, count);
+	for (uint32_t symbol = 0; symbol < count; symbol++) {
+		if (freqs[symbol] != 0) {
+			// insertion sort by frequency
+			uint32_t i = leafCount++;
+			while (i != 0 && freqs[leaves[i - 1]] > freqs[symbol]) {
+				leaves[i] = leaves[i - 1];
+				--i;
+			}
+			leaves[i] = static_cast<uint16_t>(symbol);
+		}
+	}
+
+	// two queues: sorted leaves and internal nodes created in increasing weight
+	uint32_t weight[2*litlenSymbolCount];
+	uint16_t parent[2*litlenSymbolCount];
+	for (uint32_t i = 0; i < leafCount; i++) {
+		weight[i] = freqs[leaves[i]];
+	}
+	uint32_t leaf = 0;
+	uint32_t node = leafCount;
+	const uint32_t root = 2*leafCount - 2;
+	for (uint32_t next = leafCount; next <= root; next++) {
+		uint32_t pick[2];
+		for (uint32_t &item : pick) {
+			if (leaf < leafCount && (node >= next || weight[leaf] <= weight[node])) {
+				item = leaf++;
+			} else {
+				item = node++;
+			}
+		}
+		weight[next] = weight[pick[0]] + weight[pick[1]];
+		parent[pick[0]] = parent[pick[1]] = static_cast<uint16_t>(next);
+	}
+
+	// depth of leaves, then limit code length with Kraft inequality
+	uint32_t lengthCount[2*litlenSymbolCount]{};
+	weight[root] = 0;
+	for (uint32_t i = root; i-- != 0;) {
+		weight[i] = weight[parent[i]] + 1;
+		if (i < leafCount) {
+			lengthCount[weight[i]]++;
+		}
+	}
+	for (uint32_t length = maxLength + 1; length < leafCount; length++) {
+		lengthCount[maxLength] += lengthCount[length];
+	}
+	uint32_t total = 0;
+	for (uint32_t length = 1; length <= maxLength; length++) {
+		total += lengthCount[length] << (maxLength - length);
+	}
+	while (total > (1U << maxLength)) {
+		lengthCount[maxLength]--;
+		for (uint32_t length = maxLength - 1; length != 0; length--) {
+			if (lengthCount[length] != 0) {
+				lengthCount[length]--;
+				lengthCount[length + 1] += 2;
+				break;
+			}
+		}
+		--total;
+	}
+	// most frequent symbols get shortest codes
+	uint32_t index = leafCount;
+	for (uint32_t length = 1; length <= maxLength; length++) {
+		for (uint32_t k = lengthCount[length]; k != 0; k--) {
+			lengths[leaves[--index]] = static_cast<uint8_t>(length);
+		}
+	}
+}
+
+void BuildCanonicalCodes(const uint8_t *lengths, uint32_t count, uint16_t *codes) noexcept {
+	uint32_t lengthCount[deflateMaxBits + 1]{};
+	for (uint32_t symbol = 0; symbol < count; symbol++) {
+		lengthCount[lengths[symbol]]++;
+	}
+	lengthCount[0] = 0;
+	uint32_t next[deflateMaxBits + 1];
+	uint32_t code = 0;
+	for (uint32_t length = 1; length <= deflateMaxBits; length++) {
+		code = (code + lengthCount[length - 1]) << 1;
+		next[length] = code;
+	}
+	for (uint32_t symbol = 0; symbol < count; symbol++) {
+		const uint32_t length = lengths[symbol];
+		codes[symbol] = (length == 0) ? 0 : static_cast<uint16_t>(ReverseBits(next[length]++, length));
+	}
+}
+
+struct LengthCodeTable {
+	uint8_t code[deflateMaxMatch + 1];
+	constexpr LengthCodeTable() noexcept : code{} {
+		for (uint32_t symbol = 0; symbol < 29; symbol++) {
+			const uint32_t end = (symbol == 28) ? 259 : lengthBase[symbol + 1];
+			for (uint32_t length = lengthBase[symbol]; length < end; length++) {
+				code[length] = static_cast<uint8_t>(symbol);
+			}
+		}
+	}
+};
+
+constexpr LengthCodeTable lengthCodeTable;
+
+inline uint32_t DistanceCode(uint32_t distance) noexcept {
+	--distance;
+	if (distance < 4) {
+		return distance;
+	}
+	const uint32_t bits = np2_bsr(distance);
+	return 2*bits + ((distance >> (bits - 1)) & 1);
+}
+
+struct DeflateToken {
+	uint16_t value;		// literal byte or match length
+	uint16_t distance;	// zero for literal
+};
+
+class DeflateEncoder {
+public:
+	bool Init() noexcept {
+		return finder.Init(15, 32);
+	}
+	bool Compress(const uint8_t *data, size_t length, ByteBuffer &out) noexcept;
+
+private:
+	static constexpr uint32_t blockSize = 0xffff;	// fits in one stored block
+	MatchFinder finder;
+	uint32_t litlenFreq[286];
+	uint32_t distanceFreq[30];
+	uint8_t litlenLengths[286];
+	uint8_t distanceLengths[30];
+	uint16_t litlenCodes[286];
+	uint16_t distanceCodes[30];
+	DeflateToken tokens[blockSize];
+
+	void WriteBlock(const uint8_t *data, size_t length, uint32_t tokenCount, bool final, BitWriter &writer, ByteBuffer &out) noexcept;
+	void WriteTokens(uint32_t tokenCount, BitWriter &writer) const noexcept;
+};
+
+void DeflateEncoder::WriteTokens(uint32_t tokenCount, BitWriter &writer) const noexcept {
+	for (uint32_t i = 0; i < tokenCount; i++) {
+		const DeflateToken token = tokens[i];
+		if (token.distance == 0) {
+			writer.Add(litlenCodes[token.value], litlenLengths[token.value]);
+		} else {
+			const uint32_t code = lengthCodeTable.code[token.value];
+			writer.Add(litlenCodes[257 + code], litlenLengths[257 + code]);
+			writer.Add(token.value - lengthBase[code], lengthExtra[code]);
+			const uint32_t distanceCode = DistanceCode(token.distance);
+			writer.Add(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+			writer.Add(token.distance - distanceBase[distanceCode], distanceExtra[distanceCode]);
+		}
+	}
+	writer.Add(litlenCodes[256], litlenLengths[256]);
+}
+
+void DeflateEncoder::WriteBlock(const uint8_t *data, size_t length, uint32_t tokenCount, bool final, BitWriter &writer, ByteBuffer &out) noexcept {
+	memset(litlenFreq, 0, sizeof(litlenFreq));
+	memset(distanceFreq, 0, sizeof(distanceFreq));
+	uint64_t extraBits = 0;
+	for (uint32_t i = 0; i < tokenCount; i++) {
+		const DeflateToken token = tokens[i];
+		if (token.distance == 0) {
+			litlenFreq[token.value]++;
+		} else {
+			const uint32_t code = lengthCodeTable.code[token.value];
+			const uint32_t distanceCode = DistanceCode(token.distance);
+			litlenFreq[257 + code]++;
+			distanceFreq[distanceCode]++;
+			extraBits += lengthExtra[code] + distanceExtra[distanceCode];
+		}
+	}
+	litlenFreq[256] = 1;
+
+	// fixed Huffman codes
+	uint64_t fixedBits = 3 + extraBits;
+	for (uint32_t symbol = 0; symbol < 286; symbol++) {
+		const uint32_t bits = (symbol < 144) ? 8 : ((symbol < 256) ? 9 : ((symbol < 280) ? 7 : 8));
+		fixedBits += static_cast<uint64_t>(litlenFreq[symbol])*bits;
+	}
+	for (uint32_t symbol = 0; symbol < 30; symbol++) {
+		fixedBits += static_cast<uint64_t>(distanceFreq[symbol])*5;
+	}
+
+	// dynamic Huffman codes, each code has at least two symbols to be complete
+	if (tokenCount == 0) {
+		litlenFreq[0] = 1;
+	}
+	if (distanceFreq[0] == 0) {
+		distanceFreq[0] = 1;
+	}
+	if (distanceFreq[1] == 0) {
+		distanceFreq[1] = 1;
+	}
+	BuildCodeLengths(litlenFreq, 286, deflateMaxBits, litlenLengths);
+	BuildCodeLengths(distanceFreq, 30, deflateMaxBits, distanceLengths);
+	uint32_t litlenCount = 286;
+	while (litlenLengths[litlenCount - 1] == 0) {
+		--litlenCount;
+	}
+	uint32_t distanceCount = 30;
+	while (distanceLengths[distanceCount - 1] == 0) {
+		--distanceCount;
+	}
+	uint8_t lengths[286 + 30];
+	memcpy(lengths, litlenLengths, litlenCount);
+	memcpy(lengths + litlenCount, distanceLengths, distanceCount);
+	const uint32_t total = litlenCount + distanceCount;
+
+	// run length encoded code lengths, symbol | extra bits << 8
+	uint16_t runs[286 + 30];
+	uint32_t runCount = 0;
+	uint32_t codeLengthFreq[codeLengthSymbolCount]{};
+	for (uint32_t i = 0; i < total;) {
+		const uint8_t value = lengths[i];
+		uint32_t run = 1;
+		while (i + run < total && lengths[i + run] == value) {
+			++run;
+		}
+		i += run;
+		if (value == 0) {
+			while (run >= 11) {
+				const uint32_t count = (run < 138) ? run : 138;
+				runs[runCount++] = static_cast<uint16_t>(18 | ((count - 11) << 8));
+				codeLengthFreq[18]++;
+				run -= count;
+			}
+			if (run >= 3) {
+				runs[runCount++] = static_cast<uint16_t>(17 | ((run - 3) << 8));
+				codeLengthFreq[17]++;
+				run = 0;
+			}
+		} else {
+			runs[runCount++] = value;
+			codeLengthFreq[value]++;
+			--run;
+			while (run >= 3) {
+				const uint32_t count = (run < 6) ? run : 6;
+				runs[runCount++] = static_cast<uint16_t>(16 | ((count - 3) << 8));
+				codeLengthFreq[16]++;
+				run -= count;
+			}
+		}
+		while (run != 0) {
+			runs[runCount++] = value;
+			codeLengthFreq[value]++;
+			--run;
+		}
+	}
+	uint32_t used = 0;
+	for (const uint32_t freq : codeLengthFreq) {
+		used += freq != 0;
+	}
+	if (used < 2) {
+		codeLengthFreq[(codeLengthFreq[0] == 0) ? 0 : 1]++;
+	}
+	uint8_t codeLengthLengths[codeLengthSymbolCount];
+	uint16_t codeLengthCodes[codeLengthSymbolCount];
+	BuildCodeLengths(codeLengthFreq, codeLengthSymbolCount, 7, codeLengthLengths);
+	BuildCanonicalCodes(codeLengthLengths, codeLengthSymbolCount, codeLengthCodes);
+	uint32_t codeLengthCount = codeLengthSymbolCount;
+	while (codeLengthCount > 4 && codeLengthLengths[codeLengthOrder[codeLengthCount - 1]] == 0) {
+		--codeLengthCount;
+	}
+
+	uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3*codeLengthCount + extraBits;
+	for (uint32_t symbol = 0; symbol < codeLengthSymbolCount; symbol++) {
+		dynamicBits += static_cast<uint64_t>(codeLengthFreq[symbol])*codeLengthLengths[symbol];
+	}
+	dynamicBits += 2*codeLengthFreq[16] + 3*codeLengthFreq[17] + 7*codeLengthFreq[18];
+	for (uint32_t symbol = 0; symbol < litlenCount; symbol++) {
+		dynamicBits += static_cast<uint64_t>(litlenFreq[symbol])*litlenLengths[symbol];
+	}
+	for (uint32_t symbol = 0; symbol < distanceCount; symbol++) {
+		dynamicBits += static_cast<uint64_t>(distanceFreq[symbol])*distanceLengths[symbol];
+	}
+	const uint64_t storedBits = 3 + 7 + 32 + 8*static_cast<uint64_t>(length);
+
+	if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+		writer.Add(final, 1);
+		writer.Add(0, 2);
+		writer.Flush();
+		const uint16_t size[2] = {static_cast<uint16_t>(length), static_cast<uint16_t>(~length)};
+		out.Append(size, sizeof(size));
+		out.Append(data, length);
+	} else if (fixedBits <= dynamicBits) {
+		writer.Add(final, 1);
+		writer.Add(1, 2);
+		memset(litlenLengths, 8, 144);
+		memset(litlenLengths + 144, 9, 256 - 144);
+		memset(litlenLengths + 256, 7, 280 - 256);
+		memset(litlenLengths + 280, 8, 286 - 280);
+		memset(distanceLengths, 5, 30);
+		BuildCanonicalCodes(litlenLengths, 286, litlenCodes);
+		BuildCanonicalCodes(distanceLengths, 30, distanceCodes);
+		WriteTokens(tokenCount, writer);
+	} else {
+		writer.Add(final, 1);
+		writer.Add(2, 2);
+		writer.Add(litlenCount - 257, 5);
+		writer.Add(distanceCount - 1, 5);
+		writer.Add(codeLengthCount - 4, 4);
+		for (uint32_t i = 0; i < codeLengthCount; i++) {
+			writer.Add(codeLengthLengths[codeLengthOrder[i]], 3);
+		}
+		for (uint32_t i = 0; i < runCount; i++) {
+			const uint32_t symbol = runs[i] & 0xff;
+			writer.Add(codeLengthCodes[symbol], codeLengthLengths[symbol]);
+			if (symbol >= 16) {
+				constexpr uint8_t repeatBits[3] = {2, 3, 7};
+				writer.Add(runs[i] >> 8, repeatBits[symbol - 16]);
+			}
+		}
+		BuildCanonicalCodes(litlenLengths, 286, litlenCodes);
+		BuildCanonicalCodes(distanceLengths, 30, distanceCodes);
+		WriteTokens(tokenCount, writer);
+	}
+}
+
+bool DeflateEncoder::Compress(const uint8_t *data, size_t length, ByteBuffer &out) noexcept {
+	BitWriter writer{out};
+	if (length == 0) {
+		// final fixed Huffman block with only end of block code
+		if (!out.Reserve(8)) {
+			return false;
+		}
+		writer.Add(3, 3);
+		writer.Add(0, 7);
+		writer.Flush();
+		return true;
+	}
+	for (size_t chunk = 0; chunk < length; chunk += compressChunkSize) {
+		const uint8_t * const base = data + chunk;
+		const uint32_t chunkLength = static_cast<uint32_t>((length - chunk < compressChunkSize) ? length - chunk : compressChunkSize);
+		finder.Reset();
+		uint32_t position = 0;
+		while (position < chunkLength) {
+			const uint32_t start = position;
+			const uint32_t end = (chunkLength - position < blockSize) ? chunkLength : position + blockSize;
+			uint32_t tokenCount = 0;
+			while (position < end) {
+				uint32_t distance = 0;
+				const uint32_t matchLength = (end - position >= minMatchLength) ? finder.Find(base, position, end, deflateWindowSize, deflateMaxMatch, distance) : 0;
+				if (matchLength != 0) {
+					tokens[tokenCount++] = {static_cast<uint16_t>(matchLength), static_cast<uint16_t>(distance)};
+					const uint32_t stop = position + matchLength;
+					for (; position < stop; position++) {
+						if (chunkLength - position >= minMatchLength) {
+							finder.Insert(base, position);
+						}
+					}
+				} else {
+					tokens[tokenCount++] = {base[position], 0};
+					if (chunkLength - position >= minMatchLength) {
+						finder.Insert(base, position);
+					}
+					++position;
+				}
+			}
+			// stored block is the largest output
+			if (!out.Reserve(end - start + 64)) {
+				return false;
+			}
+			const bool final = position == chunkLength && chunk + chunkLength == length;
+			WriteBlock(base + start, end - start, tokenCount, final, writer, out);
+		}
+	}
+	writer.Flush();
+	return true;
+}
+
+bool WriteGzip(const uint8_t *data, size_t length, ByteBuffer &out) noexcept {
+	// no file name, modification time or extra field, unknown OS
+	constexpr uint8_t header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+	if (!out.Reserve(sizeof(header))) {
+		return false;
+	}
+	out.Append(header, sizeof(header));
+	DeflateEncoder *encoder = static_cast<DeflateEncoder *>(malloc(sizeof(DeflateEncoder)));
+	if (encoder == nullptr) {
+		return false;
+	}
+	new (encoder) DeflateEncoder();
+	const bool success = encoder->Init() && encoder->Compress(data, length, out);
+	encoder->~DeflateEncoder();
+	free(encoder);
+	if (!success || !out.Reserve(8)) {
+		return false;
+	}
+	StoreLE32(out.data + out.length, UpdateCRC32(0, data, length));
+	StoreLE32(out.data + out.length + 4, static_cast<uint32_t>(length));
+	out.length += 8;
+	return true;
+}
+
+struct FSEEncodeTable {
+	struct SymbolTransform {
+		int32_t deltaFindState;
+		uint32_t deltaBits;
+	};
+	uint32_t accuracyLog;
+	uint16_t stateTable[64];
+	SymbolTransform transform[matchLengthMaxSymbol + 1];
+
+	void Build(const int16_t *norm, uint32_t symbolCount, uint32_t log) noexcept {
+		const uint32_t tableSize = 1U << log;
+		const uint32_t mask = tableSize - 1;
+		uint32_t high = tableSize - 1;
+		uint8_t tableSymbol[64];
+		uint32_t cumulative[matchLengthMaxSymbol + 2];
+		cumulative[0] = 0;
+		for (uint32_t symbol = 0; symbol < symbolCount; symbol++) {
+			if (norm[symbol] == -1) {
+				cumulative[symbol + 1] = cumulative[symbol] + 1;
+				tableSymbol[high--] = static_cast<uint8_t>(symbol);
+			} else {
+				cumulative[symbol + 1] = cumulative[symbol] + norm[symbol];
+			}
+		}
+		// same spreading as decoder
+		const uint32_t step = FSESpreadStep(tableSize);
+		uint32_t position = 0;
+		for (uint32_t symbol = 0; symbol < symbolCount; symbol++) {
+			for (int32_t i = 0; i < norm[symbol]; i++) {
+				tableSymbol[position] = static_cast<uint8_t>(symbol);
+				do {
+					position = (position + step) & mask;
+				} while (position > high);
+			}
+		}
+		for (uint32_t i = 0; i < tableSize; i++) {
+			stateTable[cumulative[tableSymbol[i]]++] = static_cast<uint16_t>(tableSize + i);
+		}
+		int32_t total = 0;
+		for (uint32_t symbol = 0; symbol < symbolCount; symbol++) {
+			const int32_t count = norm[symbol];
+			SymbolTransform &item = transform[symbol];
+			if (count == -1 || count == 1) {
+				item.deltaBits = (log << 16) - tableSize;
+				item.deltaFindState = total - 1;
+				++total;
+			} else if (count > 1) {
+				const uint32_t maxBitsOut = log - np2_bsr(count - 1);
+				const uint32_t minStatePlus = static_cast<uint32_t>(count) << maxBitsOut;
+				item.deltaBits = (maxBitsOut << 16) - minStatePlus;
+				item.deltaFindState = total - count;
+				total += count;
+			} else {
+				item.deltaBits = ((log + 1) << 16) - tableSize;
+				item.deltaFindState = 0;
+			}
+		}
+		accuracyLog = log;
+	}
+	uint32_t InitState(uint32_t symbol) const noexcept {
+		const SymbolTransform &item = transform[symbol];
+		const uint32_t bits = (item.deltaBits + (1 << 15)) >> 16;
+		const uint32_t value = (bits << 16) - item.deltaBits;
+		return stateTable[static_cast<int32_t>(value >> bits) + item.deltaFindState];
+	}
+	void Encode(BitWriter &writer, uint32_t &state, uint32_t symbol) const noexcept {
+		const SymbolTransform &item = transform[symbol];
+		const uint32_t bits = (state + item.deltaBits) >> 16;
+		writer.Add(state, bits);
+		state = stateTable[static_cast<int32_t>(state >> bits) + item.deltaFindState];
+	}
+};
+
+struct ZstdSequence {
+	uint32_t literalLength;
+	uint32_t matchLength;
+	uint32_t offset;
+};
+
+inline uint32_t LiteralLengthCode(uint32_t value) noexcept {
+	if (value < 16) {
+		return value;
+	}
+	uint32_t code = literalLengthMaxSymbol;
+	while (literalLengthBase[code] > value) {
+		--code;
+	}
+	return code;
+}
+
+inline uint32_t MatchLengthCode(uint32_t value) noexcept {
+	if (value < 35) {
+		return value - 3;
+	}
+	uint32_t code = matchLengthMaxSymbol;
+	while (matchLengthBase[code] > value) {
+		--code;
+	}
+	return code;
+}
+
+class ZstdEncoder {
+public:
+	bool Init() noexcept;
+	bool Compress(const uint8_t *data, size_t length, ByteBuffer &out) noexcept;
+
+private:
+	static constexpr uint32_t windowBits = 20;
+	static constexpr uint32_t maxMatch = 65536;
+	MatchFinder finder;
+	FSEEncodeTable literalLengthTable;
+	FSEEncodeTable offsetTable;
+	FSEEncodeTable matchLengthTable;
+	ByteBuffer block;
+	uint8_t literals[zstdBlockSizeMax];
+	ZstdSequence sequences[zstdBlockSizeMax/minMatchLength];
+
+	bool EncodeBlock(uint32_t literalCount, uint32_t sequenceCount) noexcept;
+};
+
+bool ZstdEncoder::Init() noexcept {
+	literalLengthTable.Build(literalLengthDefaultNorm, std::size(literalLengthDefaultNorm), literalLengthDefaultLog);
+	offsetTable.Build(offsetDefaultNorm, std::size(offsetDefaultNorm), offsetDefaultLog);
+	matchLengthTable.Build(matchLengthDefaultNorm, std::size(matchLengthDefaultNorm), matchLengthDefaultLog);
+	return finder.Init(windowBits, 8) && block.Reserve(2*zstdBlockSizeMax);
+}
+
+// raw literals and sequences with predefined codes, sequences are written in
+// reverse order so decoder reads them forward.
+bool ZstdEncoder::EncodeBlock(uint32_t literalCount, uint32_t sequenceCount) noexcept {
+	block.length = 0;
+	if (literalCount < 32) {
+		block.AppendByte(static_cast<uint8_t>(literalCount << 3));
+	} else if (literalCount < 4096) {
+		block.AppendByte(static_cast<uint8_t>((literalCount << 4) | 4));
+		block.AppendByte(static_cast<uint8_t>(literalCount >> 4));
+	} else {
+		block.AppendByte(static_cast<uint8_t>((literalCount << 4) | 12));
+		block.AppendByte(static_cast<uint8_t>(literalCount >> 4));
+		block.AppendByte(static_cast<uint8_t>(literalCount >> 12));
+	}
+	block.Append(literals, literalCount);
+
+	if (sequenceCount < 128) {
+		block.AppendByte(static_cast<uint8_t>(sequenceCount));
+	} else if (sequenceCount < 0x7F00) {
+		block.AppendByte(static_cast<uint8_t>((sequenceCount >> 8) + 128));
+		block.AppendByte(static_cast<uint8_t>(sequenceCount));
+	} else {
+		block.AppendByte(255);
+		block.AppendByte(static_cast<uint8_t>(sequenceCount - 0x7F00));
+		block.AppendByte(static_cast<uint8_t>((sequenceCount - 0x7F00) >> 8));
+	}
+	if (sequenceCount == 0) {
+		return true;
+	}
+	block.AppendByte(0);	// predefined mode for all codes
+
+	BitWriter writer{block};
+	uint32_t literalLengthState = 0;
+	uint32_t offsetState = 0;
+	uint32_t matchLengthState = 0;
+	for (uint32_t i = sequenceCount; i-- != 0;) {
+		const ZstdSequence &sequence = sequences[i];
+		const uint32_t literalLengthCode = LiteralLengthCode(sequence.literalLength);
+		const uint32_t matchLengthCode = MatchLengthCode(sequence.matchLength);
+		const uint32_t offsetValue = sequence.offset + 3;
+		const uint32_t offsetCode = np2_bsr(offsetValue);
+		if (i == sequenceCount - 1) {
+			matchLengthState = matchLengthTable.InitState(matchLengthCode);
+			offsetState = offsetTable.InitState(offsetCode);
+			literalLengthState = literalLengthTable.InitState(literalLengthCode);
+		} else {
+			offsetTable.Encode(writer, offsetState, offsetCode);
+			matchLengthTable.Encode(writer, matchLengthState, matchLengthCode);
+			literalLengthTable.Encode(writer, literalLengthState, literalLengthCode);
+		}
+		writer.Add(sequence.literalLength - literalLengthBase[literalLengthCode], literalLengthBits[literalLengthCode]);
+		writer.Add(sequence.matchLength - matchLengthBase[matchLengthCode], matchLengthBits[matchLengthCode]);
+		writer.Add(offsetValue, offsetCode);
+	}
+	writer.Add(matchLengthState, matchLengthTable.accuracyLog);
+	writer.Add(offsetState, offsetTable.accuracyLog);
+	writer.Add(literalLengthState, literalLengthTable.accuracyLog);
+	writer.Add(1, 1);	// end mark
+	writer.Flush();
+	return true;
+}
+
+bool ZstdEncoder::Compress(const uint8_t *data, size_t length, ByteBuffer &out) noexcept {
+	// single segment frame with content size and checksum
+	uint8_t header[4 + 1 + 8];
+	StoreLE32(header, zstdMagic);
+	uint32_t headerSize;
+	if (length < 256) {
+		header[4] = 0x24;
+		header[5] = static_cast<uint8_t>(length);
+		headerSize = 6;
+	} else if (length < 65536 + 256) {
+		header[4] = 0x64;
+		header[5] = static_cast<uint8_t>(length - 256);
+		header[6] = static_cast<uint8_t>((length - 256) >> 8);
+		headerSize = 7;
+	} else if (static_cast<uint64_t>(length) <= UINT32_MAX) {
+		header[4] = 0xA4;
+		StoreLE32(header + 5, static_cast<uint32_t>(length));
+		headerSize = 9;
+	} else {
+		header[4] = 0xE4;
+		StoreLE64(header + 5, length);
+		headerSize = 13;
+	}
+	if (!out.Reserve(headerSize + 3)) {
+		return false;
+	}
+	out.Append(header, headerSize);
+	if (length == 0) {
+		// last raw block with zero size
+		const uint8_t empty[3] = {1, 0, 0};
+		out.Append(empty, sizeof(empty));
+	}
+
+	for (size_t chunk = 0; chunk < length; chunk += compressChunkSize) {
+		const uint8_t * const base = data + chunk;
+		const uint32_t chunkLength = static_cast<uint32_t>((length - chunk < compressChunkSize) ? length - chunk : compressChunkSize);
+		finder.Reset();
+		uint32_t position = 0;
+		while (position < chunkLength) {
+			const uint32_t start = position;
+			const uint32_t end = (chunkLength - position < zstdBlockSizeMax) ? chunkLength : position + zstdBlockSizeMax;
+			uint32_t literalCount = 0;
+			uint32_t sequenceCount = 0;
+			uint32_t literalStart = position;
+			while (position < end) {
+				uint32_t distance = 0;
+				const uint32_t matchLength = (end - position >= minMatchLength) ? finder.Find(base, position, end, (1U << windowBits) - 1, maxMatch, distance) : 0;
+				if (matchLength != 0) {
+					const uint32_t literalLength = position - literalStart;
+					memcpy(literals + literalCount, base + literalStart, literalLength);
+					literalCount += literalLength;
+					sequences[sequenceCount++] = {literalLength, matchLength, distance};
+					const uint32_t stop = position + matchLength;
+					for (; position < stop; position++) {
+						if (chunkLength - position >= minMatchLength) {
+							finder.Insert(base, position);
+						}
+					}
+					literalStart = position;
+				} else {
+					if (chunkLength - position >= minMatchLength) {
+						finder.Insert(base, position);
+					}
+					++position;
+				}
+			}
+			memcpy(literals + literalCount, base + literalStart, end - literalStart);
+			literalCount += end - literalStart;
+
+			const bool last = end == chunkLength && chunk + chunkLength == length;
+			const uint32_t size = end - start;
+			EncodeBlock(literalCount, sequenceCount);
+			const bool compressed = block.length < size;
+			const uint32_t blockSize = compressed ? static_cast<uint32_t>(block.length) : size;
+			if (!out.Reserve(3 + blockSize)) {
+				return false;
+			}
+			const uint32_t blockHeader = (blockSize << 3) | (compressed ? 4 : 0) | (last ? 1 : 0);
+			out.AppendByte(static_cast<uint8_t>(blockHeader));
+			out.AppendByte(static_cast<uint8_t>(blockHeader >> 8));
+			out.AppendByte(static_cast<uint8_t>(blockHeader >> 16));
+			out.Append(compressed ? block.data : base + start, blockSize);
+		}
+	}
+
+	if (!out.Reserve(4)) {
+		return false;
+	}
+	StoreLE32(out.data + out.length, static_cast<uint32_t>(XXH64(data, length)));
+	out.length += 4;
+	return true;
+}
+
+bool WriteZstd(const uint8_t *data, size_t length, ByteBuffer &out) noexcept {
+	ZstdEncoder *encoder = static_cast<ZstdEncoder *>(malloc(sizeof(ZstdEncoder)));
+	if (encoder == nullptr) {
+		return false;
+	}
+	new (encoder) ZstdEncoder();
+	const bool success = encoder->Init() && encoder->Compress(data, length, out);
+	encoder->~ZstdEncoder();
+	free(encoder);
+	return success;
+}
+
+void *DefaultRealloc(void *block, size_t size) noexcept {
+	if (size == 0) {
+		free(block);
+		return nullptr;
+	}
+	return realloc(block, size);
+}
+
+}
+
+CompressionFormat DetectCompression(const void *data, size_t length) noexcept {
+	if (length >= 4) {
+		const uint32_t magic = LoadLE32(static_cast<const uint8_t *>(data));
+		if ((magic & 0xffffff) == gzipMagic) {
+			return CompressionFormat::Gzip;
+		}
+		if (magic == zstdMagic) {
+			return CompressionFormat::Zstd;
+		}
+	}
+	return CompressionFormat::None;
+}
+
+Decompressor::~Decompressor() {
+	if (output != nullptr) {
+		reallocProc(output, 0);
+	}
+	free(segments);
+}
+
+void Decompressor::Fail(DecompressStatus result) noexcept {
+	// keep first error
+	DecompressStatus expected = DecompressStatus::Ok;
+	status.compare_exchange_strong(expected, result, std::memory_order_acq_rel);
+}
+
+bool Decompressor::AddSegment(size_t &capacity, const DecompressSegment &segment) noexcept {
+	if (segmentCount == capacity) {
+		const size_t size = (capacity == 0) ? 64 : 2*capacity;
+		void *block = realloc(segments, size*sizeof(DecompressSegment));
+		if (block == nullptr) {
+			return false;
+		}
+		segments = static_cast<DecompressSegment *>(block);
+		capacity = size;
+	}
+	segments[segmentCount++] = segment;
+	return true;
+}
+
+bool Decompressor::ScanGzip() noexcept {
+	size_t capacity = 0;
+	size_t srcOffset = 0;
+	size_t dstOffset = 0;
+	while (srcOffset < inputLength) {
+		const uint8_t *member = input + srcOffset;
+		const size_t size = BgzfMemberSize(member, inputLength - srcOffset);
+		if (size < 28 || size > inputLength - srcOffset) {
+			return false;
+		}
+		const size_t length = LoadLE32(member + size - 4);
+		if (length > maxSize - dstOffset) {
+			Fail(DecompressStatus::TooLarge);
+			return false;
+		}
+		if (!AddSegment(capacity, {srcOffset, size, dstOffset, length})) {
+			return false;
+		}
+		srcOffset += size;
+		dstOffset += length;
+	}
+	outputLength = dstOffset;
+	return true;
+}
+
+bool Decompressor::ScanZstd() noexcept {
+	size_t capacity = 0;
+	size_t srcOffset = 0;
+	size_t dstOffset = 0;
+	while (srcOffset < inputLength) {
+		const uint8_t *frame = input + srcOffset;
+		const size_t remaining = inputLength - srcOffset;
+		if (remaining >= 8 && (LoadLE32(frame) & 0xFFFFFFF0U) == zstdSkippableMagic) {
+			const size_t size = LoadLE32(frame + 4);
+			if (size > remaining - 8) {
+				return false;
+			}
+			srcOffset += 8 + size;
+			continue;
+		}
+		ZstdFrameHeader header;
+		const DecompressStatus result = ParseZstdFrameHeader(frame, remaining, header);
+		if (result != DecompressStatus::Ok) {
+			if (result == DecompressStatus::Unsupported) {
+				Fail(result);
+			}
+			return false;
+		}
+		if (header.contentSize == zstdUnknownSize) {
+			return false;
+		}
+		if (header.contentSize > maxSize - dstOffset) {
+			Fail(DecompressStatus::TooLarge);
+			return false;
+		}
+		const size_t size = ZstdFrameSize(frame, remaining, header);
+		const size_t length = static_cast<size_t>(header.contentSize);
+		if (size == 0 || !AddSegment(capacity, {srcOffset, size, dstOffset, length})) {
+			return false;
+		}
+		srcOffset += size;
+		dstOffset += length;
+	}
+	outputLength = dstOffset;
+	return true;
+}
+
+bool Decompressor::Prepare(CompressionFormat format_, const void *data, size_t length, size_t maxSize_, size_t padding_, CompressionReallocProc reallocProc_) noexcept {
+	format = format_;
+	input = static_cast<const uint8_t *>(data);
+	inputLength = length;
+	maxSize = maxSize_;
+	padding = (padding_ == 0) ? 1 : padding_;
+	reallocProc = (reallocProc_ == nullptr) ? DefaultRealloc : reallocProc_;
+	if (format == CompressionFormat::None || DetectCompression(data, length) != format) {
+		Fail(DecompressStatus::Corrupt);
+		return false;
+	}
+
+	const bool scanned = (format == CompressionFormat::Gzip) ? ScanGzip() : ScanZstd();
+	if (Status() != DecompressStatus::Ok) {
+		return false;
+	}
+	if (!scanned) {
+		free(segments);
+		segments = nullptr;
+		segmentCount = 0;
+		outputLength = 0;
+		return true;
+	}
+	output = static_cast<uint8_t *>(reallocProc(nullptr, outputLength + padding));
+	if (output == nullptr) {
+		Fail(DecompressStatus::OutOfMemory);
+		return false;
+	}
+	memset(output + outputLength, 0, padding);
+	return true;
+}
+
+void Decompressor::RunSequential() noexcept {
+	OutputBuffer out{};
+	out.maxSize = maxSize;
+	out.padding = padding;
+	out.reallocProc = reallocProc;
+	size_t sizeHint = inputLength*4;
+	if (format == CompressionFormat::Gzip) {
+		// ISIZE of last member, exact size for single member smaller than 4 GiB
+		const size_t size = LoadLE32(input + inputLength - 4);
+		if (size >= inputLength) {
+			sizeHint = size;
+		}
+	}
+	if (!out.Grow((sizeHint < maxSize) ? sizeHint : maxSize)) {
+		Fail(out.error);
+		return;
+	}
+
+	DecompressStatus result = DecompressStatus::Ok;
+	size_t pos = 0;
+	if (format == CompressionFormat::Gzip) {
+		Inflater *inflater = static_cast<Inflater *>(malloc(sizeof(Inflater)));
+		if (inflater == nullptr) {
+			result = DecompressStatus::OutOfMemory;
+		} else {
+			inflater->Init();
+			do {
+				size_t consumed = 0;
+				result = inflater->InflateGzipMember(input + pos, inputLength - pos, consumed, out);
+				pos += consumed;
+				// data after last member is ignored like gzip
+			} while (result == DecompressStatus::Ok && pos < inputLength
+				&& DetectCompression(input + pos, inputLength - pos) == CompressionFormat::Gzip);
+			free(inflater);
+		}
+	} else {
+		ZstdDecoder *decoder = static_cast<ZstdDecoder *>(malloc(sizeof(ZstdDecoder)));
+		if (decoder == nullptr) {
+			result = DecompressStatus::OutOfMemory;
+		} else {
+			decoder->Init();
+			while (result == DecompressStatus::Ok && pos < inputLength) {
+				size_t consumed = 0;
+				result = decoder->DecodeFrame(input + pos, inputLength - pos, consumed, out);
+				pos += consumed;
+			}
+			free(decoder);
+		}
+	}
+
+	if (result == DecompressStatus::Ok) {
+		output = out.data;
+		outputLength = out.length;
+		memset(output + outputLength, 0, padding);
+	} else {
+		reallocProc(out.data, 0);
+		Fail(result);
+	}
+}
+
+void Decompressor::RunSegments() noexcept {
+	Inflater *inflater = nullptr;
+	ZstdDecoder *decoder = nullptr;
+	if (format == CompressionFormat::Gzip) {
+		inflater = static_cast<Inflater *>(malloc(sizeof(Inflater)));
+		if (inflater != nullptr) {
+			inflater->Init();
+		}
+	} else {
+		decoder = static_cast<ZstdDecoder *>(malloc(sizeof(ZstdDecoder)));
+		if (decoder != nullptr) {
+			decoder->Init();
+		}
+	}
+	if (inflater == nullptr && decoder == nullptr) {
+		Fail(DecompressStatus::OutOfMemory);
+		return;
+	}
+
+	while (Status() == DecompressStatus::Ok) {
+		const size_t index = nextSegment.fetch_add(1, std::memory_order_relaxed);
+		if (index >= segmentCount) {
+			break;
+		}
+		const DecompressSegment &segment = segments[index];
+		OutputBuffer out{};
+		out.data = output + segment.dstOffset;
+		out.capacity = segment.dstLength;
+		out.maxSize = segment.dstLength;
+		size_t consumed = 0;
+		const uint8_t *src = input + segment.srcOffset;
+		DecompressStatus result;
+		if (inflater != nullptr) {
+			result = inflater->InflateGzipMember(src, segment.srcLength, consumed, out);
+		} else {
+			result = decoder->DecodeFrame(src, segment.srcLength, consumed, out);
+		}
+		if (result == DecompressStatus::Ok && (consumed != segment.srcLength || out.length != segment.dstLength)) {
+			result = DecompressStatus::Corrupt;
+		}
+		if (result != DecompressStatus::Ok) {
+			Fail(result);
+		}
+	}
+	free(inflater);
+	free(decoder);
+}
+
+void Decompressor::Run() noexcept {
+	if (Status() != DecompressStatus::Ok) {
+		return;
+	}
+	if (segments != nullptr) {
+		RunSegments();
+	} else {
+		RunSequential();
+	}
+}
+
+char *Decompressor::Detach() noexcept {
+	if (Status() != DecompressStatus::Ok || output == nullptr) {
+		return nullptr;
+	}
+	char *result = reinterpret_cast<char *>(output);
+	output = nullptr;
+	return result;
+}
+
+Compressor::~Compressor() {
+	free(input);
+	free(output);
+}
+
+bool Compressor::Write(const void *data, size_t length) noexcept {
+	if (length == 0) {
+		return true;
+	}
+	if (length > inputCapacity - inputLength) {
+		size_t size = inputCapacity + inputCapacity/2;
+		if (size < inputLength + length) {
+			size = inputLength + length;
+		}
+		void *block = realloc(input, size);
+		if (block == nullptr) {
+			return false;
+		}
+		input = static_cast<uint8_t *>(block);
+		inputCapacity = size;
+	}
+	memcpy(input + inputLength, data, length);
+	inputLength += length;
+	return true;
+}
+
+bool Compressor::Finish() noexcept {
+	ByteBuffer buffer;
+	bool success;
+	switch (format) {
+	case CompressionFormat::Gzip:
+		success = WriteGzip(input, inputLength, buffer);
+		break;
+	case CompressionFormat::Zstd:
+		success = WriteZstd(input, inputLength, buffer);
+		break;
+	default:
+		success = buffer.Reserve(inputLength);
+		if (success) {
+			buffer.Append(input, inputLength);
+		}
+		break;
+	}
+	free(input);
+	input = nullptr;
+	inputLength = 0;
+	inputCapacity = 0;
+	if (!success) {
+		return false;
+	}
+	free(output);
+	outputLength = buffer.length;
+	output = buffer.Detach();
+	return true;
+}
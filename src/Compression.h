@@ -0,0 +1,116 @@
+// gzip and Zstandard compression for loading and saving compressed files
+#pragma once
+
+#include <atomic>
+
+// The codecs have no dependency on Windows or Scintilla. Decompressor writes the
+// whole decompressed content into one buffer which is then used as file data.
+
+enum class CompressionFormat : uint8_t {
+	None,
+	Gzip,	// RFC 1952, one or more members
+	Zstd,	// RFC 8878, one or more frames, without dictionary
+};
+
+enum class DecompressStatus : uint8_t {
+	Ok,
+	Corrupt,		// bad header, truncated data or checksum mismatch
+	Unsupported,	// e.g. Zstandard frame requires a dictionary
+	TooLarge,		// decompressed size exceeds limit
+	OutOfMemory,
+};
+
+// checks magic bytes of gzip member or Zstandard frame.
+CompressionFormat DetectCompression(const void *data, size_t length) noexcept;
+
+// same as C realloc(), except zero size frees the block and returns nullptr.
+typedef void *(*CompressionReallocProc)(void *block, size_t size) noexcept;
+
+struct DecompressSegment {
+	size_t srcOffset;
+	size_t srcLength;
+	size_t dstOffset;
+	size_t dstLength;
+};
+
+// When the input consists of independent members or frames whose decompressed
+// size is recorded before decoding (BGZF blocks, Zstandard frames with content
+// size), each one is decoded directly at its final offset in the output, and
+// Run() can be called from multiple threads to decode them in parallel.
+// Otherwise content is decoded sequentially into a growing buffer.
+class Decompressor {
+public:
+	Decompressor() noexcept = default;
+	Decompressor(const Decompressor &) = delete;
+	Decompressor &operator=(const Decompressor &) = delete;
+	~Decompressor();
+
+	// scans input and allocates output. padding zero bytes are appended after output.
+	// input must stay valid until Run() returns.
+	bool Prepare(CompressionFormat format, const void *data, size_t length, size_t maxSize, size_t padding, CompressionReallocProc reallocProc) noexcept;
+	// number of segments can be decoded in parallel, zero for sequential decoding.
+	size_t Segments() const noexcept {
+		return segmentCount;
+	}
+	// decodes pending segments, only call it from multiple threads when Segments() > 1.
+	void Run() noexcept;
+	DecompressStatus Status() const noexcept {
+		return status.load(std::memory_order_acquire);
+	}
+	size_t Length() const noexcept {
+		return outputLength;
+	}
+	// transfers output to caller, returns nullptr on failure.
+	char *Detach() noexcept;
+
+private:
+	CompressionFormat format = CompressionFormat::None;
+	const uint8_t *input = nullptr;
+	size_t inputLength = 0;
+	size_t maxSize = 0;
+	size_t padding = 0;
+	CompressionReallocProc reallocProc = nullptr;
+	uint8_t *output = nullptr;
+	size_t outputLength = 0;
+	DecompressSegment *segments = nullptr;
+	size_t segmentCount = 0;
+	std::atomic<size_t> nextSegment = 0;
+	std::atomic<DecompressStatus> status = DecompressStatus::Ok;
+
+	void Fail(DecompressStatus result) noexcept;
+	bool AddSegment(size_t &capacity, const DecompressSegment &segment) noexcept;
+	bool ScanGzip() noexcept;
+	bool ScanZstd() noexcept;
+	void RunSequential() noexcept;
+	void RunSegments() noexcept;
+};
+
+// Compresses text for saving, output is owned by the object.
+// Gzip output uses LZ77 with dynamic Huffman codes, Zstandard output uses raw
+// literals with predefined sequence codes.
+class Compressor {
+public:
+	explicit Compressor(CompressionFormat format_) noexcept : format{format_} {}
+	Compressor(const Compressor &) = delete;
+	Compressor &operator=(const Compressor &) = delete;
+	~Compressor();
+
+	// appends text to compress, returns false on out of memory.
+	bool Write(const void *data, size_t length) noexcept;
+	// compresses all written text, returns false on out of memory.
+	bool Finish() noexcept;
+	const void *Data() const noexcept {
+		return output;
+	}
+	size_t Length() const noexcept {
+		return outputLength;
+	}
+
+private:
+	CompressionFormat format;
+	uint8_t *input = nullptr;
+	size_t inputLength = 0;
+	size_t inputCapacity = 0;
+	uint8_t *output = nullptr;
+	size_t outputLength = 0;
+};
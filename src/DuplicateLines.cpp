@@ -0,0 +1,232 @@
+// Duplicate line finder for removing duplicate or unique lines in original order
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "DuplicateLines.h"
+
+namespace {
+
+constexpr bool IsEOLChar(char ch) noexcept {
+	return ch == '\r' || ch == '\n';
+}
+
+// returns position of first CR or LF, checks eight bytes at a time.
+size_t FindEOL(const char *text, size_t pos, size_t length) noexcept {
+	constexpr uint64_t ones = UINT64_C(0x0101010101010101);
+	constexpr uint64_t highs = UINT64_C(0x8080808080808080);
+	while (pos + 8 <= length) {
+		uint64_t value;
+		memcpy(&value, text + pos, sizeof(value));
+		const uint64_t cr = value ^ (ones*'\r');
+		const uint64_t lf = value ^ (ones*'\n');
+		if (((cr - ones) & ~cr & highs) | ((lf - ones) & ~lf & highs)) {
+			break;
+		}
+		pos += 8;
+	}
+	while (pos < length && !IsEOLChar(text[pos])) {
+		++pos;
+	}
+	return pos;
+}
+
+uint32_t HashLine(const char *text, size_t length) noexcept {
+	constexpr uint64_t prime = UINT64_C(0x9E3779B97F4A7C15);
+	uint64_t hash = length*prime;
+	while (length >= 8) {
+		uint64_t value;
+		memcpy(&value, text, sizeof(value));
+		hash = (hash ^ value)*prime;
+		hash ^= hash >> 29;
+		text += 8;
+		length -= 8;
+	}
+	if (length != 0) {
+		uint64_t value = 0;
+		memcpy(&value, text, length);
+		hash = (hash ^ value)*prime;
+	}
+	hash ^= hash >> 32;
+	return static_cast<uint32_t>(hash*prime >> 32);
+}
+
+// returns start of next line.
+inline size_t SkipEOL(const char *text, size_t pos, size_t length) noexcept {
+	if (pos < length) {
+		if (text[pos] == '\r' && pos + 1 < length && text[pos + 1] == '\n') {
+			++pos;
+		}
+		++pos;
+	}
+	return pos;
+}
+
+}
+
+DuplicateLineFinder::~DuplicateLineFinder() {
+	free(lines);
+	free(groups);
+	free(table);
+}
+
+// double the hash table to keep it at most half full.
+bool DuplicateLineFinder::Grow() noexcept {
+	const uint32_t mask = (tableMask == 0) ? 1024 - 1 : tableMask*2 + 1;
+	if (mask <= tableMask) {
+		return false;
+	}
+	uint32_t *newTable = static_cast<uint32_t *>(calloc(static_cast<size_t>(mask) + 1, sizeof(uint32_t)));
+	if (newTable == nullptr) {
+		return false;
+	}
+	for (uint32_t index = 0; index < groupCount; index++) {
+		uint32_t slot = groups[index].hash & mask;
+		while (newTable[slot] != 0) {
+			slot = (slot + 1) & mask;
+		}
+		newTable[slot] = index + 1;
+	}
+	free(table);
+	table = newTable;
+	tableMask = mask;
+	return true;
+}
+
+bool DuplicateLineFinder::SameLine(size_t start, const char *line, size_t length) const noexcept {
+	const size_t end = start + length;
+	return end <= textLength && (end == textLength || IsEOLChar(text[end]))
+		&& memcmp(text + start, line, length) == 0;
+}
+
+bool DuplicateLineFinder::Find(const char *text_, size_t length) noexcept {
+	text = text_;
+	textLength = length;
+	lineCount = 0;
+	groupCount = 0;
+	if (table == nullptr) {
+		if (!Grow()) {
+			return false;
+		}
+	} else {
+		memset(table, 0, (static_cast<size_t>(tableMask) + 1)*sizeof(uint32_t));
+	}
+
+	size_t pos = 0;
+	while (pos < length) {
+		const size_t start = pos;
+		pos = FindEOL(text, pos, length);
+		const size_t lineLength = pos - start;
+		const uint32_t hash = HashLine(text + start, lineLength);
+		pos = SkipEOL(text, pos, length);
+
+		if (lineCount == lineCapacity) {
+			if (lineCapacity == UINT32_MAX) {
+				return false;
+			}
+			const uint32_t capacity = (lineCapacity < 1024) ? 1024 : ((lineCapacity < UINT32_MAX/2) ? lineCapacity*2 : UINT32_MAX);
+			uint32_t *newLines = static_cast<uint32_t *>(realloc(lines, static_cast<size_t>(capacity)*sizeof(uint32_t)));
+			if (newLines == nullptr) {
+				return false;
+			}
+			lines = newLines;
+			lineCapacity = capacity;
+		}
+
+		uint32_t slot = hash & tableMask;
+		uint32_t entry;
+		while ((entry = table[slot]) != 0) {
+			const Group &group = groups[entry - 1];
+			if (group.hash == hash && SameLine(group.start, text + start, lineLength)) {
+				break;
+			}
+			slot = (slot + 1) & tableMask;
+		}
+		if (entry != 0) {
+			groups[entry - 1].count++;
+			lines[lineCount++] = entry - 1;
+			continue;
+		}
+
+		// new distinct line, group count is less than line count
+		if (groupCount == groupCapacity) {
+			const uint32_t capacity = (groupCapacity < 1024) ? 1024 : ((groupCapacity < UINT32_MAX/2) ? groupCapacity*2 : UINT32_MAX);
+			Group *newGroups = static_cast<Group *>(realloc(groups, static_cast<size_t>(capacity)*sizeof(Group)));
+			if (newGroups == nullptr) {
+				return false;
+			}
+			groups = newGroups;
+			groupCapacity = capacity;
+		}
+		if (groupCount >= tableMask/2) {
+			if (!Grow()) {
+				return false;
+			}
+			slot = hash & tableMask;
+			while (table[slot] != 0) {
+				slot = (slot + 1) & tableMask;
+			}
+		}
+		Group &group = groups[groupCount];
+		group.start = start;
+		group.hash = hash;
+		group.count = 1;
+		lines[lineCount++] = groupCount;
+		++groupCount;
+		table[slot] = groupCount;
+	}
+	return true;
+}
+
+uint32_t DuplicateLineFinder::DropCount(unsigned flags) const noexcept {
+	uint32_t count = 0;
+	for (uint32_t index = 0; index < groupCount; index++) {
+		const Group &group = groups[index];
+		if (group.count == 1) {
+			count += (flags & DuplicateLineDropUnique) ? 1 : 0;
+		} else {
+			count += (flags & DuplicateLineDropFirst) ? 1 : 0;
+			count += (flags & DuplicateLineDropRepeat) ? group.count - 1 : 0;
+		}
+	}
+	return count;
+}
+
+size_t DuplicateLineFinder::Filter(char *output, unsigned flags) const noexcept {
+	size_t outLength = 0;
+	size_t lastEOL = 0;
+	size_t pos = 0;
+	for (uint32_t index = 0; index < lineCount; index++) {
+		const size_t start = pos;
+		pos = FindEOL(text, pos, textLength);
+		const size_t lineEnd = pos;
+		pos = SkipEOL(text, pos, textLength);
+
+		const Group &group = groups[lines[index]];
+		unsigned drop;
+		if (group.count == 1) {
+			drop = DuplicateLineDropUnique;
+		} else if (group.start == start) {
+			drop = DuplicateLineDropFirst;
+		} else {
+			drop = DuplicateLineDropRepeat;
+		}
+		if (!(flags & drop)) {
+			memcpy(output + outLength, text + start, pos - start);
+			outLength += pos - start;
+			lastEOL = pos - lineEnd;
+		}
+	}
+	if (textLength != 0 && !IsEOLChar(text[textLength - 1])) {
+		// no line ending on last line
+		outLength -= lastEOL;
+	}
+	return outLength;
+}
+
+size_t DuplicateLineFinder::MemoryUsage() const noexcept {
+	return static_cast<size_t>(lineCapacity)*sizeof(uint32_t)
+		+ static_cast<size_t>(groupCapacity)*sizeof(Group)
+		+ ((table == nullptr) ? 0 : (static_cast<size_t>(tableMask) + 1)*sizeof(uint32_t));
+}
@@ -0,0 +1,59 @@
+// Duplicate line finder for removing duplicate or unique lines in original order
+#pragma once
+
+// Lines end with CR, LF or CR+LF, text after last line ending is the last line when not empty.
+// Lines with same content are grouped with a hash table sized by number of distinct lines,
+// each line only takes a 32-bit group index, so text with up to UINT32_MAX lines is supported.
+
+enum {
+	DuplicateLineDropUnique = 1,	// lines appear only once
+	DuplicateLineDropFirst = 2,		// first line of lines appear more than once
+	DuplicateLineDropRepeat = 4,	// lines same as a previous line
+};
+
+class DuplicateLineFinder {
+public:
+	DuplicateLineFinder() noexcept = default;
+	DuplicateLineFinder(const DuplicateLineFinder &) = delete;
+	DuplicateLineFinder &operator=(const DuplicateLineFinder &) = delete;
+	~DuplicateLineFinder();
+
+	// returns false on out of memory or too many lines. text must be kept until Filter() finished.
+	bool Find(const char *text, size_t length) noexcept;
+
+	uint32_t LineCount() const noexcept {
+		return lineCount;
+	}
+	// number of distinct lines.
+	uint32_t GroupCount() const noexcept {
+		return groupCount;
+	}
+	// number of lines dropped by DuplicateLineDrop* flags.
+	uint32_t DropCount(unsigned flags) const noexcept;
+	// copy lines not dropped with their line ending into output, which has at least length bytes.
+	// line ending after last copied line is removed when text not ends with line ending.
+	size_t Filter(char *output, unsigned flags) const noexcept;
+	// bytes allocated for lines, groups and hash table.
+	size_t MemoryUsage() const noexcept;
+
+private:
+	struct Group {
+		size_t start;		// first line
+		uint32_t hash;
+		uint32_t count;
+	};
+
+	bool Grow() noexcept;
+	bool SameLine(size_t start, const char *line, size_t length) const noexcept;
+
+	const char *text = nullptr;
+	size_t textLength = 0;
+	uint32_t *lines = nullptr;		// group index of each line
+	uint32_t lineCount = 0;
+	uint32_t lineCapacity = 0;
+	Group *groups = nullptr;
+	uint32_t groupCount = 0;
+	uint32_t groupCapacity = 0;
+	uint32_t *table = nullptr;		// group index + 1, zero for empty slot
+	uint32_t tableMask = 0;
+};
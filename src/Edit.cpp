@@ -40,6 +40,13 @@ struct IUnknown;
 #include "Edit.h"
 #include "Styles.h"
 #include "Dialogs.h"
+#include "Validator.h"
+#include "TagIndex.h"
+#include "Compression.h"
+#include "FileDataCache.h"
+#include "BackgroundJob.h"
+#include "ThreadJobExecutor.h"
+#include "DuplicateLines.h"
 #include "resource.h"
 
 extern HWND hwndMain;
@@ -70,6 +77,12 @@ static LPWSTR wchPrefixSelection;
 static LPWSTR wchAppendSelection;
 static LPWSTR wchPrefixLines;
 static LPWSTR wchAppendLines;
+static void EditCancelWellFormed() noexcept;
+
+// raw (decompressed) file data of current document, kept from loading until the
+// document is modified, so reloading with another encoding doesn't read the file again.
+static void *EditReallocFileData(void *block, size_t size) noexcept;
+static FileDataCache rawFileData{EditReallocFileData};
 
 // see TransliterateText()
 #if defined(_MSC_VER) && (_WIN32_WINNT >= _WIN32_WINNT_WIN7)
@@ -104,6 +117,9 @@ void Edit_ReleaseResources() noexcept {
 	NP2HeapFree(wchAppendSelection);
 	NP2HeapFree(wchPrefixLines);
 	NP2HeapFree(wchAppendLines);
+	EditFreeRawFileData();
+	EditCancelWellFormed();
+	NP2ScratchRelease();
 #if NP2_DYNAMIC_LOAD_ELSCORE_DLL
 	if (hELSCoreDLL != nullptr) {
 		FreeLibrary(hELSCoreDLL);
@@ -132,6 +148,14 @@ extern bool bLargeFileMode;
 #endif
 extern int iWrapColumn;
 extern int iWordWrapIndent;
+extern DWORD dwCompressDocumentSize;
+
+// keep huge read-mostly document (e.g. log) compressed in memory, it's decompressed on modification.
+static void EditCompressDocument(size_t length) noexcept {
+	if (dwCompressDocumentSize != 0 && length >= (static_cast<size_t>(dwCompressDocumentSize) << 20)) {
+		SciCall_CompressDocument();
+	}
+}
 
 void EditSetNewText(LPCSTR lpstrText, DWORD cbText, Sci_Line lineCount) noexcept {
 	bFreezeAppTitle = true;
@@ -182,6 +206,7 @@ void EditSetNewText(LPCSTR lpstrText, DWORD cbText, Sci_Line lineCount) noexcept
 	SciCall_SetUndoCollection(true);
 	SciCall_EmptyUndoBuffer();
 	SciCall_SetSavePoint();
+	EditCompressDocument(cbText);
 
 	bFreezeAppTitle = false;
 }
@@ -962,6 +987,108 @@ labelStart:
 #endif
 }
 
+void EditFreeRawFileData() noexcept {
+	rawFileData.Clear();
+}
+
+// decompressed content replaces file data, the padding is cleared by Decompressor,
+// so large buffer is not zeroed on allocation.
+static void *EditReallocFileData(void *block, size_t size) noexcept {
+	if (size == 0) {
+		if (block != nullptr) {
+			HeapFree(g_hDefaultHeap, 0, block);
+		}
+		return nullptr;
+	}
+	return (block == nullptr) ? HeapAlloc(g_hDefaultHeap, 0, size) : HeapReAlloc(g_hDefaultHeap, 0, block, size);
+}
+
+// size of decompressed content is unknown after it exceeded the limit, shown as "> limit".
+static void EditWarnLoadBigFile(LPCWSTR pszFile, LONGLONG fileSize, LONGLONG maxFileSize, bool sizeExceeded) noexcept {
+	WCHAR tchDocSize[32];
+	WCHAR tchMaxSize[32];
+	WCHAR tchDocBytes[32];
+	WCHAR tchMaxBytes[32];
+	StrFormatByteSize(maxFileSize, tchMaxSize, COUNTOF(tchMaxSize));
+	FormatNumber64(tchMaxBytes, maxFileSize);
+	if (sizeExceeded) {
+		wsprintf(tchDocSize, L"> %s", tchMaxSize);
+		wsprintf(tchDocBytes, L"> %s", tchMaxBytes);
+	} else {
+		StrFormatByteSize(fileSize, tchDocSize, COUNTOF(tchDocSize));
+		FormatNumber64(tchDocBytes, fileSize);
+	}
+	MsgBoxWarn(MB_OK, IDS_WARNLOADBIGFILE, pszFile, tchDocSize, tchDocBytes, tchMaxSize, tchMaxBytes);
+}
+
+static DWORD WINAPI DecompressThreadProc(LPVOID lpParam) noexcept {
+	static_cast<Decompressor *>(lpParam)->Run();
+	return 0;
+}
+
+// replaces gzip or Zstandard file data with decompressed content. data is loaded as is
+// when it's corrupt or unsupported, e.g. a binary file starts with same magic bytes.
+static bool EditDecompressFileData(LPCWSTR pszFile, char *&lpData, DWORD &cbData, LONGLONG maxFileSize, EditFileIOStatus &status) noexcept {
+	#define MAX_DECOMPRESS_THREADS	16
+	status.compression = CompressionFormat::None;
+	const CompressionFormat format = DetectCompression(lpData, cbData);
+	if (format == CompressionFormat::None) {
+		return true;
+	}
+
+	Decompressor decompressor;
+	const size_t maxSize = static_cast<size_t>(min<ULONGLONG>(maxFileSize, MAXDWORD));
+	if (decompressor.Prepare(format, lpData, cbData, maxSize, NP2_ENCODING_DETECTION_PADDING, EditReallocFileData)) {
+		// BGZF blocks or Zstandard frames are decoded in parallel
+		HANDLE workers[MAX_DECOMPRESS_THREADS - 1];
+		DWORD workerCount = 0;
+		const size_t segments = decompressor.Segments();
+		if (segments > 1) {
+			SYSTEM_INFO info;
+			GetNativeSystemInfo(&info);
+			DWORD threads = min<DWORD>(info.dwNumberOfProcessors, MAX_DECOMPRESS_THREADS);
+			if (threads > segments) {
+				threads = static_cast<DWORD>(segments);
+			}
+			while (workerCount + 1 < threads) {
+				HANDLE worker = CreateThread(nullptr, 0, DecompressThreadProc, &decompressor, 0, nullptr);
+				if (worker == nullptr) {
+					break;
+				}
+				workers[workerCount++] = worker;
+			}
+		}
+		decompressor.Run();
+		if (workerCount != 0) {
+			WaitForMultipleObjects(workerCount, workers, TRUE, INFINITE);
+			for (DWORD i = 0; i < workerCount; i++) {
+				CloseHandle(workers[i]);
+			}
+		}
+	}
+
+	switch (decompressor.Status()) {
+	case DecompressStatus::Ok:
+		NP2HeapFree(lpData);
+		cbData = static_cast<DWORD>(decompressor.Length());
+		lpData = decompressor.Detach();
+		status.compression = format;
+		return true;
+	case DecompressStatus::TooLarge:
+		dwLastIOError = ERROR_FILE_TOO_LARGE;
+		status.bFileTooBig = true;
+		EditWarnLoadBigFile(pszFile, 0, static_cast<LONGLONG>(maxSize), true);
+		break;
+	case DecompressStatus::OutOfMemory:
+		dwLastIOError = ERROR_NOT_ENOUGH_MEMORY;
+		break;
+	default:
+		return true;
+	}
+	NP2HeapFree(lpData);
+	return false;
+}
+
 //=============================================================================
 //
 // EditLoadFile()
@@ -1023,29 +1150,45 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 	if (fileSize.QuadPart > maxFileSize) {
 		CloseHandle(hFile);
 		status.bFileTooBig = true;
-		WCHAR tchDocSize[32];
-		WCHAR tchMaxSize[32];
-		WCHAR tchDocBytes[32];
-		WCHAR tchMaxBytes[32];
-		StrFormatByteSize(fileSize.QuadPart, tchDocSize, COUNTOF(tchDocSize));
-		StrFormatByteSize(maxFileSize, tchMaxSize, COUNTOF(tchMaxSize));
-		FormatNumber64(tchDocBytes, fileSize.QuadPart);
-		FormatNumber64(tchMaxBytes, maxFileSize);
-		MsgBoxWarn(MB_OK, IDS_WARNLOADBIGFILE, pszFile, tchDocSize, tchDocBytes, tchMaxSize, tchMaxBytes);
+		EditWarnLoadBigFile(pszFile, fileSize.QuadPart, maxFileSize, false);
 		return false;
 	}
 
-	char *lpData = static_cast<char *>(NP2HeapAlloc(static_cast<size_t>(fileSize.QuadPart) + NP2_ENCODING_DETECTION_PADDING));
+	FILETIME ftLastWrite{};
+	GetFileTime(hFile, nullptr, nullptr, &ftLastWrite);
+	const FileDataKey fileKey = {
+		pszFile,
+		static_cast<uint64_t>(fileSize.QuadPart),
+		(static_cast<uint64_t>(ftLastWrite.dwHighDateTime) << 32) | ftLastWrite.dwLowDateTime,
+	};
+	size_t cbKept = 0;
+	char *lpData = status.bRecode ? rawFileData.Take(fileKey, cbKept, status.compression) : nullptr;
 	DWORD cbData = 0;
-	const BOOL bReadSuccess = ReadFile(hFile, lpData, static_cast<DWORD>(fileSize.QuadPart), &cbData, nullptr);
-	dwLastIOError = GetLastError();
-	CloseHandle(hFile);
+	if (lpData != nullptr) {
+		// file not changed since loaded, take back the kept data
+		CloseHandle(hFile);
+		cbData = static_cast<DWORD>(cbKept);
+	} else {
+		EditFreeRawFileData();
+		lpData = static_cast<char *>(NP2HeapAlloc(static_cast<size_t>(fileSize.QuadPart) + NP2_ENCODING_DETECTION_PADDING));
+		const BOOL bReadSuccess = ReadFile(hFile, lpData, static_cast<DWORD>(fileSize.QuadPart), &cbData, nullptr);
+		dwLastIOError = GetLastError();
+		CloseHandle(hFile);
 
-	if (!bReadSuccess) {
-		NP2HeapFree(lpData);
-		return false;
+		if (!bReadSuccess) {
+			NP2HeapFree(lpData);
+			return false;
+		}
+		if (!EditDecompressFileData(pszFile, lpData, cbData, maxFileSize, status)) {
+			return false;
+		}
 	}
 
+	// raw data is not modified below (except byte swap which is restored),
+	// it's kept for reloading with another encoding.
+	char * const lpRawData = lpData;
+	const DWORD cbRawData = cbData;
+
 	status.iEOLMode = GetScintillaEOLMode(iDefaultEOLMode);
 	status.bInconsistent = false;
 	status.totalLineCount = 1;
@@ -1087,8 +1230,11 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 			// remove the NULL terminator.
 			cbData -= 1;
 		}
+		if (uFlags & NCP_UNICODE_REVERSE) {
+			// restore byte order of raw data
+			_swab(lpRawData, lpRawData, cbRawData);
+		}
 
-		NP2HeapFree(lpData);
 		lpData = lpDataUTF8;
 		fvCurFile.Init(lpData, cbData);
 	} else if (uFlags & NCP_UTF8) {
@@ -1100,7 +1246,6 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 		if (encodingFlag != EncodingFlag_UTF7 || (uFlags & NCP_7BIT) != 0) {
 			const UINT uCodePage = mEncoding[iEncoding].uCodePage;
 			lpDataUTF8 = RecodeAsUTF8(lpData, &cbData, uCodePage, 0);
-			NP2HeapFree(lpData);
 			lpData = lpDataUTF8;
 		}
 	} else if (cbData < MAX_NON_UTF8_SIZE && (encodingFlag & (EncodingFlag_Binary | EncodingFlag_Invalid)) == 0
@@ -1111,7 +1256,6 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 		const UINT legacyACP = mEncoding[CPI_DEFAULT].uCodePage;
 		char * const result = RecodeAsUTF8(lpData, &back, legacyACP, MB_ERR_INVALID_CHARS);
 		if (result) {
-			NP2HeapFree(lpData);
 			lpDataUTF8 = result;
 			lpData = result;
 			cbData = back;
@@ -1127,10 +1271,32 @@ bool EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept {
 	SciCall_SetCodePage((uFlags & NCP_DEFAULT) ? iDefaultCodePage : SC_CP_UTF8);
 	EditSetNewText(lpDataUTF8, cbData, status.totalLineCount);
 
-	NP2HeapFree(lpData);
+	if (lpData != lpRawData) {
+		NP2HeapFree(lpData);
+	}
+	// dropped on SCN_SAVEPOINTLEFT or loading another file, freed when too large
+	rawFileData.Keep(lpRawData, cbRawData, status.compression, fileKey);
 	return true;
 }
 
+// writes to file, or collects text to be compressed when saving compressed file.
+static BOOL EditWriteFile(HANDLE hFile, LPCVOID lpBuffer, DWORD cbData, Compressor *compressor) noexcept {
+	if (compressor != nullptr) {
+		if (compressor->Write(lpBuffer, cbData)) {
+			return TRUE;
+		}
+		SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+		return FALSE;
+	}
+	DWORD dwBytesWritten;
+	return WriteFile(hFile, lpBuffer, cbData, &dwBytesWritten, nullptr);
+}
+
+// truncates file before writing, deferred until compressed data is ready when saving compressed file.
+static BOOL EditTruncateFile(HANDLE hFile, const Compressor *compressor) noexcept {
+	return compressor != nullptr || SetEndOfFile(hFile);
+}
+
 //=============================================================================
 //
 // EditSaveFile()
@@ -1177,6 +1343,8 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 	}
 
 	BOOL bWriteSuccess;
+	Compressor compressor{status.compression};
+	Compressor * const pCompressor = (status.compression == CompressionFormat::None) ? nullptr : &compressor;
 	// get text
 	DWORD cbData = static_cast<DWORD>(SciCall_GetLength());
 	char *lpData = nullptr;
@@ -1184,17 +1352,16 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 	UINT uFlags = mEncoding[iEncoding].uFlags;
 
 	if (cbData == 0) {
-		bWriteSuccess = SetEndOfFile(hFile);
+		bWriteSuccess = EditTruncateFile(hFile, pCompressor);
 		// write encoding BOM
-		DWORD dwBytesWritten;
 		if (uFlags & NCP_UNICODE_BOM) {
 			if (uFlags & NCP_UNICODE_REVERSE) {
-				bWriteSuccess = WriteFile(hFile, "\xFE\xFF", 2, &dwBytesWritten, nullptr);
+				bWriteSuccess = EditWriteFile(hFile, "\xFE\xFF", 2, pCompressor);
 			} else {
-				bWriteSuccess = WriteFile(hFile, "\xFF\xFE", 2, &dwBytesWritten, nullptr);
+				bWriteSuccess = EditWriteFile(hFile, "\xFF\xFE", 2, pCompressor);
 			}
 		} else if (uFlags & NCP_UTF8_SIGN) {
-			bWriteSuccess = WriteFile(hFile, "\xEF\xBB\xBF", 3, &dwBytesWritten, nullptr);
+			bWriteSuccess = EditWriteFile(hFile, "\xEF\xBB\xBF", 3, pCompressor);
 		}
 		dwLastIOError = GetLastError();
 	} else {
@@ -1229,18 +1396,17 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 		}
 #endif
 
-		DWORD dwBytesWritten;
 		if (uFlags & NCP_UNICODE) {
-			SetEndOfFile(hFile);
+			EditTruncateFile(hFile, pCompressor);
 
 			LPWSTR lpDataWide = static_cast<LPWSTR>(NP2HeapAlloc(cbData * sizeof(WCHAR) + 16));
 			const int cbDataWide = MultiByteToWideChar(CP_UTF8, 0, lpData, cbData, lpDataWide, static_cast<int>(NP2HeapSize(lpDataWide) / sizeof(WCHAR)));
 
 			if (uFlags & NCP_UNICODE_BOM) {
 				if (uFlags & NCP_UNICODE_REVERSE) {
-					WriteFile(hFile, "\xFE\xFF", 2, &dwBytesWritten, nullptr);
+					EditWriteFile(hFile, "\xFE\xFF", 2, pCompressor);
 				} else {
-					WriteFile(hFile, "\xFF\xFE", 2, &dwBytesWritten, nullptr);
+					EditWriteFile(hFile, "\xFF\xFE", 2, pCompressor);
 				}
 			}
 
@@ -1248,18 +1414,18 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 				_swab(reinterpret_cast<char *>(lpDataWide), reinterpret_cast<char *>(lpDataWide), static_cast<int>(cbDataWide * sizeof(WCHAR)));
 			}
 
-			bWriteSuccess = WriteFile(hFile, lpDataWide, cbDataWide * sizeof(WCHAR), &dwBytesWritten, nullptr);
+			bWriteSuccess = EditWriteFile(hFile, lpDataWide, cbDataWide * sizeof(WCHAR), pCompressor);
 			dwLastIOError = GetLastError();
 
 			NP2HeapFree(lpDataWide);
 		} else if (uFlags & NCP_UTF8) {
-			SetEndOfFile(hFile);
+			EditTruncateFile(hFile, pCompressor);
 
 			if (uFlags & NCP_UTF8_SIGN) {
-				WriteFile(hFile, "\xEF\xBB\xBF", 3, &dwBytesWritten, nullptr);
+				EditWriteFile(hFile, "\xEF\xBB\xBF", 3, pCompressor);
 			}
 
-			bWriteSuccess = WriteFile(hFile, lpData, cbData, &dwBytesWritten, nullptr);
+			bWriteSuccess = EditWriteFile(hFile, lpData, cbData, pCompressor);
 			dwLastIOError = GetLastError();
 		} else if (uFlags & (NCP_8BIT | NCP_7BIT)) {
 			BOOL bCancelDataLoss = FALSE;
@@ -1282,16 +1448,16 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 			NP2HeapFree(lpDataWide);
 
 			if (!bCancelDataLoss || InfoBoxWarn(MB_OKCANCEL, L"MsgConv3", IDS_ERR_UNICODE2) == IDOK) {
-				SetEndOfFile(hFile);
-				bWriteSuccess = WriteFile(hFile, lpData, cbData, &dwBytesWritten, nullptr);
+				EditTruncateFile(hFile, pCompressor);
+				bWriteSuccess = EditWriteFile(hFile, lpData, cbData, pCompressor);
 				dwLastIOError = GetLastError();
 			} else {
 				bWriteSuccess = FALSE;
 				status.bCancelDataLoss = true;
 			}
 		} else {
-			SetEndOfFile(hFile);
-			bWriteSuccess = WriteFile(hFile, lpData, cbData, &dwBytesWritten, nullptr);
+			EditTruncateFile(hFile, pCompressor);
+			bWriteSuccess = EditWriteFile(hFile, lpData, cbData, pCompressor);
 			dwLastIOError = GetLastError();
 		}
 	}
@@ -1300,10 +1466,27 @@ bool EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &st
 		NP2HeapFree(lpData);
 	}
 
+	if (bWriteSuccess && pCompressor != nullptr) {
+		if (!compressor.Finish()) {
+			bWriteSuccess = FALSE;
+			dwLastIOError = ERROR_NOT_ENOUGH_MEMORY;
+		} else if (compressor.Length() > MAXDWORD) {
+			bWriteSuccess = FALSE;
+			dwLastIOError = ERROR_FILE_TOO_LARGE;
+		} else {
+			// truncated only after compression succeeded, so failure above keeps the original file
+			DWORD dwBytesWritten;
+			bWriteSuccess = SetEndOfFile(hFile)
+				&& WriteFile(hFile, compressor.Data(), static_cast<DWORD>(compressor.Length()), &dwBytesWritten, nullptr);
+			dwLastIOError = GetLastError();
+		}
+	}
+
 	CloseHandle(hFile);
 	if (bWriteSuccess) {
 		if (!(saveFlag & FileSaveFlag_SaveCopy)) {
 			SciCall_SetSavePoint();
+			EditCompressDocument(SciCall_GetLength());
 		}
 		return true;
 	}
@@ -2111,8 +2294,8 @@ void EditShowHex() noexcept {
 		return;
 	}
 
-	char *ch = static_cast<char *>(NP2HeapAlloc(count + 1));
-	char *cch = static_cast<char *>(NP2HeapAlloc(count * 3 + 3));
+	char *ch = static_cast<char *>(NP2ScratchAlloc(count + 1));
+	char *cch = static_cast<char *>(NP2ScratchAlloc(count * 3 + 3));
 	SciCall_GetSelBytes(ch);
 	const uint8_t *p = reinterpret_cast<const uint8_t *>(ch);
 	const uint8_t * const end = p + count;
@@ -2125,12 +2308,13 @@ void EditShowHex() noexcept {
 		*t++ = ' ';
 	} while (p < end);
 	t[-1] = ']';
+	*t = '\0';
 
 	const Sci_Position iSelEnd = SciCall_GetSelectionEnd();
 	SciCall_InsertText(iSelEnd, cch);
 	SciCall_SetSel(iSelEnd, iSelEnd + (t - cch));
-	NP2HeapFree(ch);
-	NP2HeapFree(cch);
+	NP2ScratchFree(ch);
+	NP2ScratchFree(cch);
 }
 
 void EditBase64Encode(Base64EncodingFlag encodingFlag) noexcept {
@@ -2143,10 +2327,10 @@ void EditBase64Encode(Base64EncodingFlag encodingFlag) noexcept {
 		return;
 	}
 
-	char *input = static_cast<char *>(NP2HeapAlloc(len + 1));
+	char *input = static_cast<char *>(NP2ScratchAlloc(len + 1));
 	SciCall_GetSelBytes(input);
 	size_t outLen = (len*4)/3 + 4 + MAX_PATH*2;
-	char *output = static_cast<char *>(NP2HeapAlloc(outLen));
+	char *output = static_cast<char *>(NP2ScratchAlloc(outLen));
 	outLen = 0;
 	if (encodingFlag == Base64EncodingFlag_HtmlEmbeddedImage) {
 		memcpy(output, "<img src=\"data:image/", CSTRLEN("<img src=\"data:image/"));
@@ -2169,8 +2353,8 @@ void EditBase64Encode(Base64EncodingFlag encodingFlag) noexcept {
 	}
 
 	EditReplaceMainSelection(outLen, output);
-	NP2HeapFree(input);
-	NP2HeapFree(output);
+	NP2ScratchFree(input);
+	NP2ScratchFree(output);
 }
 
 void EditBase64Decode(bool decodeAsHex) noexcept {
@@ -2183,17 +2367,17 @@ void EditBase64Decode(bool decodeAsHex) noexcept {
 		return;
 	}
 
-	char *input = static_cast<char *>(NP2HeapAlloc(len + 1));
+	char *input = static_cast<char *>(NP2ScratchAlloc(len + 1));
 	SciCall_GetSelText(input);
 	size_t outLen = (len*3)/4 + 4;
-	uint8_t *output = static_cast<uint8_t *>(NP2HeapAlloc(outLen));
+	uint8_t *output = static_cast<uint8_t *>(NP2ScratchAlloc(outLen));
 	outLen = Base64Decode(output, reinterpret_cast<const uint8_t *>(input), len);
-	NP2HeapFree(input);
+	NP2ScratchFree(input);
 	if (outLen != 0) {
 		if(decodeAsHex) {
 			const int iEOLMode = SciCall_GetEOLMode();
 			len = outLen*3 + outLen/8;
-			input = static_cast<char *>(NP2HeapAlloc(len + 1));
+			input = static_cast<char *>(NP2ScratchAlloc(len + 1));
 			char *t = input;
 			size_t i = 0;
 			do {
@@ -2221,12 +2405,106 @@ void EditBase64Decode(bool decodeAsHex) noexcept {
 				--t;
 			}
 			outLen = t - input;
-			NP2HeapFree(output);
+			NP2ScratchFree(output);
 			output = reinterpret_cast<uint8_t *>(input);
 		}
 		EditReplaceMainSelection(outLen, reinterpret_cast<char *>(output));
 	}
-	NP2HeapFree(output);
+	NP2ScratchFree(output);
+}
+
+//=============================================================================
+//
+// EditCheckWellFormed()
+//
+// check JSON or XML document on a snapshot in background thread,
+// result is committed on main window with APPM_JOB_DONE.
+#define WELLFORMED_INLINE_SIZE	(256*1024)
+class WellFormedJob final : public BackgroundJob {
+public:
+	bool xml;
+	bool utf8;
+	WellFormedResult result;
+
+protected:
+	bool Run() noexcept override;
+	void Apply() noexcept override;
+};
+
+static WellFormedJob wellFormedJob;
+static ThreadJobExecutor jobExecutor;
+static InlineJobExecutor inlineExecutor;
+
+bool WellFormedJob::Run() noexcept {
+	return xml
+		? CheckXMLWellFormed(Text(), Length(), utf8, result, ContinueProc, this)
+		: CheckJSONWellFormed(Text(), Length(), utf8, result, ContinueProc, this);
+}
+
+static void EditClearWellFormedError() noexcept {
+	SciCall_MarkerDeleteAll(MarkerNumber_WellFormedError);
+	SciCall_SetIndicatorCurrent(IndicatorNumber_WellFormedError);
+	SciCall_IndicatorClearRange(0, SciCall_GetLength());
+}
+
+void WellFormedJob::Apply() noexcept {
+	LPCWSTR kind = xml ? L"XML" : L"JSON";
+	if (result.message == nullptr) {
+		MsgBoxInfo(MB_OK, IDS_WELLFORMED_OK, kind);
+		return;
+	}
+
+	// document may be changed while checking
+	const Sci_Position length = SciCall_GetLength();
+	const Sci_Position position = min(static_cast<Sci_Position>(result.position), length);
+	EditSelectEx(position, position);
+	const Sci_Line iLine = SciCall_LineFromPosition(position);
+	// mark the line and the character at error, or last character for error at end of document
+	SciCall_MarkerAdd(iLine, MarkerNumber_WellFormedError);
+	Sci_Position start = position;
+	const Sci_Position end = SciCall_PositionAfter(position);
+	if (end == start) {
+		start = SciCall_PositionBefore(position);
+	}
+	SciCall_SetIndicatorCurrent(IndicatorNumber_WellFormedError);
+	SciCall_IndicatorFillRange(start, end - start);
+	WCHAR tchLine[32];
+	WCHAR tchColumn[32];
+	FormatNumber(tchLine, iLine + 1);
+	FormatNumber(tchColumn, SciCall_GetColumn(position) + 1);
+	MsgBoxWarn(MB_OK, IDS_WELLFORMED_ERROR, kind, tchLine, tchColumn, result.message);
+}
+
+static void EditCancelWellFormed() noexcept {
+	jobExecutor.Cancel(wellFormedJob);
+}
+
+void EditCheckWellFormed() noexcept {
+	WellFormedJob &job = wellFormedJob;
+	EditCancelWellFormed();
+	EditClearWellFormedError();
+
+	const size_t length = SciCall_GetLength();
+	if (!job.TakeSnapshot(SciCall_GetRangePointer(0, length), length)) {
+		return;
+	}
+	job.utf8 = SciCall_GetCodePage() == SC_CP_UTF8;
+	if (pLexCurrent->iLexer == SCLEX_XML || pLexCurrent->iLexer == SCLEX_JSON) {
+		job.xml = pLexCurrent->iLexer == SCLEX_XML;
+	} else {
+		// guess from first non-blank character
+		const char *ptr = job.Text();
+		while (IsASpace(*ptr)) {
+			++ptr;
+		}
+		job.xml = *ptr == '<';
+	}
+	if (length < WELLFORMED_INLINE_SIZE) {
+		inlineExecutor.Submit(job);
+	} else {
+		jobExecutor.Init(hwndMain, APPM_JOB_DONE);
+		jobExecutor.Submit(job);
+	}
 }
 
 //=============================================================================
@@ -2258,7 +2536,7 @@ static int ConvertNumRadix(char *tch, uint64_t num, int radix) noexcept {
 		buf[index--] = 'O';
 		buf[index] = '0';
 		length += 2;
-		strcat(tch, buf + index);
+		memcpy(tch, buf + index, length);
 		return length;
 	}
 	break;
@@ -2286,7 +2564,7 @@ static int ConvertNumRadix(char *tch, uint64_t num, int radix) noexcept {
 		buf[index--] = 'b';
 		buf[index] = '0';
 		length += 2;
-		strcat(tch, buf + index);
+		memcpy(tch, buf + index, length);
 		return length;
 	}
 	break;
@@ -2311,8 +2589,8 @@ void EditConvertNumRadix(int radix) noexcept {
 	radix -= IDM_EDIT_NUM2BIN;
 	radix = (radix == 1) ? 10 : (2 << radix);
 
-	char *ch = static_cast<char *>(NP2HeapAlloc(count + 1));
-	char *tch = static_cast<char *>(NP2HeapAlloc(2 + count * 4 + 8 + 1));
+	char *ch = static_cast<char *>(NP2ScratchAlloc(count + 1));
+	char *tch = static_cast<char *>(NP2ScratchAlloc(2 + count * 4 + 8 + 1));
 	Sci_Position cch = 0;
 	char *p = ch;
 	uint64_t value = 0;
@@ -2411,8 +2689,8 @@ void EditConvertNumRadix(int radix) noexcept {
 	tch[cch] = '\0';
 
 	EditReplaceMainSelection(cch, tch);
-	NP2HeapFree(ch);
-	NP2HeapFree(tch);
+	NP2ScratchFree(ch);
+	NP2ScratchFree(tch);
 }
 
 //=============================================================================
@@ -2996,14 +3274,43 @@ void EditModifyLines(LPCWSTR pwszPrefix, LPCWSTR pwszAppend, bool skipEmptyLine)
 //
 // EditAlignText()
 //
+namespace {
+
+// count characters in text without tab, same as column returned by SCI_GETCOLUMN
+Sci_Position CountCharacters(const char *s, Sci_Position length, UINT cpEdit) noexcept {
+	Sci_Position count = 0;
+	if (cpEdit == CP_UTF8) {
+		for (Sci_Position i = 0; i < length; i++) {
+			count += (static_cast<uint8_t>(s[i]) & 0xc0) != 0x80;
+		}
+	} else if (cpEdit == 0) {
+		count = length;
+	} else {
+		for (Sci_Position i = 0; i < length; i++, count++) {
+			if (IsDBCSLeadByteEx(cpEdit, s[i])) {
+				++i;
+			}
+		}
+	}
+	return count;
+}
+
+inline char *AppendChars(char *p, char ch, Sci_Position count) noexcept {
+	if (count > 0) {
+		memset(p, ch, count);
+		p += count;
+	}
+	return p;
+}
+
+}
+
 void EditAlignText(EditAlignMode nMode) noexcept {
 	if (SciCall_IsRectangleSelection()) {
 		NotifyRectangleSelection();
 		return;
 	}
 
-#define BUFSIZE_ALIGN 1024
-
 	const Sci_Position iSelStart = SciCall_GetSelectionStart();
 	const Sci_Position iSelEnd = SciCall_GetSelectionEnd();
 	Sci_Position iCurPos = SciCall_GetCurrentPos();
@@ -3019,7 +3326,7 @@ void EditAlignText(EditAlignMode nMode) noexcept {
 		}
 	}
 
-	Sci_Position iMinIndent = BUFSIZE_ALIGN;
+	Sci_Position iMinIndent = PTRDIFF_MAX;
 	Sci_Position iMaxLength = 0;
 	for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
 		Sci_Position iLineEndPos = SciCall_GetLineEndPosition(iLine);
@@ -3042,164 +3349,139 @@ void EditAlignText(EditAlignMode nMode) noexcept {
 		}
 	}
 
-	if (iMaxLength < BUFSIZE_ALIGN) {
-		struct EditAlignTextVar {
-			char tchLineBuf[BUFSIZE_ALIGN * kMaxMultiByteCount];
-			WCHAR wchLineBuf[BUFSIZE_ALIGN];
-			LPWSTR pWords[BUFSIZE_ALIGN];
-			WCHAR wchNewLineBuf[BUFSIZE_ALIGN * 3];
-		};
-		EditAlignTextVar * const var = static_cast<EditAlignTextVar *>(NP2HeapAlloc(sizeof(EditAlignTextVar)));
-		SciCall_BeginUndoAction();
-		for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
-			const Sci_Position iIndentPos = SciCall_GetLineIndentPosition(iLine);
-			const Sci_Position iEndPos = SciCall_GetLineEndPosition(iLine);
+	if (iMaxLength == 0) {
+		// all lines are blank
+		iMinIndent = 0;
+	}
 
-			if (iIndentPos == iEndPos && iEndPos > 0) {
-				const Sci_Position iStartPos = SciCall_PositionFromLine(iLine);
-				SciCall_DeleteRange(iStartPos, iEndPos - iStartPos);
-			} else {
-				char* const tchLineBuf = var->tchLineBuf;
-				WCHAR* const wchLineBuf = var->wchLineBuf;
-				LPWSTR* const pWords = var->pWords;
-				WCHAR * const wchNewLineBuf = var->wchNewLineBuf;
-				WCHAR *p = wchLineBuf;
+	// build aligned text for all lines in one pass, then replace the range once.
+	const Sci_Position iStartPos = SciCall_PositionFromLine(iLineStart);
+	const Sci_Position iEndPos = SciCall_GetLineEndPosition(iLineEnd);
+	const Sci_Position cchText = iEndPos - iStartPos;
+	const char * const pszText = SciCall_GetRangePointer(iStartPos, cchText);
+	const Sci_Position iWidth = iMaxLength - iMinIndent;
+	const bool bUseTabs = SciCall_GetUseTabs();
+	const int iTabWidth = SciCall_GetTabWidth();
+	const Sci_Line iLineCount = SciCall_GetLineCount();
 
-				Sci_Position iWordsLength = 0;
-				const Sci_Position cchLine = SciCall_GetLine(iLine, tchLineBuf);
+	Sci_Position cbAlign = cchText + 1;
+	char *pszAlign = static_cast<char *>(NP2HeapAlloc(cbAlign));
+	Sci_Position cchAlign = 0;
+	Sci_Position iPrevLineEnd = 0;
+	for (Sci_Line iLine = iLineStart; iLine <= iLineEnd; iLine++) {
+		// offsets relative to iStartPos
+		const Sci_Position iLineStartPos = SciCall_PositionFromLine(iLine) - iStartPos;
+		const Sci_Position iIndentPos = SciCall_GetLineIndentPosition(iLine) - iStartPos;
+		Sci_Position iLineEndPos = SciCall_GetLineEndPosition(iLine) - iStartPos;
+		// line end, indentation, padding and text of current line
+		const Sci_Position cbLine = (iLineStartPos - iPrevLineEnd) + iMinIndent + iWidth + (iLineEndPos - iLineStartPos);
+		if (cchAlign + cbLine >= cbAlign) {
+			cbAlign = max(cbAlign*2, cchAlign + cbLine + 1);
+			pszAlign = static_cast<char *>(NP2HeapReAlloc(pszAlign, cbAlign));
+		}
+
+		char *p = pszAlign + cchAlign;
+		memcpy(p, pszText + iPrevLineEnd, iLineStartPos - iPrevLineEnd);
+		p += iLineStartPos - iPrevLineEnd;
+		iPrevLineEnd = iLineEndPos;
+		while (iLineEndPos > iIndentPos && IsASpaceOrTab(pszText[iLineEndPos - 1])) {
+			--iLineEndPos;
+		}
+		if (iIndentPos == iLineEndPos) {
+			// remove white space on blank line
+			cchAlign = p - pszAlign;
+			continue;
+		}
 
-				int iWords = MultiByteToWideChar(cpEdit, 0, tchLineBuf, static_cast<int>(cchLine), wchLineBuf, COUNTOF(var->wchLineBuf));
-				wchLineBuf[iWords] = L'\0';
-				iWords = 0;
-				StrTrim(wchLineBuf, L"\r\n\t ");
+		int iWords = 0;
+		Sci_Position iWordsLength = 0;
+		for (Sci_Position iPos = iIndentPos; iPos < iLineEndPos; ) {
+			const Sci_Position iWordStart = iPos;
+			while (iPos < iLineEndPos && !IsASpaceOrTab(pszText[iPos])) {
+				++iPos;
+			}
+			++iWords;
+			iWordsLength += CountCharacters(pszText + iWordStart, iPos - iWordStart, cpEdit);
+			while (iPos < iLineEndPos && IsASpaceOrTab(pszText[iPos])) {
+				++iPos;
+			}
+		}
 
-				while (*p) {
-					if (*p != L' ' && *p != L'\t') {
-						pWords[iWords++] = p++;
-						iWordsLength++;
-						while (*p && *p != L' ' && *p != L'\t') {
-							p++;
-							iWordsLength++;
-						}
-					} else {
-						*p++ = L'\0';
+		int iGaps = 0;
+		Sci_Position iSpacesPerGap = 0;
+		Sci_Position iExtraSpaces = 0;
+		Sci_Position iOddSpaces = 0;
+		if (nMode == EditAlignMode_Justify || nMode == EditAlignMode_JustifyEx) {
+			bool bNextLineIsBlank = false;
+			if (nMode == EditAlignMode_JustifyEx) {
+				if (iLineCount <= iLine + 1) {
+					bNextLineIsBlank = true;
+				} else {
+					const Sci_Position iNextLineEndPos = SciCall_GetLineEndPosition(iLine + 1);
+					const Sci_Position iNextLineIndentPos = SciCall_GetLineIndentPosition(iLine + 1);
+					if (iNextLineIndentPos == iNextLineEndPos) {
+						bNextLineIsBlank = true;
 					}
 				}
+			}
 
-				if (iWords > 0) {
-					if (nMode == EditAlignMode_Justify || nMode == EditAlignMode_JustifyEx) {
-						bool bNextLineIsBlank = false;
-						if (nMode == EditAlignMode_JustifyEx) {
-							if (SciCall_GetLineCount() <= iLine + 1) {
-								bNextLineIsBlank = true;
-							} else {
-								const Sci_Position iLineEndPos = SciCall_GetLineEndPosition(iLine + 1);
-								const Sci_Position iLineIndentPos = SciCall_GetLineIndentPosition(iLine + 1);
-								if (iLineIndentPos == iLineEndPos) {
-									bNextLineIsBlank = true;
-								}
-							}
-						}
-
-						if ((nMode == EditAlignMode_Justify || nMode == EditAlignMode_JustifyEx) &&
-								iWords > 1 && iWordsLength >= 2 &&
-								((nMode != EditAlignMode_JustifyEx || !bNextLineIsBlank || iLineStart == iLineEnd) ||
-								 (bNextLineIsBlank && iWordsLength*4 > (iMaxLength - iMinIndent)*3))) {
-							const int iGaps = iWords - 1;
-							const Sci_Position iSpacesPerGap = (iMaxLength - iMinIndent - iWordsLength) / iGaps;
-							const Sci_Position iExtraSpaces = (iMaxLength - iMinIndent - iWordsLength) % iGaps;
-
-							lstrcpy(wchNewLineBuf, pWords[0]);
-							p = StrEnd(wchNewLineBuf);
-
-							for (int i = 1; i < iWords; i++) {
-								for (Sci_Position j = 0; j < iSpacesPerGap; j++) {
-									*p++ = L' ';
-								}
-								if (i > iGaps - iExtraSpaces) {
-									*p++ = L' ';
-								}
-								*p = L'\0';
-								lstrcat(p, pWords[i]);
-								p = StrEnd(p);
-							}
-
-							WideCharToMultiByte(cpEdit, 0, wchNewLineBuf, -1, tchLineBuf, COUNTOF(var->tchLineBuf), nullptr, nullptr);
-
-							SciCall_SetTargetRange(SciCall_PositionFromLine(iLine), SciCall_GetLineEndPosition(iLine));
-							SciCall_ReplaceTarget(-1, tchLineBuf);
-							SciCall_SetLineIndentation(iLine, iMinIndent);
-						} else {
-							lstrcpy(wchNewLineBuf, pWords[0]);
-							p = StrEnd(wchNewLineBuf);
-
-							for (int i = 1; i < iWords; i++) {
-								*p++ = L' ';
-								*p = L'\0';
-								lstrcat(wchNewLineBuf, pWords[i]);
-								p = StrEnd(p);
-							}
-
-							WideCharToMultiByte(cpEdit, 0, wchNewLineBuf, -1, tchLineBuf, COUNTOF(var->tchLineBuf), nullptr, nullptr);
-
-							SciCall_SetTargetRange(SciCall_PositionFromLine(iLine), SciCall_GetLineEndPosition(iLine));
-							SciCall_ReplaceTarget(-1, tchLineBuf);
-							SciCall_SetLineIndentation(iLine, iMinIndent);
-						}
-					} else {
-						const Sci_Position iExtraSpaces = iMaxLength - iMinIndent - iWordsLength - iWords + 1;
-						Sci_Position iOddSpaces = iExtraSpaces % 2;
-
-						p = wchNewLineBuf;
-						if (nMode == EditAlignMode_Right) {
-							for (Sci_Position i = 0; i < iExtraSpaces; i++) {
-								*p++ = L' ';
-							}
-						}
-
-						if (nMode == EditAlignMode_Center) {
-							for (Sci_Position i = 1; i < iExtraSpaces - iOddSpaces; i += 2) {
-								*p++ = L' ';
-							}
-						}
-
-						*p = L'\0';
-						for (int i = 0; i < iWords; i++) {
-							lstrcat(p, pWords[i]);
-							if (i < iWords - 1) {
-								lstrcat(p, L" ");
-							}
-							if (nMode == EditAlignMode_Center && iWords > 1 && iOddSpaces > 0 && i + 1 >= iWords / 2) {
-								lstrcat(p, L" ");
-								iOddSpaces--;
-							}
-							p = StrEnd(p);
-						}
-
-						WideCharToMultiByte(cpEdit, 0, wchNewLineBuf, -1, tchLineBuf, COUNTOF(var->tchLineBuf), nullptr, nullptr);
+			if (iWords > 1 && iWordsLength >= 2 &&
+					((nMode != EditAlignMode_JustifyEx || !bNextLineIsBlank || iLineStart == iLineEnd) ||
+					 (bNextLineIsBlank && iWordsLength*4 > iWidth*3))) {
+				iGaps = iWords - 1;
+				iSpacesPerGap = (iWidth - iWordsLength) / iGaps;
+				iExtraSpaces = (iWidth - iWordsLength) % iGaps;
+			}
+		}
 
-						Sci_Position iPos;
-						if (nMode == EditAlignMode_Right || nMode == EditAlignMode_Center) {
-							SciCall_SetLineIndentation(iLine, iMinIndent);
-							iPos = SciCall_GetLineIndentPosition(iLine);
-						} else {
-							iPos = SciCall_PositionFromLine(iLine);
-						}
+		// same as SCI_SETLINEINDENTATION
+		if (bUseTabs) {
+			p = AppendChars(p, '\t', iMinIndent / iTabWidth);
+			p = AppendChars(p, ' ', iMinIndent % iTabWidth);
+		} else {
+			p = AppendChars(p, ' ', iMinIndent);
+		}
+		if (nMode == EditAlignMode_Right || nMode == EditAlignMode_Center) {
+			const Sci_Position iPadding = iWidth - iWordsLength - iWords + 1;
+			if (nMode == EditAlignMode_Right) {
+				p = AppendChars(p, ' ', iPadding);
+			} else {
+				iOddSpaces = iPadding % 2;
+				p = AppendChars(p, ' ', (iPadding - iOddSpaces) / 2);
+			}
+		}
 
-						SciCall_SetTargetRange(iPos, SciCall_GetLineEndPosition(iLine));
-						SciCall_ReplaceTarget(-1, tchLineBuf);
-						if (nMode == EditAlignMode_Left) {
-							SciCall_SetLineIndentation(iLine, iMinIndent);
-						}
-					}
+		int iWord = 0;
+		for (Sci_Position iPos = iIndentPos; iPos < iLineEndPos; ++iWord) {
+			if (iWord != 0) {
+				if (iGaps > 0) {
+					p = AppendChars(p, ' ', iSpacesPerGap + (iWord > iGaps - iExtraSpaces));
+				} else {
+					*p++ = ' ';
 				}
+				if (nMode == EditAlignMode_Center && iWords > 1 && iOddSpaces > 0 && iWord >= iWords / 2) {
+					*p++ = ' ';
+					iOddSpaces--;
+				}
+			}
+			const Sci_Position iWordStart = iPos;
+			while (iPos < iLineEndPos && !IsASpaceOrTab(pszText[iPos])) {
+				++iPos;
+			}
+			memcpy(p, pszText + iWordStart, iPos - iWordStart);
+			p += iPos - iWordStart;
+			while (iPos < iLineEndPos && IsASpaceOrTab(pszText[iPos])) {
+				++iPos;
 			}
 		}
-		SciCall_EndUndoAction();
-		NP2HeapFree(var);
-	} else {
-		MsgBoxInfo(MB_OK, IDS_BUFFERTOOSMALL);
+		cchAlign = p - pszAlign;
+	}
+
+	if (cchAlign != cchText || memcmp(pszAlign, pszText, cchText) != 0) {
+		SciCall_SetTargetRange(iStartPos, iEndPos);
+		SciCall_ReplaceTarget(cchAlign, pszAlign);
 	}
+	NP2HeapFree(pszAlign);
 
 	if (iCurPos < iAnchorPos) {
 		iCurPos = iLineStart;
@@ -3871,113 +4153,72 @@ void EditWrapToColumn(int nColumn/*, int nTabWidth*/) noexcept {
 	iSelStart = SciCall_PositionFromLine(iLine);
 
 	const Sci_Position iSelCount = iSelEnd - iSelStart;
-	char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1 + 2));
-	LPWSTR pszTextW = static_cast<LPWSTR>(NP2HeapAlloc((iSelCount + 1 + 2) * sizeof(WCHAR)));
+	char *pszText = static_cast<char *>(NP2ScratchAlloc(iSelCount + 1 + 2));
 
 	const Sci_TextRangeFull tr = { { iSelStart, iSelEnd }, pszText };
 	SciCall_GetTextRangeFull(&tr);
 
-	const UINT cpEdit = SciCall_GetCodePage();
-	const int cchTextW = MultiByteToWideChar(cpEdit, 0, pszText, static_cast<int>(iSelCount), pszTextW, static_cast<int>(NP2HeapSize(pszTextW) / sizeof(WCHAR)));
-	NP2HeapFree(pszText);
-
-	LPWSTR pszConvW = static_cast<LPWSTR>(NP2HeapAlloc(cchTextW * sizeof(WCHAR) * 3 + 2));
+	// each inserted line break replaces at least one white space
+	char *pszConv = static_cast<char *>(NP2ScratchAlloc(iSelCount * 2 + 2));
 
+	const UINT cpEdit = SciCall_GetCodePage();
+	const bool dbcs = !(cpEdit == CP_UTF8 || cpEdit == 0);
 	const unsigned iEOLMode = SciCall_GetEOLMode();
-	unsigned wszEOL = '\r' | ('\n' << 16);
-	wszEOL >>= 16*(iEOLMode >> 1);
-
-#define ISDELIMITER(wc) StrChr(L",;.:-+%&\xA6|/*?!\"\'~\xB4#=", wc)
-#define ISWHITE(wc)		IsASpaceOrTab(wc)
-#define ISWORDEND(wc)	(/*ISDELIMITER(wc) ||*/ IsASpace(wc))
+	unsigned szEOL = '\r' | ('\n' << 8);
+	szEOL >>= 8*(iEOLMode >> 1);
 
-	int cchConvW = 0;
-	int iLineLength = 0;
+	Sci_Position cchConv = 0;
+	Sci_Position iLineLength = 0;
 	bool bModified = false;
-	for (int iTextW = 0; iTextW < cchTextW; iTextW++) {
-		const WCHAR w = pszTextW[iTextW];
-
-		//if (ISDELIMITER(w)) {
-		//	int iNextWordLen = 0;
-		//	WCHAR w2 = pszTextW[iTextW + 1];
-		//
-		//	if (iLineLength + iNextWordLen + 1 > nColumn) {
-		//		memcpy(pszConvW + cchConvW, &wszEOL, 2*sizeof(WCHAR));
-		//		cchConvW += (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
-		//		iLineLength = 0;
-		//		bModified = true;
-		//	}
-		//
-		//	while (w2 != L'\0' && !ISWORDEND(w2)) {
-		//		iNextWordLen++;
-		//		w2 = pszTextW[iTextW + iNextWordLen + 1];
-		//	}
-		//
-		//	if (ISDELIMITER(w2) && iNextWordLen > 0) // delimiters go with the word
-		//		iNextWordLen++;
-		//
-		//	pszConvW[cchConvW++] = w;
-		//	iLineLength++;
-		//
-		//	if (iNextWordLen > 0) {
-		//		if (iLineLength + iNextWordLen + 1 > nColumn) {
-		//			memcpy(pszConvW + cchConvW, &wszEOL, 2*sizeof(WCHAR));
-		//			cchConvW += (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
-		//			iLineLength = 0;
-		//			bModified = true;
-		//		}
-		//	}
-		//}
-
-		if (ISWHITE(w)) {
-			while (IsASpaceOrTab(pszTextW[iTextW + 1])) {
-				iTextW++;
+	for (Sci_Position i = 0; i < iSelCount; i++) {
+		const char ch = pszText[i];
+		if (IsASpaceOrTab(ch)) {
+			while (IsASpaceOrTab(pszText[i + 1])) {
+				i++;
 				bModified = true;
 			} // Modified: left out some whitespaces
 
-			WCHAR w2 = pszTextW[iTextW + 1];
-			int iNextWordLen = 0;
-
-			while (w2 != L'\0' && !ISWORDEND(w2)) {
-				iNextWordLen++;
-				w2 = pszTextW[iTextW + iNextWordLen + 1];
+			Sci_Position iNextWordEnd = i + 1;
+			while (pszText[iNextWordEnd] != '\0' && !IsASpace(pszText[iNextWordEnd])) {
+				iNextWordEnd++;
 			}
 
-			//if (ISDELIMITER(w2) /*&& iNextWordLen > 0*/) // delimiters go with the word
-			//	iNextWordLen++;
-			if (iNextWordLen > 0) {
+			if (iNextWordEnd > i + 1) {
+				const Sci_Position iNextWordLen = CountCharacters(pszText + i + 1, iNextWordEnd - i - 1, cpEdit);
 				if (iLineLength + iNextWordLen + 1 > nColumn) {
-					memcpy(pszConvW + cchConvW, &wszEOL, 2*sizeof(WCHAR));
-					cchConvW += (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
+					memcpy(pszConv + cchConv, &szEOL, 2);
+					cchConv += (iEOLMode == SC_EOL_CRLF) ? 2 : 1;
 					iLineLength = 0;
 					bModified = true;
 				} else {
 					if (iLineLength > 0) {
-						pszConvW[cchConvW++] = L' ';
+						pszConv[cchConv++] = ' ';
 						iLineLength++;
 					}
 				}
 			}
 		} else {
-			pszConvW[cchConvW++] = w;
-			if (w == L'\r' || w == L'\n') {
+			pszConv[cchConv++] = ch;
+			if (IsEOLChar(ch)) {
 				iLineLength = 0;
-			} else {
+			} else if (dbcs) {
 				iLineLength++;
+				if (IsDBCSLeadByteEx(cpEdit, ch) && i + 1 < iSelCount) {
+					pszConv[cchConv++] = pszText[++i];
+				}
+			} else {
+				iLineLength += (cpEdit != CP_UTF8) || (static_cast<uint8_t>(ch) & 0xc0) != 0x80;
 			}
 		}
 	}
 
-	NP2HeapFree(pszTextW);
+	NP2ScratchFree(pszText);
 
 	if (bModified) {
-		pszText = static_cast<char *>(NP2HeapAlloc(cchConvW * kMaxMultiByteCount));
-		const int cchText = WideCharToMultiByte(cpEdit, 0, pszConvW, cchConvW, pszText, static_cast<int>(NP2HeapSize(pszText)), nullptr, nullptr);
-		EditReplaceRange(iSelStart, iSelEnd, cchText, pszText);
-		NP2HeapFree(pszText);
+		EditReplaceRange(iSelStart, iSelEnd, cchConv, pszConv);
 	}
 
-	NP2HeapFree(pszConvW);
+	NP2ScratchFree(pszConv);
 }
 
 //=============================================================================
@@ -3999,8 +4240,8 @@ void EditJoinLinesEx() noexcept {
 	iSelStart = SciCall_PositionFromLine(iLine);
 
 	const Sci_Position iSelCount = iSelEnd - iSelStart;
-	char *pszText = static_cast<char *>(NP2HeapAlloc(iSelCount + 1 + 2));
-	char *pszJoin = static_cast<char *>(NP2HeapAlloc(NP2HeapSize(pszText)));
+	char *pszText = static_cast<char *>(NP2ScratchAlloc(iSelCount + 1 + 2));
+	char *pszJoin = static_cast<char *>(NP2ScratchAlloc(iSelCount + 1 + 2));
 
 	const Sci_TextRangeFull tr = { { iSelStart, iSelEnd }, pszText };
 	SciCall_GetTextRangeFull(&tr);
@@ -4038,13 +4279,13 @@ void EditJoinLinesEx() noexcept {
 		}
 	}
 
-	NP2HeapFree(pszText);
+	NP2ScratchFree(pszText);
 
 	if (bModified) {
 		EditReplaceRange(iSelStart, iSelEnd, cchJoin, pszJoin);
 	}
 
-	NP2HeapFree(pszJoin);
+	NP2ScratchFree(pszJoin);
 }
 
 //=============================================================================
@@ -4097,6 +4338,44 @@ int __cdecl DontSortLine(const void *p1, const void *p2) noexcept {
 	return s1->iLine - s2->iLine;
 }
 
+// Remove duplicate or unique lines in original order, lines are grouped with
+// a hash table and compared byte by byte instead of sorting UTF-16 copies.
+// returns length of replaced text, or -1 when lines can't be grouped.
+Sci_Position EditFilterDuplicateLines(Sci_Line iLineStart, Sci_Line iLineEnd, EditSortFlag iSortFlags) noexcept {
+	const Sci_Position iTargetStart = SciCall_PositionFromLine(iLineStart);
+	const Sci_Position iTargetEnd = SciCall_PositionFromLine(iLineEnd + 1);
+	const Sci_Position cchText = iTargetEnd - iTargetStart;
+	const char * const pszText = SciCall_GetRangePointer(iTargetStart, cchText);
+
+	DuplicateLineFinder finder;
+	if (!finder.Find(pszText, cchText)) {
+		return -1;
+	}
+	unsigned flags = 0;
+	if (iSortFlags & EditSortFlag_RemoveUnique) {
+		flags |= DuplicateLineDropUnique;
+	}
+	if (iSortFlags & EditSortFlag_RemoveDuplicate) {
+		flags |= DuplicateLineDropFirst | DuplicateLineDropRepeat;
+	}
+	if (iSortFlags & EditSortFlag_MergeDuplicate) {
+		flags |= DuplicateLineDropRepeat;
+	}
+	if (finder.DropCount(flags) == 0) {
+		return cchText;
+	}
+
+	char * const pszOut = static_cast<char *>(NP2HeapAlloc(cchText + 1));
+	if (pszOut == nullptr) {
+		return -1;
+	}
+	const Sci_Position cchTotal = finder.Filter(pszOut, flags);
+	SciCall_SetTargetRange(iTargetStart, iTargetEnd);
+	SciCall_ReplaceTarget(cchTotal, pszOut);
+	NP2HeapFree(pszOut);
+	return cchTotal;
+}
+
 }
 
 void EditSortLines(EditSortFlag iSortFlags) noexcept {
@@ -4149,6 +4428,22 @@ void EditSortLines(EditSortFlag iSortFlags) noexcept {
 		return;
 	}
 
+	if (!bIsRectangular && (iSortFlags & EditSortFlag_DontSort)
+		&& !(iSortFlags & (EditSortFlag_Descending | EditSortFlag_IgnoreCase | EditSortFlag_Shuffle))) {
+		const Sci_Position cchTotal = EditFilterDuplicateLines(iLineStart, iLineEnd, iSortFlags);
+		if (cchTotal >= 0) {
+			if (iAnchorPos > iCurPos) {
+				iCurPos = iSelStart;
+				iAnchorPos = iSelStart + cchTotal;
+			} else {
+				iAnchorPos = iSelStart;
+				iCurPos = iSelStart + cchTotal;
+			}
+			SciCall_SetSel(iAnchorPos, iCurPos);
+			return;
+		}
+	}
+
 	SciCall_BeginUndoAction();
 	if (bIsRectangular) {
 		EditPadWithSpaces(!(iSortFlags & EditSortFlag_Shuffle), true);
@@ -4757,6 +5052,10 @@ static INT_PTR CALLBACK EditFindReplaceDlgProc(HWND hwnd, UINT umsg, WPARAM wPar
 			CheckDlgButton(hwnd, IDC_FINDREGEXP, BST_CHECKED);
 		}
 
+		if (lpefr->fuFlags & NP2_SkipCommentString) {
+			CheckDlgButton(hwnd, IDC_FINDSKIPCOMMENTSTRING, BST_CHECKED);
+		}
+
 		if (lpefr->bTransformBS) {
 			CheckDlgButton(hwnd, IDC_FINDTRANSFORMBS, BST_CHECKED);
 		}
@@ -4967,6 +5266,10 @@ static INT_PTR CALLBACK EditFindReplaceDlgProc(HWND hwnd, UINT umsg, WPARAM wPar
 				lpefr->fuFlags |= NP2_RegexDefaultFlags;
 			}
 
+			if (IsButtonChecked(hwnd, IDC_FINDSKIPCOMMENTSTRING)) {
+				lpefr->fuFlags |= NP2_SkipCommentString;
+			}
+
 			lpefr->bTransformBS = IsButtonChecked(hwnd, IDC_FINDTRANSFORMBS);
 			lpefr->bNoFindWrap = IsButtonChecked(hwnd, IDC_NOWRAP);
 
@@ -5253,6 +5556,27 @@ int EditPrepareFind(char *szFind2, const EDITFINDREPLACE *lpefr) noexcept {
 	return searchFlags;
 }
 
+// search style mask is only set for current search, other searches find text in all styles.
+static Sci_Position EditFindTextFull(int searchFlags, Sci_TextToFindFull *ttf) noexcept {
+	if (searchFlags & NP2_SkipCommentString) {
+		EditSetSearchStyleMask(searchFlags);
+		const Sci_Position iPos = SciCall_FindTextFull(searchFlags, ttf);
+		SciCall_SetSearchStyleMask(nullptr);
+		return iPos;
+	}
+	return SciCall_FindTextFull(searchFlags, ttf);
+}
+
+static Sci_Position EditFindTextAll(int searchFlags, Sci_TextToFindAll *tta) noexcept {
+	if (searchFlags & NP2_SkipCommentString) {
+		EditSetSearchStyleMask(searchFlags);
+		const Sci_Position count = SciCall_FindTextAll(searchFlags, tta);
+		SciCall_SetSearchStyleMask(nullptr);
+		return count;
+	}
+	return SciCall_FindTextAll(searchFlags, tta);
+}
+
 int EditPrepareReplace(HWND hwnd, char *szFind2, char **pszReplace2, BOOL *bReplaceRE, const EDITFINDREPLACE *lpefr) noexcept {
 	const int searchFlags = EditPrepareFind(szFind2, lpefr);
 	if (searchFlags == NP2_InvalidSearchFlags) {
@@ -5292,13 +5616,13 @@ void EditFindNext(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept
 	const Sci_Position iSelAnchor = SciCall_GetAnchor();
 
 	Sci_TextToFindFull ttf = { { SciCall_GetSelectionEnd(), SciCall_GetLength() }, szFind2, { 0, 0 } };
-	Sci_Position iPos = SciCall_FindTextFull(searchFlags, &ttf);
+	Sci_Position iPos = EditFindTextFull(searchFlags, &ttf);
 	bool bSuppressNotFound = false;
 
 	if (iPos < 0 && ttf.chrg.cpMin > 0 && !lpefr->bNoFindWrap && !fExtendSelection) {
 		if (IDOK == InfoBoxInfo(MB_OKCANCEL, L"MsgFindWrap1", IDS_FIND_WRAPFW)) {
 			ttf.chrg.cpMin = 0;
-			iPos = SciCall_FindTextFull(searchFlags, &ttf);
+			iPos = EditFindTextFull(searchFlags, &ttf);
 		} else {
 			bSuppressNotFound = true;
 		}
@@ -5334,14 +5658,14 @@ void EditFindPrev(const EDITFINDREPLACE *lpefr, bool fExtendSelection) noexcept
 	const Sci_Position iSelAnchor = SciCall_GetAnchor();
 
 	Sci_TextToFindFull ttf = { { SciCall_GetSelectionStart(), 0 }, szFind2, { 0, 0 } };
-	Sci_Position iPos = SciCall_FindTextFull(searchFlags, &ttf);
+	Sci_Position iPos = EditFindTextFull(searchFlags, &ttf);
 	const Sci_Position iLength = SciCall_GetLength();
 	bool bSuppressNotFound = false;
 
 	if (iPos < 0 && ttf.chrg.cpMin < iLength && !lpefr->bNoFindWrap && !fExtendSelection) {
 		if (IDOK == InfoBoxInfo(MB_OKCANCEL, L"MsgFindWrap2", IDS_FIND_WRAPRE)) {
 			ttf.chrg.cpMin = iLength;
-			iPos = SciCall_FindTextFull(searchFlags, &ttf);
+			iPos = EditFindTextFull(searchFlags, &ttf);
 		} else {
 			bSuppressNotFound = true;
 		}
@@ -5378,13 +5702,13 @@ bool EditReplace(HWND hwnd, const EDITFINDREPLACE *lpefr) noexcept {
 	const Sci_Position iSelEnd = SciCall_GetSelectionEnd();
 
 	Sci_TextToFindFull ttf = { { iSelStart, SciCall_GetLength() }, szFind2, { 0, 0 } };
-	Sci_Position iPos = SciCall_FindTextFull(searchFlags, &ttf);
+	Sci_Position iPos = EditFindTextFull(searchFlags, &ttf);
 	bool bSuppressNotFound = false;
 
 	if (iPos < 0 && ttf.chrg.cpMin > 0 && !lpefr->bNoFindWrap) {
 		if (IDOK == InfoBoxInfo(MB_OKCANCEL, L"MsgFindWrap1", IDS_FIND_WRAPFW)) {
 			ttf.chrg.cpMin = 0;
-			iPos = SciCall_FindTextFull(searchFlags, &ttf);
+			iPos = EditFindTextFull(searchFlags, &ttf);
 		} else {
 			bSuppressNotFound = true;
 		}
@@ -5411,13 +5735,13 @@ bool EditReplace(HWND hwnd, const EDITFINDREPLACE *lpefr) noexcept {
 	ttf.chrg.cpMin = SciCall_GetTargetEnd();
 	ttf.chrg.cpMax = SciCall_GetLength();
 
-	iPos = SciCall_FindTextFull(searchFlags, &ttf);
+	iPos = EditFindTextFull(searchFlags, &ttf);
 	bSuppressNotFound = false;
 
 	if (iPos < 0 && ttf.chrg.cpMin > 0 && !lpefr->bNoFindWrap) {
 		if (IDOK == InfoBoxInfo(MB_OKCANCEL, L"MsgFindWrap1", IDS_FIND_WRAPFW)) {
 			ttf.chrg.cpMin = 0;
-			iPos = SciCall_FindTextFull(searchFlags, &ttf);
+			iPos = EditFindTextFull(searchFlags, &ttf);
 		} else {
 			bSuppressNotFound = true;
 		}
@@ -5587,7 +5911,9 @@ void EditMarkAll::Continue(HANDLE timer) noexcept {
 	}
 
 	Sci_Position cpMin = iStartPos;
-	Sci_TextToFindFull ttf = { { cpMin, iMaxLength }, pszText, { 0, 0 } };
+	Sci_Position matchEnd = iStartPos;
+	Sci_CharacterRangeFull matches[EditMarkAll_RangeCacheCount];
+	Sci_TextToFindAll tta = { { cpMin, iMaxLength }, pszText, matches, EditMarkAll_RangeCacheCount };
 
 	Sci_Position matchCount_ = matchCount;
 	UINT index = 0;
@@ -5597,34 +5923,37 @@ void EditMarkAll::Continue(HANDLE timer) noexcept {
 	SciCall_SetIndicatorCurrent(IndicatorNumber_MarkOccurrence);
 	WaitableTimer_Set(timer, WaitableTimer_IdleTaskTimeSlot);
 	while (cpMin < iMaxLength && WaitableTimer_Continue(timer)) {
-		ttf.chrg.cpMin = cpMin;
-		const Sci_Position iPos = SciCall_FindTextFull(findFlag, &ttf);
-		if (iPos < 0) {
-			iStartPos = iMaxLength;
-			break;
-		}
-
-		++matchCount_;
-		const Sci_Position iSelCount = ttf.chrgText.cpMax - iPos;
-		if (iSelCount == 0) {
-			// empty regex
-			cpMin = SciCall_PositionAfter(iPos);
-			continue;
-		}
+		// find a batch of matches with single message
+		const Sci_Position count = EditFindTextAll(findFlag, &tta);
+		for (Sci_Position i = 0; i < count; i++) {
+			++matchCount_;
+			const Sci_Position iPos = matches[i].cpMin;
+			const Sci_Position iSelCount = matches[i].cpMax - iPos;
+			if (iSelCount == 0) {
+				// empty regex
+				continue;
+			}
 
-		if (index != 0 && iPos == cpMin && (findFlag & NP2_MarkAllSelectAll) == 0) {
-			// merge adjacent indicator ranges
-			ranges[index - 1] += iSelCount;
-		} else {
-			ranges[index] = iPos;
-			ranges[index + 1] = iSelCount;
-			index += 2;
-			if (index == COUNTOF(ranges)) {
-				bookmarkLine = EditMarkAll_Bookmark(bookmarkLine, ranges, index, findFlag, matchCount_);
-				index = 0;
+			if (index != 0 && iPos == matchEnd && (findFlag & NP2_MarkAllSelectAll) == 0) {
+				// merge adjacent indicator ranges
+				ranges[index - 1] += iSelCount;
+			} else {
+				ranges[index] = iPos;
+				ranges[index + 1] = iSelCount;
+				index += 2;
+				if (index == COUNTOF(ranges)) {
+					bookmarkLine = EditMarkAll_Bookmark(bookmarkLine, ranges, index, findFlag, matchCount_);
+					index = 0;
+				}
 			}
+			matchEnd = matches[i].cpMax;
 		}
-		cpMin = ttf.chrgText.cpMax;
+		if (count < EditMarkAll_RangeCacheCount) {
+			iStartPos = iMaxLength;
+			cpMin = matchEnd;
+			break;
+		}
+		cpMin = tta.chrg.cpMin;
 	}
 	if (index) {
 		bookmarkLine = EditMarkAll_Bookmark(bookmarkLine, ranges, index, findFlag, matchCount_);
@@ -5769,6 +6098,43 @@ static void ShwowReplaceCount(Sci_Position iCount) noexcept {
 	}
 }
 
+//=============================================================================
+//
+// EditReplaceAllText()
+//
+// plain text matches are found in batches with SCI_FINDTEXTALL, regex replacement
+// still finds one match at a time as the replacement refers to groups of last match.
+#define EditReplaceAll_RangeCacheCount	256
+static Sci_Position EditReplaceAllText(int searchFlags, const char *szFind, const char *pszReplace, Sci_Position cpMin, Sci_Position cpMax) noexcept {
+	Sci_CharacterRangeFull matches[EditReplaceAll_RangeCacheCount];
+	Sci_TextToFindAll tta = { { cpMin, cpMax }, szFind, matches, EditReplaceAll_RangeCacheCount };
+	Sci_Position iCount = 0;
+	while (tta.chrg.cpMin < tta.chrg.cpMax) {
+		const Sci_Position count = EditFindTextAll(searchFlags, &tta);
+		if (count <= 0) {
+			break;
+		}
+		if (iCount == 0) {
+			SciCall_BeginUndoAction();
+		}
+
+		iCount += count;
+		// matches are positions before current batch is replaced
+		Sci_Position delta = 0;
+		for (Sci_Position i = 0; i < count; i++) {
+			SciCall_SetTargetRange(matches[i].cpMin + delta, matches[i].cpMax + delta);
+			const Sci_Position iReplacedLen = SciCall_ReplaceTargetEx(FALSE, -1, pszReplace);
+			delta += iReplacedLen - (matches[i].cpMax - matches[i].cpMin);
+		}
+		if (count < EditReplaceAll_RangeCacheCount) {
+			break;
+		}
+		tta.chrg.cpMin += delta;
+		tta.chrg.cpMax += delta;
+	}
+	return iCount;
+}
+
 //=============================================================================
 //
 // EditReplaceAll()
@@ -5790,39 +6156,43 @@ bool EditReplaceAll(HWND hwnd, const EDITFINDREPLACE *lpefr, bool bShowInfo) noe
 	watch.Start();
 #endif
 
-	const bool bRegexStartOfLine = bReplaceRE && (szFind2[0] == '^');
-	Sci_TextToFindFull ttf = { { 0, SciCall_GetLength() }, szFind2, { 0, 0 } };
 	Sci_Position iCount = 0;
-	while (SciCall_FindTextFull(searchFlags, &ttf) >= 0) {
-		if (++iCount == 1) {
-			SciCall_BeginUndoAction();
-		}
+	if (!(searchFlags & SCFIND_REGEXP)) {
+		iCount = EditReplaceAllText(searchFlags, szFind2, pszReplace2, 0, SciCall_GetLength());
+	} else {
+		const bool bRegexStartOfLine = bReplaceRE && (szFind2[0] == '^');
+		Sci_TextToFindFull ttf = { { 0, SciCall_GetLength() }, szFind2, { 0, 0 } };
+		while (EditFindTextFull(searchFlags, &ttf) >= 0) {
+			if (++iCount == 1) {
+				SciCall_BeginUndoAction();
+			}
 
-		SciCall_SetTargetRange(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
-		const Sci_Position iReplacedLen = SciCall_ReplaceTargetEx(bReplaceRE, -1, pszReplace2);
+			SciCall_SetTargetRange(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
+			const Sci_Position iReplacedLen = SciCall_ReplaceTargetEx(bReplaceRE, -1, pszReplace2);
 
-		ttf.chrg.cpMin = (ttf.chrgText.cpMin + iReplacedLen);
-		// document length change: iReplacedLen - (ttf.chrgText.cpMax - ttf.chrgText.cpMin)
-		ttf.chrg.cpMax += ttf.chrg.cpMin - ttf.chrgText.cpMax;
+			ttf.chrg.cpMin = (ttf.chrgText.cpMin + iReplacedLen);
+			// document length change: iReplacedLen - (ttf.chrgText.cpMax - ttf.chrgText.cpMin)
+			ttf.chrg.cpMax += ttf.chrg.cpMin - ttf.chrgText.cpMax;
 
-		if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
-			break;
-		}
+			if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
+				break;
+			}
 
-		if (ttf.chrgText.cpMin == ttf.chrgText.cpMax && !bRegexStartOfLine) {
-			// move to next line after the replacement.
-			ttf.chrg.cpMin = SciCall_PositionAfter(ttf.chrg.cpMin);
-		}
+			if (ttf.chrgText.cpMin == ttf.chrgText.cpMax && !bRegexStartOfLine) {
+				// move to next line after the replacement.
+				ttf.chrg.cpMin = SciCall_PositionAfter(ttf.chrg.cpMin);
+			}
 
-		if (bRegexStartOfLine) {
-			const Sci_Line iLine = SciCall_LineFromPosition(ttf.chrg.cpMin);
-			const Sci_Position ilPos = SciCall_PositionFromLine(iLine);
+			if (bRegexStartOfLine) {
+				const Sci_Line iLine = SciCall_LineFromPosition(ttf.chrg.cpMin);
+				const Sci_Position ilPos = SciCall_PositionFromLine(iLine);
 
-			if (ilPos == ttf.chrg.cpMin) {
-				ttf.chrg.cpMin = SciCall_PositionFromLine(iLine + 1);
-			}
-			if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
-				break;
+				if (ilPos == ttf.chrg.cpMin) {
+					ttf.chrg.cpMin = SciCall_PositionFromLine(iLine + 1);
+				}
+				if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
+					break;
+				}
 			}
 		}
 	}
@@ -5871,44 +6241,48 @@ bool EditReplaceAllInSelection(HWND hwnd, const EDITFINDREPLACE *lpefr, bool bSh
 	BeginWaitCursor();
 	SendMessage(hwnd, WM_SETREDRAW, FALSE, 0);
 
-	const bool bRegexStartOfLine = bReplaceRE && (szFind2[0] == '^');
-	Sci_TextToFindFull ttf = { { SciCall_GetSelectionStart(), SciCall_GetLength() }, szFind2, { 0, 0 } };
 	Sci_Position iCount = 0;
-	while (SciCall_FindTextFull(searchFlags, &ttf) >= 0) {
-		if (ttf.chrgText.cpMax <= SciCall_GetSelectionEnd()) {
-			if (++iCount == 1) {
-				SciCall_BeginUndoAction();
-			}
+	if (!(searchFlags & SCFIND_REGEXP)) {
+		iCount = EditReplaceAllText(searchFlags, szFind2, pszReplace2, SciCall_GetSelectionStart(), SciCall_GetSelectionEnd());
+	} else {
+		const bool bRegexStartOfLine = bReplaceRE && (szFind2[0] == '^');
+		Sci_TextToFindFull ttf = { { SciCall_GetSelectionStart(), SciCall_GetLength() }, szFind2, { 0, 0 } };
+		while (EditFindTextFull(searchFlags, &ttf) >= 0) {
+			if (ttf.chrgText.cpMax <= SciCall_GetSelectionEnd()) {
+				if (++iCount == 1) {
+					SciCall_BeginUndoAction();
+				}
 
-			SciCall_SetTargetRange(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
-			const Sci_Position iReplacedLen = SciCall_ReplaceTargetEx(bReplaceRE, -1, pszReplace2);
+				SciCall_SetTargetRange(ttf.chrgText.cpMin, ttf.chrgText.cpMax);
+				const Sci_Position iReplacedLen = SciCall_ReplaceTargetEx(bReplaceRE, -1, pszReplace2);
 
-			ttf.chrg.cpMin = (ttf.chrgText.cpMin + iReplacedLen);
-			// document length change: iReplacedLen - (ttf.chrgText.cpMax - ttf.chrgText.cpMin)
-			ttf.chrg.cpMax += ttf.chrg.cpMin - ttf.chrgText.cpMax;
+				ttf.chrg.cpMin = (ttf.chrgText.cpMin + iReplacedLen);
+				// document length change: iReplacedLen - (ttf.chrgText.cpMax - ttf.chrgText.cpMin)
+				ttf.chrg.cpMax += ttf.chrg.cpMin - ttf.chrgText.cpMax;
 
-			if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
-				break;
-			}
+				if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
+					break;
+				}
 
-			if (ttf.chrgText.cpMin == ttf.chrgText.cpMax && !bRegexStartOfLine) {
-				// move to next line after the replacement.
-				ttf.chrg.cpMin = SciCall_PositionAfter(ttf.chrg.cpMin);
-			}
+				if (ttf.chrgText.cpMin == ttf.chrgText.cpMax && !bRegexStartOfLine) {
+					// move to next line after the replacement.
+					ttf.chrg.cpMin = SciCall_PositionAfter(ttf.chrg.cpMin);
+				}
 
-			if (bRegexStartOfLine) {
-				const Sci_Line iLine = SciCall_LineFromPosition(ttf.chrg.cpMin);
-				const Sci_Position ilPos = SciCall_PositionFromLine(iLine);
+				if (bRegexStartOfLine) {
+					const Sci_Line iLine = SciCall_LineFromPosition(ttf.chrg.cpMin);
+					const Sci_Position ilPos = SciCall_PositionFromLine(iLine);
 
-				if (ilPos == ttf.chrg.cpMin) {
-					ttf.chrg.cpMin = SciCall_PositionFromLine(iLine + 1);
-				}
-				if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
-					break;
+					if (ilPos == ttf.chrg.cpMin) {
+						ttf.chrg.cpMin = SciCall_PositionFromLine(iLine + 1);
+					}
+					if (ttf.chrg.cpMin == ttf.chrg.cpMax) {
+						break;
+					}
 				}
+			} else { // gone across selection, cancel
+				break;
 			}
-		} else { // gone across selection, cancel
-			break;
 		}
 	}
 
@@ -8022,7 +8396,319 @@ void FoldAltArrow(int key, int mode) noexcept {
 	}
 }
 
+//=============================================================================
+//
+// Tag pair index for XML and HTML
+//
+// only styled text is indexed, one slice on each query or idle timer tick,
+// inserting or deleting plain text moves tags after it.
+#define TAG_INDEX_SLICE_SIZE	(1024*1024)
+#define TAG_INDEX_IDLE_TIME		50
+static TagPairIndex tagIndex;
+static LPCEDITLEXER tagIndexLexer;
+static bool tagIndexTimer;
+static bool tagHighlighted;
+static bool tagHighlightPending;	// caret tag not yet indexed
+
+enum TagQuery {
+	TagQuery_TagAt,
+	TagQuery_MatchingTag,
+	TagQuery_EnclosingElement,
+	TagQuery_NextSibling,
+	TagQuery_PreviousSibling,
+};
+
+static void StopTagIndexTimer() noexcept {
+	if (tagIndexTimer) {
+		tagIndexTimer = false;
+		KillTimer(hwndMain, ID_TAGINDEXTIMER);
+	}
+}
+
+void EditResetTagIndex() noexcept {
+	tagIndexLexer = nullptr;
+	tagHighlightPending = false;
+	StopTagIndexTimer();
+}
+
+// character is in text content, or is '>' of tag before text or '<' of tag after text.
+static bool IsTagTextBoundary(Sci_Position position, int bracket) noexcept {
+	const int style = SciCall_GetStyleIndexAt(position);
+	const int ch = SciCall_GetCharAt(position);
+	if (style == SCE_H_DEFAULT || style == SCE_H_ENTITY) {
+		// '<' or '</' in text starts a tag when followed by a name
+		return ch != '<' && !(ch == '/' && position != 0 && SciCall_GetCharAt(position - 1) == '<');
+	}
+	return (style == SCE_H_TAG || style == SCE_H_TAGUNKNOWN || style == SCE_H_TAGEND)
+		&& ch == bracket;
+}
+
+void EditTagIndexModified(int modificationType, Sci_Position position, Sci_Position length, const char *text) noexcept {
+	if (tagIndexLexer != pLexCurrent) {
+		// lexer changed, index is rebuilt on next query
+		EditResetTagIndex();
+		return;
+	}
+	// text without markup inside text content doesn't change tags after it
+	const bool insertion = (modificationType & SC_MOD_INSERTTEXT) != 0;
+	const Sci_Position after = insertion ? position + length : position;
+	if (text != nullptr && memchr(text, '<', length) == nullptr && memchr(text, '>', length) == nullptr
+		&& (position == 0 || IsTagTextBoundary(position - 1, '>'))
+		&& (after == SciCall_GetLength() || IsTagTextBoundary(after, '<'))) {
+		if (insertion) {
+			tagIndex.InsertText(position, length);
+		} else {
+			tagIndex.DeleteText(position, length);
+		}
+	} else {
+		tagIndex.Invalidate(position);
+	}
+}
+
+static bool IsTagStyle(void *param, size_t position) noexcept {
+	UNREFERENCED_PARAMETER(param);
+	const int style = SciCall_GetStyleIndexAt(position);
+	return style == SCE_H_TAG || style == SCE_H_TAGUNKNOWN;
+}
+
+static const char *GetTagText(void *param, size_t position, size_t length) noexcept {
+	UNREFERENCED_PARAMETER(param);
+	return SciCall_GetRangePointer(position, length);
+}
+
+static bool PrepareTagIndex() noexcept {
+	const int iLexer = pLexCurrent->iLexer;
+	if (iLexer != SCLEX_HTML && iLexer != SCLEX_XML) {
+		EditResetTagIndex();
+		return false;
+	}
+	if (tagIndexLexer != pLexCurrent) {
+		tagIndexLexer = pLexCurrent;
+		tagIndex.Reset(iLexer == SCLEX_HTML);
+	}
+	return true;
+}
+
+// index next slice of styled text, returns false when no styled text is left.
+static bool ExtendTagIndex() noexcept {
+	if (tagIndex.Finished()) {
+		return false;
+	}
+	const Sci_Position length = SciCall_GetLength();
+	const Sci_Position endStyled = SciCall_GetEndStyled();
+	const Sci_Position start = tagIndex.ValidUntil();
+	Sci_Position sliceLength = TAG_INDEX_SLICE_SIZE;
+	while (true) {
+		const Sci_Position end = min(endStyled, start + sliceLength);
+		if (end <= start && end != length) {
+			return false;
+		}
+		const char *text = SciCall_GetRangePointer(start, end - start);
+		if (!tagIndex.Extend(text, end - start, end == length, IsTagStyle, GetTagText, nullptr)) {
+			return false;
+		}
+		if (tagIndex.ValidUntil() != static_cast<size_t>(start) || tagIndex.Finished()) {
+			return true;
+		}
+		// tag longer than the slice
+		if (end == endStyled) {
+			return false;
+		}
+		sliceLength *= 2;
+	}
+}
+
+// index styled text on idle timer, stops after whole document is indexed.
+void EditTagIndexTimer() noexcept {
+	if (!PrepareTagIndex() || (!ExtendTagIndex()
+		&& (tagIndex.Finished() || SciCall_GetEndStyled() == SciCall_GetLength()))) {
+		StopTagIndexTimer();
+	}
+	if (tagHighlightPending && EditHighlightMatchingTag(true)) {
+		SciCall_BraceHighlight(INVALID_POSITION, INVALID_POSITION);
+		SciCall_SetHighlightGuide(0);
+	}
+}
+
+// indexes all styled text as needed when force is true, otherwise at most one slice.
+static uint32_t QueryTagIndex(TagQuery query, size_t value, bool force) noexcept {
+	uint32_t result;
+	bool extended = false;
+	while (true) {
+		switch (query) {
+		case TagQuery_TagAt:
+			result = tagIndex.TagAt(value);
+			break;
+		case TagQuery_MatchingTag:
+			result = tagIndex.MatchingTag(static_cast<uint32_t>(value));
+			break;
+		case TagQuery_EnclosingElement:
+			result = tagIndex.EnclosingElement(value);
+			break;
+		case TagQuery_NextSibling:
+			result = tagIndex.NextSibling(value);
+			break;
+		default:
+			result = tagIndex.PreviousSibling(value);
+			break;
+		}
+		if (result != TagPairIndex::pending || (extended && !force) || !ExtendTagIndex()) {
+			break;
+		}
+		extended = true;
+	}
+	if (result == TagPairIndex::pending && !tagIndexTimer) {
+		// continue after more text is styled
+		tagIndexTimer = true;
+		SetTimer(hwndMain, ID_TAGINDEXTIMER, TAG_INDEX_IDLE_TIME, nullptr);
+	}
+	return result;
+}
+
+// tag with caret on its name, e.g. <|name, </na|me or <name|>
+static uint32_t GetCaretTag(Sci_Position iCurPos, bool force) noexcept {
+	const uint32_t index = QueryTagIndex(TagQuery_TagAt, iCurPos, force);
+	if (index < tagIndex.Count()) {
+		const TagEntry tag = tagIndex[index];
+		if (static_cast<size_t>(iCurPos) > tag.start && static_cast<size_t>(iCurPos) <= tag.NameEnd()) {
+			return index;
+		}
+	}
+	return TagPairIndex::npos;
+}
+
+bool EditMatchTag(bool select) noexcept {
+	if (!PrepareTagIndex()) {
+		return false;
+	}
+
+	Sci_Position iCurPos = SciCall_GetCurrentPos();
+	const uint32_t index = GetCaretTag(iCurPos, true);
+	if (index == TagPairIndex::npos) {
+		return false;
+	}
+	const uint32_t match = QueryTagIndex(TagQuery_MatchingTag, index, true);
+	if (match >= tagIndex.Count()) {
+		return false;
+	}
+
+	const TagEntry tag = tagIndex[index];
+	const TagEntry other = tagIndex[match];
+	if (select) {
+		Sci_Position iAnchorPos = SciCall_GetAnchor();
+		const Sci_Position iMinPos = min(iAnchorPos, iCurPos);
+		const Sci_Position iMaxPos = max(iAnchorPos, iCurPos);
+		if (other.start > tag.start) {
+			iAnchorPos = min(static_cast<Sci_Position>(tag.start), iMinPos);
+			iCurPos = max(static_cast<Sci_Position>(other.End()), iMaxPos);
+		} else {
+			iAnchorPos = max(static_cast<Sci_Position>(tag.End()), iMaxPos);
+			iCurPos = min(static_cast<Sci_Position>(other.start), iMinPos);
+		}
+		EditSelectEx(iAnchorPos, iCurPos);
+	} else {
+		iCurPos = other.NameStart();
+		EditSelectEx(iCurPos, iCurPos);
+		SciCall_ChooseCaretX();
+	}
+	return true;
+}
+
+// highlight name of matching tags around caret, returns false when caret is not on tag name.
+bool EditHighlightMatchingTag(bool highlight) noexcept {
+	if (tagHighlighted) {
+		tagHighlighted = false;
+		const Sci_Position length = SciCall_GetLength();
+		SciCall_SetIndicatorCurrent(IndicatorNumber_MatchBrace);
+		SciCall_IndicatorClearRange(0, length);
+		SciCall_SetIndicatorCurrent(IndicatorNumber_MatchBraceError);
+		SciCall_IndicatorClearRange(0, length);
+	}
+	tagHighlightPending = false;
+	if (!highlight || !PrepareTagIndex()) {
+		return false;
+	}
+
+	// index at most one more slice on caret move
+	const Sci_Position iCurPos = SciCall_GetCurrentPos();
+	const uint32_t index = GetCaretTag(iCurPos, false);
+	if (index == TagPairIndex::npos) {
+		tagHighlightPending = tagIndex.TagAt(iCurPos) == TagPairIndex::pending;
+		return false;
+	}
+	const uint32_t match = QueryTagIndex(TagQuery_MatchingTag, index, false);
+	tagHighlightPending = match == TagPairIndex::pending;
+	const TagEntry tag = tagIndex[index];
+	if (match < tagIndex.Count()) {
+		const TagEntry other = tagIndex[match];
+		tagHighlighted = true;
+		SciCall_SetIndicatorCurrent(IndicatorNumber_MatchBrace);
+		SciCall_IndicatorFillRange(tag.NameStart(), tag.nameLength);
+		SciCall_IndicatorFillRange(other.NameStart(), other.nameLength);
+	} else if (match == TagPairIndex::npos && tag.kind != TagKind_Empty) {
+		tagHighlighted = true;
+		SciCall_SetIndicatorCurrent(IndicatorNumber_MatchBraceError);
+		SciCall_IndicatorFillRange(tag.NameStart(), tag.nameLength);
+	}
+	return true;
+}
+
+static bool EditGotoTagBlock(int menu) noexcept {
+	if (!PrepareTagIndex()) {
+		return false;
+	}
+	const Sci_Position iCurPos = SciCall_GetCurrentPos();
+	if (SciCall_GetStyleIndexAt(iCurPos) > SCE_H_SGML_BLOCK_DEFAULT) {
+		return false; // script or style block
+	}
+
+	uint32_t index;
+	switch (menu) {
+	case IDM_EDIT_GOTO_BLOCK_START:
+		index = QueryTagIndex(TagQuery_EnclosingElement, iCurPos, true);
+		if (index < tagIndex.Count() && tagIndex[index].start == static_cast<size_t>(iCurPos)) {
+			index = tagIndex[index].parent;
+		}
+		break;
+
+	case IDM_EDIT_GOTO_BLOCK_END:
+		index = QueryTagIndex(TagQuery_EnclosingElement, iCurPos, true);
+		while (index < tagIndex.Count()) {
+			const uint32_t match = QueryTagIndex(TagQuery_MatchingTag, index, true);
+			if (match < tagIndex.Count() && tagIndex[match].start != static_cast<size_t>(iCurPos)) {
+				index = match;
+				break;
+			}
+			index = tagIndex[index].parent;
+		}
+		break;
+
+	case IDM_EDIT_GOTO_PREV_SIBLING_BLOCK:
+		index = QueryTagIndex(TagQuery_PreviousSibling, iCurPos, true);
+		break;
+
+	case IDM_EDIT_GOTO_NEXT_SIBLING_BLOCK:
+		index = QueryTagIndex(TagQuery_NextSibling, iCurPos, true);
+		break;
+
+	default:
+		return false;
+	}
+
+	if (index < tagIndex.Count()) {
+		const Sci_Position iPos = tagIndex[index].start;
+		EditSelectEx(iPos, iPos);
+		SciCall_ChooseCaretX();
+		return true;
+	}
+	return false;
+}
+
 void EditGotoBlock(int menu) noexcept {
+	if (EditGotoTagBlock(menu)) {
+		return;
+	}
+
 	const Sci_Position iCurPos = SciCall_GetCurrentPos();
 	const Sci_Line iCurLine = SciCall_LineFromPosition(iCurPos);
 
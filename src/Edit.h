@@ -32,6 +32,7 @@
 #define NP2_MarkAllBookmark		0x00002000
 #define NP2_MarkAllSelectAll	0x00004000
 #define NP2_FromFindAll			0x00008000
+#define NP2_SkipCommentString	0x00010000
 
 struct EDITFINDREPLACE {
 	char	szFind[512];
@@ -128,6 +129,7 @@ constexpr int GetSettingsEOLMode(int mode) noexcept {
 
 struct EditFileIOStatus;
 void 	EditDetectEOLMode(LPCSTR lpData, DWORD cbData, EditFileIOStatus &status) noexcept;
+void	EditFreeRawFileData() noexcept;
 bool	EditLoadFile(LPWSTR pszFile, EditFileIOStatus &status) noexcept;
 bool	EditSaveFile(HWND hwnd, LPCWSTR pszFile, int saveFlag, EditFileIOStatus &status) noexcept;
 
@@ -151,6 +153,7 @@ enum Base64EncodingFlag {
 };
 void	EditBase64Encode(Base64EncodingFlag encodingFlag) noexcept;
 void	EditBase64Decode(bool decodeAsHex) noexcept;
+void	EditCheckWellFormed() noexcept;
 void	EditConvertNumRadix(int radix) noexcept;
 void	EditModifyNumber(bool bIncrease);
 
@@ -219,11 +222,13 @@ void	EditFormatCode(int menu) noexcept;
 
 enum {
 	MarkerNumber_Bookmark = 0,
+	MarkerNumber_WellFormedError = 1,
 
 	// [0, INDICATOR_CONTAINER) are reserved for lexer.
 	IndicatorNumber_MarkOccurrence = INDICATOR_CONTAINER + 0,
 	IndicatorNumber_MatchBrace = INDICATOR_CONTAINER + 1,
 	IndicatorNumber_MatchBraceError = INDICATOR_CONTAINER + 2,
+	IndicatorNumber_WellFormedError = INDICATOR_CONTAINER + 3,
 	// [INDICATOR_IME, INDICATOR_IME_MAX] are reserved for IME.
 
 	MarginNumber_LineNumber = 0,
@@ -332,6 +337,7 @@ struct EditAutoCompletionConfig {
 	UINT dwScanWordsTimeout;
 	bool bEnglistIMEModeOnly;
 	bool bIgnoreCase;
+	bool bFuzzyMatch;
 	bool bLaTeXInputMethod;
 	UINT iVisibleItemCount;
 	int iMinWordLength;
@@ -355,6 +361,7 @@ extern const uint32_t DefaultWordCharSet[8];
 void	EditCompleteUpdateConfig() noexcept;
 bool	IsDocWordChar(uint32_t ch) noexcept;
 bool	IsAutoCompletionWordCharacter(uint32_t ch) noexcept;
+void	EditSetSearchStyleMask(int searchFlags) noexcept;
 void	EditCompleteWord(int iCondition, bool autoInsert) noexcept;
 bool	EditIsOpenBraceMatched(Sci_Position pos, Sci_Position startPos) noexcept;
 void	EditAutoCloseBraceQuote(int ch, AutoInsertCharacter what) noexcept;
@@ -626,6 +633,11 @@ void FoldToggleDefault(FOLD_ACTION action) noexcept;
 void FoldClickAt(Sci_Position pos, int mode) noexcept;
 void FoldAltArrow(int key, int mode) noexcept;
 void EditGotoBlock(int menu) noexcept;
+void EditResetTagIndex() noexcept;
+void EditTagIndexModified(int modificationType, Sci_Position position, Sci_Position length, const char *text) noexcept;
+void EditTagIndexTimer() noexcept;
+bool EditMatchTag(bool select) noexcept;
+bool EditHighlightMatchingTag(bool highlight) noexcept;
 
 enum SelectOption {
 	SelectOption_None = 0,
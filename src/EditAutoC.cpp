@@ -17,6 +17,7 @@ struct IUnknown;
 #include "resource.h"
 #include "EditAutoC_Data0.h"
 #include "LaTeXInput.h"
+#include "FuzzyMatch.h"
 
 #define NP2_AUTOC_CACHE_SORT_KEY	1
 #define NP2_AUTOC_USE_WORD_POINTER	0	// used for debug
@@ -24,6 +25,12 @@ struct IUnknown;
 #define NP2_AUTOC_MAX_WORD_LENGTH	(1024 - 3 - 1 - 16)	// SP + '(' + ')' + '\0'
 #define NP2_AUTOC_WORD_BUFFER_SIZE	1024
 #define NP2_AUTOC_INIT_BUFFER_SIZE	(4096)
+// maximum number of words shown for fuzzy match, ordered by match score
+#define NP2_AUTOC_FUZZY_MAX_COUNT	256
+
+// words collected for fuzzy match, reused while typing more characters of same word.
+static FuzzyMatcher fuzzyMatcher;
+static Sci_Position fuzzyWordStart = -1;
 
 // memory buffer
 struct WordListBuffer {
@@ -45,6 +52,8 @@ struct WordList {
 	UINT startSortKey;
 	bool bIgnoreCase;
 #endif
+	bool bFuzzy;
+	uint64_t startMask;
 	UINT nWordCount;
 	UINT nTotalLen;
 
@@ -52,7 +61,7 @@ struct WordList {
 	UINT capacity;
 	WordListBuffer *buffer;
 
-	void Init(LPCSTR pRoot, UINT iRootLen, bool ignoreCase) noexcept;
+	void Init(LPCSTR pRoot, UINT iRootLen, bool ignoreCase, bool fuzzy) noexcept;
 	void Free() const noexcept;
 	char *GetList() const noexcept;
 	void AddBuffer() noexcept;
@@ -179,9 +188,13 @@ void WordList::AddBuffer() noexcept {
 }
 
 void WordList::AddWord(LPCSTR pWord, UINT len) noexcept {
+	// the tree only removes duplicate words for fuzzy match, which are ranked by FuzzyMatcher
+	if (bFuzzy && !FuzzyIsSubsequence(pWordStart, iStartLen, pWord, len)) {
+		return;
+	}
 	WordNode *root = pListHead;
 #if NP2_AUTOC_CACHE_SORT_KEY
-	const UINT sortKey = (iStartLen > NP2_AUTOC_SORT_KEY_LENGTH) ? 0 : WL_SortKeyFunc(pWord, len);
+	const UINT sortKey = (iStartLen > NP2_AUTOC_SORT_KEY_LENGTH || bFuzzy) ? 0 : WL_SortKeyFunc(pWord, len);
 #endif
 	if (root == nullptr) {
 		WordNode *node = WordList_AddNode();
@@ -207,7 +220,7 @@ void WordList::AddWord(LPCSTR pWord, UINT len) noexcept {
 			path[top++] = iter;
 #if NP2_AUTOC_CACHE_SORT_KEY
 			dir = static_cast<int>(iter->sortKey - sortKey);
-			if (dir == 0 && (len > NP2_AUTOC_SORT_KEY_LENGTH || iter->len > NP2_AUTOC_SORT_KEY_LENGTH || bIgnoreCase)) {
+			if (dir == 0 && (len > NP2_AUTOC_SORT_KEY_LENGTH || iter->len > NP2_AUTOC_SORT_KEY_LENGTH || bIgnoreCase || bFuzzy)) {
 				dir = WL_strcmp(WordNode_GetWord(iter), pWord);
 			}
 #else
@@ -261,6 +274,9 @@ void WordList::AddWord(LPCSTR pWord, UINT len) noexcept {
 	pListHead = root;
 	nWordCount++;
 	nTotalLen += len + 1;
+	if (bFuzzy) {
+		fuzzyMatcher.AddWord(pWord, len);
+	}
 	offset += NP2_align_up(len + 1 + sizeof(WordNode), alignof(WordNode));
 }
 
@@ -299,10 +315,30 @@ char* WordList::GetList() const noexcept {
 	return pList;
 }
 
-void WordList::Init(LPCSTR pRoot, UINT iRootLen, bool ignoreCase) noexcept {
+static char *AutoC_GetFuzzyList(UINT nTotalLen) noexcept {
+	char *buf = static_cast<char *>(NP2HeapAlloc(nTotalLen + 1));// additional separator
+	char * const pList = buf;
+	const UINT count = fuzzyMatcher.ResultCount();
+	for (UINT index = 0; index < count; index++) {
+		UINT len;
+		LPCSTR word = fuzzyMatcher.Result(index, len);
+		memcpy(buf, word, len);
+		buf += len;
+		*buf++ = '\n'; // the separator char
+	}
+	// trim last separator char
+	if (buf != pList) {
+		*(--buf) = '\0';
+	}
+	return pList;
+}
+
+void WordList::Init(LPCSTR pRoot, UINT iRootLen, bool ignoreCase, bool fuzzy) noexcept {
 	memset(this, 0, sizeof(struct WordList));
 	pWordStart = pRoot;
 	iStartLen = iRootLen;
+	bFuzzy = fuzzy;
+	startMask = FuzzyMask(pRoot, iRootLen);
 
 	if (ignoreCase) {
 		WL_strcmp = strcmp;
@@ -329,12 +365,23 @@ void WordList::Init(LPCSTR pRoot, UINT iRootLen, bool ignoreCase) noexcept {
 void WordList::UpdateRoot(LPCSTR pRoot, UINT iRootLen) noexcept {
 	pWordStart = pRoot;
 	iStartLen = iRootLen;
+	startMask = FuzzyMask(pRoot, iRootLen);
+	if (bFuzzy) {
+		fuzzyMatcher.Reset(pRoot, iRootLen);
+	}
 #if NP2_AUTOC_CACHE_SORT_KEY
 	startSortKey = WL_SortKeyFunc(pRoot, iRootLen);
 #endif
 }
 
 bool WordList::StartsWith(LPCSTR pWord) const noexcept {
+	if (bFuzzy) {
+		const UINT len = static_cast<UINT>(strlen(pWord));
+		if ((startMask & ~FuzzyMask(pWord, len)) != 0) {
+			return false;
+		}
+		return FuzzyIsSubsequence(pWordStart, iStartLen, pWord, len);
+	}
 #if NP2_AUTOC_CACHE_SORT_KEY
 	if (iStartLen <= NP2_AUTOC_SORT_KEY_LENGTH) {
 		return startSortKey == WL_SortKeyFunc(pWord, iStartLen);
@@ -572,6 +619,25 @@ bool IsAutoCompletionWordCharacter(uint32_t ch) noexcept {
 	return cc == CharacterClass_Word;
 }
 
+// only search text outside comments and strings for NP2_SkipCommentString,
+// the mask is cleared when current lexer has no comment or string style.
+void EditSetSearchStyleMask(int searchFlags) noexcept {
+	if (searchFlags & NP2_SkipCommentString) {
+		uint32_t styleMask[8];
+		uint32_t skipped = 0;
+		for (UINT i = 0; i < COUNTOF(styleMask); i++) {
+			const uint32_t mask = CommentStyleMask[i] | AllStringStyleMask[i];
+			skipped |= mask;
+			styleMask[i] = ~mask;
+		}
+		if (skipped != 0) {
+			SciCall_SetSearchStyleMask(styleMask);
+			return;
+		}
+	}
+	SciCall_SetSearchStyleMask(nullptr);
+}
+
 static constexpr bool IsEscapeCharacter(int ch) noexcept {
 	return ch == '0'	// '\0'
 		|| ch == 'a'	// '\a'
@@ -810,11 +876,18 @@ static void AutoC_AddDocWord(WordList &pWList, const uint32_t (&ignoredStyleMask
 		pFind = static_cast<char *>(NP2HeapAlloc(iRootLen + 2));
 	}
 
+	// for fuzzy match, find words contain first character then filter them by whole root,
+	// e.g. "respheader" for getHttpResponseHeader.
+	const int iFindLen = pWList.bFuzzy ? 1 : iRootLen;
 	pFind[0] = prefix;
-	memcpy(pFind + (prefix != '\0'), pRoot, iRootLen);
-	int findFlag = (bIgnoreCase ? SCFIND_NONE : SCFIND_MATCHCASE) | SCFIND_MATCH_TO_WORD_END;
+	memcpy(pFind + (prefix != '\0'), pRoot, iFindLen);
+	int findFlag = ((bIgnoreCase || pWList.bFuzzy) ? SCFIND_NONE : SCFIND_MATCHCASE) | SCFIND_MATCH_TO_WORD_END;
+	bool bInnerMatch = false;
 	if (IsDefaultWordChar(static_cast<uint8_t>(pRoot[0]))) {
-		findFlag |= SCFIND_WORDSTART;
+		bInnerMatch = pWList.bFuzzy && prefix == '\0';
+		if (!bInnerMatch) {
+			findFlag |= SCFIND_WORDSTART;
+		}
 	}
 
 	const Sci_Position iCurrentPos = SciCall_GetCurrentPos() - iRootLen - (prefix ? 1 : 0);
@@ -826,7 +899,11 @@ static void AutoC_AddDocWord(WordList &pWList, const uint32_t (&ignoredStyleMask
 	WaitableTimer_Set(timer, autoCompletionConfig.dwScanWordsTimeout);
 
 	while (iPosFind >= 0 && iPosFind < iDocLen && WaitableTimer_Continue(timer)) {
-		Sci_Position wordEnd = iPosFind + iRootLen;
+		if (bInnerMatch) {
+			// the match ends at word end, move to word start
+			iPosFind = SciCall_WordStartPosition(iPosFind, true);
+		}
+		Sci_Position wordEnd = iPosFind + iFindLen;
 		const int style = SciCall_GetStyleIndexAt(wordEnd - 1);
 		wordEnd = ft.chrgText.cpMax;
 		if (iPosFind != iCurrentPos && !BitTestEx(ignoredStyleMask, style)) {
@@ -1619,13 +1696,21 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 
 	bool bIgnoreLexer = (pRoot[0] >= '0' && pRoot[0] <= '9'); // number
 	const bool bIgnoreCase = bIgnoreLexer || autoCompletionConfig.bIgnoreCase;
+	const bool bFuzzy = autoCompletionConfig.bFuzzyMatch && !bIgnoreLexer;
+	// when list for previous root is shown, only words matched previous root are checked again
+	const bool bFuzzyReuse = bFuzzy && iCondition != AutoCompleteCondition_Normal
+		&& autoCompletionConfig.iPreviousItemCount != 0 && fuzzyWordStart == iStartWordPos
+		&& fuzzyMatcher.Covers(pRoot, iRootLen);
 	WordList pWList;
-	pWList.Init(pRoot, iRootLen, bIgnoreCase);
+	pWList.Init(pRoot, iRootLen, bIgnoreCase, bFuzzy);
+	if (bFuzzy && !bFuzzyReuse) {
+		fuzzyMatcher.Reset(pRoot, iRootLen);
+	}
 	bool bIgnoreDoc = false;
 	char prefix = '\0';
 
 	int iCurrentStyle = SciCall_GetStyleIndexAt(iCurrentPos);
-	if (!bIgnoreLexer && IsSpecialStartChar(ch, chPrev)) {
+	if (!bIgnoreLexer && !bFuzzyReuse && IsSpecialStartChar(ch, chPrev)) {
 		int iPrevStyle = 0;
 		if (ch == ':' && chPrev != ':') {
 			const Sci_Position iPos = SciCall_WordStartPosition(iStartWordPos - 1, false);
@@ -1651,7 +1736,7 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 		iCurrentStyle = SciCall_GetStyleIndexAt(iStartWordPos);
 	}
 
-	bool retry = true;
+	bool retry = !bFuzzyReuse;
 	uint32_t ignoredStyleMask[8] = {0};
 	const bool bScanWordsInDocument = autoCompletionConfig.bScanWordsInDocument;
 	if (pLexCurrent->lexerAttr & LexerAttr_PlainTextFile) {
@@ -1720,6 +1805,19 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 		}
 	}
 
+	if (bFuzzy) {
+		// rank matched words, only keep top ranked words
+		fuzzyWordStart = iStartWordPos;
+		pWList.nWordCount = fuzzyMatcher.Match(pWList.pWordStart, pWList.iStartLen, NP2_AUTOC_FUZZY_MAX_COUNT);
+		pWList.nTotalLen = 0;
+		const UINT count = fuzzyMatcher.ResultCount();
+		for (UINT index = 0; index < count; index++) {
+			UINT len;
+			fuzzyMatcher.Result(index, len);
+			pWList.nTotalLen += len + 1;
+		}
+	}
+
 #if 0
 	watch.Stop();
 	const double elapsed = watch.Get();
@@ -1727,7 +1825,7 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 #endif
 
 	const bool bShow = pWList.nWordCount > 0 && !(pWList.nWordCount == 1 && pWList.nTotalLen == static_cast<UINT>(iRootLen + 1));
-	const bool bUpdated = (autoCompletionConfig.iPreviousItemCount == 0)
+	const bool bUpdated = (autoCompletionConfig.iPreviousItemCount == 0) || bFuzzy
 		// deleted some words. leave some words that no longer matches current input at the top.
 		|| (iCondition == AutoCompleteCondition_OnCharAdded && autoCompletionConfig.iPreviousItemCount - pWList.nWordCount > autoCompletionConfig.iVisibleItemCount)
 		// added some words. TODO: check top matched items before updating, if top items not changed, delay the update.
@@ -1735,9 +1833,11 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 
 	if (bShow && bUpdated) {
 		autoCompletionConfig.iPreviousItemCount = pWList.nWordCount;
-		char *pList = pWList.GetList();
+		char *pList = bFuzzy ? AutoC_GetFuzzyList(pWList.nTotalLen) : pWList.GetList();
 		SciCall_AutoCSetOptions(SC_AUTOCOMPLETE_FIXED_SIZE);
-		SciCall_AutoCSetOrder(SC_ORDER_PRESORTED); // pre-sorted
+		// fuzzy matched words are sorted by score, and may not start with current word
+		SciCall_AutoCSetOrder(bFuzzy ? SC_ORDER_CUSTOM : SC_ORDER_PRESORTED);
+		SciCall_AutoCSetAutoHide(!bFuzzy);
 		SciCall_AutoCSetIgnoreCase(bIgnoreCase); // case sensitivity
 		SciCall_AutoCSetCaseInsensitiveBehaviour(bIgnoreCase);
 		//SciCall_AutoCSetSeparator('\n');
@@ -1748,6 +1848,14 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 		SciCall_AutoCSetCancelAtStart(false); // don't cancel the list when deleting character
 		SciCall_AutoCSetChooseSingle(autoInsert);
 		SciCall_AutoCShow(pWList.iStartLen, pList);
+		if (bFuzzy) {
+			// select the best match
+			char *pEnd = strchr(pList, '\n');
+			if (pEnd) {
+				*pEnd = '\0';
+			}
+			SciCall_AutoCSelect(pList);
+		}
 		NP2HeapFree(pList);
 	}
 
@@ -1759,7 +1867,7 @@ static bool EditCompleteWordCore(int iCondition, bool autoInsert) noexcept {
 }
 
 void EditCompleteWord(int iCondition, bool autoInsert) noexcept {
-	if (iCondition == AutoCompleteCondition_OnCharAdded) {
+	if (iCondition == AutoCompleteCondition_OnCharAdded && !autoCompletionConfig.bFuzzyMatch) {
 		if (autoCompletionConfig.iPreviousItemCount <= 2*autoCompletionConfig.iVisibleItemCount) {
 			return;
 		}
@@ -216,6 +216,7 @@ using LPCEDITLEXER = const EDITLEXER *;
 #define NP2LEX_REGISTRY		63093	// SCLEX_REGISTRY	Registry File
 #define NP2LEX_COFFEESCRIPT	63094	// SCLEX_COFFEESCRIPT	CoffeeScript
 #define NP2LEX_AUTOHOTKEY	63095	// SCLEX_AUTOHOTKEY	AutoHotkey Script
+#define NP2LEX_LOG			63096	// SCLEX_LOG		Log File
 
 // special lexers
 #define NP2LEX_ANSI			63196	// SCLEX_NULL		ANSI Art
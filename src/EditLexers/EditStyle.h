@@ -284,3 +284,10 @@
 #define NP2STYLE_Rule					63697
 #define NP2STYLE_Citation				63698
 #define NP2STYLE_BitField				63699
+#define NP2STYLE_Error					63700
+#define NP2STYLE_Warning				63701
+#define NP2STYLE_Information			63702
+#define NP2STYLE_Debug					63703
+#define NP2STYLE_Thread					63704
+#define NP2STYLE_UniqueID				63705
+#define NP2STYLE_StackTrace				63706
@@ -307,5 +307,12 @@
 #define NP2StyleX_Rule					EDITSTYLE_HOLE(Rule, L"Rule")
 #define NP2StyleX_Citation				EDITSTYLE_HOLE(Citation, L"Citation")
 #define NP2StyleX_BitField				EDITSTYLE_HOLE(BitField, L"Bit Field")
+#define NP2StyleX_Error					EDITSTYLE_HOLE(Error, L"Error")
+#define NP2StyleX_Warning				EDITSTYLE_HOLE(Warning, L"Warning")
+#define NP2StyleX_Information			EDITSTYLE_HOLE(Information, L"Information")
+#define NP2StyleX_Debug					EDITSTYLE_HOLE(Debug, L"Debug")
+#define NP2StyleX_Thread				EDITSTYLE_HOLE(Thread, L"Thread")
+#define NP2StyleX_UniqueID				EDITSTYLE_HOLE(UniqueID, L"Unique ID")
+#define NP2StyleX_StackTrace			EDITSTYLE_HOLE(StackTrace, L"Stack Trace")
 
 #define EDITSTYLE_DEFAULT 				{ STYLE_DEFAULT, NP2StyleX_Default, L"" }
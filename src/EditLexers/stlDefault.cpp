@@ -124,7 +124,7 @@ EDITLEXER lex2ndTextFile = {
 		0, 0,
 //2nd Text Settings--Autogenerated -- end of section automatically generated
 	EDITLEXER_HOLE(L"2nd Text File", Styles_2ndText),
-	L"log; asc; map; bnf",
+	L"asc; map; bnf",
 	&Keywords_NULL,
 	Styles_2ndText
 };
@@ -299,3 +299,40 @@ EDITLEXER lexINI = {
 	&Keywords_NULL,
 	Styles_INI
 };
+
+static EDITSTYLE Styles_Log[] = {
+	EDITSTYLE_DEFAULT,
+	{ SCE_LOG_DATETIME, NP2StyleX_DateTime, L"fore:#008080" },
+	{ SCE_LOG_LEVEL_ERROR, NP2StyleX_Error, L"bold; fore:#FF0000" },
+	{ SCE_LOG_LEVEL_WARNING, NP2StyleX_Warning, L"bold; fore:#E08000" },
+	{ SCE_LOG_LEVEL_INFO, NP2StyleX_Information, L"fore:#0000FF" },
+	{ SCE_LOG_LEVEL_DEBUG, NP2StyleX_Debug, L"fore:#808080" },
+	{ SCE_LOG_THREAD, NP2StyleX_Thread, L"fore:#7F007F" },
+	{ SCE_LOG_NUMBER, NP2StyleX_Number, L"fore:#FF0000" },
+	{ SCE_LOG_STRING, NP2StyleX_String, L"fore:#008000" },
+	{ SCE_LOG_UNIQUE_ID, NP2StyleX_UniqueID, L"fore:#A46000" },
+	{ SCE_LOG_STACKTRACE, NP2StyleX_StackTrace, L"fore:#C80000; back:#FFF4F4; eolfilled" },
+};
+
+EDITLEXER lexLog = {
+	SCLEX_LOG, NP2LEX_LOG,
+//Log Settings++Autogenerated -- start of section automatically generated
+		LexerAttr_NoLineComment |
+		LexerAttr_NoBlockComment |
+		LexerAttr_PlainTextFile,
+		TAB_WIDTH_4, INDENT_WIDTH_4,
+		(1 << 0) | (1 << 1), // level1, level2
+		0,
+		'\0', 0, 0,
+		0,
+		0, 0,
+		0, 0,
+		KeywordAttr_Default
+		, 0,
+		0, 0,
+//Log Settings--Autogenerated -- end of section automatically generated
+	EDITLEXER_HOLE(L"Log File", Styles_Log),
+	L"log",
+	&Keywords_NULL,
+	Styles_Log
+};
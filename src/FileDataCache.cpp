@@ -0,0 +1,55 @@
+// Raw file data kept for reloading current document with another encoding
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include "Compression.h"
+#include "FileDataCache.h"
+
+FileDataCache::~FileDataCache() {
+	Clear();
+}
+
+void FileDataCache::Clear() noexcept {
+	if (data != nullptr) {
+		freeProc(data, 0);
+		data = nullptr;
+	}
+	free(path);
+	path = nullptr;
+	length = 0;
+}
+
+void FileDataCache::Keep(char *data_, size_t length_, CompressionFormat compression_, const FileDataKey &key) noexcept {
+	Clear();
+	if (length_ > MaxLength) {
+		freeProc(data_, 0);
+		return;
+	}
+	const size_t cbPath = (wcslen(key.path) + 1)*sizeof(wchar_t);
+	path = static_cast<wchar_t *>(malloc(cbPath));
+	if (path == nullptr) {
+		freeProc(data_, 0);
+		return;
+	}
+	memcpy(path, key.path, cbPath);
+	data = data_;
+	length = length_;
+	compression = compression_;
+	size = key.size;
+	lastWrite = key.lastWrite;
+}
+
+char *FileDataCache::Take(const FileDataKey &key, size_t &length_, CompressionFormat &compression_) noexcept {
+	char *result = nullptr;
+	if (data != nullptr && size == key.size && lastWrite == key.lastWrite && wcscmp(path, key.path) == 0) {
+		result = data;
+		length_ = length;
+		compression_ = compression;
+		data = nullptr;
+	}
+	Clear();
+	return result;
+}
@@ -0,0 +1,43 @@
+// Raw file data kept for reloading current document with another encoding
+#pragma once
+
+// The (decompressed) content of a loaded file is kept while the document is unmodified,
+// so reloading with another encoding doesn't read and decompress the file again.
+// Only small content is kept, larger file is read again, which is served from system
+// file cache in most cases, instead of holding a second copy of a huge file in memory.
+
+struct FileDataKey {
+	const wchar_t *path;	// real path
+	uint64_t size;			// file size on disk
+	uint64_t lastWrite;		// last write time
+};
+
+class FileDataCache {
+public:
+	static constexpr size_t MaxLength = 4*1024*1024;
+
+	// freeProc is called with zero size to free data.
+	explicit FileDataCache(CompressionReallocProc freeProc_) noexcept : freeProc{freeProc_} {}
+	FileDataCache(const FileDataCache &) = delete;
+	FileDataCache &operator=(const FileDataCache &) = delete;
+	~FileDataCache();
+
+	// takes ownership of data, which is freed instead of kept when longer than MaxLength.
+	void Keep(char *data, size_t length, CompressionFormat compression, const FileDataKey &key) noexcept;
+	// transfers kept data to caller when it's for same unchanged file, otherwise kept data
+	// is freed and returns nullptr.
+	char *Take(const FileDataKey &key, size_t &length, CompressionFormat &compression) noexcept;
+	void Clear() noexcept;
+	bool Empty() const noexcept {
+		return data == nullptr;
+	}
+
+private:
+	CompressionReallocProc freeProc;
+	char *data = nullptr;
+	size_t length = 0;
+	CompressionFormat compression = CompressionFormat::None;
+	wchar_t *path = nullptr;
+	uint64_t size = 0;
+	uint64_t lastWrite = 0;
+};
@@ -0,0 +1,338 @@
+// Fuzzy word matcher for auto-completion
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "VectorISA.h"
+#include "FuzzyMatch.h"
+
+namespace {
+
+constexpr uint8_t FuzzyFold(uint8_t ch) noexcept {
+	return (ch >= 'A' && ch <= 'Z') ? (ch + 'a' - 'A') : ch;
+}
+
+constexpr bool IsUpper(uint8_t ch) noexcept {
+	return ch >= 'A' && ch <= 'Z';
+}
+
+constexpr bool IsLower(uint8_t ch) noexcept {
+	return ch >= 'a' && ch <= 'z';
+}
+
+constexpr bool IsDigit(uint8_t ch) noexcept {
+	return ch >= '0' && ch <= '9';
+}
+
+bool IsWordBoundary(const char *word, uint32_t index) noexcept {
+	if (index == 0) {
+		return true;
+	}
+	const uint8_t ch = word[index];
+	const uint8_t chPrev = word[index - 1];
+	if (chPrev == '_' || chPrev == '-' || chPrev == '.' || chPrev == ':' || chPrev == ' ' || chPrev == '$') {
+		return ch != chPrev;
+	}
+	return (IsUpper(ch) && IsLower(chPrev))
+		|| (IsDigit(ch) && !IsDigit(chPrev));
+}
+
+// whether root starts with prefix, case insensitive.
+bool FuzzyStartsWith(const char *root, uint32_t rootLength, const char *prefix, uint32_t prefixLength) noexcept {
+	if (prefix == nullptr || prefixLength > rootLength) {
+		return false;
+	}
+	for (uint32_t i = 0; i < prefixLength; i++) {
+		if (FuzzyFold(root[i]) != FuzzyFold(prefix[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+uint64_t FuzzyMask(const char *word, uint32_t length) noexcept {
+	uint64_t mask = 0;
+	for (uint32_t i = 0; i < length; i++) {
+		mask |= UINT64_C(1) << (FuzzyFold(word[i]) & 63);
+	}
+	return mask;
+}
+
+bool FuzzyIsSubsequence(const char *root, uint32_t rootLength, const char *word, uint32_t length) noexcept {
+	uint32_t index = 0;
+	for (uint32_t i = 0; i < length && index < rootLength; i++) {
+		if (FuzzyFold(word[i]) == FuzzyFold(root[index])) {
+			++index;
+		}
+	}
+	return index == rootLength;
+}
+
+int FuzzyScore(const char *root, uint32_t rootLength, const char *word, uint32_t length) noexcept {
+	if (length < rootLength || !FuzzyIsSubsequence(root, rootLength, word, length)) {
+		return -1;
+	}
+
+	int score = 0;
+	uint32_t pos = 0;
+	uint32_t prevMatch = 0;
+	for (uint32_t index = 0; index < rootLength; index++) {
+		const uint8_t ch = FuzzyFold(root[index]);
+		while (FuzzyFold(word[pos]) != ch) {
+			++pos;
+		}
+		const bool consecutive = index != 0 && pos == prevMatch + 1;
+		if (!consecutive && !IsWordBoundary(word, pos)) {
+			// prefer later match on word boundary when rest of root still matches
+			for (uint32_t next = pos + 1; next < length; next++) {
+				if (FuzzyFold(word[next]) == ch && IsWordBoundary(word, next)
+					&& FuzzyIsSubsequence(root + index + 1, rootLength - index - 1, word + next + 1, length - next - 1)) {
+					pos = next;
+					break;
+				}
+			}
+		}
+
+		score += 1;
+		if (root[index] == word[pos]) {
+			score += 1;
+		}
+		if (index != 0 && pos == prevMatch + 1) {
+			score += 6;
+		} else if (IsWordBoundary(word, pos)) {
+			score += (pos == 0) ? 12 : 8;
+		} else if (index != 0) {
+			const uint32_t gap = pos - prevMatch - 1;
+			score -= (gap < 4) ? static_cast<int>(gap) : 4;
+		}
+		prevMatch = pos;
+		++pos;
+	}
+
+	if (prevMatch + 1 == rootLength) {
+		// prefix match
+		score += 32;
+	}
+	const uint32_t extra = length - rootLength;
+	score = score*4 - static_cast<int>((extra < 63) ? extra : 63)/8;
+	return (score < 0) ? 0 : ((score < FuzzyMaxScore) ? score : FuzzyMaxScore - 1);
+}
+
+FuzzyMatcher::~FuzzyMatcher() {
+	free(text);
+	free(words);
+	free(active);
+	free(activeMask);
+	free(results);
+	free(baseRoot);
+	free(lastRoot);
+}
+
+bool FuzzyMatcher::SetRoot(char *&buffer, uint32_t &bufferLength, const char *root, uint32_t rootLength) noexcept {
+	char *copy = static_cast<char *>(realloc(buffer, rootLength + 1));
+	if (copy == nullptr) {
+		return false;
+	}
+	memcpy(copy, root, rootLength);
+	copy[rootLength] = '\0';
+	buffer = copy;
+	bufferLength = rootLength;
+	return true;
+}
+
+void FuzzyMatcher::Reset(const char *root, uint32_t rootLength) noexcept {
+	textLength = 0;
+	wordCount = 0;
+	activeCount = 0;
+	resultCount = 0;
+	matched = false;
+	if (!SetRoot(baseRoot, baseRootLength, root, rootLength)) {
+		free(baseRoot);
+		baseRoot = nullptr;
+	}
+}
+
+bool FuzzyMatcher::Covers(const char *root, uint32_t rootLength) const noexcept {
+	return FuzzyStartsWith(root, rootLength, baseRoot, baseRootLength);
+}
+
+bool FuzzyMatcher::AddWord(const char *word, uint32_t length) noexcept {
+	if (textCapacity < textLength + length + 1) {
+		const size_t newCapacity = (textCapacity < 4096) ? 4096 : textCapacity*2;
+		if (newCapacity < textLength + length + 1) {
+			return false;
+		}
+		char *newText = static_cast<char *>(realloc(text, newCapacity));
+		if (newText == nullptr) {
+			return false;
+		}
+		text = newText;
+		textCapacity = newCapacity;
+	}
+	if (wordCount == wordCapacity) {
+		const uint32_t newCapacity = (wordCapacity < 256) ? 256 : wordCapacity*2;
+		Word *newWords = static_cast<Word *>(realloc(words, newCapacity*sizeof(Word)));
+		if (newWords == nullptr) {
+			return false;
+		}
+		words = newWords;
+		uint32_t *newActive = static_cast<uint32_t *>(realloc(active, newCapacity*sizeof(uint32_t)));
+		if (newActive == nullptr) {
+			return false;
+		}
+		active = newActive;
+		uint64_t *newMask = static_cast<uint64_t *>(realloc(activeMask, newCapacity*sizeof(uint64_t)));
+		if (newMask == nullptr) {
+			return false;
+		}
+		activeMask = newMask;
+		wordCapacity = newCapacity;
+	}
+
+	memcpy(text + textLength, word, length);
+	text[textLength + length] = '\0';
+	Word &item = words[wordCount];
+	item.offset = textLength;
+	item.length = length;
+	item.mask = FuzzyMask(word, length);
+	++wordCount;
+	textLength += length + 1;
+	matched = false;
+	return true;
+}
+
+bool FuzzyMatcher::Better(const Ranked &lhs, const Ranked &rhs) const noexcept {
+	if (lhs.score != rhs.score) {
+		return lhs.score > rhs.score;
+	}
+	return strcmp(text + words[lhs.index].offset, text + words[rhs.index].offset) < 0;
+}
+
+// results is a heap with the worst ranked word at top, which is replaced by a better word when full.
+void FuzzyMatcher::Push(Ranked item, uint32_t maxResult) noexcept {
+	uint32_t pos;
+	if (resultCount < maxResult) {
+		// sift up
+		pos = resultCount++;
+		while (pos != 0) {
+			const uint32_t parent = (pos - 1)/2;
+			if (!Better(results[parent], item)) {
+				break;
+			}
+			results[pos] = results[parent];
+			pos = parent;
+		}
+	} else {
+		if (!Better(item, results[0])) {
+			return;
+		}
+		// sift down
+		pos = 0;
+		while (true) {
+			uint32_t child = 2*pos + 1;
+			if (child >= resultCount) {
+				break;
+			}
+			if (child + 1 < resultCount && Better(results[child], results[child + 1])) {
+				++child;
+			}
+			if (!Better(item, results[child])) {
+				break;
+			}
+			results[pos] = results[child];
+			pos = child;
+		}
+	}
+	results[pos] = item;
+}
+
+uint32_t FuzzyMatcher::Match(const char *root, uint32_t rootLength, uint32_t maxResult) noexcept {
+	resultCount = 0;
+	if (!(matched && FuzzyStartsWith(root, rootLength, lastRoot, lastRootLength))) {
+		// check all words again
+		activeCount = wordCount;
+		for (uint32_t index = 0; index < wordCount; index++) {
+			active[index] = index;
+			activeMask[index] = words[index].mask;
+		}
+	}
+	if (resultCapacity < maxResult) {
+		Ranked *newResults = static_cast<Ranked *>(realloc(results, maxResult*sizeof(Ranked)));
+		if (newResults != nullptr) {
+			results = newResults;
+			resultCapacity = maxResult;
+		} else {
+			maxResult = resultCapacity;
+		}
+	}
+
+	// words are compacted in place, keep only words matched current root.
+	const uint64_t rootMask = FuzzyMask(root, rootLength);
+	uint32_t count = 0;
+	uint32_t index = 0;
+	const auto check = [&](uint32_t offset) noexcept {
+		const uint32_t wordIndex = active[offset];
+		const Word &word = words[wordIndex];
+		const int score = FuzzyScore(root, rootLength, text + word.offset, word.length);
+		if (score >= 0) {
+			activeMask[count] = activeMask[offset];
+			active[count++] = wordIndex;
+			if (maxResult != 0) {
+				Push({score, wordIndex}, maxResult);
+			}
+		}
+	};
+#if NP2_USE_SSE2
+	// prefilter two words at once, reject word missing any character in root.
+	const __m128i needle = _mm_set1_epi64x(static_cast<int64_t>(rootMask));
+	const __m128i zero = _mm_setzero_si128();
+	for (; index + 2 <= activeCount; index += 2) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(activeMask + index));
+		const __m128i missing = _mm_andnot_si128(chunk, needle);
+		uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi32(missing, zero));
+		// all four 32-bit lanes of a word must be zero
+		mask &= mask >> 4;
+		if (mask & 0x000f) {
+			check(index);
+		}
+		if (mask & 0x0f00) {
+			check(index + 1);
+		}
+	}
+#endif
+	for (; index < activeCount; index++) {
+		if ((rootMask & ~activeMask[index]) == 0) {
+			check(index);
+		}
+	}
+	activeCount = count;
+	matched = SetRoot(lastRoot, lastRootLength, root, rootLength);
+
+	// sort heap, move worst word to end
+	uint32_t remain = resultCount;
+	while (remain > 1) {
+		--remain;
+		const Ranked item = results[remain];
+		results[remain] = results[0];
+		uint32_t pos = 0;
+		while (true) {
+			uint32_t child = 2*pos + 1;
+			if (child >= remain) {
+				break;
+			}
+			if (child + 1 < remain && Better(results[child], results[child + 1])) {
+				++child;
+			}
+			if (!Better(item, results[child])) {
+				break;
+			}
+			results[pos] = results[child];
+			pos = child;
+		}
+		results[pos] = item;
+	}
+	return count;
+}
@@ -0,0 +1,85 @@
+// Fuzzy word matcher for auto-completion
+#pragma once
+
+// Characters in root appear in the word in same order (case insensitive), match on word start
+// and after camelCase, snake_case or kebab-case boundary get higher score.
+// e.g. both "ghrh" and "respheader" matches "getHttpResponseHeader".
+
+constexpr int FuzzyMaxScore = 0xffff;
+
+// character presence bitmask used to quickly reject words that can't match.
+// different characters may share same bit, which only cause more words to be checked.
+uint64_t FuzzyMask(const char *word, uint32_t length) noexcept;
+bool FuzzyIsSubsequence(const char *root, uint32_t rootLength, const char *word, uint32_t length) noexcept;
+// returns -1 when not match, otherwise a score less than FuzzyMaxScore.
+int FuzzyScore(const char *root, uint32_t rootLength, const char *word, uint32_t length) noexcept;
+
+// Words collected for a root are ranked by Match(), only best ones are kept in a bounded heap.
+// When the root is extended (e.g. typing next character), only words matched previous root
+// are checked again.
+class FuzzyMatcher {
+public:
+	FuzzyMatcher() noexcept = default;
+	FuzzyMatcher(const FuzzyMatcher &) = delete;
+	FuzzyMatcher &operator=(const FuzzyMatcher &) = delete;
+	~FuzzyMatcher();
+
+	// discard all words, words added later are matched with root or roots extend it.
+	void Reset(const char *root, uint32_t rootLength) noexcept;
+	// whether words can be reused for root, i.e. root extends root passed to Reset().
+	bool Covers(const char *root, uint32_t rootLength) const noexcept;
+	// returns false on out of memory. caller should avoid adding duplicate word.
+	bool AddWord(const char *word, uint32_t length) noexcept;
+	// returns number of matched words, best maxResult words are available through Result().
+	uint32_t Match(const char *root, uint32_t rootLength, uint32_t maxResult) noexcept;
+
+	uint32_t WordCount() const noexcept {
+		return wordCount;
+	}
+	uint32_t ResultCount() const noexcept {
+		return resultCount;
+	}
+	// results are ordered by score in descending order, then by word.
+	const char *Result(uint32_t index, uint32_t &length) const noexcept {
+		const Word &word = words[results[index].index];
+		length = word.length;
+		return text + word.offset;
+	}
+	int ResultScore(uint32_t index) const noexcept {
+		return results[index].score;
+	}
+
+private:
+	struct Word {
+		size_t offset;
+		uint32_t length;
+		uint64_t mask;
+	};
+	struct Ranked {
+		int score;
+		uint32_t index;
+	};
+
+	bool Better(const Ranked &lhs, const Ranked &rhs) const noexcept;
+	void Push(Ranked item, uint32_t maxResult) noexcept;
+	static bool SetRoot(char *&buffer, uint32_t &bufferLength, const char *root, uint32_t rootLength) noexcept;
+
+	char *text = nullptr;
+	size_t textLength = 0;
+	size_t textCapacity = 0;
+	Word *words = nullptr;
+	uint32_t wordCount = 0;
+	uint32_t wordCapacity = 0;
+	// words matched last root and their masks, stored contiguously for the prefilter.
+	uint32_t *active = nullptr;
+	uint64_t *activeMask = nullptr;
+	uint32_t activeCount = 0;
+	Ranked *results = nullptr;
+	uint32_t resultCount = 0;
+	uint32_t resultCapacity = 0;
+	char *baseRoot = nullptr;
+	uint32_t baseRootLength = 0;
+	char *lastRoot = nullptr;
+	uint32_t lastRootLength = 0;
+	bool matched = false;
+};
@@ -101,6 +101,116 @@ void IniClearAllSectionEx(LPCWSTR lpszPrefix, LPCWSTR lpszIniFile, bool bDelete)
 	}
 }
 
+//=============================================================================
+//
+// Scratch buffers for whole selection commands
+// large blocks are rounded up to size class and kept after free, then
+// released when no scratch buffer is freed for kScratchIdleTimeout.
+//
+namespace {
+
+constexpr size_t kScratchMinCachedSize = 64*1024;
+constexpr size_t kScratchMaxCachedSize = 256*1024*1024;
+constexpr UINT kScratchIdleTimeout = 5000;
+
+struct ScratchBlock {
+	void *ptr;
+	size_t size;
+};
+
+ScratchBlock scratchCache[4];
+UINT_PTR scratchTimerId;
+
+// round up to multiple of 1/8 of the highest power of two
+inline size_t GetScratchSizeClass(size_t size) noexcept {
+	const size_t mask = (static_cast<size_t>(1) << (np2::bsr(size) - 3)) - 1;
+	return (size + mask) & ~mask;
+}
+
+void CALLBACK ScratchTimerProc(HWND /*hwnd*/, UINT /*uMsg*/, UINT_PTR /*idEvent*/, DWORD /*dwTime*/) noexcept {
+	NP2ScratchRelease();
+}
+
+}
+
+void *NP2ScratchAlloc(size_t size) noexcept {
+	if (size < kScratchMinCachedSize) {
+		return HeapAlloc(g_hDefaultHeap, 0, size);
+	}
+
+	// best fit, but don't waste more than half of the block
+	ScratchBlock *best = nullptr;
+	for (ScratchBlock &block : scratchCache) {
+		if (block.ptr != nullptr && block.size >= size && block.size/2 <= size
+			&& (best == nullptr || block.size < best->size)) {
+			best = &block;
+		}
+	}
+	if (best != nullptr) {
+		void *ptr = best->ptr;
+		best->ptr = nullptr;
+		best->size = 0;
+		return ptr;
+	}
+
+	size = GetScratchSizeClass(size);
+	void *ptr = HeapAlloc(g_hDefaultHeap, 0, size);
+	if (ptr == nullptr) {
+		// retry after releasing cached blocks
+		NP2ScratchRelease();
+		ptr = HeapAlloc(g_hDefaultHeap, 0, size);
+	}
+	return ptr;
+}
+
+void NP2ScratchFree(void *ptr) noexcept {
+	if (ptr == nullptr) {
+		return;
+	}
+
+	const size_t size = HeapSize(g_hDefaultHeap, 0, ptr);
+	if (size >= kScratchMinCachedSize && size <= kScratchMaxCachedSize) {
+		// replace empty or the smallest block
+		ScratchBlock *victim = &scratchCache[0];
+		for (ScratchBlock &block : scratchCache) {
+			if (block.ptr == nullptr) {
+				victim = &block;
+				break;
+			}
+			if (block.size < victim->size) {
+				victim = &block;
+			}
+		}
+		if (victim->ptr == nullptr || victim->size < size) {
+			if (victim->ptr != nullptr) {
+				HeapFree(g_hDefaultHeap, 0, victim->ptr);
+			}
+			victim->ptr = ptr;
+			victim->size = size;
+			ptr = nullptr;
+			// restart idle timer
+			scratchTimerId = SetTimer(nullptr, scratchTimerId, kScratchIdleTimeout, ScratchTimerProc);
+		}
+	}
+	if (ptr != nullptr) {
+		HeapFree(g_hDefaultHeap, 0, ptr);
+	}
+}
+
+void NP2ScratchRelease() noexcept {
+	if (scratchTimerId != 0) {
+		KillTimer(nullptr, scratchTimerId);
+		scratchTimerId = 0;
+	}
+	for (ScratchBlock &block : scratchCache) {
+		if (block.ptr != nullptr) {
+			HeapFree(g_hDefaultHeap, 0, block.ptr);
+			block.ptr = nullptr;
+			block.size = 0;
+		}
+	}
+}
+
 //=============================================================================
 //
 // Manipulation of (cached) ini file sections
@@ -396,6 +396,11 @@ inline int GetBitmapResourceIdForCurrentDPI(int resourceId) noexcept {
 #define NP2HeapFree(hMem)			HeapFree(g_hDefaultHeap, 0, (hMem))
 #define NP2HeapSize(hMem)			HeapSize(g_hDefaultHeap, 0, (hMem))
 
+// scratch buffer for transient text, memory is not zero initialized.
+void *NP2ScratchAlloc(size_t size) noexcept;
+void NP2ScratchFree(void *ptr) noexcept;
+void NP2ScratchRelease() noexcept;
+
 #define IniGetString(lpSection, lpName, lpDefault, lpReturnedStr, nSize) \
 	GetPrivateProfileString(lpSection, lpName, lpDefault, lpReturnedStr, nSize, szIniFile)
 #define IniGetInt(lpSection, lpName, nDefault) \
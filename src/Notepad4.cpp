@@ -37,6 +37,9 @@ struct IUnknown;
 #include "Edit.h"
 #include "Styles.h"
 #include "Dialogs.h"
+#include "Compression.h"
+#include "BackgroundJob.h"
+#include "ThreadJobExecutor.h"
 #include "resource.h"
 
 #ifndef SM_CXPADDEDBORDER
@@ -169,6 +172,7 @@ bool	bLargeFileMode = false;
 #endif
 int		iDefaultEOLMode;
 static int iCurrentEOLMode;
+static CompressionFormat iCurrentCompression;
 bool	bWarnLineEndings;
 bool	bFixLineEndings;
 bool	bAutoStripBlanks;
@@ -185,6 +189,7 @@ bool	bFileWatchingKeepAtEnd;
 bool	bResetFileWatching;
 static DWORD dwFileCheckInterval;
 static DWORD dwAutoReloadTimeout;
+DWORD dwCompressDocumentSize;
 bool bUseXPFileDialog;
 static EscFunction iEscFunction;
 static bool bAlwaysOnTop;
@@ -1225,6 +1230,8 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 	case WM_TIMER:
 		if (wParam == ID_AUTOSAVETIMER) {
 			AutoSave_DoWork(FileSaveFlag_Default);
+		} else if (wParam == ID_TAGINDEXTIMER) {
+			EditTagIndexTimer();
 		}
 		break;
 
@@ -1557,6 +1564,10 @@ LRESULT CALLBACK MainWndProc(HWND hwnd, UINT umsg, WPARAM wParam, LPARAM lParam)
 	}
 	break;
 
+	case APPM_JOB_DONE:
+		AsPointer<ThreadJobExecutor *>(lParam)->Complete(static_cast<uint32_t>(wParam));
+		break;
+
 	case APPM_POST_HOTSPOTCLICK: {
 		// release mouse capture and restore selection
 		const int x = SciCall_PointXFromPosition(lParam);
@@ -1864,6 +1875,12 @@ void EditCreate(HWND hwndParent) noexcept {
 	SciCall_MarkerEnableHighlight(bHighlightCurrentBlock);
 	SciCall_BraceHighlightIndicator(true, IndicatorNumber_MatchBrace);
 	SciCall_BraceBadLightIndicator(true, IndicatorNumber_MatchBraceError);
+	// first error found by EditCheckWellFormed()
+	SciCall_MarkerSetForeTranslucent(MarkerNumber_WellFormedError, ColorAlpha(RGB(0x80, 0x00, 0x00), SC_ALPHA_OPAQUE));
+	SciCall_MarkerSetBackTranslucent(MarkerNumber_WellFormedError, ColorAlpha(RGB(0xFF, 0x40, 0x40), SC_ALPHA_OPAQUE));
+	SciCall_MarkerDefine(MarkerNumber_WellFormedError, SC_MARK_SHORTARROW);
+	SciCall_IndicSetStyle(IndicatorNumber_WellFormedError, INDIC_SQUIGGLE);
+	SciCall_IndicSetFore(IndicatorNumber_WellFormedError, RGB(0xFF, 0x00, 0x00));
 
 	// CallTip
 	SciCall_SetMouseDwellTime((callTipInfo.showCallTip == ShowCallTip_None)? SC_TIME_FOREVER : CallTipDefaultMouseDwellTime);
@@ -1877,6 +1894,7 @@ void EditCreate(HWND hwndParent) noexcept {
 void EditReplaceDocument(HANDLE pdoc) noexcept {
 	const UINT cpEdit = SciCall_GetCodePage();
 	SciCall_SetDocPointer(pdoc);
+	EditResetTagIndex();
 	// reduce reference count to 1
 	SciCall_ReleaseDocument(pdoc);
 	SciCall_SetCodePage(cpEdit);
@@ -3112,7 +3130,7 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 
 			if (SelectEncodingDlg(hwnd, &iNewEncoding, IDS_SELRECT_RELOAD_ENCODING)) {
 				iSrcEncoding = iNewEncoding;
-				FileLoad(static_cast<FileLoadFlag>(FileLoadFlag_DontSave | FileLoadFlag_Reload), szCurFile);
+				FileLoad(static_cast<FileLoadFlag>(FileLoadFlag_DontSave | FileLoadFlag_Reload | FileLoadFlag_Recode), szCurFile);
 			}
 		}
 		break;
@@ -3754,6 +3772,10 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		EndWaitCursor();
 		break;
 
+	case IDM_EDIT_CHECK_WELLFORMED:
+		EditCheckWellFormed();
+		break;
+
 	case IDM_EDIT_NUM2HEX:
 	case IDM_EDIT_NUM2DEC:
 	case IDM_EDIT_NUM2BIN:
@@ -3762,6 +3784,9 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		break;
 
 	case IDM_EDIT_FINDMATCHINGBRACE: {
+		if (EditMatchTag(false)) {
+			break;
+		}
 		Sci_Position iBrace2 = INVALID_POSITION;
 		Sci_Position iPos = SciCall_GetCurrentPos();
 		int ch = SciCall_GetCharAt(iPos);
@@ -3781,6 +3806,9 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 	break;
 
 	case IDM_EDIT_SELTOMATCHINGBRACE: {
+		if (EditMatchTag(true)) {
+			break;
+		}
 		Sci_Position iBrace2 = INVALID_POSITION;
 		Sci_Position iCurPos = SciCall_GetCurrentPos();
 		Sci_Position iPos = iCurPos;
@@ -4206,6 +4234,7 @@ LRESULT MsgCommand(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 			SendMessage(hwnd, WM_NOTIFY, IDC_EDIT, AsInteger<LPARAM>(&scn));
 		} else {
 			SciCall_BraceHighlight(INVALID_POSITION, INVALID_POSITION);
+			EditHighlightMatchingTag(false);
 		}
 		break;
 
@@ -4918,7 +4947,10 @@ LRESULT MsgNotify(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 				if (bMatchBraces) {
 					Sci_Position iPos = SciCall_GetCurrentPos();
 					int ch = SciCall_GetCharAt(iPos);
-					if (IsBraceMatchChar(ch)) {
+					if (EditHighlightMatchingTag(true)) {
+						SciCall_BraceHighlight(INVALID_POSITION, INVALID_POSITION);
+						SciCall_SetHighlightGuide(0);
+					} else if (IsBraceMatchChar(ch)) {
 						const Sci_Position iBrace2 = SciCall_BraceMatch(iPos);
 						if (iBrace2 >= 0) {
 							const Sci_Position col1 = SciCall_GetColumn(iPos);
@@ -5088,6 +5120,7 @@ LRESULT MsgNotify(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 		case SCN_MODIFIED:
 			// we only watch SC_MOD_INSERTTEXT | SC_MOD_DELETETEXT
 			++dwCurrentDocReversion;
+			EditTagIndexModified(scn->modificationType, scn->position, scn->length, scn->text);
 			UpdateStatusBarCacheLineColumn();
 			if (scn->linesAdded) {
 				UpdateLineNumberWidth();
@@ -5126,6 +5159,7 @@ LRESULT MsgNotify(HWND hwnd, WPARAM wParam, LPARAM lParam) {
 
 		case SCN_SAVEPOINTLEFT:
 			bDocumentModified = true;
+			EditFreeRawFileData();
 			UpdateDocumentModificationStatus();
 			break;
 
@@ -5388,6 +5422,9 @@ void LoadSettings() noexcept {
 		if (section.GetBool(L"FindReplaceRegExpSearch", false)) {
 			efrData.fuFlags |= NP2_RegexDefaultFlags;
 		}
+		if (section.GetBool(L"FindReplaceSkipCommentString", false)) {
+			efrData.fuFlags |= NP2_SkipCommentString;
+		}
 		efrData.bTransformBS = section.GetBool(L"FindReplaceTransformBackslash", false);
 		efrData.bWildcardSearch = section.GetBool(L"FindReplaceWildcardSearch", false);
 	}
@@ -5425,6 +5462,7 @@ void LoadSettings() noexcept {
 	autoCompletionConfig.dwScanWordsTimeout = max(iValue, AUTOC_SCAN_WORDS_MIN_TIMEOUT);
 	autoCompletionConfig.bEnglistIMEModeOnly = section.GetBool(L"AutoCEnglishIMEModeOnly", false);
 	autoCompletionConfig.bIgnoreCase = section.GetBool(L"AutoCIgnoreCase", false);
+	autoCompletionConfig.bFuzzyMatch = section.GetBool(L"AutoCFuzzyMatch", false);
 	autoCompletionConfig.bLaTeXInputMethod = section.GetBool(L"LaTeXInputMethod", false);
 	iValue = section.GetInt(L"AutoCVisibleItemCount", 16);
 	autoCompletionConfig.iVisibleItemCount = max(iValue, MIN_AUTO_COMPLETION_VISIBLE_ITEM_COUNT);
@@ -5747,6 +5785,7 @@ void SaveSettings(bool bSaveSettingsNow) noexcept {
 		section.SetBoolEx(L"FindReplaceMatchWholeWorldOnly", (efrData.fuFlags & SCFIND_WHOLEWORD), false);
 		section.SetBoolEx(L"FindReplaceMatchBeginingWordOnly", (efrData.fuFlags & SCFIND_WORDSTART), false);
 		section.SetBoolEx(L"FindReplaceRegExpSearch", (efrData.fuFlags & SCFIND_REGEXP), false);
+		section.SetBoolEx(L"FindReplaceSkipCommentString", (efrData.fuFlags & NP2_SkipCommentString), false);
 		section.SetBoolEx(L"FindReplaceTransformBackslash", efrData.bTransformBS, false);
 		section.SetBoolEx(L"FindReplaceWildcardSearch", efrData.bWildcardSearch, false);
 	}
@@ -5773,6 +5812,7 @@ void SaveSettings(bool bSaveSettingsNow) noexcept {
 	section.SetIntEx(L"AutoCScanWordsTimeout", autoCompletionConfig.dwScanWordsTimeout, AUTOC_SCAN_WORDS_DEFAULT_TIMEOUT);
 	section.SetBoolEx(L"AutoCEnglishIMEModeOnly", autoCompletionConfig.bEnglistIMEModeOnly, false);
 	section.SetBoolEx(L"AutoCIgnoreCase", autoCompletionConfig.bIgnoreCase, false);
+	section.SetBoolEx(L"AutoCFuzzyMatch", autoCompletionConfig.bFuzzyMatch, false);
 	section.SetBoolEx(L"LaTeXInputMethod", autoCompletionConfig.bLaTeXInputMethod, false);
 	section.SetIntEx(L"AutoCVisibleItemCount", autoCompletionConfig.iVisibleItemCount, 16);
 	section.SetIntEx(L"AutoCMinWordLength", autoCompletionConfig.iMinWordLength, 1);
@@ -6635,6 +6675,8 @@ void LoadFlags() noexcept {
 
 	dwFileCheckInterval = section.GetInt(L"FileCheckInterval", 1000);
 	dwAutoReloadTimeout = section.GetInt(L"AutoReloadTimeout", 1000);
+	// in MiB, zero to disable
+	dwCompressDocumentSize = section.GetInt(L"CompressDocumentSize", 0);
 
 	if (IsVistaAndAbove()) {
 		bUseXPFileDialog = section.GetBool(L"UseXPFileDialog", false);
@@ -7205,6 +7247,18 @@ void ToggleFullScreenMode() noexcept {
 	SetForegroundWindow(hwnd);
 }
 
+// compress new file on save by file extension, e.g. access.log.gz
+static CompressionFormat GetFileCompression(LPCWSTR lpszFile) noexcept {
+	LPCWSTR lpszExt = PathFindExtension(lpszFile);
+	if (StrCaseEqual(lpszExt, L".gz")) {
+		return CompressionFormat::Gzip;
+	}
+	if (StrCaseEqual(lpszExt, L".zst")) {
+		return CompressionFormat::Zstd;
+	}
+	return CompressionFormat::None;
+}
+
 //=============================================================================
 //
 //	FileIO()
@@ -7291,10 +7345,12 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 		}
 		fvCurFile.Init(nullptr, 0);
 		EditSetEmptyText();
+		EditFreeRawFileData();
 		bDocumentModified = false;
 		bReadOnlyFile = false;
 		iCurrentEOLMode = GetScintillaEOLMode(iDefaultEOLMode);
 		SciCall_SetEOLMode(iCurrentEOLMode);
+		iCurrentCompression = CompressionFormat::None;
 		iCurrentEncoding = iDefaultEncoding;
 		iOriginalEncoding = iCurrentEncoding;
 		SciCall_SetCodePage((iCurrentEncoding == CPI_DEFAULT) ? iDefaultCodePage : SC_CP_UTF8);
@@ -7339,6 +7395,7 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 	EditFileIOStatus status{};
 	status.iEncoding = iCurrentEncoding;
 	status.iEOLMode = iCurrentEOLMode;
+	status.bRecode = (loadFlag & FileLoadFlag_Recode) != 0;
 
 	// Ask to create a new file...
 	if (!(loadFlag & FileLoadFlag_Reload) && !PathIsFile(szFileName)) {
@@ -7355,6 +7412,7 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 				EditSetEmptyText();
 				iCurrentEOLMode = GetScintillaEOLMode(iDefaultEOLMode);
 				SciCall_SetEOLMode(iCurrentEOLMode);
+				iCurrentCompression = GetFileCompression(szFileName);
 				if (iSrcEncoding >= CPI_FIRST) {
 					iCurrentEncoding = iSrcEncoding;
 				} else {
@@ -7376,6 +7434,7 @@ bool FileLoad(FileLoadFlag loadFlag, LPCWSTR lpszFile) {
 		if (fSuccess) {
 			iCurrentEncoding = status.iEncoding;
 			iCurrentEOLMode = status.iEOLMode;
+			iCurrentCompression = status.compression;
 		}
 	}
 
@@ -7551,6 +7610,7 @@ bool FileSave(FileSaveFlag saveFlag) noexcept {
 	WCHAR tchFile[MAX_PATH];
 	EditFileIOStatus status{};
 	status.iEncoding = iCurrentEncoding;
+	status.compression = iCurrentCompression;
 	status.iEOLMode = iCurrentEOLMode;
 
 	// Read only...
@@ -7584,9 +7644,11 @@ bool FileSave(FileSaveFlag saveFlag) noexcept {
 		}
 
 		if (SaveFileDlg(Untitled, tchFile, COUNTOF(tchFile), tchInitialDir)) {
+			status.compression = GetFileCompression(tchFile);
 			fSuccess = FileIO(false, tchFile, saveFlag & (FileSaveFlag_SaveCopy | FileSaveFlag_EndSession), status);
 			if (fSuccess) {
 				if (!(saveFlag & FileSaveFlag_SaveCopy)) {
+					iCurrentCompression = status.compression;
 					lstrcpy(szCurFile, tchFile);
 					SetDlgItemText(hwndMain, IDC_FILENAME, szCurFile);
 					SetDlgItemInt(hwndMain, IDC_REUSELOCK, GetTickCount(), FALSE);
@@ -116,10 +116,12 @@ enum {
 // https://www.codeproject.com/tips/1017834/how-to-send-data-from-one-process-to-another-in-cs
 #define APPM_COPYDATA				(WM_APP + 6)
 #define APPM_DROPFILES				(WM_APP + 7)	// ScintillaWin::Drop()
+#define APPM_JOB_DONE				(WM_APP + 8)	// ThreadJobExecutor finished a BackgroundJob
 
 #define ID_WATCHTIMER				0xA000	// file watch timer
 #define ID_PASTEBOARDTIMER			0xA001	// paste board timer
 #define ID_AUTOSAVETIMER			0xA002	// AutoSave timer
+#define ID_TAGINDEXTIMER			0xA003	// tag index timer
 
 #define REUSEWINDOWLOCKTIMEOUT		1000	// Reuse Window Lock Timeout
 
@@ -231,10 +233,14 @@ enum {
 
 void ToggleFullScreenMode() noexcept;
 
+enum class CompressionFormat : uint8_t;
+
 struct EditFileIOStatus {
 	int iEncoding;		// load output, save input
+	CompressionFormat compression;	// load output, save input
 	int iEOLMode;		// load output
 
+	bool bRecode;		// load input, reload with another encoding
 	bool bFileTooBig;	// load output
 	bool bUnicodeErr;	// load output
 	bool bBinaryFile;	// load output
@@ -252,6 +258,7 @@ enum FileLoadFlag {
 	FileLoadFlag_DontSave = 1,
 	FileLoadFlag_New = 2,
 	FileLoadFlag_Reload = 4,
+	FileLoadFlag_Recode = 8,
 };
 
 enum FileSaveFlag {
@@ -166,6 +166,10 @@ inline void SciCall_SetSearchFlags(int searchFlags) noexcept {
 	SciCall(SCI_SETSEARCHFLAGS, searchFlags, 0);
 }
 
+inline void SciCall_SetSearchStyleMask(const uint32_t *styleMask) noexcept {
+	SciCall(SCI_SETSEARCHSTYLEMASK, 0, AsInteger<LPARAM>(styleMask));
+}
+
 inline Sci_Position SciCall_SearchInTarget(Sci_Position length, const char *text) noexcept {
 	return SciCall(SCI_SEARCHINTARGET, length, AsInteger<LPARAM>(text));
 }
@@ -182,6 +186,10 @@ inline Sci_Position SciCall_FindTextFull(int searchFlags, Sci_TextToFindFull *ft
 	return SciCall(SCI_FINDTEXTFULL, searchFlags, AsInteger<LPARAM>(ft));
 }
 
+inline Sci_Position SciCall_FindTextAll(int searchFlags, Sci_TextToFindAll *ft) noexcept {
+	return SciCall(SCI_FINDTEXTALL, searchFlags, AsInteger<LPARAM>(ft));
+}
+
 inline Sci_Position SciCall_ReplaceTargetEx(BOOL regex, Sci_Position length, const char *text) noexcept {
 	return SciCall(regex ? SCI_REPLACETARGETRE : SCI_REPLACETARGET, length, AsInteger<LPARAM>(text));
 }
@@ -274,6 +282,10 @@ inline void SciCall_AllocateLines(Sci_Line lineCount) noexcept {
 	SciCall(SCI_ALLOCATELINES, lineCount, 0);
 }
 
+inline void SciCall_CompressDocument() noexcept {
+	SciCall(SCI_COMPRESSDOCUMENT, 0, 0);
+}
+
 inline void SciCall_SetSel(Sci_Position anchor, Sci_Position caret) noexcept {
 	SciCall(SCI_SETSEL, anchor, caret);
 }
@@ -1084,6 +1096,14 @@ inline void SciCall_AutoCSetTypeSeparator(char separatorCharacter) noexcept {
 	SciCall(SCI_AUTOCSETTYPESEPARATOR, separatorCharacter, 0);
 }
 
+inline void SciCall_AutoCSelect(const char *select) noexcept {
+	SciCall(SCI_AUTOCSELECT, 0, AsInteger<LPARAM>(select));
+}
+
+inline void SciCall_AutoCSetAutoHide(bool autoHide) noexcept {
+	SciCall(SCI_AUTOCSETAUTOHIDE, autoHide, 0);
+}
+
 inline void SciCall_AutoCSetCancelAtStart(bool cancel) noexcept {
 	SciCall(SCI_AUTOCSETCANCELATSTART, cancel, 0);
 }
@@ -107,6 +107,7 @@ extern EDITLEXER lexKotlin;
 extern EDITLEXER lexLaTeX;
 extern EDITLEXER lexLisp;
 extern EDITLEXER lexLLVM;
+extern EDITLEXER lexLog;
 extern EDITLEXER lexLua;
 
 extern EDITLEXER lexMakefile;
@@ -221,6 +222,7 @@ static PEDITLEXER pLexArray[] = {
 	&lexLaTeX,
 	&lexLisp,
 	&lexLLVM,
+	&lexLog,
 	&lexLua,
 
 	&lexMakefile,
@@ -2424,8 +2426,8 @@ static PEDITLEXER Style_GetLexerFromFile(LPCWSTR lpszFile, bool bCGIGuess, LPCWS
 			pLexNew = Style_SniffShebang(tchText);
 		}
 
-		// autoconf / automake
-		else if (pDotFile != nullptr && StrCaseEqual(lpszExt, L"in")) {
+		// autoconf / automake, compressed file
+		else if (pDotFile != nullptr && (StrCaseEqual(lpszExt, L"in") || StrCaseEqual(lpszExt, L"gz") || StrCaseEqual(lpszExt, L"zst"))) {
 			WCHAR tchCopy[MAX_PATH];
 			lstrcpyn(tchCopy, lpszFile, COUNTOF(tchCopy));
 			PathRemoveExtension(tchCopy);
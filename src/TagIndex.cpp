@@ -0,0 +1,525 @@
+// Tag pair index for XML and HTML
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "TagIndex.h"
+
+namespace {
+
+enum class Markup {
+	Text,
+	Tag,
+	Other,		// comment, CDATA section, processing instruction or declaration
+	Incomplete,
+};
+
+constexpr bool IsNameStart(uint8_t ch) noexcept {
+	return (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_' || ch == ':' || ch >= 0x80;
+}
+
+constexpr bool IsNameChar(uint8_t ch) noexcept {
+	return ch > ' ' && ch != '/' && ch != '>' && ch != '<' && ch != '=' && ch != '\"' && ch != '\'' && ch != 0x7f;
+}
+
+constexpr uint8_t LowerCase(uint8_t ch) noexcept {
+	return (ch >= 'A' && ch <= 'Z') ? (ch | 0x20) : ch;
+}
+
+bool IsHtmlVoidTag(const char *name, size_t length) noexcept {
+	// same as htmlVoidTagList in scintilla/lexlib/DocUtils.h, except p
+	char word[16];
+	if (length > sizeof(word) - 3) {
+		return false;
+	}
+	word[0] = ' ';
+	for (size_t i = 0; i < length; i++) {
+		word[i + 1] = LowerCase(name[i]);
+	}
+	word[length + 1] = ' ';
+	word[length + 2] = '\0';
+	return strstr(" area base basefont br col command embed frame hr img input isindex keygen link meta param source track wbr ", word) != nullptr;
+}
+
+bool HasPrefix(const char *text, size_t length, const char *prefix, size_t prefixLength) noexcept {
+	return length >= prefixLength && memcmp(text, prefix, prefixLength) == 0;
+}
+
+const char *FindDelimiter(const char *text, size_t length, const char *delimiter, size_t delimiterLength) noexcept {
+	const char * const end = text + length;
+	while (static_cast<size_t>(end - text) >= delimiterLength) {
+		const char *p = static_cast<const char *>(memchr(text, delimiter[0], end - text - delimiterLength + 1));
+		if (p == nullptr) {
+			break;
+		}
+		if (memcmp(p, delimiter, delimiterLength) == 0) {
+			return p;
+		}
+		text = p + 1;
+	}
+	return nullptr;
+}
+
+// scan markup starts with '<' at start, on return end is position after the markup.
+// when text is cut at length and complete is false, Markup::Incomplete is returned.
+Markup ScanMarkup(const char *text, size_t start, size_t length, bool complete, TagEntry &entry, size_t &end) noexcept {
+	size_t pos = start + 1;
+	if (pos == length) {
+		return complete ? Markup::Text : Markup::Incomplete;
+	}
+
+	uint8_t ch = text[pos];
+	if (ch == '!' || ch == '?') {
+		const char *delimiter = (ch == '?') ? "?>" : ">";
+		if (HasPrefix(text + pos, length - pos, "!--", 3)) {
+			delimiter = "-->";
+			pos += 3;
+		} else if (HasPrefix(text + pos, length - pos, "![CDATA[", 8)) {
+			delimiter = "]]>";
+			pos += 8;
+		}
+		const size_t delimiterLength = strlen(delimiter);
+		const char *p = FindDelimiter(text + pos, length - pos, delimiter, delimiterLength);
+		if (p == nullptr) {
+			end = length;
+			return complete ? Markup::Other : Markup::Incomplete;
+		}
+		end = (p - text) + delimiterLength;
+		return Markup::Other;
+	}
+
+	TagKind kind = TagKind_Start;
+	if (ch == '/') {
+		kind = TagKind_End;
+		++pos;
+		if (pos == length) {
+			return complete ? Markup::Text : Markup::Incomplete;
+		}
+		ch = text[pos];
+	}
+	if (!IsNameStart(ch)) {
+		return Markup::Text;
+	}
+
+	const size_t nameStart = pos;
+	do {
+		++pos;
+	} while (pos < length && IsNameChar(text[pos]));
+	const size_t nameEnd = pos;
+	if (nameEnd - nameStart > UINT16_MAX) {
+		return Markup::Text;
+	}
+
+	bool terminated = false;
+	while (pos < length) {
+		ch = text[pos];
+		if (ch == '>') {
+			if (kind == TagKind_Start && pos > nameEnd && text[pos - 1] == '/') {
+				kind = TagKind_Empty;
+			}
+			++pos;
+			terminated = true;
+			break;
+		}
+		if (ch == '<') {
+			// missing '>', tag ends before next tag
+			terminated = true;
+			break;
+		}
+		if (ch == '\"' || ch == '\'') {
+			const char *p = static_cast<const char *>(memchr(text + pos + 1, ch, length - pos - 1));
+			if (p != nullptr) {
+				pos = p - text;
+			} else if (!complete) {
+				return Markup::Incomplete;
+			}
+		}
+		++pos;
+	}
+	if (!terminated && !complete) {
+		return Markup::Incomplete;
+	}
+	if (pos - start > UINT32_MAX) {
+		return Markup::Text;
+	}
+
+	entry.start = start;
+	entry.length = static_cast<uint32_t>(pos - start);
+	entry.nameLength = static_cast<uint16_t>(nameEnd - nameStart);
+	entry.kind = kind;
+	end = pos;
+	return Markup::Tag;
+}
+
+}
+
+// text passed to Extend(), names of start tags before it are read through textProc.
+struct TagSlice {
+	const char *text;
+	size_t start;
+	TagTextProc textProc;
+	void *param;
+
+	const char *Name(size_t position, size_t length) const noexcept {
+		if (position >= start) {
+			return text + (position - start);
+		}
+		return textProc ? textProc(param, position, length) : nullptr;
+	}
+};
+
+TagPairIndex::~TagPairIndex() {
+	free(entries);
+	free(stack);
+}
+
+void TagPairIndex::Reset(bool html_) noexcept {
+	count = 0;
+	depth = 0;
+	shiftIndex = 0;
+	shiftLength = 0;
+	validUntil = 0;
+	finished = false;
+	html = html_;
+}
+
+void TagPairIndex::MoveShift(uint32_t index) noexcept {
+	while (shiftIndex < index) {
+		entries[shiftIndex].start += shiftLength;
+		++shiftIndex;
+	}
+	while (shiftIndex > index) {
+		--shiftIndex;
+		entries[shiftIndex].start -= shiftLength;
+	}
+}
+
+uint32_t TagPairIndex::FirstTagEndAfter(size_t position) const noexcept {
+	uint32_t lower = 0;
+	uint32_t upper = count;
+	while (lower < upper) {
+		const uint32_t middle = lower + (upper - lower)/2;
+		if (End(middle) > position) {
+			upper = middle;
+		} else {
+			lower = middle + 1;
+		}
+	}
+	return lower;
+}
+
+void TagPairIndex::Invalidate(size_t position) noexcept {
+	if (position > validUntil && !finished) {
+		return;
+	}
+
+	finished = false;
+	// drop tags end at or after position, tag without '>' ends at '<' after it.
+	// text after last tag is scanned again, as position may be inside other markup.
+	const uint32_t lower = position ? FirstTagEndAfter(position - 1) : 0;
+	position = lower ? End(lower - 1) : 0;
+	if (position < validUntil) {
+		validUntil = position;
+	}
+	count = lower;
+	if (shiftIndex > count) {
+		shiftIndex = count;
+	}
+
+	// rebuild stack of open start tags from parent links, they are reopened
+	uint32_t top = count ? StackTopAfter(count - 1) : npos;
+	uint32_t level = 0;
+	for (uint32_t index = top; index != npos; index = entries[index].parent) {
+		++level;
+	}
+	depth = 0;
+	if (level > stackCapacity) {
+		uint32_t *newStack = static_cast<uint32_t *>(realloc(stack, level*sizeof(uint32_t)));
+		if (newStack == nullptr) {
+			Reset(html);
+			return;
+		}
+		stack = newStack;
+		stackCapacity = level;
+	}
+	depth = level;
+	while (top != npos) {
+		TagEntry &entry = entries[top];
+		entry.pair = npos;
+		entry.matched = false;
+		stack[--level] = top;
+		top = entry.parent;
+	}
+}
+
+void TagPairIndex::InsertText(size_t position, size_t length) noexcept {
+	if (position >= validUntil) {
+		// text after indexed text, or appended to whole document
+		finished = false;
+		return;
+	}
+	const uint32_t index = FirstTagEndAfter(position);
+	if (index < count && Start(index) < position) {
+		// inserted inside a tag
+		Invalidate(position);
+		return;
+	}
+	MoveShift(index);
+	shiftLength += length;
+	validUntil += length;
+}
+
+void TagPairIndex::DeleteText(size_t position, size_t length) noexcept {
+	if (position >= validUntil) {
+		return;
+	}
+	const uint32_t index = FirstTagEndAfter(position);
+	if (position + length >= validUntil || (index < count && Start(index) < position + length)) {
+		// deleted text reaches end of indexed text or overlaps a tag
+		Invalidate(position);
+		return;
+	}
+	MoveShift(index);
+	shiftLength -= length;
+	validUntil -= length;
+}
+
+bool TagPairIndex::Push(uint32_t index) noexcept {
+	if (depth == stackCapacity) {
+		const uint32_t newCapacity = stackCapacity ? 2*stackCapacity : 64;
+		uint32_t *newStack = static_cast<uint32_t *>(realloc(stack, newCapacity*sizeof(uint32_t)));
+		if (newStack == nullptr) {
+			return false;
+		}
+		stack = newStack;
+		stackCapacity = newCapacity;
+	}
+	stack[depth++] = index;
+	return true;
+}
+
+bool TagPairIndex::SameName(const TagSlice &slice, uint32_t startIndex, const char *other, size_t length) const noexcept {
+	const TagEntry &startTag = entries[startIndex];
+	if (length != startTag.nameLength) {
+		return false;
+	}
+	const char *name = slice.Name(Start(startIndex) + 1, length);
+	if (name == nullptr) {
+		return false;
+	}
+	if (!html) {
+		return memcmp(name, other, length) == 0;
+	}
+	for (size_t i = 0; i < length; i++) {
+		if (LowerCase(name[i]) != LowerCase(other[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// entry.start is position in the slice, name is always inside the slice.
+bool TagPairIndex::AddTag(const TagSlice &slice, TagEntry &entry) noexcept {
+	if (count == capacity) {
+		if (capacity >= pending/2) {
+			return false;
+		}
+		const uint32_t newCapacity = capacity ? 2*capacity : 1024;
+		TagEntry *newEntries = static_cast<TagEntry *>(realloc(entries, newCapacity*sizeof(TagEntry)));
+		if (newEntries == nullptr) {
+			return false;
+		}
+		entries = newEntries;
+		capacity = newCapacity;
+	}
+
+	const uint32_t index = count;
+	const char * const name = slice.text + entry.NameStart();
+	entry.pair = npos;
+	entry.matched = false;
+	entry.parent = depth ? stack[depth - 1] : npos;
+	if (entry.kind == TagKind_Start) {
+		if (html && IsHtmlVoidTag(name, entry.nameLength)) {
+			entry.kind = TagKind_Empty;
+		} else if (!Push(index)) {
+			return false;
+		}
+	} else if (entry.kind == TagKind_End) {
+		// start tags above the matched one are closed implicitly, e.g. <li> or <p> in HTML.
+		// end tag without matched start tag leaves the stack unchanged.
+		uint32_t level = depth;
+		while (level != 0) {
+			--level;
+			const uint32_t startIndex = stack[level];
+			if (SameName(slice, startIndex, name, entry.nameLength)) {
+				for (uint32_t i = level; i < depth; i++) {
+					entries[stack[i]].pair = index;
+				}
+				entries[startIndex].matched = true;
+				entry.pair = startIndex;
+				entry.matched = true;
+				entry.parent = entries[startIndex].parent;
+				depth = level;
+				break;
+			}
+		}
+	}
+	// stored start is moved by shiftLength, see Start()
+	entry.start = slice.start + entry.start - shiftLength;
+	entries[count++] = entry;
+	return true;
+}
+
+bool TagPairIndex::Extend(const char *text, size_t length, bool complete, TagStyleProc styleProc, TagTextProc textProc, void *param) noexcept {
+	const TagSlice slice = {text, validUntil, textProc, param};
+	size_t position = 0;
+	while (position < length) {
+		const char *p = static_cast<const char *>(memchr(text + position, '<', length - position));
+		if (p == nullptr) {
+			position = length;
+			break;
+		}
+
+		const size_t start = p - text;
+		if (styleProc != nullptr && !styleProc(param, slice.start + start)) {
+			position = start + 1;
+			continue;
+		}
+
+		TagEntry entry;
+		size_t end = start + 1;
+		const Markup markup = ScanMarkup(text, start, length, complete, entry, end);
+		if (markup == Markup::Incomplete) {
+			position = start;
+			break;
+		}
+		if (markup == Markup::Tag && !AddTag(slice, entry)) {
+			validUntil = slice.start + start;
+			return false;
+		}
+		position = end;
+	}
+
+	validUntil = slice.start + position;
+	finished = complete && position >= length;
+	return true;
+}
+
+uint32_t TagPairIndex::LastTagBefore(size_t position) const noexcept {
+	// last tag starts at or before position, or npos
+	uint32_t lower = 0;
+	uint32_t upper = count;
+	while (lower < upper) {
+		const uint32_t middle = lower + (upper - lower)/2;
+		if (Start(middle) <= position) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+	return lower - 1;
+}
+
+uint32_t TagPairIndex::TagAt(size_t position) const noexcept {
+	if (position >= validUntil) {
+		return Unknown();
+	}
+	const uint32_t index = LastTagBefore(position);
+	if (index != npos && position < End(index)) {
+		return index;
+	}
+	return npos;
+}
+
+uint32_t TagPairIndex::MatchingTag(uint32_t index) const noexcept {
+	const TagEntry &entry = entries[index];
+	if (entry.matched) {
+		return entry.pair;
+	}
+	if (entry.kind == TagKind_Start && entry.pair == npos) {
+		return Unknown();
+	}
+	return npos;
+}
+
+uint32_t TagPairIndex::EnclosingElement(size_t position) const noexcept {
+	if (position >= validUntil) {
+		return Unknown();
+	}
+	const uint32_t index = LastTagBefore(position);
+	if (index == npos) {
+		return npos;
+	}
+	const TagEntry &entry = entries[index];
+	if (position < End(index)) {
+		if (entry.kind == TagKind_End) {
+			return entry.matched ? entry.pair : entry.parent;
+		}
+		return index;
+	}
+	return StackTopAfter(index);
+}
+
+uint32_t TagPairIndex::NextSibling(size_t position) const noexcept {
+	if (position >= validUntil) {
+		return Unknown();
+	}
+	uint32_t index = LastTagBefore(position);
+	if (index != npos && position < End(index)) {
+		// skip current element
+		const TagEntry &entry = entries[index];
+		if (entry.kind == TagKind_Start) {
+			if (entry.matched) {
+				index = entry.pair;
+			} else if (entry.pair == npos && !finished) {
+				return pending;
+			}
+		}
+	}
+	for (++index; index < count; index++) {
+		const TagEntry &entry = entries[index];
+		if (entry.kind != TagKind_End) {
+			return index;
+		}
+		if (entry.matched) {
+			return npos; // end of parent element
+		}
+	}
+	return Unknown();
+}
+
+uint32_t TagPairIndex::PreviousSibling(size_t position) const noexcept {
+	if (position >= validUntil) {
+		return Unknown();
+	}
+	uint32_t index = LastTagBefore(position);
+	if (index == npos) {
+		return npos;
+	}
+	const TagEntry &current = entries[index];
+	if (position < End(index)) {
+		// skip current element
+		if (current.kind == TagKind_End && current.matched) {
+			index = current.pair;
+		}
+	} else {
+		++index;
+	}
+	while (index != 0) {
+		--index;
+		const TagEntry &entry = entries[index];
+		switch (entry.kind) {
+		case TagKind_Empty:
+			return index;
+		case TagKind_Start:
+			return npos; // start of parent element
+		case TagKind_End:
+			if (entry.matched) {
+				return entry.pair;
+			}
+			break;
+		}
+	}
+	return npos;
+}
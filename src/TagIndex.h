@@ -0,0 +1,124 @@
+// Tag pair index for XML and HTML
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Lexer styles are only queried through TagStyleProc, without it (e.g. in tests)
+// comments, CDATA sections and processing instructions are skipped by syntax.
+
+enum TagKind : uint8_t {
+	TagKind_Start,		// <name ...>
+	TagKind_End,		// </name>
+	TagKind_Empty,		// <name .../> or HTML void element
+};
+
+struct TagEntry {
+	size_t start;		// position of '<'
+	uint32_t length;	// up to and including '>'
+	uint32_t pair;		// matched tag, or end tag that implicitly closed this start tag
+	uint32_t parent;	// enclosing start tag
+	uint16_t nameLength;
+	TagKind kind;
+	bool matched;
+
+	size_t End() const noexcept {
+		return start + length;
+	}
+	size_t NameStart() const noexcept {
+		return start + 1 + (kind == TagKind_End);
+	}
+	size_t NameEnd() const noexcept {
+		return NameStart() + nameLength;
+	}
+};
+
+// returns true when '<' at position is styled as tag by the lexer.
+typedef bool (*TagStyleProc)(void *param, size_t position) noexcept;
+// returns document text in [position, position + length) before the text passed to Extend(),
+// used to compare name of start tag with end tag.
+typedef const char *(*TagTextProc)(void *param, size_t position, size_t length) noexcept;
+
+struct TagSlice;
+
+// Tags are indexed in document order with their enclosing start tag (which forms
+// a persistent stack), queries are binary search plus constant steps.
+// Inserting or deleting text outside tags moves following tags, other edits drop
+// tags after the modified position, which are indexed again on next Extend().
+class TagPairIndex {
+public:
+	static constexpr uint32_t npos = UINT32_MAX;
+	// answer depends on text not yet indexed, call Extend() then query again.
+	static constexpr uint32_t pending = UINT32_MAX - 1;
+
+	TagPairIndex() noexcept = default;
+	TagPairIndex(const TagPairIndex &) = delete;
+	TagPairIndex &operator=(const TagPairIndex &) = delete;
+	~TagPairIndex();
+
+	void Reset(bool html) noexcept;
+	void Invalidate(size_t position) noexcept;
+	// caller ensures inserted or deleted text contains no markup, and not inside or
+	// after unclosed markup (including comment and '<' in text) which it may extend.
+	void InsertText(size_t position, size_t length) noexcept;
+	void DeleteText(size_t position, size_t length) noexcept;
+	// index tags in text, which is the document in [ValidUntil(), ValidUntil() + length).
+	// complete is true when the text ends at document end. returns false on out of memory.
+	bool Extend(const char *text, size_t length, bool complete, TagStyleProc styleProc, TagTextProc textProc, void *param) noexcept;
+
+	size_t ValidUntil() const noexcept {
+		return validUntil;
+	}
+	bool Finished() const noexcept {
+		return finished;
+	}
+	uint32_t Count() const noexcept {
+		return count;
+	}
+	TagEntry operator[](uint32_t index) const noexcept {
+		TagEntry entry = entries[index];
+		entry.start = Start(index);
+		return entry;
+	}
+
+	uint32_t TagAt(size_t position) const noexcept;
+	uint32_t MatchingTag(uint32_t index) const noexcept;
+	uint32_t EnclosingElement(size_t position) const noexcept;
+	uint32_t NextSibling(size_t position) const noexcept;
+	uint32_t PreviousSibling(size_t position) const noexcept;
+
+private:
+	TagEntry *entries = nullptr;
+	uint32_t count = 0;
+	uint32_t capacity = 0;
+	uint32_t *stack = nullptr;
+	uint32_t depth = 0;
+	uint32_t stackCapacity = 0;
+	// same as Partitioning in Scintilla, start of entries after shiftIndex are moved by
+	// shiftLength (with wrap around), so edits only update entries between two edits.
+	uint32_t shiftIndex = 0;
+	size_t shiftLength = 0;
+	size_t validUntil = 0;
+	bool finished = false;	// whole document indexed
+	bool html = false;
+
+	uint32_t Unknown() const noexcept {
+		return finished ? npos : pending;
+	}
+	size_t Start(uint32_t index) const noexcept {
+		return entries[index].start + ((index >= shiftIndex) ? shiftLength : 0);
+	}
+	size_t End(uint32_t index) const noexcept {
+		return Start(index) + entries[index].length;
+	}
+	void MoveShift(uint32_t index) noexcept;
+	uint32_t FirstTagEndAfter(size_t position) const noexcept;
+	uint32_t LastTagBefore(size_t position) const noexcept;
+	uint32_t StackTopAfter(uint32_t index) const noexcept {
+		const TagEntry &entry = entries[index];
+		return (entry.kind == TagKind_Start) ? index : entry.parent;
+	}
+	bool Push(uint32_t index) noexcept;
+	bool SameName(const TagSlice &slice, uint32_t startIndex, const char *name, size_t length) const noexcept;
+	bool AddTag(const TagSlice &slice, TagEntry &entry) noexcept;
+};
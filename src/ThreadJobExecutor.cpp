@@ -0,0 +1,72 @@
+// Run BackgroundJob on worker thread
+
+#include <windows.h>
+#include <shlwapi.h>
+#include <commctrl.h>
+#include "Helpers.h"
+#include "BackgroundJob.h"
+#include "ThreadJobExecutor.h"
+
+DWORD WINAPI ThreadJobExecutor::ThreadProc(LPVOID lpParam) noexcept {
+	ThreadJobExecutor * const executor = static_cast<ThreadJobExecutor *>(lpParam);
+	BackgroundJob * const job = executor->current;
+	job->Execute();
+	// generation only changes on UI thread after this thread finished
+	PostMessage(executor->hwnd, executor->msgDone, job->Generation(), AsInteger<LPARAM>(executor));
+	return 0;
+}
+
+void ThreadJobExecutor::Join() noexcept {
+	HANDLE worker = InterlockedExchangePointer(&workerThread, nullptr);
+	if (worker) {
+		while (WaitForSingleObject(worker, 0) != WAIT_OBJECT_0) {
+			MSG msg;
+			if (PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE)) {
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		}
+		CloseHandle(worker);
+	}
+}
+
+bool ThreadJobExecutor::Submit(BackgroundJob &job) noexcept {
+	if (current != nullptr) {
+		Cancel(*current);
+	}
+	current = &job;
+	job.Start();
+	workerThread = CreateThread(nullptr, 0, ThreadProc, this, 0, nullptr);
+	if (workerThread == nullptr) {
+		// run on UI thread
+		current = nullptr;
+		job.Execute();
+		job.Commit(job.Generation());
+	}
+	return true;
+}
+
+void ThreadJobExecutor::Cancel(BackgroundJob &job) noexcept {
+	job.Cancel();
+	if (current == &job) {
+		Join();
+		current = nullptr;
+	}
+	job.Discard();
+}
+
+void ThreadJobExecutor::Complete(uint32_t jobGeneration) noexcept {
+	BackgroundJob * const job = current;
+	// ignore completion of cancelled job
+	if (job == nullptr || job->Generation() != jobGeneration) {
+		return;
+	}
+	HANDLE worker = InterlockedExchangePointer(&workerThread, nullptr);
+	if (worker) {
+		// thread exits right after posting the completion
+		WaitForSingleObject(worker, INFINITE);
+		CloseHandle(worker);
+	}
+	current = nullptr;
+	job->Commit(jobGeneration);
+}
@@ -0,0 +1,25 @@
+// Run BackgroundJob on worker thread
+#pragma once
+
+// runs one job at a time on a new thread, completion is posted to owner window
+// as message(generation, executor), the window procedure then calls executor->Complete(generation).
+class ThreadJobExecutor final : public JobExecutor {
+public:
+	void Init(HWND owner, UINT message) noexcept {
+		hwnd = owner;
+		msgDone = message;
+	}
+	bool Submit(BackgroundJob &job) noexcept override;
+	void Cancel(BackgroundJob &job) noexcept override;
+	// closes the finished thread and commits the job.
+	void Complete(uint32_t jobGeneration) noexcept;
+
+private:
+	HWND hwnd = nullptr;
+	UINT msgDone = 0;
+	HANDLE workerThread = nullptr;
+	BackgroundJob *current = nullptr;
+
+	void Join() noexcept;
+	static DWORD WINAPI ThreadProc(LPVOID lpParam) noexcept;
+};
@@ -0,0 +1,788 @@
+// Well-formedness checking for JSON and XML
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include "VectorISA.h"
+#include "Validator.h"
+
+namespace {
+
+constexpr size_t checkInterval = 1024*1024;
+constexpr const char *msgNoMemory = "out of memory";
+constexpr const char *msgInvalidUTF8 = "invalid UTF-8 sequence";
+
+// growable stack for nesting of JSON containers and XML elements.
+template <typename T>
+class NestingStack {
+	T *items = nullptr;
+	size_t count = 0;
+	size_t capacity = 0;
+public:
+	NestingStack() noexcept = default;
+	NestingStack(const NestingStack &) = delete;
+	NestingStack &operator=(const NestingStack &) = delete;
+	~NestingStack() {
+		free(items);
+	}
+	bool Push(T item) noexcept {
+		if (count == capacity) {
+			const size_t newCapacity = capacity ? 2*capacity : 64;
+			T *newItems = static_cast<T *>(realloc(items, newCapacity*sizeof(T)));
+			if (newItems == nullptr) {
+				return false;
+			}
+			items = newItems;
+			capacity = newCapacity;
+		}
+		items[count++] = item;
+		return true;
+	}
+	void Pop() noexcept {
+		--count;
+	}
+	bool Empty() const noexcept {
+		return count == 0;
+	}
+	const T &Top() const noexcept {
+		return items[count - 1];
+	}
+};
+
+constexpr bool IsSpace(uint8_t ch) noexcept {
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+constexpr bool IsDigit(uint8_t ch) noexcept {
+	return ch >= '0' && ch <= '9';
+}
+
+constexpr bool IsHexDigit(uint8_t ch) noexcept {
+	return IsDigit(ch) || ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f');
+}
+
+// length of well-formed UTF-8 sequence (no overlong form or surrogate), or zero.
+size_t UTF8SequenceLength(const uint8_t *ptr, const uint8_t *end) noexcept {
+	const uint8_t ch = *ptr;
+	const size_t remain = end - ptr;
+	if (ch < 0xC2 || ch > 0xF4) {
+		return 0;
+	}
+	if (ch < 0xE0) {
+		return (remain >= 2 && (ptr[1] & 0xC0) == 0x80) ? 2 : 0;
+	}
+	if (ch < 0xF0) {
+		if (remain < 3 || (ptr[1] & 0xC0) != 0x80 || (ptr[2] & 0xC0) != 0x80
+			|| (ch == 0xE0 && ptr[1] < 0xA0) || (ch == 0xED && ptr[1] >= 0xA0)) {
+			return 0;
+		}
+		return 3;
+	}
+	if (remain < 4 || (ptr[1] & 0xC0) != 0x80 || (ptr[2] & 0xC0) != 0x80 || (ptr[3] & 0xC0) != 0x80
+		|| (ch == 0xF0 && ptr[1] < 0x90) || (ch == 0xF4 && ptr[1] >= 0x90)) {
+		return 0;
+	}
+	return 4;
+}
+
+// skip printable ASCII characters other than the three stop characters,
+// stops at control characters and non-ASCII bytes.
+inline const uint8_t *SkipPlainText(const uint8_t *ptr, const uint8_t *end, uint8_t stop1, uint8_t stop2, uint8_t stop3) noexcept {
+#if NP2_USE_SSE2
+	const __m128i vect1 = _mm_set1_epi8(stop1);
+	const __m128i vect2 = _mm_set1_epi8(stop2);
+	const __m128i vect3 = _mm_set1_epi8(stop3);
+	const __m128i space = _mm_set1_epi8(' ');
+	while (ptr + sizeof(__m128i) <= end) {
+		const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+		// signed compare: bytes >= 0x80 are also less than space
+		const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, vect1), _mm_cmpeq_epi8(chunk, vect2)),
+			_mm_or_si128(_mm_cmpeq_epi8(chunk, vect3), _mm_cmplt_epi8(chunk, space)));
+		const uint32_t mask = _mm_movemask_epi8(special);
+		if (mask) {
+			return ptr + np2::ctz(mask);
+		}
+		ptr += sizeof(__m128i);
+	}
+#endif
+	while (ptr < end) {
+		const uint8_t ch = *ptr;
+		if (ch < ' ' || ch >= 0x80 || ch == stop1 || ch == stop2 || ch == stop3) {
+			break;
+		}
+		++ptr;
+	}
+	return ptr;
+}
+
+class WellFormedChecker {
+protected:
+	const uint8_t * const begin;
+	const uint8_t * const end;
+	const uint8_t *ptr;
+	const uint8_t *nextCheck;
+	WellFormedResult &result;
+	const WellFormedContinueProc continueProc;
+	void * const param;
+	const bool utf8;
+
+public:
+	WellFormedChecker(const char *text, size_t length, bool utf8_, WellFormedResult &result_, WellFormedContinueProc continueProc_, void *param_) noexcept:
+		begin{reinterpret_cast<const uint8_t *>(text)},
+		end{begin + length},
+		ptr{begin},
+		nextCheck{begin + checkInterval},
+		result{result_},
+		continueProc{continueProc_},
+		param{param_},
+		utf8{utf8_} {
+		result.position = length;
+		result.message = nullptr;
+	}
+
+protected:
+	bool Fail(const uint8_t *where, const char *message) noexcept {
+		result.position = where - begin;
+		result.message = message;
+		return false;
+	}
+
+	// keep invalid UTF-8 error found while scanning a name
+	bool FailName(const uint8_t *where, const char *message) noexcept {
+		return result.message == nullptr && Fail(where, message);
+	}
+
+	bool Continue() noexcept {
+		if (ptr >= nextCheck) {
+			nextCheck = ptr + checkInterval;
+			if (continueProc && !continueProc(param)) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool SkipSpace() noexcept {
+		const uint8_t * const start = ptr;
+		while (ptr < end && IsSpace(*ptr)) {
+			++ptr;
+		}
+		return ptr != start;
+	}
+
+	bool Match(const char *s, size_t length) const noexcept {
+		return static_cast<size_t>(end - ptr) >= length && memcmp(ptr, s, length) == 0;
+	}
+
+	// non-ASCII character
+	bool MultiByte() noexcept {
+		if (utf8) {
+			const size_t length = UTF8SequenceLength(ptr, end);
+			if (length == 0) {
+				return Fail(ptr, msgInvalidUTF8);
+			}
+			ptr += length;
+		} else {
+			++ptr;
+		}
+		return true;
+	}
+};
+
+class JSONChecker final : public WellFormedChecker {
+	bool String() noexcept;
+	bool Number() noexcept;
+	bool Scalar() noexcept;
+	bool Member() noexcept;
+public:
+	using WellFormedChecker::WellFormedChecker;
+	bool Check() noexcept;
+};
+
+bool JSONChecker::String() noexcept {
+	const uint8_t * const start = ptr;
+	++ptr;
+	while (true) {
+		ptr = SkipPlainText(ptr, end, '\"', '\\', '\"');
+		if (ptr == end) {
+			return Fail(start, "unterminated string");
+		}
+		const uint8_t ch = *ptr;
+		if (ch == '\"') {
+			++ptr;
+			return true;
+		}
+		if (ch == '\\') {
+			if (ptr + 1 == end) {
+				return Fail(start, "unterminated string");
+			}
+			const uint8_t escape = ptr[1];
+			if (escape == 'u') {
+				if (end - ptr < 6 || !(IsHexDigit(ptr[2]) && IsHexDigit(ptr[3]) && IsHexDigit(ptr[4]) && IsHexDigit(ptr[5]))) {
+					return Fail(ptr, "invalid \\u escape sequence");
+				}
+				ptr += 6;
+			} else if (escape == '\"' || escape == '\\' || escape == '/' || escape == 'b'
+				|| escape == 'f' || escape == 'n' || escape == 'r' || escape == 't') {
+				ptr += 2;
+			} else {
+				return Fail(ptr, "invalid escape sequence");
+			}
+		} else if (ch < ' ') {
+			return Fail(ptr, "control character in string");
+		} else if (!MultiByte()) {
+			return false;
+		}
+	}
+}
+
+bool JSONChecker::Number() noexcept {
+	if (*ptr == '-') {
+		++ptr;
+	}
+	if (ptr == end || !IsDigit(*ptr)) {
+		return Fail(ptr, "digit expected");
+	}
+	if (*ptr == '0') {
+		++ptr;
+	} else {
+		while (ptr < end && IsDigit(*ptr)) {
+			++ptr;
+		}
+	}
+	if (ptr < end && *ptr == '.') {
+		++ptr;
+		if (ptr == end || !IsDigit(*ptr)) {
+			return Fail(ptr, "digit expected");
+		}
+		while (ptr < end && IsDigit(*ptr)) {
+			++ptr;
+		}
+	}
+	if (ptr < end && (*ptr | 0x20) == 'e') {
+		++ptr;
+		if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+			++ptr;
+		}
+		if (ptr == end || !IsDigit(*ptr)) {
+			return Fail(ptr, "digit expected");
+		}
+		while (ptr < end && IsDigit(*ptr)) {
+			++ptr;
+		}
+	}
+	return true;
+}
+
+bool JSONChecker::Scalar() noexcept {
+	const uint8_t ch = *ptr;
+	if (ch == '\"') {
+		return String();
+	}
+	if (ch == '-' || IsDigit(ch)) {
+		return Number();
+	}
+	if (Match("true", 4) || Match("null", 4)) {
+		ptr += 4;
+		return true;
+	}
+	if (Match("false", 5)) {
+		ptr += 5;
+		return true;
+	}
+	return Fail(ptr, "value expected");
+}
+
+// object member name and colon
+bool JSONChecker::Member() noexcept {
+	if (ptr == end || *ptr != '\"') {
+		return Fail(ptr, "property name expected");
+	}
+	if (!String()) {
+		return false;
+	}
+	SkipSpace();
+	if (ptr == end || *ptr != ':') {
+		return Fail(ptr, "':' expected");
+	}
+	++ptr;
+	return true;
+}
+
+bool JSONChecker::Check() noexcept {
+	// '{' or '[' for each open container
+	NestingStack<uint8_t> stack;
+	bool expectValue = true;
+	while (Continue()) {
+		SkipSpace();
+		if (expectValue) {
+			if (ptr == end) {
+				return Fail(ptr, "value expected");
+			}
+			const uint8_t ch = *ptr;
+			if (ch == '{' || ch == '[') {
+				if (!stack.Push(ch)) {
+					return Fail(ptr, msgNoMemory);
+				}
+				++ptr;
+				SkipSpace();
+				if (ptr < end && *ptr == ch + 2) {
+					// empty object or array, '{' + 2 is '}', '[' + 2 is ']'
+					++ptr;
+					stack.Pop();
+					expectValue = false;
+				} else if (ch == '{' && !Member()) {
+					return false;
+				}
+				continue;
+			}
+			if (!Scalar()) {
+				return false;
+			}
+			expectValue = false;
+		} else {
+			if (stack.Empty()) {
+				return (ptr == end) || Fail(ptr, "unexpected character after value");
+			}
+			const uint8_t container = stack.Top();
+			if (ptr == end) {
+				return Fail(ptr, (container == '{') ? "',' or '}' expected" : "',' or ']' expected");
+			}
+			const uint8_t ch = *ptr;
+			if (ch == ',') {
+				++ptr;
+				if (container == '{') {
+					SkipSpace();
+					if (!Member()) {
+						return false;
+					}
+				}
+				expectValue = true;
+			} else if (ch == container + 2) {
+				++ptr;
+				stack.Pop();
+			} else {
+				return Fail(ptr, (container == '{') ? "',' or '}' expected" : "',' or ']' expected");
+			}
+		}
+	}
+	return false;
+}
+
+constexpr bool IsNameStart(uint8_t ch) noexcept {
+	return ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'z') || ch == '_' || ch == ':' || ch >= 0x80;
+}
+
+constexpr bool IsNameChar(uint8_t ch) noexcept {
+	return IsNameStart(ch) || IsDigit(ch) || ch == '-' || ch == '.';
+}
+
+constexpr bool IsXMLChar(uint32_t ch) noexcept {
+	return ch == '\t' || ch == '\n' || ch == '\r' || (ch >= 0x20 && ch <= 0xD7FF)
+		|| (ch >= 0xE000 && ch <= 0xFFFD) || (ch >= 0x10000 && ch <= 0x10FFFF);
+}
+
+struct XMLName {
+	const uint8_t *name;
+	size_t length;
+};
+
+class XMLChecker final : public WellFormedChecker {
+	bool hasDoctype = false;
+	size_t Name() noexcept;
+	bool Reference() noexcept;
+	bool CharData() noexcept;
+	bool AttributeValue(uint8_t quote) noexcept;
+	bool StartTag(XMLName &element, bool &emptyElement) noexcept;
+	bool EndTag(const XMLName &element) noexcept;
+	bool Comment() noexcept;
+	bool CData() noexcept;
+	bool ProcessingInstruction(bool declaration) noexcept;
+	bool Doctype() noexcept;
+	bool SkipUntil(const char *terminator, size_t length, const uint8_t *start, const char *message) noexcept;
+public:
+	using WellFormedChecker::WellFormedChecker;
+	bool Check() noexcept;
+};
+
+// length of name at current position, non-ASCII name characters are not checked against Unicode ranges.
+size_t XMLChecker::Name() noexcept {
+	const uint8_t * const start = ptr;
+	if (ptr < end && IsNameStart(*ptr)) {
+		do {
+			if (*ptr >= 0x80) {
+				if (!MultiByte()) {
+					return 0;
+				}
+			} else {
+				++ptr;
+			}
+		} while (ptr < end && IsNameChar(*ptr));
+	}
+	return ptr - start;
+}
+
+bool XMLChecker::Reference() noexcept {
+	const uint8_t * const start = ptr;
+	++ptr;
+	if (ptr < end && *ptr == '#') {
+		++ptr;
+		const bool hex = ptr < end && *ptr == 'x';
+		if (hex) {
+			++ptr;
+		}
+		const uint8_t * const digits = ptr;
+		uint32_t value = 0;
+		while (ptr < end && (hex ? IsHexDigit(*ptr) : IsDigit(*ptr))) {
+			const uint32_t digit = IsDigit(*ptr) ? *ptr - '0' : (*ptr | 0x20) - 'a' + 10;
+			value = (value > 0x10FFFF) ? value : value*(hex ? 16 : 10) + digit;
+			++ptr;
+		}
+		if (ptr == digits || ptr == end || *ptr != ';' || !IsXMLChar(value)) {
+			return Fail(start, "invalid character reference");
+		}
+	} else {
+		const uint8_t * const name = ptr;
+		const size_t length = Name();
+		if (length == 0) {
+			return FailName(start, "invalid entity reference");
+		}
+		if (ptr == end || *ptr != ';') {
+			return Fail(start, "';' expected after entity reference");
+		}
+		// without DTD only predefined entities can be referenced
+		if (!hasDoctype) {
+			const bool predefined = (length == 2 && (memcmp(name, "lt", 2) == 0 || memcmp(name, "gt", 2) == 0))
+				|| (length == 3 && memcmp(name, "amp", 3) == 0)
+				|| (length == 4 && (memcmp(name, "apos", 4) == 0 || memcmp(name, "quot", 4) == 0));
+			if (!predefined) {
+				return Fail(start, "undefined entity");
+			}
+		}
+	}
+	++ptr;
+	return true;
+}
+
+// text content until next markup
+bool XMLChecker::CharData() noexcept {
+	while (true) {
+		ptr = SkipPlainText(ptr, end, '<', '&', ']');
+		if (ptr == end) {
+			return true;
+		}
+		const uint8_t ch = *ptr;
+		if (ch == '<') {
+			return true;
+		}
+		if (ch == '&') {
+			if (!Reference()) {
+				return false;
+			}
+		} else if (ch == ']') {
+			if (Match("]]>", 3)) {
+				return Fail(ptr, "']]>' not allowed in text");
+			}
+			++ptr;
+		} else if (ch < ' ') {
+			if (!IsSpace(ch)) {
+				return Fail(ptr, "invalid character");
+			}
+			++ptr;
+		} else if (!MultiByte()) {
+			return false;
+		}
+	}
+}
+
+bool XMLChecker::AttributeValue(uint8_t quote) noexcept {
+	const uint8_t * const start = ptr;
+	++ptr;
+	while (true) {
+		ptr = SkipPlainText(ptr, end, quote, '<', '&');
+		if (ptr == end) {
+			return Fail(start, "unterminated attribute value");
+		}
+		const uint8_t ch = *ptr;
+		if (ch == quote) {
+			++ptr;
+			return true;
+		}
+		if (ch == '<') {
+			return Fail(ptr, "'<' not allowed in attribute value");
+		}
+		if (ch == '&') {
+			if (!Reference()) {
+				return false;
+			}
+		} else if (ch < ' ') {
+			if (!IsSpace(ch)) {
+				return Fail(ptr, "invalid character");
+			}
+			++ptr;
+		} else if (!MultiByte()) {
+			return false;
+		}
+	}
+}
+
+bool XMLChecker::StartTag(XMLName &element, bool &emptyElement) noexcept {
+	constexpr size_t maxCheckedAttributes = 32;
+	XMLName attributes[maxCheckedAttributes];
+	size_t attributeCount = 0;
+	const uint8_t * const start = ptr;
+	++ptr;
+	element.name = ptr;
+	element.length = Name();
+	if (element.length == 0) {
+		return FailName(ptr, "element name expected");
+	}
+	while (true) {
+		const bool space = SkipSpace();
+		if (ptr == end) {
+			return Fail(start, "unterminated start tag");
+		}
+		if (*ptr == '>') {
+			++ptr;
+			emptyElement = false;
+			return true;
+		}
+		if (*ptr == '/') {
+			if (ptr + 1 < end && ptr[1] == '>') {
+				ptr += 2;
+				emptyElement = true;
+				return true;
+			}
+			return Fail(ptr, "'>' expected");
+		}
+		if (!space) {
+			return Fail(ptr, "whitespace expected");
+		}
+		const uint8_t * const name = ptr;
+		const size_t length = Name();
+		if (length == 0) {
+			return FailName(ptr, "attribute name expected");
+		}
+		// unique attribute constraint, only checked for first few attributes
+		for (size_t index = 0; index < attributeCount; index++) {
+			if (attributes[index].length == length && memcmp(attributes[index].name, name, length) == 0) {
+				return Fail(name, "duplicate attribute");
+			}
+		}
+		if (attributeCount < maxCheckedAttributes) {
+			attributes[attributeCount++] = {name, length};
+		}
+		SkipSpace();
+		if (ptr == end || *ptr != '=') {
+			return Fail(ptr, "'=' expected");
+		}
+		++ptr;
+		SkipSpace();
+		if (ptr == end || (*ptr != '\"' && *ptr != '\'')) {
+			return Fail(ptr, "quoted attribute value expected");
+		}
+		if (!AttributeValue(*ptr)) {
+			return false;
+		}
+	}
+}
+
+bool XMLChecker::EndTag(const XMLName &element) noexcept {
+	const uint8_t * const start = ptr;
+	ptr += 2;
+	const uint8_t * const name = ptr;
+	const size_t length = Name();
+	if (length != element.length || memcmp(name, element.name, length) != 0) {
+		return FailName(start, "end tag does not match start tag");
+	}
+	SkipSpace();
+	if (ptr == end || *ptr != '>') {
+		return Fail(ptr, "'>' expected");
+	}
+	++ptr;
+	return true;
+}
+
+bool XMLChecker::SkipUntil(const char *terminator, size_t length, const uint8_t *start, const char *message) noexcept {
+	while (true) {
+		const uint8_t *found = static_cast<const uint8_t *>(memchr(ptr, terminator[0], end - ptr));
+		if (found == nullptr) {
+			ptr = end;
+			return Fail(start, message);
+		}
+		ptr = found;
+		if (Match(terminator, length)) {
+			ptr += length;
+			return true;
+		}
+		++ptr;
+	}
+}
+
+bool XMLChecker::Comment() noexcept {
+	const uint8_t * const start = ptr;
+	ptr += 4;
+	while (true) {
+		const uint8_t *found = static_cast<const uint8_t *>(memchr(ptr, '-', end - ptr));
+		if (found == nullptr) {
+			return Fail(start, "unterminated comment");
+		}
+		ptr = found;
+		if (Match("--", 2)) {
+			if (Match("-->", 3)) {
+				ptr += 3;
+				return true;
+			}
+			return Fail(ptr, "'--' not allowed in comment");
+		}
+		++ptr;
+	}
+}
+
+bool XMLChecker::CData() noexcept {
+	const uint8_t * const start = ptr;
+	ptr += 9;
+	return SkipUntil("]]>", 3, start, "unterminated CDATA section");
+}
+
+bool XMLChecker::ProcessingInstruction(bool declaration) noexcept {
+	const uint8_t * const start = ptr;
+	ptr += 2;
+	const uint8_t * const target = ptr;
+	const size_t length = Name();
+	if (length == 0) {
+		return FailName(ptr, "processing instruction target expected");
+	}
+	if (!declaration && length == 3 && (target[0] | 0x20) == 'x' && (target[1] | 0x20) == 'm' && (target[2] | 0x20) == 'l') {
+		return Fail(start, "XML declaration must be at start of document");
+	}
+	if (!Match("?>", 2) && !SkipSpace()) {
+		return Fail(ptr, "whitespace expected");
+	}
+	return SkipUntil("?>", 2, start, "unterminated processing instruction");
+}
+
+// skip document type declaration, internal subset is not checked.
+bool XMLChecker::Doctype() noexcept {
+	const uint8_t * const start = ptr;
+	ptr += 9;
+	int depth = 0;
+	while (ptr < end) {
+		const uint8_t ch = *ptr;
+		if (ch == '\"' || ch == '\'') {
+			const uint8_t *found = static_cast<const uint8_t *>(memchr(ptr + 1, ch, end - ptr - 1));
+			if (found == nullptr) {
+				break;
+			}
+			ptr = found + 1;
+		} else if (depth != 0 && Match("<!--", 4)) {
+			if (!Comment()) {
+				return false;
+			}
+		} else {
+			++ptr;
+			if (ch == '[') {
+				++depth;
+			} else if (ch == ']') {
+				--depth;
+			} else if (ch == '>' && depth == 0) {
+				hasDoctype = true;
+				return true;
+			}
+		}
+	}
+	return Fail(start, "unterminated document type declaration");
+}
+
+bool XMLChecker::Check() noexcept {
+	NestingStack<XMLName> stack;
+	bool seenRoot = false;
+	if (Match("<?xml", 5) && end - ptr > 5 && IsSpace(ptr[5])) {
+		if (!ProcessingInstruction(true)) {
+			return false;
+		}
+	}
+	while (Continue()) {
+		if (stack.Empty()) {
+			SkipSpace();
+			if (ptr == end) {
+				return seenRoot || Fail(ptr, "root element expected");
+			}
+			if (*ptr != '<') {
+				return Fail(ptr, "text not allowed outside root element");
+			}
+		} else {
+			if (!CharData()) {
+				return false;
+			}
+			if (ptr == end) {
+				return Fail(stack.Top().name - 1, "element is not closed");
+			}
+		}
+
+		// ptr is at '<'
+		const uint8_t ch = (ptr + 1 < end) ? ptr[1] : 0;
+		if (ch == '/') {
+			if (stack.Empty()) {
+				return Fail(ptr, "end tag without start tag");
+			}
+			if (!EndTag(stack.Top())) {
+				return false;
+			}
+			stack.Pop();
+		} else if (ch == '?') {
+			if (!ProcessingInstruction(false)) {
+				return false;
+			}
+		} else if (ch == '!') {
+			if (Match("<!--", 4)) {
+				if (!Comment()) {
+					return false;
+				}
+			} else if (Match("<![CDATA[", 9)) {
+				if (stack.Empty()) {
+					return Fail(ptr, "CDATA section not allowed outside root element");
+				}
+				if (!CData()) {
+					return false;
+				}
+			} else if (Match("<!DOCTYPE", 9)) {
+				if (seenRoot || hasDoctype) {
+					return Fail(ptr, "document type declaration not allowed here");
+				}
+				if (!Doctype()) {
+					return false;
+				}
+			} else {
+				return Fail(ptr, "invalid markup declaration");
+			}
+		} else {
+			if (stack.Empty() && seenRoot) {
+				return Fail(ptr, "only one root element is allowed");
+			}
+			XMLName element;
+			bool emptyElement = false;
+			if (!StartTag(element, emptyElement)) {
+				return false;
+			}
+			seenRoot = true;
+			if (!emptyElement && !stack.Push(element)) {
+				return Fail(element.name - 1, msgNoMemory);
+			}
+		}
+	}
+	return false;
+}
+
+}
+
+bool CheckJSONWellFormed(const char *text, size_t length, bool utf8, WellFormedResult &result, WellFormedContinueProc continueProc, void *param) noexcept {
+	JSONChecker checker(text, length, utf8, result, continueProc, param);
+	return checker.Check() || result.message != nullptr;
+}
+
+bool CheckXMLWellFormed(const char *text, size_t length, bool utf8, WellFormedResult &result, WellFormedContinueProc continueProc, void *param) noexcept {
+	XMLChecker checker(text, length, utf8, result, continueProc, param);
+	return checker.Check() || result.message != nullptr;
+}
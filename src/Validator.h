@@ -0,0 +1,18 @@
+// Well-formedness checking for JSON and XML
+#pragma once
+
+// The checker has no dependency on Windows or Scintilla, it only reads the text
+// passed in, so it can be run on a document snapshot in a background thread.
+
+struct WellFormedResult {
+	size_t position;		// byte offset of first error
+	const char *message;	// nullptr when text is well-formed
+};
+
+// called periodically, returns false to cancel checking.
+typedef bool (*WellFormedContinueProc)(void *param) noexcept;
+
+// RFC 8259 JSON text, returns false when cancelled.
+bool CheckJSONWellFormed(const char *text, size_t length, bool utf8, WellFormedResult &result, WellFormedContinueProc continueProc, void *param) noexcept;
+// XML 1.0 well-formedness, without validating against DTD, returns false when cancelled.
+bool CheckXMLWellFormed(const char *text, size_t length, bool utf8, WellFormedResult &result, WellFormedContinueProc continueProc, void *param) noexcept;
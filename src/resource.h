@@ -89,6 +89,7 @@
 #define IDC_RESETPOSITION				159
 #define IDC_USEMONOSPACEDFONT			160
 #define IDC_FINDALLBOOKMARK				161
+#define IDC_FINDSKIPCOMMENTSTRING		162
 // IDR_ACCFINDREPLACE
 #define IDACC_FIND						200
 #define IDACC_REPLACE					201
@@ -724,6 +725,7 @@
 #define IDM_EDIT_BASE64_HTML_EMBEDDED_IMAGE		40496
 #define IDM_EDIT_BASE64_DECODE					40497
 #define IDM_EDIT_BASE64_DECODE_AS_HEX			40498
+#define IDM_EDIT_CHECK_WELLFORMED				40499
 
 #define IDM_HELP_ABOUT					40500	// F1
 #define IDM_CMDLINE_HELP				40501
@@ -868,7 +870,6 @@
 #define IDS_ERR_CREATELINK				50004
 #define IDS_ERR_PREVWINDISABLED			50005
 #define IDS_SELRECT						50006
-#define IDS_BUFFERTOOSMALL				50007
 #define IDS_FIND_WRAPFW					50008
 #define IDS_FIND_WRAPRE					50009
 #define IDS_NOTFOUND					50010
@@ -908,6 +909,8 @@
 #define IDS_GOOGLE_SEARCH_URL			50044
 #define IDS_BING_SEARCH_URL				50045
 #define IDS_WIKI_SEARCH_URL				50046
+#define IDS_WELLFORMED_OK				50047
+#define IDS_WELLFORMED_ERROR			50048
 
 #define IDS_EOLMODENAME_CRLF			62000
 #define IDS_EOLMODENAME_LF				62001
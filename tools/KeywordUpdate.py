@@ -60,6 +60,7 @@ lexerList = [
 	('NP2LEX_LATEX', 'stlLaTeX.cpp', 'LexLaTeX.cxx', '', 0, None),
 	('NP2LEX_LISP', 'stlLisp.cpp', 'LexLisp.cxx', '', 0, None),
 	('NP2LEX_LLVM', 'stlLLVM.cpp', 'LexLLVM.cxx', 'LLVM.ll', 0, parse_llvm_api_file),
+	('NP2LEX_LOG', 'stlDefault.cpp', 'LexLog.cxx', '', (0, 'Log'), None),
 	('NP2LEX_LUA', 'stlLua.cpp', 'LexLua.cxx', 'Lua.lua', 0, parse_lua_api_file),
 
 	('NP2LEX_MAKEFILE', 'stlMake.cpp', 'LexMakefile.cxx', '', 0, None),
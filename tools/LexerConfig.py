@@ -668,6 +668,10 @@ LexerConfigMap = {
 		'extra_word_char': '-@%$',
 		'string_style_range': ['SCE_LLVM_STRING', 'SCE_LLVM_ESCAPECHAR'],
 	},
+	'NP2LEX_LOG': {
+		'escape_char_start': NoEscapeCharacter,
+		'plain_text_file': True,
+	},
 	'NP2LEX_LUA': {
 		'line_comment_string': '--',
 		'block_comment_string': ('--[[', '--]]'),